@@ -0,0 +1,158 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "avcpp/av.h"
+#include "avcpp/ffmpeg.h"
+#include "avcpp/codec.h"
+#include "avcpp/packet.h"
+#include "avcpp/avutils.h"
+
+// API2
+#include "avcpp/format.h"
+#include "avcpp/formatcontext.h"
+#include "avcpp/codec.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/videorescaler.h"
+#include "avcpp/abrtranscoder.h"
+
+using namespace std;
+using namespace av;
+
+//
+// Decode input video once and encode it into several heights: out-<height>.<ext> for every height given.
+//
+// Usage: api2-abr-transcode input ext height [height ...]
+//
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+        return 1;
+
+    av::init();
+    av::setFFmpegLoggingLevel(AV_LOG_INFO);
+
+    string uri {argv[1]};
+    string ext {argv[2]};
+
+    error_code ec;
+
+    //
+    // INPUT
+    //
+    FormatContext ictx;
+    ssize_t      videoStream = -1;
+    VideoDecoderContext vdec;
+    Stream      vst;
+
+    ictx.openInput(uri, ec);
+    if (ec) {
+        cerr << "Can't open input\n";
+        return 1;
+    }
+
+    ictx.findStreamInfo();
+
+    for (size_t i = 0; i < ictx.streamsCount(); ++i) {
+        auto st = ictx.stream(i);
+        if (st.mediaType() == AVMEDIA_TYPE_VIDEO) {
+            videoStream = i;
+            vst = st;
+            break;
+        }
+    }
+
+    if (vst.isNull()) {
+        cerr << "Video stream not found\n";
+        return 1;
+    }
+
+    vdec = VideoDecoderContext(vst);
+    vdec.setRefCountedFrames(true);
+
+    vdec.open(Codec(), ec);
+    if (ec) {
+        cerr << "Can't open codec\n";
+        return 1;
+    }
+
+    //
+    // OUTPUTS
+    //
+    AbrTranscoder::Options options;
+    options.gopSize = 48;
+    options.memoryLimit = 128 * 1024 * 1024;
+
+    AbrTranscoder abr{ictx, vdec, int(videoStream), options};
+
+    struct Output
+    {
+        FormatContext       octx;
+        VideoEncoderContext encoder;
+        VideoRescaler       rescaler;
+    };
+    vector<unique_ptr<Output>> outputs;
+
+    for (int i = 3; i < argc; ++i) {
+        auto const height = atoi(argv[i]) & ~1;
+        auto const width  = int(int64_t(vdec.width()) * height / vdec.height()) & ~1;
+        string out = "out-" + to_string(height) + "." + ext;
+
+        auto output = make_unique<Output>();
+
+        OutputFormat ofrmt;
+        ofrmt.setFormat(string(), out);
+        output->octx.setFormat(ofrmt);
+
+        output->encoder = VideoEncoderContext{findEncodingCodec(ofrmt)};
+        output->encoder.setWidth(width);
+        output->encoder.setHeight(height);
+        if (vdec.pixelFormat() > -1)
+            output->encoder.setPixelFormat(vdec.pixelFormat());
+        output->encoder.setTimeBase(Rational{1, 1000});
+        output->encoder.setBitRate(vdec.bitRate() * height / vdec.height());
+        // I frames are forced by the transcoder on the same positions in all renditions
+        output->encoder.setGopSize(int(options.gopSize));
+
+        output->encoder.open(Codec(), ec);
+        if (ec) {
+            cerr << "Can't open encoder for " << out << "\n";
+            return 1;
+        }
+
+        output->rescaler = VideoRescaler{width, height, output->encoder.pixelFormat()};
+
+        Stream ost = output->octx.addStream(output->encoder);
+        ost.setFrameRate(vst.frameRate());
+
+        output->octx.openOutput(out, ec);
+        if (ec) {
+            cerr << "Can't open output " << out << "\n";
+            return 1;
+        }
+        output->octx.writeHeader();
+
+        abr.addRendition(output->rescaler, output->encoder, output->octx);
+        outputs.push_back(std::move(output));
+    }
+
+    //
+    // PROCESS
+    //
+    abr.transcode(ec);
+    if (ec) {
+        cerr << "Transcoding error: " << ec << ", " << ec.message() << endl;
+        return 1;
+    }
+
+    for (auto &output : outputs)
+        output->octx.writeTrailer();
+
+    auto const &stats = abr.stats();
+    clog << "Decoded frames: " << stats.framesDecoded
+         << ", forced I frames: " << stats.keyFramesForced
+         << ", peak frames memory: " << stats.peakMemory / 1024 << " KiB"
+         << ", memory waits: " << stats.memoryWaits << '\n';
+    for (size_t i = 0; i < stats.packetsWritten.size(); ++i)
+        clog << "  rendition " << i << ": " << stats.packetsWritten[i] << " packets\n";
+}
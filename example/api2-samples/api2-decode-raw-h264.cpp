@@ -1,6 +1,6 @@
 #include <cstdio>
 #include <iostream>
-#include <filesystem>
+#include <span>
 
 #include "avcpp/av.h"
 #include "avcpp/ffmpeg.h"
@@ -13,6 +13,7 @@
 // API2
 #include "avcpp/codec.h"
 #include "avcpp/codeccontext.h"
+#include "avcpp/codecparser.h"
 
 using namespace std;
 using namespace av;
@@ -116,42 +117,23 @@ int main(int argc, char **argv)
             }
         }
 
-        // Load a whole raw H.264 bitstream file into memory. Assumed AnnexB format:
+        // Raw H.264 bitstream in the AnnexB format:
         //  ([start code] NALU) | ( [start code] NALU) | ...
-        auto const fsize = std::filesystem::file_size(uri);
-        std::vector<uint8_t> data(fsize);
-        std::fread(data.data(), 1, data.size(), in);
-
-        // Start code:
-        //   0x00 0x00 0x00 0x01
-        // or
-        //   0x00 0x00 0x01
-        // Select shortest and check previous
-        const uint8_t startCode[3] = {0x00, 0x00, 0x01};
-
-        auto start = data.begin();
-        while (true) {
-            // Look for a start code pattern in the bitstream
-            auto it = std::search(start, data.end(), std::begin(startCode), std::end(startCode));
-
-            auto const finish = (it == data.begin() || *(it - 1) != 0x00) ? it : it - 1;
-
-            if (start != data.begin())
-                start -= 1;
-
-            // FFmpeg expects, that start code present in the AVPacket
-            auto const ptr = std::to_address(start);
-            auto const size = size_t(finish - start);
-
-            start = it + 1;
-
-            clog << "  Data: " << (void *)ptr << ", size: " << size << endl;
+        //
+        // Split it into the packets with codec parser. Data can be provided by chunks of any size, like it
+        // happens with sockets or pipes. Packets that fully lay inside chunk reference it without copy.
+        CodecParser parser{AV_CODEC_ID_H264};
 
-            // Wrap into av::Packet
-            Packet pkt {ptr, size, Packet::wrap_data_static {}};
+        auto decode = [&](Packet &pkt) {
+            clog << "  Data: " << (void *)pkt.data() << ", size: " << pkt.size() << ", key: " << pkt.isKeyPacket() << endl;
 
             // ...and decode it into frame
-            auto frame = vdec.decode(pkt, ec);
+            error_code decodeEc;
+            auto frame = vdec.decode(pkt, decodeEc);
+            if (decodeEc) {
+                cerr << "Decoding error: " << decodeEc << ", " << decodeEc.message() << endl;
+                return;
+            }
 
             // For valid Timestamp some NALU processing is needed to extract extra data
             auto ts = frame.pts();
@@ -162,11 +144,19 @@ int main(int argc, char **argv)
 
             if (frame)
                 ++counter;
+        };
 
-            if (it == data.end())
-                break;
+        std::vector<uint8_t> chunk(4096);
+        while (auto const size = std::fread(chunk.data(), 1, chunk.size(), in)) {
+            parser.parseAll(std::span<const uint8_t>{chunk.data(), size}, decode, ec);
+            if (ec) {
+                cerr << "Parsing error: " << ec << ", " << ec.message() << endl;
+                return 1;
+            }
         }
 
+        parser.flushAll(decode);
+
         clog << "Flush frames:\n";
         while (true) {
             VideoFrame frame = vdec.decode(Packet(), ec);
@@ -0,0 +1,161 @@
+#include <iostream>
+
+#include "avcpp/av.h"
+#include "avcpp/ffmpeg.h"
+#include "avcpp/codec.h"
+#include "avcpp/packet.h"
+#include "avcpp/avutils.h"
+
+// API2
+#include "avcpp/format.h"
+#include "avcpp/formatcontext.h"
+#include "avcpp/codec.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/videorescaler.h"
+#include "avcpp/audioresampler.h"
+#include "avcpp/dualstreamtranscoder.h"
+
+using namespace std;
+using namespace av;
+
+//
+// Transcode first video and first audio streams of the input at once. Codecs are the defaults of the output format.
+//
+// Usage: api2-dual-stream-transcode input output
+//
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+        return 1;
+
+    av::init();
+    av::setFFmpegLoggingLevel(AV_LOG_INFO);
+
+    string uri {argv[1]};
+    string out {argv[2]};
+
+    error_code ec;
+
+    //
+    // INPUT
+    //
+    FormatContext ictx;
+    int          videoStream = -1;
+    int          audioStream = -1;
+    Stream       vst;
+    Stream       ast;
+
+    ictx.openInput(uri, ec);
+    if (ec) {
+        cerr << "Can't open input\n";
+        return 1;
+    }
+
+    ictx.findStreamInfo();
+
+    for (size_t i = 0; i < ictx.streamsCount(); ++i) {
+        auto st = ictx.stream(i);
+        if (st.mediaType() == AVMEDIA_TYPE_VIDEO && vst.isNull()) {
+            videoStream = int(i);
+            vst = st;
+        } else if (st.mediaType() == AVMEDIA_TYPE_AUDIO && ast.isNull()) {
+            audioStream = int(i);
+            ast = st;
+        }
+    }
+
+    if (vst.isNull() || ast.isNull()) {
+        cerr << "Video or audio stream not found\n";
+        return 1;
+    }
+
+    VideoDecoderContext vdec{vst};
+    vdec.setRefCountedFrames(true);
+    vdec.open(Codec(), ec);
+    if (ec) {
+        cerr << "Can't open video decoder\n";
+        return 1;
+    }
+
+    AudioDecoderContext adec{ast};
+    adec.open(Codec(), ec);
+    if (ec) {
+        cerr << "Can't open audio decoder\n";
+        return 1;
+    }
+
+    //
+    // OUTPUT
+    //
+    OutputFormat  ofmt;
+    FormatContext octx;
+
+    ofmt.setFormat(string(), out);
+    octx.setFormat(ofmt);
+
+    VideoEncoderContext venc{findEncodingCodec(ofmt, true)};
+    venc.setWidth(vdec.width());
+    venc.setHeight(vdec.height());
+    if (vdec.pixelFormat() > -1)
+        venc.setPixelFormat(vdec.pixelFormat());
+    venc.setTimeBase(Rational{1, 1000});
+    venc.setBitRate(vdec.bitRate());
+    venc.open(Codec(), ec);
+    if (ec) {
+        cerr << "Can't open video encoder\n";
+        return 1;
+    }
+
+    Codec acodec = findEncodingCodec(ofmt, false);
+    AudioEncoderContext aenc{acodec};
+    aenc.setSampleRate(48000);
+    aenc.setSampleFormat(acodec.supportedSampleFormats()[0]);
+    aenc.setChannelLayout(AV_CH_LAYOUT_STEREO);
+    aenc.setTimeBase(Rational(1, aenc.sampleRate()));
+    aenc.setBitRate(adec.bitRate());
+    aenc.open(ec);
+    if (ec) {
+        cerr << "Can't open audio encoder\n";
+        return 1;
+    }
+
+    Stream vost = octx.addStream(venc);
+    vost.setFrameRate(vst.frameRate());
+    octx.addStream(aenc);
+
+    octx.openOutput(out, ec);
+    if (ec) {
+        cerr << "Can't open output\n";
+        return 1;
+    }
+    octx.writeHeader();
+
+    //
+    // CONVERTERS
+    //
+    VideoRescaler  rescaler{venc.width(), venc.height(), venc.pixelFormat()};
+    AudioResampler resampler(aenc.channelLayout(), aenc.sampleRate(), aenc.sampleFormat(),
+                             adec.channelLayout(), adec.sampleRate(), adec.sampleFormat());
+
+    //
+    // PROCESS
+    //
+    DualStreamTranscoder transcoder{ictx, octx};
+    transcoder.setVideo(videoStream, vdec, venc, 0, &rescaler);
+    transcoder.setAudio(audioStream, adec, aenc, 1, &resampler);
+
+    transcoder.transcode(ec);
+    if (ec) {
+        cerr << "Transcoding error: " << ec << ", " << ec.message() << endl;
+        return 1;
+    }
+
+    octx.writeTrailer();
+
+    auto const &stats = transcoder.stats();
+    clog << "Video: " << stats.videoFrames << " frames / " << stats.videoPackets << " packets"
+         << ", audio: " << stats.audioFrames << " frames / " << stats.audioPackets << " packets"
+         << ", interleaved: " << stats.muxer.packetsWritten
+         << ", forced: " << stats.muxer.forcedWrites
+         << ", max queued: " << stats.muxer.maxQueued << '\n';
+}
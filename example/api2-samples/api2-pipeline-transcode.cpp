@@ -0,0 +1,145 @@
+#include <iostream>
+#include <chrono>
+
+#include "avcpp/av.h"
+#include "avcpp/ffmpeg.h"
+#include "avcpp/codec.h"
+#include "avcpp/packet.h"
+#include "avcpp/avutils.h"
+
+// API2
+#include "avcpp/format.h"
+#include "avcpp/formatcontext.h"
+#include "avcpp/codec.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/pipeline.h"
+
+using namespace std;
+using namespace av;
+
+//
+// Same as api2-decode-encode-video, but demuxing, decoding, encoding and muxing are run on own threads and overlap.
+//
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+        return 1;
+
+    av::init();
+    av::setFFmpegLoggingLevel(AV_LOG_INFO);
+
+    string uri {argv[1]};
+    string out {argv[2]};
+
+    error_code ec;
+
+    //
+    // INPUT
+    //
+    FormatContext ictx;
+    ssize_t      videoStream = -1;
+    VideoDecoderContext vdec;
+    Stream      vst;
+
+    ictx.openInput(uri, ec);
+    if (ec) {
+        cerr << "Can't open input\n";
+        return 1;
+    }
+
+    ictx.findStreamInfo();
+
+    for (size_t i = 0; i < ictx.streamsCount(); ++i) {
+        auto st = ictx.stream(i);
+        if (st.mediaType() == AVMEDIA_TYPE_VIDEO) {
+            videoStream = i;
+            vst = st;
+            break;
+        }
+    }
+
+    if (vst.isNull()) {
+        cerr << "Video stream not found\n";
+        return 1;
+    }
+
+    vdec = VideoDecoderContext(vst);
+    vdec.setRefCountedFrames(true);
+
+    vdec.open(Codec(), ec);
+    if (ec) {
+        cerr << "Can't open codec\n";
+        return 1;
+    }
+
+    //
+    // OUTPUT
+    //
+    OutputFormat  ofrmt;
+    FormatContext octx;
+
+    ofrmt.setFormat(string(), out);
+    octx.setFormat(ofrmt);
+
+    Codec               ocodec  = findEncodingCodec(ofrmt);
+    VideoEncoderContext encoder {ocodec};
+
+    encoder.setWidth(vdec.width());
+    encoder.setHeight(vdec.height());
+    if (vdec.pixelFormat() > -1)
+        encoder.setPixelFormat(vdec.pixelFormat());
+    encoder.setTimeBase(Rational{1, 1000});
+    encoder.setBitRate(vdec.bitRate());
+
+    encoder.open(Codec(), ec);
+    if (ec) {
+        cerr << "Can't opent encodec\n";
+        return 1;
+    }
+
+    Stream ost = octx.addStream(encoder);
+    ost.setFrameRate(vst.frameRate());
+
+    octx.openOutput(out, ec);
+    if (ec) {
+        cerr << "Can't open output\n";
+        return 1;
+    }
+
+    octx.dump();
+    octx.writeHeader();
+    octx.flush();
+
+    //
+    // PROCESS
+    //
+    Pipeline pl{16};
+
+    auto packets = pl.source<Packet>(pipeline::demux(ictx));
+    auto frames  = pl.stage<VideoFrame>(packets, pipeline::decode(vdec, int(videoStream)));
+
+    // Frame time base adjustment, as in the single-threaded sample
+    auto prepared = pl.stage<VideoFrame>(frames, [&encoder](VideoFrame &&frame, const PipelineEmitter<VideoFrame> &emit) {
+        frame.setTimeBase(encoder.timeBase());
+        frame.setStreamIndex(0);
+        frame.setPictureType();
+        emit(std::move(frame));
+    });
+
+    auto encoded = pl.stage<Packet>(prepared, pipeline::encode(encoder));
+    pl.sink(encoded, pipeline::mux(octx, 0));
+
+    auto const start = chrono::steady_clock::now();
+
+    pl.run();
+    pl.wait(ec);
+    if (ec) {
+        cerr << "Transcoding error: " << ec << ", " << ec.message() << endl;
+        return 1;
+    }
+
+    auto const elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+    clog << "Transcoded in " << elapsed.count() << " ms\n";
+
+    octx.writeTrailer();
+}
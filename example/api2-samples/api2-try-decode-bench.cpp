@@ -0,0 +1,203 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+
+#include "avcpp/avconfig.h"
+
+#include "avcpp/av.h"
+#include "avcpp/ffmpeg.h"
+#include "avcpp/codec.h"
+#include "avcpp/packet.h"
+#include "avcpp/avutils.h"
+
+// API2
+#include "avcpp/format.h"
+#include "avcpp/formatcontext.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/syntheticmedia.h"
+
+using namespace std;
+using namespace av;
+
+//
+// Compares demux+decode loops of the same input:
+//  - throws:     default OptionalErrorCode, exceptions are thrown on the error paths
+//  - error_code: std::error_code is filled on every call
+//  - result:     tryReadPacket()/tryDecode(), EAGAIN/EOF are the plain Result states
+//
+// Input "synthetic" is generated in memory: 720p MPEG-4, 10 seconds, scene cut every 5 seconds.
+//
+
+namespace {
+
+struct Input
+{
+    MemoryIO            io; // synthetic input, must outlive ictx
+    FormatContext       ictx;
+    VideoDecoderContext vdec;
+    int                 videoStream = -1;
+};
+
+bool open_input(Input &in, const string &uri, const vector<uint8_t> &synthetic)
+{
+    error_code ec;
+    if (synthetic.empty()) {
+        in.ictx.openInput(uri, ec);
+    } else {
+        in.io = MemoryIO{synthetic};
+        in.ictx.openInput(&in.io, ec);
+    }
+    if (ec) {
+        cerr << "Can't open input: " << ec.message() << endl;
+        return false;
+    }
+    in.ictx.findStreamInfo(ec);
+    if (ec) {
+        cerr << "Can't find streams: " << ec.message() << endl;
+        return false;
+    }
+
+    for (auto&& st : in.ictx.streams()) {
+        if (st.mediaType() == AVMEDIA_TYPE_VIDEO) {
+            in.videoStream = st.index();
+            in.vdec = VideoDecoderContext(st);
+            in.vdec.open({{"threads", "1"}}, Codec(), ec);
+            if (ec) {
+                cerr << "Can't open codec: " << ec.message() << endl;
+                return false;
+            }
+            return true;
+        }
+    }
+
+    cerr << "Video stream not found\n";
+    return false;
+}
+
+size_t decode_throws(Input &in)
+{
+    size_t frames = 0;
+    try {
+        while (Packet pkt = in.ictx.readPacket()) {
+            if (pkt.streamIndex() != in.videoStream)
+                continue;
+            if (in.vdec.decode(pkt))
+                ++frames;
+        }
+        while (in.vdec.decode(Packet()))
+            ++frames;
+    } catch (const av::Exception &e) {
+        cerr << "Error: " << e.what() << endl;
+    }
+    return frames;
+}
+
+size_t decode_error_code(Input &in)
+{
+    size_t frames = 0;
+    error_code ec;
+    while (Packet pkt = in.ictx.readPacket(ec)) {
+        if (ec)
+            break;
+        if (pkt.streamIndex() != in.videoStream)
+            continue;
+        if (in.vdec.decode(pkt, ec))
+            ++frames;
+        if (ec)
+            break;
+    }
+    while (in.vdec.decode(Packet(), ec))
+        ++frames;
+    if (ec)
+        cerr << "Error: " << ec.message() << endl;
+    return frames;
+}
+
+size_t decode_result(Input &in)
+{
+    size_t frames = 0;
+    while (true) {
+        auto pkt = in.ictx.tryReadPacket();
+        if (pkt.isEof())
+            break;
+        if (!pkt) {
+            cerr << "Read error: " << pkt.error().message() << endl;
+            return frames;
+        }
+        if (pkt->streamIndex() != in.videoStream)
+            continue;
+
+        auto frame = in.vdec.tryDecode(*pkt);
+        for (; frame; frame = in.vdec.tryDecode())
+            ++frames;
+        if (frame.isError()) {
+            cerr << "Decode error: " << frame.error().message() << endl;
+            return frames;
+        }
+    }
+
+    auto frame = in.vdec.tryDecode(Packet());
+    for (; frame; frame = in.vdec.tryDecode())
+        ++frames;
+    return frames;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <input|synthetic> [passes]\n";
+        return 1;
+    }
+
+    av::init();
+    av::setFFmpegLoggingLevel(AV_LOG_ERROR);
+
+    string uri {argv[1]};
+    int passes = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+
+    vector<uint8_t> synthetic;
+    if (uri == "synthetic") {
+        SyntheticMedia::Options options;
+        options.hasAudio          = false;
+        options.duration          = chrono::seconds(10);
+        options.video.width       = 1280;
+        options.video.height      = 720;
+        options.video.sceneLength = 125;
+        options.videoBitRate      = 4'000'000;
+
+        error_code ec;
+        synthetic = SyntheticMedia::generate(options, ec);
+        if (ec) {
+            cerr << "Can't generate input: " << ec.message() << endl;
+            return 1;
+        }
+    }
+
+    const pair<const char*, function<size_t(Input&)>> modes[] = {
+        {"throws",     decode_throws},
+        {"error_code", decode_error_code},
+        {"result",     decode_result},
+    };
+
+    for (auto const &[name, proc] : modes) {
+        chrono::nanoseconds best = chrono::nanoseconds::max();
+        size_t frames = 0;
+        for (int pass = 0; pass < passes; ++pass) {
+            Input in;
+            if (!open_input(in, uri, synthetic))
+                return 1;
+
+            auto const start = chrono::steady_clock::now();
+            frames = proc(in);
+            best = std::min(best, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start));
+        }
+
+        auto const ms = chrono::duration<double, milli>(best).count();
+        cout << name << ": " << frames << " frames, " << ms << " ms, "
+             << (frames ? ms * 1000.0 / double(frames) : 0.0) << " us/frame (best of " << passes << ")" << endl;
+    }
+}
@@ -0,0 +1,162 @@
+#include "abrtranscoder.h"
+
+#if AVCPP_HAS_AVFORMAT
+
+#include <algorithm>
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+// Decoded frame shared by the renditions. Ticket returns frame size to the budget when the last rendition drops it.
+struct SharedFrame
+{
+    VideoFrame            frame;
+    std::shared_ptr<void> ticket;
+};
+
+} // anonymous namespace
+
+AbrTranscoder::AbrTranscoder(FormatContext &input, VideoDecoderContext &decoder, int streamIndex)
+    : AbrTranscoder(input, decoder, streamIndex, Options{})
+{
+}
+
+AbrTranscoder::AbrTranscoder(FormatContext &input, VideoDecoderContext &decoder, int streamIndex, const Options &options)
+    : m_input(input),
+      m_decoder(decoder),
+      m_streamIndex(streamIndex),
+      m_options(options)
+{
+}
+
+size_t AbrTranscoder::addRendition(VideoRescaler &rescaler, VideoEncoderContext &encoder, FormatContext &output, int outputStream)
+{
+    m_renditions.push_back({&rescaler, &encoder, &output, outputStream});
+    return m_renditions.size() - 1;
+}
+
+void AbrTranscoder::transcode(OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (m_renditions.empty()) {
+        throws_if(ec, Errors::InvalidArgument);
+        return;
+    }
+
+    m_stats = Stats{};
+    m_stats.packetsWritten.assign(m_renditions.size(), 0);
+
+    auto budget = m_options.memoryBudget ? m_options.memoryBudget : make_shared<MemoryBudget>(m_options.memoryLimit);
+    auto const budgetStats = budget->stats();
+    auto cancelled = make_shared<atomic_bool>(false);
+    Pipeline pl{m_options.queueCapacity};
+
+    auto packets = pl.source<Packet>(pipeline::demux(m_input));
+    auto decoded = pl.stage<VideoFrame>(packets, pipeline::decode(m_decoder, m_streamIndex));
+
+    // GOP alignment and memory accounting
+    auto const gopSize = m_options.gopSize;
+    auto frames = pl.stage<SharedFrame>(decoded,
+        [this, budget, cancelled, gopSize, index = uint64_t(0)](VideoFrame &&frame, const PipelineEmitter<SharedFrame> &emit) mutable {
+            // Source picture types must not leak into encoders: they force I frames on their own positions
+            auto const forceKey = gopSize && index % gopSize == 0;
+            frame.setPictureType(forceKey ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE);
+            if (forceKey)
+                ++m_stats.keyFramesForced;
+            ++m_stats.framesDecoded;
+            ++index;
+
+            auto const bytes = MemoryBudget::payloadBytes(frame);
+            if (!budget->acquire(bytes, cancelled.get()))
+                throw PipelineCancelled{};
+
+            SharedFrame item;
+            item.ticket = std::shared_ptr<void>(nullptr, [budget, bytes](void*) { budget->release(bytes); });
+            item.frame  = std::move(frame);
+            emit(std::move(item));
+        });
+
+    // Waiting on the budget is interrupted by the pipeline cancel
+    frames->addProducerListener([budget, cancelled, queue = frames.get()] {
+        if (queue->isCancelled()) {
+            cancelled->store(true, memory_order_release);
+            budget->wakeWaiters();
+        }
+    });
+
+    auto branches = pl.broadcast(frames, m_renditions.size());
+
+    for (size_t i = 0; i < m_renditions.size(); ++i) {
+        auto const &rendition = m_renditions[i];
+
+        auto scaled = pl.stage<VideoFrame>(branches[i],
+            [&rendition](SharedFrame &&in, const PipelineEmitter<VideoFrame> &emit) {
+                VideoFrame out;
+                {
+                    // Drop the shared frame before waiting on the encoder
+                    auto item = std::move(in);
+                    out = rendition.rescaler->rescale(item.frame);
+                    out.setTimeBase(item.frame.timeBase());
+                    out.setPictureType(item.frame.pictureType());
+                }
+                out.setTimeBase(rendition.encoder->timeBase());
+                out.setStreamIndex(rendition.stream);
+                emit(std::move(out));
+            });
+
+        auto encoded = pl.stage<Packet>(scaled, pipeline::encode(*rendition.encoder));
+
+        pl.sink(encoded, [&rendition, &count = m_stats.packetsWritten[i]](Packet &&pkt) {
+            pkt.setStreamIndex(rendition.stream);
+            rendition.output->writePacket(pkt);
+            ++count;
+        });
+    }
+
+    {
+        lock_guard lock{m_mutex};
+        if (m_cancelled) {
+            m_cancelled = false;
+            return;
+        }
+        pl.run(ec);
+        if (ec && *ec)
+            return;
+        m_pipeline = &pl;
+    }
+
+    auto const detach = [this] {
+        lock_guard lock{m_mutex};
+        m_pipeline  = nullptr;
+        m_cancelled = false;
+    };
+
+    try {
+        pl.wait(ec);
+    } catch (...) {
+        detach();
+        throw;
+    }
+    detach();
+
+    auto const stats = budget->stats();
+    m_stats.peakMemory  = stats.peak;
+    m_stats.memoryWaits = stats.waits - budgetStats.waits;
+    m_stats.memoryStall = stats.stallTime - budgetStats.stallTime;
+}
+
+void AbrTranscoder::cancel()
+{
+    lock_guard lock{m_mutex};
+    m_cancelled = true;
+    if (m_pipeline)
+        m_pipeline->cancel();
+}
+
+} // namespace av
+
+#endif // if AVCPP_HAS_AVFORMAT
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "avcompat.h"
+
+#if AVCPP_HAS_AVFORMAT
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "pipeline.h"
+
+namespace av {
+
+/**
+ * @brief The AbrTranscoder class
+ *
+ * Adaptive bitrate ladder: single video stream is decoded once and encoded into several renditions in parallel,
+ * each one is written into own output context.
+ *
+ * - Decoded frames are shared by all renditions by reference and released as soon as the slowest rendition
+ *   rescales them. Payload of the decoded frames in flight is limited by Options::memoryLimit (or shared
+ *   Options::memoryBudget): decoding waits while it is exceeded.
+ * - Every Options::gopSize frame is forced to be I frame in all renditions, so segments are switchable at the same
+ *   positions. Open encoders with gop size not less than gopSize and without scene cut detection (e.g.
+ *   "sc_threshold=0" and "forced-idr=1" for libx264).
+ *
+ * Objects are referenced, not copied, and must outlive transcode(). Encoders must be opened and output headers
+ * written before transcode(), trailers - after it.
+ *
+ * @code
+ * AbrTranscoder abr{ictx, vdec, videoStream};
+ * abr.addRendition(scaler720, enc720, octx720);
+ * abr.addRendition(scaler360, enc360, octx360);
+ * abr.transcode();
+ * @endcode
+ */
+class AbrTranscoder : public noncopyable
+{
+public:
+    struct Options
+    {
+        size_t gopSize       = 48;                ///< frames between forced I frames, 0 - keep encoders decision
+        size_t memoryLimit   = 256 * 1024 * 1024; ///< bytes of decoded frames in flight, 0 - unlimited
+        size_t queueCapacity = 8;                 ///< capacity of the queues between stages
+
+        /// Budget shared with other jobs, used instead of memoryLimit. Decoder always waits on it, whatever policy.
+        std::shared_ptr<MemoryBudget> memoryBudget;
+    };
+
+    /**
+     * Counters of the last transcode() call
+     */
+    struct Stats
+    {
+        uint64_t                 framesDecoded   = 0;
+        uint64_t                 keyFramesForced = 0;
+        size_t                   peakMemory      = 0; ///< max bytes of the budget: decoded frames in flight
+        uint64_t                 memoryWaits     = 0; ///< decoder waits on the memory limit
+        std::chrono::nanoseconds memoryStall{0};      ///< time decoder waited on the memory limit
+        std::vector<uint64_t>    packetsWritten;      ///< per rendition
+    };
+
+    /**
+     * @param streamIndex  input stream to transcode, packets of other streams are ignored
+     */
+    AbrTranscoder(FormatContext &input, VideoDecoderContext &decoder, int streamIndex);
+    AbrTranscoder(FormatContext &input, VideoDecoderContext &decoder, int streamIndex, const Options &options);
+
+    /**
+     * Add rendition. Rescaler destination size and pixel format must match encoder ones.
+     *
+     * @param outputStream  stream index in the output context
+     * @return rendition index
+     */
+    size_t addRendition(VideoRescaler &rescaler, VideoEncoderContext &encoder, FormatContext &output, int outputStream = 0);
+
+    size_t renditionsCount() const noexcept { return m_renditions.size(); }
+
+    const Options& options() const noexcept { return m_options; }
+
+    /**
+     * Transcode till the input EOF, encoders are flushed at the end. Blocks caller: stages are run on own threads.
+     */
+    void transcode(OptionalErrorCode ec = throws());
+
+    /**
+     * Stop transcode() from other thread
+     */
+    void cancel();
+
+    /**
+     * Valid after transcode() returns
+     */
+    const Stats& stats() const noexcept { return m_stats; }
+
+private:
+    struct Rendition
+    {
+        VideoRescaler       *rescaler;
+        VideoEncoderContext *encoder;
+        FormatContext       *output;
+        int                  stream;
+    };
+
+    FormatContext          &m_input;
+    VideoDecoderContext    &m_decoder;
+    int                     m_streamIndex;
+    Options                 m_options;
+    std::vector<Rendition>  m_renditions;
+    Stats                   m_stats;
+
+    std::mutex              m_mutex;
+    Pipeline               *m_pipeline = nullptr;
+    bool                    m_cancelled = false;
+};
+
+} // namespace av
+
+#endif // if AVCPP_HAS_AVFORMAT
@@ -2,6 +2,7 @@
 
 #include "audioresampler.h"
 #include "avlog.h"
+#include "instrumentation.h"
 
 using namespace std;
 
@@ -40,6 +41,7 @@ AudioResampler::AudioResampler(uint64_t dstChannelsLayout, int dstRate, SampleFo
 
 AudioResampler::~AudioResampler()
 {
+    AVCPP_INSTRUMENT_FORGET(this);
     if (m_raw)
     {
         swr_free(&m_raw);
@@ -145,6 +147,7 @@ SampleFormat AudioResampler::srcSampleFormat() const
 bool AudioResampler::pop(AudioSamples &dst, bool getall, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_INSTRUMENT("resample_pop", this, nullptr);
 
     if (!m_raw) {
         fflog(AV_LOG_ERROR, "SwrContext does not inited\n");
@@ -187,6 +190,7 @@ bool AudioResampler::pop(AudioSamples &dst, bool getall, OptionalErrorCode ec)
     }
     dst.setPts(m_nextPts);
     m_nextPts = dst.pts() + Timestamp{dst.samplesCount(), dst.timeBase()};
+    AVCPP_INSTRUMENT_BYTES(dst.size());
 
     //result = swr_get_delay(m_raw, m_dstRate);
     //clog << "  delay [pop]: " << result << endl;
@@ -199,11 +203,34 @@ AudioSamples AudioResampler::pop(size_t samplesCount, OptionalErrorCode ec)
 {
     clear_if(ec);
 
+    AudioSamples dst{nullptr};
+    auto st = popCommon(samplesCount, dst);
+    if (get<1>(st)) {
+        throws_if(ec, get<0>(st), *get<1>(st));
+        return AudioSamples(nullptr);
+    }
+    return get<0>(st) ? AudioSamples::null() : std::move(dst);
+}
+
+Result<AudioSamples> AudioResampler::tryPop(size_t samplesCount)
+{
+    AudioSamples dst{nullptr};
+    auto st = popCommon(samplesCount, dst);
+    if (get<1>(st))
+        return make_result_status<AudioSamples>(get<0>(st), *get<1>(st));
+    if (get<0>(st))
+        return make_result_status<AudioSamples>(get<0>(st));
+    return Result<AudioSamples>(std::move(dst));
+}
+
+std::pair<int, const error_category *> AudioResampler::popCommon(size_t samplesCount, AudioSamples &dst)
+{
+    AVCPP_INSTRUMENT("resample_pop", this, nullptr);
+
     if (!m_raw)
     {
         fflog(AV_LOG_ERROR, "SwrContext does not inited\n");
-        throws_if(ec, Errors::ResamplerNotInited);
-        return AudioSamples(nullptr);
+        return {static_cast<int>(Errors::ResamplerNotInited), &avcpp_category()};
     }
 
     auto delay = swr_get_delay(m_raw, m_dstRate);
@@ -211,24 +238,22 @@ AudioSamples AudioResampler::pop(size_t samplesCount, OptionalErrorCode ec)
     // Need more data
     if (size_t(delay) < samplesCount + m_filterSize / 2 && samplesCount)
     {
-        return AudioSamples(nullptr);
+        return {AVERROR(EAGAIN), nullptr};
     }
 
     if (!samplesCount)
         samplesCount = size_t(delay); // Request all samples
 
-    AudioSamples dst(dstSampleFormat(), int(samplesCount), dstChannelLayout(), dstSampleRate());
+    dst = AudioSamples(dstSampleFormat(), int(samplesCount), dstChannelLayout(), dstSampleRate());
     if (!dst.isValid())
     {
-        throws_if(ec, Errors::CantAllocateFrame);
-        return AudioSamples(nullptr);
+        return {static_cast<int>(Errors::CantAllocateFrame), &avcpp_category()};
     }
 
     auto sts = swr_convert_frame(m_raw, dst.raw(), nullptr);
     if (sts < 0)
     {
-        throws_if(ec, sts, ffmpeg_category());
-        return AudioSamples(nullptr);
+        return {sts, &ffmpeg_category()};
     }
 
     dst.setTimeBase(Rational(1, m_dstRate));
@@ -241,17 +266,41 @@ AudioSamples AudioResampler::pop(size_t samplesCount, OptionalErrorCode ec)
     }
     dst.setPts(m_nextPts);
     m_nextPts = dst.pts() + Timestamp(dst.samplesCount(), dst.timeBase());
+    AVCPP_INSTRUMENT_BYTES(dst.size());
+
+    // Fully flushed
+    if (!dst.samplesCount())
+        return {AVERROR_EOF, nullptr};
 
-    return dst.samplesCount() ? std::move(dst) : AudioSamples::null();
+    return {0, nullptr};
 }
 
 void AudioResampler::push(const AudioSamples &src, OptionalErrorCode ec)
 {
+    clear_if(ec);
+
+    auto st = pushCommon(src);
+    if (get<1>(st))
+        throws_if(ec, get<0>(st), *get<1>(st));
+}
+
+Result<void> AudioResampler::tryPush(const AudioSamples &src)
+{
+    auto st = pushCommon(src);
+    if (get<1>(st))
+        return make_result_status<void>(get<0>(st), *get<1>(st));
+    return {};
+}
+
+std::pair<int, const error_category *> AudioResampler::pushCommon(const AudioSamples &src)
+{
+    AVCPP_INSTRUMENT("resample_push", this, nullptr);
+    AVCPP_INSTRUMENT_BYTES(src.size());
+
     if (!m_raw)
     {
         fflog(AV_LOG_ERROR, "SwrContext does not inited\n");
-        throws_if(ec, Errors::ResamplerNotInited);
-        return;
+        return {static_cast<int>(Errors::ResamplerNotInited), &avcpp_category()};
     }
 
     // Null samples is allowed
@@ -262,8 +311,7 @@ void AudioResampler::push(const AudioSamples &src, OptionalErrorCode ec)
             src.channelsCount() != srcChannels() ||
             src.channelsLayout() != srcChannelLayout())
         {
-            throws_if(ec, Errors::ResamplerInputChanges);
-            return;
+            return {static_cast<int>(Errors::ResamplerInputChanges), &avcpp_category()};
         }
     }
 
@@ -271,8 +319,7 @@ void AudioResampler::push(const AudioSamples &src, OptionalErrorCode ec)
     if (sts < 0)
     {
         fflog(AV_LOG_DEBUG, "Src is null: %d, payload: %p\n", src.isNull(), src.data());
-        throws_if(ec, sts, ffmpeg_category());
-        return;
+        return {sts, &ffmpeg_category()};
     }
 
     // TODO: need protection if we still work in scheme: One Resampler Per Channel
@@ -285,6 +332,8 @@ void AudioResampler::push(const AudioSamples &src, OptionalErrorCode ec)
 
     //auto result = swr_get_delay(m_raw, m_dstRate);
     //clog << "  delay [push]: " << result << endl;
+
+    return {0, nullptr};
 }
 
 
@@ -8,6 +8,7 @@
 #include "avutils.h"
 #include "sampleformat.h"
 #include "averror.h"
+#include "result.h"
 
 namespace av {
 
@@ -89,6 +90,19 @@ public:
      */
     AudioSamples pop(size_t samplesCount, OptionalErrorCode ec = throws());
 
+    /**
+     * @brief Non-throwing push()
+     */
+    Result<void> tryPush(const AudioSamples &src);
+
+    /**
+     * @brief Non-throwing pop()
+     *
+     * @param[in] samplesCount  samples count to extract. If zero (0) - extract all delayed (buffered) samples.
+     * @return resampled samples; Again if less than @p samplesCount samples avail; Eof if resampler fully flushed
+     */
+    Result<AudioSamples> tryPop(size_t samplesCount);
+
     bool isValid() const;
     operator bool() const { return isValid(); }
 
@@ -116,6 +130,9 @@ private:
               uint64_t srcChannelsLayout, int srcRate, SampleFormat srcFormat,
               AVDictionary **dict, OptionalErrorCode ec);
 
+    std::pair<int, const std::error_category*> pushCommon(const AudioSamples &src);
+    std::pair<int, const std::error_category*> popCommon(size_t samplesCount, AudioSamples &dst);
+
 private:
     // Cached values to avoid access to the av_opt
     uint64_t       m_dstChannelsLayout;
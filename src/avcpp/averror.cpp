@@ -61,6 +61,16 @@ std::string AvcppCategory::message(int ev) const
         case Errors::IncorrectBufferSinkMediaType: return "Incorrect frame media type provided for BufferSink filter";
         case Errors::MixBufferSinkAccess: return "Mix getFrame() and getSamples() calls on BufferSink";
         case Errors::BufferReadonly: return "AVBufferRef is readonly but write access requested";
+        case Errors::BsfNotFound: return "Bitstream filter not found";
+        case Errors::BsfNotInited: return "Bitstream filter context not inited";
+        case Errors::BsfAlreadyInited: return "Bitstream filter context already inited, configuration is not allowed";
+        case Errors::ParserNotFound: return "Codec parser not found for the given codec";
+        case Errors::PacketTableInvalid: return "Invalid or unsupported packet table file";
+        case Errors::ChunkExtradataMismatch: return "Chunk encoders produced different extradata";
+        case Errors::ChunkTimestampConflict: return "Chunk DTS can't follow the previous chunk without exceeding PTS";
+        case Errors::ChunkUnhandledException: return "Unhandled exception in the chunk encoding or in the packet sink";
+        case Errors::CodecOutputPending: return "Codec does not accept input until pending output is received";
+        case Errors::CodecFlushUnsupported: return "Codec does not support flushing of the buffers";
     }
 
     return "Uknown AvCpp error";
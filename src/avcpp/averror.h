@@ -60,6 +60,21 @@ enum class Errors
     IncorrectBufferSinkFilter,
     IncorrectBufferSinkMediaType,
     MixBufferSinkAccess,
+
+    BsfNotFound,
+    BsfNotInited,
+    BsfAlreadyInited,
+
+    ParserNotFound,
+
+    PacketTableInvalid,
+
+    ChunkExtradataMismatch,
+    ChunkTimestampConflict,
+    ChunkUnhandledException,
+
+    CodecOutputPending,
+    CodecFlushUnsupported,
 };
 
 class OptionalErrorCode
@@ -0,0 +1,463 @@
+#include "avcompat.h"
+#include "avlog.h"
+#include "dictionary.h"
+
+#include "bitstreamfilter.h"
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+bool is_again_or_eof(int sts) noexcept
+{
+    return sts == AVERROR(EAGAIN) || sts == AVERROR_EOF;
+}
+
+} // anonymous namespace
+
+//
+// BitStreamFilter
+//
+
+BitStreamFilter::BitStreamFilter(const AVBitStreamFilter *ptr)
+    : FFWrapperPtr<const AVBitStreamFilter>(ptr)
+{
+}
+
+BitStreamFilter::BitStreamFilter(const std::string &name)
+{
+    setFilter(name);
+}
+
+BitStreamFilter::BitStreamFilter(const char *name)
+{
+    setFilter(name);
+}
+
+bool BitStreamFilter::setFilter(const std::string &name)
+{
+    return setFilter(name.c_str());
+}
+
+bool BitStreamFilter::setFilter(const char *name)
+{
+    m_raw = name ? av_bsf_get_by_name(name) : nullptr;
+    return m_raw;
+}
+
+std::string BitStreamFilter::name() const
+{
+    return RAW_GET(name, string());
+}
+
+std::vector<AVCodecID> BitStreamFilter::codecIds() const
+{
+    vector<AVCodecID> ids;
+    if (!m_raw || !m_raw->codec_ids)
+        return ids;
+    for (auto id = m_raw->codec_ids; *id != AV_CODEC_ID_NONE; ++id)
+        ids.push_back(*id);
+    return ids;
+}
+
+bool BitStreamFilter::supportsCodec(AVCodecID id) const noexcept
+{
+    if (!m_raw)
+        return false;
+    if (!m_raw->codec_ids)
+        return true;
+    for (auto cur = m_raw->codec_ids; *cur != AV_CODEC_ID_NONE; ++cur) {
+        if (*cur == id)
+            return true;
+    }
+    return false;
+}
+
+BitStreamFilter::operator bool() const
+{
+    return !isNull();
+}
+
+BitStreamFilter findBitStreamFilter(const std::string &name)
+{
+    return BitStreamFilter(name);
+}
+
+std::vector<BitStreamFilter> bitStreamFilters()
+{
+    vector<BitStreamFilter> filters;
+    void *opaque = nullptr;
+    while (auto bsf = av_bsf_iterate(&opaque))
+        filters.emplace_back(bsf);
+    return filters;
+}
+
+//
+// BitStreamFilterContext
+//
+
+BitStreamFilterContext::BitStreamFilterContext(const BitStreamFilter &filter, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!filter) {
+        throws_if(ec, Errors::BsfNotFound);
+        return;
+    }
+
+    auto sts = av_bsf_alloc(filter.raw(), &m_raw);
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return;
+    }
+}
+
+BitStreamFilterContext::BitStreamFilterContext(const std::string &name, OptionalErrorCode ec)
+    : BitStreamFilterContext(BitStreamFilter(name), ec)
+{
+}
+
+BitStreamFilterContext::~BitStreamFilterContext()
+{
+    av_bsf_free(&m_raw);
+}
+
+BitStreamFilterContext::BitStreamFilterContext(BitStreamFilterContext &&other)
+{
+    swap(other);
+}
+
+BitStreamFilterContext &BitStreamFilterContext::operator=(BitStreamFilterContext &&rhs)
+{
+    if (this == &rhs)
+        return *this;
+    BitStreamFilterContext(std::move(rhs)).swap(*this);
+    return *this;
+}
+
+void BitStreamFilterContext::swap(BitStreamFilterContext &other) noexcept
+{
+    using std::swap;
+    swap(m_raw,           other.m_raw);
+    swap(m_inputTimeBase, other.m_inputTimeBase);
+    swap(m_inited,        other.m_inited);
+    swap(m_initPending,   other.m_initPending);
+}
+
+BitStreamFilterContext BitStreamFilterContext::chain(const std::string &description, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    BitStreamFilterContext ctx;
+    auto sts = av_bsf_list_parse_str(description.c_str(), &ctx.m_raw);
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return BitStreamFilterContext();
+    }
+    return ctx;
+}
+
+BitStreamFilterContext BitStreamFilterContext::chain(const std::vector<std::string> &filters, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    AVBSFList *list = av_bsf_list_alloc();
+    if (!list) {
+        throws_if(ec, AVERROR(ENOMEM), ffmpeg_category());
+        return BitStreamFilterContext();
+    }
+
+    ScopeOutAction onReturn([&list]() {
+        av_bsf_list_free(&list);
+    });
+
+    for (auto const &name : filters) {
+        auto sts = av_bsf_list_append2(list, name.c_str(), nullptr);
+        if (sts < 0) {
+            throws_if(ec, sts, ffmpeg_category());
+            return BitStreamFilterContext();
+        }
+    }
+
+    BitStreamFilterContext ctx;
+    auto sts = av_bsf_list_finalize(&list, &ctx.m_raw);
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return BitStreamFilterContext();
+    }
+    return ctx;
+}
+
+BitStreamFilter BitStreamFilterContext::filter() const
+{
+    return BitStreamFilter(RAW_GET(filter, nullptr));
+}
+
+void BitStreamFilterContext::setInputParameters(const CodecParametersView &par, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return;
+    }
+    if (m_inited) {
+        throws_if(ec, Errors::BsfAlreadyInited);
+        return;
+    }
+    if (!par.isValid()) {
+        throws_if(ec, Errors::InvalidArgument);
+        return;
+    }
+
+    auto sts = avcodec_parameters_copy(m_raw->par_in, par.raw());
+    if (sts < 0)
+        throws_if(ec, sts, ffmpeg_category());
+}
+
+CodecParametersView BitStreamFilterContext::inputParameters() const
+{
+    return CodecParametersView(RAW_GET(par_in, nullptr));
+}
+
+CodecParametersView BitStreamFilterContext::outputParameters() const
+{
+    return CodecParametersView(RAW_GET(par_out, nullptr));
+}
+
+void BitStreamFilterContext::setInputTimeBase(const Rational &tb, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return;
+    }
+    if (m_inited) {
+        throws_if(ec, Errors::BsfAlreadyInited);
+        return;
+    }
+    m_raw->time_base_in = tb.getValue();
+    m_inputTimeBase = tb;
+}
+
+Rational BitStreamFilterContext::inputTimeBase() const
+{
+    return m_raw ? Rational(m_raw->time_base_in) : Rational();
+}
+
+Rational BitStreamFilterContext::outputTimeBase() const
+{
+    return m_raw ? Rational(m_raw->time_base_out) : Rational();
+}
+
+void BitStreamFilterContext::setOption(const std::string &name, const std::string &value, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return;
+    }
+    if (m_inited) {
+        throws_if(ec, Errors::BsfAlreadyInited);
+        return;
+    }
+    if (!m_raw->priv_data) {
+        throws_if(ec, AVERROR_OPTION_NOT_FOUND, ffmpeg_category());
+        return;
+    }
+
+    auto sts = av_opt_set(m_raw->priv_data, name.c_str(), value.c_str(), AV_OPT_SEARCH_CHILDREN);
+    if (sts < 0)
+        throws_if(ec, sts, ffmpeg_category());
+}
+
+void BitStreamFilterContext::setOptions(Dictionary &options, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return;
+    }
+    if (m_inited) {
+        throws_if(ec, Errors::BsfAlreadyInited);
+        return;
+    }
+    if (!m_raw->priv_data)
+        return;
+
+    auto dict = options.release();
+    auto sts = av_opt_set_dict2(m_raw->priv_data, &dict, AV_OPT_SEARCH_CHILDREN);
+    options.assign(dict);
+    if (sts < 0)
+        throws_if(ec, sts, ffmpeg_category());
+}
+
+void BitStreamFilterContext::init(OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return;
+    }
+    if (m_inited) {
+        throws_if(ec, Errors::BsfAlreadyInited);
+        return;
+    }
+
+    // Time base is taken from the first packet: av_bsf_init() derives time_base_out from time_base_in, so it
+    // is deferred until then
+    if (m_inputTimeBase == Rational()) {
+        m_inited      = true;
+        m_initPending = true;
+        return;
+    }
+
+    auto sts = av_bsf_init(m_raw);
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return;
+    }
+    m_inited = true;
+}
+
+void BitStreamFilterContext::finishInit(OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_initPending)
+        return;
+
+    auto sts = av_bsf_init(m_raw);
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return;
+    }
+    m_initPending = false;
+}
+
+bool BitStreamFilterContext::isInited() const noexcept
+{
+    return m_inited;
+}
+
+void BitStreamFilterContext::sendPacket(Packet &packet, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return;
+    }
+    if (!m_inited) {
+        throws_if(ec, Errors::BsfNotInited);
+        return;
+    }
+
+    if (packet.isNull()) {
+        sendEof(ec);
+        return;
+    }
+
+    // Time base was not provided during configuration: take it from the first packet
+    if (m_initPending) {
+        m_raw->time_base_in = packet.timeBase().getValue();
+        m_inputTimeBase     = packet.timeBase();
+        finishInit(ec);
+        if (is_error(ec))
+            return;
+    } else if (m_inputTimeBase != Rational()) {
+        packet.setTimeBase(m_inputTimeBase);
+    }
+
+    // BSF requires reference-counted input, non-ref-counted payload is copied by FFmpeg in that case
+    auto sts = av_bsf_send_packet(m_raw, packet.raw());
+    if (sts < 0) {
+        if (sts == AVERROR(EAGAIN)) {
+            if (ec)
+                *ec = make_ffmpeg_error(sts);
+        } else {
+            throws_if(ec, sts, ffmpeg_category());
+        }
+        return;
+    }
+
+    // On success FFmpeg takes reference and blanks the AVPacket
+    packet.reset();
+}
+
+void BitStreamFilterContext::sendEof(OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return;
+    }
+    if (!m_inited) {
+        throws_if(ec, Errors::BsfNotInited);
+        return;
+    }
+
+    // Nothing was sent: time base stays unknown
+    finishInit(ec);
+    if (is_error(ec))
+        return;
+
+    auto sts = av_bsf_send_packet(m_raw, nullptr);
+    if (sts < 0 && sts != AVERROR_EOF)
+        throws_if(ec, sts, ffmpeg_category());
+}
+
+bool BitStreamFilterContext::receivePacket(Packet &packet, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return false;
+    }
+    if (!m_inited) {
+        throws_if(ec, Errors::BsfNotInited);
+        return false;
+    }
+
+    packet.reset();
+
+    if (m_initPending) {
+        if (ec)
+            *ec = make_ffmpeg_error(AVERROR(EAGAIN));
+        return false;
+    }
+
+    auto sts = av_bsf_receive_packet(m_raw, packet.raw());
+    if (sts < 0) {
+        if (is_again_or_eof(sts)) {
+            if (ec)
+                *ec = make_ffmpeg_error(sts);
+        } else {
+            throws_if(ec, sts, ffmpeg_category());
+        }
+        return false;
+    }
+
+    packet.setTimeBase(m_raw->time_base_out);
+    packet.setComplete(true);
+    return true;
+}
+
+void BitStreamFilterContext::flush() noexcept
+{
+    if (m_raw && !m_initPending)
+        av_bsf_flush(m_raw);
+}
+
+void BitStreamFilterContext::finishDrain(const std::error_code &sts, OptionalErrorCode ec)
+{
+    if (sts && !(sts.category() == ffmpeg_category() && is_again_or_eof(sts.value()))) {
+        throws_if(ec, sts.value(), sts.category());
+        return;
+    }
+    if (ec)
+        *ec = sts;
+}
+
+} // namespace av
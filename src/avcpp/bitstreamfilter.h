@@ -0,0 +1,237 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include "ffmpeg.h"
+#include "avutils.h"
+#include "averror.h"
+#include "rational.h"
+#include "packet.h"
+#include "codecparameters.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#if __has_include(<libavcodec/bsf.h>)
+#include <libavcodec/bsf.h>
+#endif
+}
+
+namespace av {
+
+class Dictionary;
+
+/**
+ * @brief The BitStreamFilter class
+ *
+ * Non-owning wrapper for the AVBitStreamFilter description: filter lookup by name and introspection.
+ */
+class BitStreamFilter : public FFWrapperPtr<const AVBitStreamFilter>
+{
+public:
+    using FFWrapperPtr<const AVBitStreamFilter>::FFWrapperPtr;
+
+    BitStreamFilter() = default;
+    BitStreamFilter(const AVBitStreamFilter *ptr);
+    explicit BitStreamFilter(const std::string &name);
+    explicit BitStreamFilter(const char *name);
+
+    bool setFilter(const std::string &name);
+    bool setFilter(const char *name);
+
+    std::string name() const;
+
+    /**
+     * List of the codecs supported by the filter. Empty list means that filter accepts any codec.
+     */
+    std::vector<AVCodecID> codecIds() const;
+
+    /**
+     * Check that filter accepts given codec
+     */
+    bool supportsCodec(AVCodecID id) const noexcept;
+
+    operator bool() const;
+};
+
+/**
+ * Find bitstream filter by name. Returns null filter if nothing found.
+ */
+BitStreamFilter findBitStreamFilter(const std::string &name);
+
+/**
+ * Enumerate all registered bitstream filters
+ */
+std::vector<BitStreamFilter> bitStreamFilters();
+
+
+/**
+ * @brief The BitStreamFilterContext class
+ *
+ * Owning wrapper for AVBSFContext. Context must be configured (input codec parameters, input time base,
+ * filter options) and inited via init() before any packets processing.
+ *
+ * Processing follows send/receive pattern:
+ * @code
+ * bsf.sendPacket(inPkt);
+ * while (bsf.receivePacket(outPkt, ec)) {
+ *     // use outPkt
+ * }
+ * // ec holds EAGAIN here: new input required
+ * @endcode
+ *
+ * Chain of the filters can be created via BitStreamFilterContext::chain(): all chained filters work as a single
+ * context.
+ */
+class BitStreamFilterContext : public FFWrapperPtr<AVBSFContext>, public noncopyable
+{
+public:
+    BitStreamFilterContext() = default;
+    explicit BitStreamFilterContext(const BitStreamFilter &filter, OptionalErrorCode ec = throws());
+    explicit BitStreamFilterContext(const std::string &name, OptionalErrorCode ec = throws());
+
+    ~BitStreamFilterContext();
+
+    BitStreamFilterContext(BitStreamFilterContext &&other);
+    BitStreamFilterContext& operator=(BitStreamFilterContext &&rhs);
+
+    void swap(BitStreamFilterContext &other) noexcept;
+
+    /**
+     * Create filter chain from the textual description, like: "h264_mp4toannexb,dump_extra=freq=keyframe".
+     * Filters are separated by ',', options are separated from filter name by '=' and delimited by ':'.
+     *
+     * Empty description creates pass-through ("null") filter.
+     */
+    static BitStreamFilterContext chain(const std::string &description, OptionalErrorCode ec = throws());
+
+    /**
+     * Create filter chain from the list of filters with default options.
+     */
+    static BitStreamFilterContext chain(const std::vector<std::string> &filters, OptionalErrorCode ec = throws());
+
+    BitStreamFilter filter() const;
+
+    /**
+     * Input codec parameters. Must be set before init().
+     */
+    void setInputParameters(const CodecParametersView &par, OptionalErrorCode ec = throws());
+    CodecParametersView inputParameters() const;
+
+    /**
+     * Output codec parameters. Valid after init() or, when the input time base is not set, after the first
+     * sent packet. Can be used to configure output stream, for example to get extradata produced by the filter.
+     */
+    CodecParametersView outputParameters() const;
+
+    /**
+     * Input time base. Must be set before init(). If omited, time base of the first sent packet is used for
+     * timestamps conversion: filter is actually initialized by the first sendPacket() (or sendEof()) then, so
+     * the output time base is derived from it.
+     */
+    void setInputTimeBase(const Rational &tb, OptionalErrorCode ec = throws());
+    Rational inputTimeBase() const;
+
+    /**
+     * Output time base, valid after init() or, when the input time base is not set, after the first sent packet.
+     */
+    Rational outputTimeBase() const;
+
+    /**
+     * Set filter private option. Must be called before init(). Not applicable for chains.
+     */
+    void setOption(const std::string &name, const std::string &value, OptionalErrorCode ec = throws());
+    void setOptions(Dictionary &options, OptionalErrorCode ec = throws());
+
+    void init(OptionalErrorCode ec = throws());
+    bool isInited() const noexcept;
+
+    /**
+     * Send packet to the filter. Reference to the packet payload is moved into filter, so no data copy is
+     * happens and packet becomes empty on success. Pass null packet (Packet(nullptr) or empty one) to signal end
+     * of stream.
+     *
+     * If filter can't accept new input, ec holds EAGAIN and packet is not touched: receivePacket() must be called
+     * before.
+     *
+     * @param packet  packet to filter, stays empty on success
+     * @param ec      error code
+     */
+    void sendPacket(Packet &packet, OptionalErrorCode ec = throws());
+
+    /**
+     * Signal end of stream: filter flushes all buffered data and returns EOF from the receivePacket() after.
+     */
+    void sendEof(OptionalErrorCode ec = throws());
+
+    /**
+     * Receive filtered packet. Packet payload is referenced, not copied.
+     *
+     * @param packet  output packet. Any content is released before receiving.
+     * @param ec      EAGAIN if more input required, EOF if filter is drained. Neither of them throws.
+     * @return true if packet received
+     */
+    bool receivePacket(Packet &packet, OptionalErrorCode ec = throws());
+
+    /**
+     * Helper: send packet and pass all filtered packets into the callback. Callback signature:
+     * `void(Packet &pkt)` or `void(Packet &pkt, OptionalErrorCode ec)`. Packet can be moved out from the callback.
+     *
+     * @return count of the output packets
+     */
+    template<typename Callable>
+    size_t filter(Packet &packet, Callable &&callable, OptionalErrorCode ec = throws())
+    {
+        clear_if(ec);
+        if (packet.isNull() || packet.size() == 0)
+            sendEof(ec);
+        else
+            sendPacket(packet, ec);
+        if (is_error(ec))
+            return 0;
+        return drain(std::forward<Callable>(callable), ec);
+    }
+
+    /**
+     * Helper: receive all available packets and pass them into the callback.
+     *
+     * @return count of the output packets
+     */
+    template<typename Callable>
+    size_t drain(Callable &&callable, OptionalErrorCode ec = throws())
+    {
+        size_t count = 0;
+        Packet out;
+        std::error_code sts;
+        while (receivePacket(out, sts)) {
+            ++count;
+            if constexpr (std::is_invocable_v<Callable, Packet&, OptionalErrorCode>) {
+                callable(out, ec);
+                if (is_error(ec))
+                    return count;
+            } else {
+                callable(out);
+            }
+        }
+
+        finishDrain(sts, ec);
+        return count;
+    }
+
+    /**
+     * Reset filter state, for example after seeking.
+     */
+    void flush() noexcept;
+
+private:
+    void finishDrain(const std::error_code &sts, OptionalErrorCode ec);
+    void finishInit(OptionalErrorCode ec);
+
+private:
+    Rational m_inputTimeBase;
+    bool     m_inited      = false;
+    bool     m_initPending = false; // av_bsf_init() waits for the time base of the first packet
+};
+
+} // namespace av
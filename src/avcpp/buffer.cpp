@@ -2,8 +2,12 @@
 
 #include "buffer.h"
 #include "avcpp/avutils.h"
+#include "avcpp/memoryaccounting.h"
+#include "avcpp/memorybudget.h"
 
 #include <cassert>
+#include <cstring>
+#include <new>
 #include <utility>
 
 namespace av {
@@ -119,6 +123,14 @@ std::span<uint8_t> BufferRefView::span(OptionalErrorCode ec)
 
 BufferRef::BufferRef(std::size_t size, bool keepUninit) noexcept
 {
+#if AVCPP_ENABLE_INSTRUMENTATION
+    if (MemoryAccounting::isEnabled()) {
+        m_raw = MemoryAccounting::allocateBuffer(size, MemoryKind::Buffer);
+        if (m_raw && !keepUninit)
+            memset(m_raw->data, 0, size);
+        return;
+    }
+#endif
     if (keepUninit) [[likely]]
         m_raw = av_buffer_alloc(size);
     else
@@ -247,4 +259,160 @@ BufferRef &av::BufferRef::operator=(BufferRef &&other) noexcept
     return *this;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+#if AVCPP_ENABLE_INSTRUMENTATION
+#if AVCPP_API_AVBUFFER_SIZE_T
+AVBufferRef* tracked_pool_alloc(void *opaque, size_t size)
+#else
+AVBufferRef* tracked_pool_alloc(void *opaque, int size)
+#endif
+{
+    auto const owner = static_cast<MemoryOwnerId>(reinterpret_cast<uintptr_t>(opaque));
+    return MemoryAccounting::allocateBuffer(size_t(size), MemoryKind::BufferPool, owner);
+}
+#endif
+
+// Opaque of the pool created with the budget: freed by FFmpeg after the last pooled buffer
+struct BudgetPool
+{
+    std::shared_ptr<MemoryBudget> budget;
+    bool                          tracked = false;
+    MemoryOwnerId                 owner   = 0;
+};
+
+// Pooled buffer charged to the budget: wraps the plain or tracked allocation
+struct BudgetBuffer
+{
+    AVBufferRef  *buf;
+    MemoryBudget *budget;
+};
+
+void budget_buffer_free(void *opaque, uint8_t */*data*/)
+{
+    auto entry = static_cast<BudgetBuffer*>(opaque);
+    entry->budget->release(size_t(entry->buf->size));
+    av_buffer_unref(&entry->buf);
+    delete entry;
+}
+
+#if AVCPP_API_AVBUFFER_SIZE_T
+AVBufferRef* budget_pool_alloc(void *opaque, size_t size)
+#else
+AVBufferRef* budget_pool_alloc(void *opaque, int size)
+#endif
+{
+    auto pool = static_cast<BudgetPool*>(opaque);
+    auto buf  = pool->tracked ? MemoryAccounting::allocateBuffer(size_t(size), MemoryKind::BufferPool, pool->owner)
+                              : av_buffer_alloc(size);
+    if (!buf)
+        return nullptr;
+
+    auto entry = new (std::nothrow) BudgetBuffer{buf, pool->budget.get()};
+    auto ref   = entry ? av_buffer_create(buf->data, buf->size, budget_buffer_free, entry, 0) : nullptr;
+    if (!ref) {
+        delete entry;
+        av_buffer_unref(&buf);
+        return nullptr;
+    }
+
+    // Called under the pool lock: waiting here would block the buffers returned to the pool
+    pool->budget->forceAcquire(size_t(size));
+    return ref;
+}
+
+void budget_pool_free(void *opaque)
+{
+    delete static_cast<BudgetPool*>(opaque);
+}
+
+} // anonymous namespace
+
+BufferPool::BufferPool(std::size_t size, OptionalErrorCode ec)
+{
+    clear_if(ec);
+#if AVCPP_ENABLE_INSTRUMENTATION
+    if (MemoryAccounting::isEnabled()) {
+        auto opaque = reinterpret_cast<void*>(uintptr_t(MemoryAccounting::currentOwner()));
+        m_raw = av_buffer_pool_init2(size, opaque, tracked_pool_alloc, nullptr);
+    } else
+#endif
+    {
+        m_raw = av_buffer_pool_init(size, nullptr);
+    }
+
+    if (!m_raw) {
+        throws_if(ec, AVERROR(ENOMEM), ffmpeg_category());
+        return;
+    }
+    m_size = size;
+}
+
+BufferPool::BufferPool(std::size_t size, std::shared_ptr<MemoryBudget> budget, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!budget) {
+        *this = BufferPool(size, ec);
+        return;
+    }
+
+    auto opaque = new (std::nothrow) BudgetPool{std::move(budget)};
+    if (opaque) {
+#if AVCPP_ENABLE_INSTRUMENTATION
+        opaque->tracked = MemoryAccounting::isEnabled();
+        opaque->owner   = MemoryAccounting::currentOwner();
+#endif
+        m_raw = av_buffer_pool_init2(size, opaque, budget_pool_alloc, budget_pool_free);
+        if (!m_raw)
+            delete opaque;
+    }
+
+    if (!m_raw) {
+        throws_if(ec, AVERROR(ENOMEM), ffmpeg_category());
+        return;
+    }
+    m_size = size;
+}
+
+BufferPool::BufferPool(BufferPool &&other) noexcept
+{
+    swap(other);
+}
+
+BufferPool::~BufferPool()
+{
+    // Memory is freed when the last buffer is returned
+    av_buffer_pool_uninit(&m_raw);
+}
+
+BufferPool &BufferPool::operator=(BufferPool &&other) noexcept
+{
+    if (this != std::addressof(other))
+        BufferPool(std::move(other)).swap(*this);
+    return *this;
+}
+
+BufferRef BufferPool::get(OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return {};
+    }
+
+    auto buf = BufferRef::wrap(av_buffer_pool_get(m_raw));
+    if (buf.isNull())
+        throws_if(ec, AVERROR(ENOMEM), ffmpeg_category());
+    return buf;
+}
+
+void BufferPool::swap(BufferPool &other) noexcept
+{
+    using std::swap;
+    swap(m_raw,  other.m_raw);
+    swap(m_size, other.m_size);
+}
+
 } // ::av
\ No newline at end of file
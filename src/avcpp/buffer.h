@@ -3,6 +3,8 @@
 #include "avcpp/averror.h"
 #include "ffmpeg.h"
 
+#include <memory>
+
 #if AVCPP_CXX_STANDARD >= 20
 #include <span>
 #endif // AVCPP_CXX_STANDARD >= 20
@@ -17,6 +19,7 @@ void null_deleter(void* /*opaque*/, uint8_t* /*data*/);
 } // ::buffer
 
 class BufferRef;
+class MemoryBudget;
 
 /**
  * Non-owning view for the nested AVBufferRef
@@ -294,4 +297,55 @@ public:
     void swap(BufferRef &other) noexcept;
 };
 
+
+/**
+ * @brief The BufferPool class
+ *
+ * Wrapper for the AVBufferPool: pool of the same size buffers that are reused instead of the allocation. Buffers
+ * returned by get() keep the pool memory alive, so the pool can be destroyed before them.
+ *
+ * With memory accounting enabled (see MemoryAccounting) at the pool creation, allocations are accounted as
+ * MemoryKind::BufferPool to the current thread owner.
+ *
+ * Pool created with the MemoryBudget charges it by the allocated buffers, till the pool is gone. Allocation never
+ * waits for the budget (see MemoryBudget), so get() does not block.
+ */
+class BufferPool : public FFWrapperPtr<AVBufferPool>
+{
+public:
+    /**
+     * Construct null pool
+     */
+    BufferPool() = default;
+
+    explicit BufferPool(std::size_t size, OptionalErrorCode ec = throws());
+    BufferPool(std::size_t size, std::shared_ptr<MemoryBudget> budget, OptionalErrorCode ec = throws());
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    BufferPool(BufferPool &&other) noexcept;
+    BufferPool& operator=(BufferPool &&other) noexcept;
+
+    ~BufferPool();
+
+    /**
+     * Get buffer from the pool or allocate new one
+     * @param ec
+     * @return
+     */
+    BufferRef get(OptionalErrorCode ec = throws());
+
+    /**
+     * Size of the pool buffers
+     * @return
+     */
+    std::size_t bufferSize() const noexcept { return m_size; }
+
+    void swap(BufferPool &other) noexcept;
+
+private:
+    std::size_t m_size = 0;
+};
+
 } // ::av
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "chunkedencoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+bool same_extradata(const AVCodecContext *lhs, const AVCodecContext *rhs) noexcept
+{
+    if (lhs->extradata_size != rhs->extradata_size)
+        return false;
+    return !lhs->extradata_size || memcmp(lhs->extradata, rhs->extradata, size_t(lhs->extradata_size)) == 0;
+}
+
+// Keeps the original error of the encoder or the sink
+std::error_code current_exception_code() noexcept
+{
+    try {
+        throw;
+    } catch (const std::system_error &e) {
+        return e.code();
+    } catch (const std::bad_alloc &) {
+        return make_error_code(errc::not_enough_memory);
+    } catch (...) {
+        return make_error_code(Errors::ChunkUnhandledException);
+    }
+}
+
+} // anonymous namespace
+
+ChunkedEncoder::ChunkedEncoder(JobScheduler &scheduler, const Codec &codec, Configure configure, PacketSink sink)
+    : ChunkedEncoder(scheduler, codec, std::move(configure), std::move(sink), Options{})
+{
+}
+
+ChunkedEncoder::ChunkedEncoder(JobScheduler &scheduler, const Codec &codec, Configure configure, PacketSink sink, const Options &options)
+    : m_scheduler(scheduler),
+      m_job(scheduler.createJob("chunked-encoder")),
+      m_codec(codec),
+      m_configure(std::move(configure)),
+      m_sink(std::move(sink)),
+      m_options(options),
+      m_reference(codec)
+{
+    m_options.encoderThreads = std::max(m_options.encoderThreads, 1);
+    m_options.minChunkFrames = std::max<size_t>(m_options.minChunkFrames, 1);
+    if (!m_options.parallelChunks)
+        m_options.parallelChunks = std::max<size_t>(1, m_scheduler.threadsCount() / size_t(m_options.encoderThreads));
+}
+
+ChunkedEncoder::~ChunkedEncoder()
+{
+    unique_lock lock{m_mutex};
+    m_cancelled = true;
+    m_cond.wait(lock, [this] { return m_running == 0; });
+}
+
+void ChunkedEncoder::open(OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (m_configure)
+        m_configure(m_reference);
+    JobScheduler::prepareCodecContext(m_reference, m_options.encoderThreads);
+    m_reference.open(m_codec, ec);
+}
+
+void ChunkedEncoder::push(const VideoFrame &frame, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (!isOpened()) {
+        throws_if(ec, Errors::CodecNotOpened);
+        return;
+    }
+
+    if (m_current) {
+        auto const size = m_current->frames.size();
+        if ((size >= m_options.minChunkFrames && frame.isKeyFrame()) ||
+            (m_options.maxChunkFrames && size >= m_options.maxChunkFrames))
+        {
+            submit(std::move(m_current));
+        }
+    }
+
+    if (raiseError(ec))
+        return;
+
+    if (!m_current) {
+        m_current = make_unique<Chunk>();
+        m_current->frames.reserve(m_options.maxChunkFrames ? m_options.maxChunkFrames : m_options.minChunkFrames);
+    }
+
+    m_current->frames.push_back(frame);
+    ++m_stats.frames;
+}
+
+void ChunkedEncoder::finish(OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (m_current)
+        submit(std::move(m_current));
+
+    {
+        unique_lock lock{m_mutex};
+        while (!m_chunks.empty() && !m_error) {
+            drain(lock);
+            if (m_chunks.empty() || m_error)
+                break;
+            m_cond.wait(lock, [this] { return m_chunks.front()->done; });
+        }
+    }
+
+    raiseError(ec);
+}
+
+void ChunkedEncoder::submit(std::unique_ptr<Chunk> chunk)
+{
+    unique_lock lock{m_mutex};
+
+    // Bounded memory: wait for the oldest chunk and emit it
+    while (m_chunks.size() >= m_options.parallelChunks && !m_error) {
+        m_cond.wait(lock, [this] { return m_chunks.front()->done; });
+        drain(lock);
+    }
+
+    if (m_error)
+        return;
+
+    auto &ref = *chunk;
+    m_chunks.push_back(std::move(chunk));
+    ++m_running;
+    ++m_stats.chunks;
+    lock.unlock();
+
+    m_scheduler.post(m_job, [this, &ref] {
+        encode(ref);
+
+        lock_guard lock{m_mutex};
+        ref.done = true;
+        --m_running;
+        m_cond.notify_all();
+    });
+}
+
+void ChunkedEncoder::encode(Chunk &chunk)
+{
+    auto &ec = chunk.error;
+    try {
+        VideoEncoderContext encoder{m_codec};
+        if (m_configure)
+            m_configure(encoder);
+        JobScheduler::prepareCodecContext(encoder, m_options.encoderThreads);
+        encoder.open(m_codec, ec);
+        if (ec)
+            return;
+
+        if (!same_extradata(encoder.raw(), m_reference.raw())) {
+            ec = make_error_code(Errors::ChunkExtradataMismatch);
+            return;
+        }
+
+        for (auto const &frame : chunk.frames) {
+            {
+                lock_guard lock{m_mutex};
+                if (m_cancelled)
+                    return;
+            }
+            auto pkt = encoder.encode(frame, ec);
+            if (ec)
+                return;
+            if (pkt)
+                chunk.packets.push_back(std::move(pkt));
+        }
+
+        while (true) {
+            auto pkt = encoder.encode(ec);
+            if (ec)
+                return;
+            if (!pkt)
+                break;
+            chunk.packets.push_back(std::move(pkt));
+        }
+    } catch (...) {
+        ec = current_exception_code();
+    }
+
+    // Frames are not needed anymore
+    chunk.frames.clear();
+    chunk.frames.shrink_to_fit();
+}
+
+void ChunkedEncoder::drain(std::unique_lock<std::mutex> &lock)
+{
+    while (!m_chunks.empty() && m_chunks.front()->done && !m_error) {
+        auto chunk = std::move(m_chunks.front());
+        m_chunks.pop_front();
+
+        if (chunk->error) {
+            m_error = chunk->error;
+            m_cancelled = true;
+            break;
+        }
+
+        // Sink is called without lock: workers are not blocked by the output
+        lock.unlock();
+        std::error_code error;
+        try {
+            emit(*chunk, error);
+        } catch (...) {
+            error = current_exception_code();
+        }
+        lock.lock();
+
+        if (error) {
+            m_error = error;
+            m_cancelled = true;
+        }
+    }
+}
+
+void ChunkedEncoder::emit(Chunk &chunk, std::error_code &error)
+{
+    // Encoder delay of the chunk can move its first DTS below the last DTS of the previous one. The whole chunk is
+    // shifted by one offset: DTS order inside the chunk is kept, and the offset must not move any DTS past its PTS
+    // (B-frames have DTS close to PTS).
+    int64_t shift = 0;
+    if (m_lastDts != NoPts) {
+        auto const first = find_if(chunk.packets.begin(), chunk.packets.end(), [](const Packet &pkt) {
+            return pkt.raw()->dts != NoPts;
+        });
+        if (first != chunk.packets.end() && first->raw()->dts <= m_lastDts) {
+            shift = m_lastDts + 1 - first->raw()->dts;
+
+            auto headroom = numeric_limits<int64_t>::max();
+            for (auto const &pkt : chunk.packets) {
+                auto const raw = pkt.raw();
+                if (raw->dts != NoPts && raw->pts != NoPts)
+                    headroom = std::min(headroom, raw->pts - raw->dts);
+            }
+            if (shift > headroom) {
+                error = make_error_code(Errors::ChunkTimestampConflict);
+                return;
+            }
+        }
+    }
+
+    for (auto &pkt : chunk.packets) {
+        auto raw = pkt.raw();
+        if (raw->dts != NoPts) {
+            if (shift) {
+                raw->dts += shift;
+                ++m_stats.dtsAdjusted;
+            }
+            m_lastDts = raw->dts;
+        }
+        ++m_stats.packets;
+        if (m_sink)
+            m_sink(std::move(pkt));
+    }
+}
+
+bool ChunkedEncoder::raiseError(OptionalErrorCode ec)
+{
+    std::error_code error;
+    {
+        lock_guard lock{m_mutex};
+        error = m_error;
+    }
+    if (!error)
+        return false;
+    throws_if(ec, error.value(), error.category());
+    return true;
+}
+
+} // namespace av
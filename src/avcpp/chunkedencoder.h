@@ -0,0 +1,149 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "avutils.h"
+#include "averror.h"
+#include "codec.h"
+#include "codeccontext.h"
+#include "frame.h"
+#include "packet.h"
+#include "jobscheduler.h"
+
+namespace av {
+
+/**
+ * @brief The ChunkedEncoder class
+ *
+ * Parallel encoding of the single video stream: frames are split into chunks at key frames, chunks are encoded
+ * at once by independent encoders on the JobScheduler, and encoded packets are stitched back into the single
+ * stream in the original order.
+ *
+ * - Chunk is closed on the first key frame (VideoFrame::isKeyFrame(), e.g. marked by decoder or scene detection)
+ *   after Options::minChunkFrames frames, or unconditionally after Options::maxChunkFrames frames.
+ * - Every chunk encoder is configured by the same callback and its extradata must match reference() one,
+ *   otherwise encoding fails with Errors::ChunkExtradataMismatch.
+ * - PTS are kept. DTS are made strictly increasing on chunk joins: encoder delay of the next chunk can move first
+ *   DTS below the last DTS of the previous one, the whole chunk DTS are shifted then. If the shift would move DTS
+ *   past PTS (not enough reorder delay headroom), encoding fails with Errors::ChunkTimestampConflict.
+ * - Memory is bounded: at most Options::parallelChunks chunks are encoded or buffered, push() waits for them.
+ *
+ * Packets are passed to the sink from the push() and finish() caller thread, in order.
+ *
+ * @code
+ * ChunkedEncoder enc{scheduler, codec, [](VideoEncoderContext &ctx) { ... }, [&](Packet &&pkt) { octx.writePacket(pkt); }};
+ * enc.open();
+ * auto ost = octx.addStream(enc.reference());
+ * ...
+ * for (...)
+ *     enc.push(frame);
+ * enc.finish();
+ * @endcode
+ */
+class ChunkedEncoder : public noncopyable
+{
+public:
+    /// Set encoder parameters (size, pixel format, time base, bit rate, options...), must not open it. Called
+    /// concurrently from the scheduler threads.
+    using Configure  = std::function<void(VideoEncoderContext &encoder)>;
+    using PacketSink = std::function<void(Packet &&packet)>;
+
+    struct Options
+    {
+        size_t minChunkFrames = 250; ///< chunk is closed on the first key frame after it
+        size_t maxChunkFrames = 0;   ///< chunk is closed without key frame, 0 - unlimited
+        size_t parallelChunks = 0;   ///< chunks encoded and buffered at once, 0 - scheduler threads / encoderThreads
+        int    encoderThreads = 1;   ///< internal threads of every chunk encoder
+    };
+
+    struct Stats
+    {
+        uint64_t chunks      = 0;
+        uint64_t frames      = 0;
+        uint64_t packets     = 0;
+        uint64_t dtsAdjusted = 0; ///< packets with DTS shifted on chunk joins
+    };
+
+    ChunkedEncoder(JobScheduler &scheduler, const Codec &codec, Configure configure, PacketSink sink);
+    ChunkedEncoder(JobScheduler &scheduler, const Codec &codec, Configure configure, PacketSink sink, const Options &options);
+
+    /**
+     * Waits for running chunks, not emitted packets are dropped
+     */
+    ~ChunkedEncoder();
+
+    /**
+     * Configure and open reference encoder. Must be called before push().
+     */
+    void open(OptionalErrorCode ec = throws());
+
+    bool isOpened() const noexcept { return m_reference.isOpened(); }
+
+    /**
+     * Opened encoder with the chunks configuration: use it to setup output stream (FormatContext::addStream())
+     */
+    const VideoEncoderContext& reference() const noexcept { return m_reference; }
+
+    /**
+     * Add frame. Frames must go in presentation order with PTS in the encoder time base. Frame is referenced, not
+     * copied.
+     */
+    void push(const VideoFrame &frame, OptionalErrorCode ec = throws());
+
+    /**
+     * Encode the last chunk and wait for all chunks. Encoder can't be used after it.
+     */
+    void finish(OptionalErrorCode ec = throws());
+
+    const Options& options() const noexcept { return m_options; }
+
+    /**
+     * Valid in the push() and finish() caller thread
+     */
+    const Stats& stats() const noexcept { return m_stats; }
+
+private:
+    struct Chunk
+    {
+        std::vector<VideoFrame> frames;
+        std::vector<Packet>     packets;
+        std::error_code         error;
+        bool                    done = false;
+    };
+
+    void submit(std::unique_ptr<Chunk> chunk);
+    void encode(Chunk &chunk);
+    void drain(std::unique_lock<std::mutex> &lock);
+    void emit(Chunk &chunk, std::error_code &error);
+    bool raiseError(OptionalErrorCode ec);
+
+private:
+    JobScheduler        &m_scheduler;
+    std::shared_ptr<Job> m_job;
+    Codec                m_codec;
+    Configure            m_configure;
+    PacketSink           m_sink;
+    Options              m_options;
+    VideoEncoderContext  m_reference;
+
+    std::unique_ptr<Chunk> m_current;  // being filled
+    int64_t                m_lastDts = NoPts;
+    Stats                  m_stats;
+
+    std::mutex                         m_mutex;
+    std::condition_variable            m_cond;
+    std::deque<std::unique_ptr<Chunk>> m_chunks; // submitted, in order
+    size_t                             m_running = 0;
+    bool                               m_cancelled = false;
+    std::error_code                    m_error;
+};
+
+} // namespace av
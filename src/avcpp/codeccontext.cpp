@@ -13,6 +13,8 @@
 #include "codecparameters.h"
 
 #include "codeccontext.h"
+#include "instrumentation.h"
+#include "tracing.h"
 
 using namespace std;
 
@@ -72,6 +74,9 @@ namespace {
 
 #define NEW_CODEC_API (AVCPP_AVCODEC_VERSION_INT >= AV_VERSION_INT(57,37,100))
 
+// Private status of the try* procs, converted to Errors::CodecOutputPending
+constexpr int OutputPending = FFERRTAG('P', 'N', 'D', 'G');
+
 #if NEW_CODEC_API
 // Use avcodec_send_packet() and avcodec_receive_frame()
 int decode(AVCodecContext *avctx,
@@ -144,6 +149,86 @@ int avcodec_encode_audio_legacy(AVCodecContext *avctx, AVPacket *avpkt,
 {
     return encode(avctx, avpkt, frame, got_packet_ptr);
 }
+
+//
+// Procs for the try* API: unlike decode()/encode(), EAGAIN and EOF of the receive side are returned as is.
+// EAGAIN of the send side means that the input is not accepted at all: reported as OutputPending.
+//
+int decode_send_status(AVCodecContext *avctx, AVFrame *frame, int *got_frame_ptr, const AVPacket *avpkt)
+{
+    *got_frame_ptr = 0;
+
+    int ret = avcodec_send_packet(avctx, avpkt);
+    if (ret == AVERROR(EAGAIN))
+        return OutputPending;
+    if (ret < 0 && ret != AVERROR_EOF)
+        return ret;
+
+    ret = avcodec_receive_frame(avctx, frame);
+    if (ret < 0)
+        return ret;
+    *got_frame_ptr = 1;
+    return 0;
+}
+
+int decode_receive_status(AVCodecContext *avctx, AVFrame *frame, int *got_frame_ptr, const AVPacket */*avpkt*/)
+{
+    *got_frame_ptr = 0;
+
+    int ret = avcodec_receive_frame(avctx, frame);
+    if (ret < 0)
+        return ret;
+    *got_frame_ptr = 1;
+    return 0;
+}
+
+int encode_send_status(AVCodecContext *avctx, AVPacket *avpkt, const AVFrame *frame, int *got_packet_ptr)
+{
+    *got_packet_ptr = 0;
+
+    int ret = avcodec_send_frame(avctx, frame);
+    if (ret == AVERROR(EAGAIN))
+        return OutputPending;
+    if (ret < 0 && ret != AVERROR_EOF)
+        return ret;
+
+    ret = avcodec_receive_packet(avctx, avpkt);
+    if (ret < 0)
+        return ret;
+    *got_packet_ptr = 1;
+    return 0;
+}
+
+int encode_receive_status(AVCodecContext *avctx, AVPacket *avpkt, const AVFrame */*frame*/, int *got_packet_ptr)
+{
+    *got_packet_ptr = 0;
+
+    int ret = avcodec_receive_packet(avctx, avpkt);
+    if (ret < 0)
+        return ret;
+    *got_packet_ptr = 1;
+    return 0;
+}
+
+int decode_video_send_status(AVCodecContext *avctx, AVFrame *frame, int *got_frame_ptr, const AVPacket *avpkt)
+{
+    return decode_send_status(avctx, frame, got_frame_ptr, avpkt);
+}
+
+int decode_audio_send_status(AVCodecContext *avctx, AVFrame *frame, int *got_frame_ptr, const AVPacket *avpkt)
+{
+    return decode_send_status(avctx, frame, got_frame_ptr, avpkt);
+}
+
+int encode_video_send_status(AVCodecContext *avctx, AVPacket *avpkt, const AVFrame *frame, int *got_packet_ptr)
+{
+    return encode_send_status(avctx, avpkt, frame, got_packet_ptr);
+}
+
+int encode_audio_send_status(AVCodecContext *avctx, AVPacket *avpkt, const AVFrame *frame, int *got_packet_ptr)
+{
+    return encode_send_status(avctx, avpkt, frame, got_packet_ptr);
+}
 #else
 int avcodec_decode_video_legacy(AVCodecContext *avctx, AVFrame *picture,
                                 int *got_picture_ptr,
@@ -169,12 +254,78 @@ int avcodec_encode_audio_legacy(AVCodecContext *avctx, AVPacket *avpkt,
 {
     return avcodec_encode_audio2(avctx, avpkt, frame, got_packet_ptr);
 }
+
+//
+// Procs for the try* API: old API has no separate receive, missed output is reported as EAGAIN.
+// Draining is done by empty packets/null frames: no output means EOF.
+//
+int legacy_status(int ret, int gotOutput, bool draining)
+{
+    if (ret < 0 || gotOutput)
+        return ret < 0 ? ret : 0;
+    return draining ? AVERROR_EOF : AVERROR(EAGAIN);
+}
+
+int decode_video_send_status(AVCodecContext *avctx, AVFrame *frame, int *got_frame_ptr, const AVPacket *avpkt)
+{
+    int ret = avcodec_decode_video2(avctx, frame, got_frame_ptr, avpkt);
+    return legacy_status(ret, *got_frame_ptr, !avpkt->size);
+}
+
+int decode_audio_send_status(AVCodecContext *avctx, AVFrame *frame, int *got_frame_ptr, const AVPacket *avpkt)
+{
+    int ret = avcodec_decode_audio4(avctx, frame, got_frame_ptr, avpkt);
+    return legacy_status(ret, *got_frame_ptr, !avpkt->size);
+}
+
+int encode_video_send_status(AVCodecContext *avctx, AVPacket *avpkt, const AVFrame *frame, int *got_packet_ptr)
+{
+    int ret = avcodec_encode_video2(avctx, avpkt, frame, got_packet_ptr);
+    return legacy_status(ret, *got_packet_ptr, !frame);
+}
+
+int encode_audio_send_status(AVCodecContext *avctx, AVPacket *avpkt, const AVFrame *frame, int *got_packet_ptr)
+{
+    int ret = avcodec_encode_audio2(avctx, avpkt, frame, got_packet_ptr);
+    return legacy_status(ret, *got_packet_ptr, !frame);
+}
+
+int decode_receive_status(AVCodecContext */*avctx*/, AVFrame */*frame*/, int *got_frame_ptr, const AVPacket */*avpkt*/)
+{
+    *got_frame_ptr = 0;
+    return AVERROR(EAGAIN);
+}
+
+int encode_receive_status(AVCodecContext */*avctx*/, AVPacket */*avpkt*/, const AVFrame */*frame*/, int *got_packet_ptr)
+{
+    *got_packet_ptr = 0;
+    return AVERROR(EAGAIN);
+}
 #endif
 
 } //::anonymous
 
 namespace av {
 
+namespace {
+
+template<typename T>
+Result<T> make_try_result(std::pair<int, const error_category*> st) noexcept
+{
+    if (get<1>(st) == &ffmpeg_category() && get<0>(st) == OutputPending)
+        return Result<T>::error(Errors::CodecOutputPending);
+    return make_result_status<T>(get<0>(st), *get<1>(st));
+}
+
+// Receive-only procs ignore the input packet
+const Packet& empty_packet()
+{
+    static const Packet packet;
+    return packet;
+}
+
+} // anonymous
+
 namespace codec_context::internal {
 const int *get_supported_samplerates(const struct AVCodec *codec)
 {
@@ -248,6 +399,22 @@ VideoFrame VideoDecoderContext::decodeVideo(OptionalErrorCode ec, const Packet &
     return outFrame;
 }
 
+Result<VideoFrame> VideoDecoderContext::tryDecode(const Packet &packet)
+{
+    auto res = tryDecodeCommon<VideoFrame>(packet, decode_video_send_status);
+    if (res)
+        res->setPictureType(AV_PICTURE_TYPE_I);
+    return res;
+}
+
+Result<VideoFrame> VideoDecoderContext::tryDecode()
+{
+    auto res = tryDecodeCommon<VideoFrame>(empty_packet(), decode_receive_status);
+    if (res)
+        res->setPictureType(AV_PICTURE_TYPE_I);
+    return res;
+}
+
 VideoEncoderContext::VideoEncoderContext(VideoEncoderContext &&other)
     : Parent(std::move(other))
 {
@@ -289,6 +456,16 @@ Packet VideoEncoderContext::encode(const VideoFrame &inFrame, OptionalErrorCode
     return packet;
 }
 
+Result<Packet> VideoEncoderContext::tryEncode(const VideoFrame &inFrame)
+{
+    return tryEncodeCommon(inFrame, encode_video_send_status);
+}
+
+Result<Packet> VideoEncoderContext::tryEncode()
+{
+    return tryEncodeCommon(VideoFrame(nullptr), encode_receive_status);
+}
+
 void CodecContext2::swap(CodecContext2 &other)
 {
     using std::swap;
@@ -355,6 +532,11 @@ CodecContext2::CodecContext2(const Codec &codec, Direction direction, AVMediaTyp
 
 CodecContext2::~CodecContext2()
 {
+    AVCPP_INSTRUMENT_FORGET(this);
+
+    av_frame_free(&m_receiveFrame);
+    av_packet_free(&m_receivePacket);
+
     //
     // Do not track stream-oriented codec:
     //  - Stream always owned by FormatContext
@@ -642,6 +824,49 @@ const Stream &CodecContext2::stream() const noexcept
 }
 #endif // if AVCPP_HAS_AVFORMAT
 
+bool CodecContext2::detachStream() noexcept
+{
+#if AVCPP_HAS_AVFORMAT
+#if !AVCPP_USE_CODECPAR
+    // Context is owned by the stream
+    if (!m_stream.isNull())
+        return false;
+#endif
+    m_stream = Stream();
+#endif // if AVCPP_HAS_AVFORMAT
+    return true;
+}
+
+bool CodecContext2::canFlushBuffers() const noexcept
+{
+    if (!isOpened())
+        return false;
+    if (av_codec_is_decoder(m_raw->codec))
+        return true;
+#ifdef AV_CODEC_CAP_ENCODER_FLUSH
+    return (m_raw->codec->capabilities & AV_CODEC_CAP_ENCODER_FLUSH) != 0;
+#else
+    return false;
+#endif
+}
+
+void CodecContext2::flushBuffers(OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (!isOpened()) {
+        throws_if(ec, Errors::CodecNotOpened);
+        return;
+    }
+
+    if (!canFlushBuffers()) {
+        throws_if(ec, Errors::CodecFlushUnsupported);
+        return;
+    }
+
+    avcodec_flush_buffers(m_raw);
+}
+
 Codec CodecContext2::codec() const noexcept
 {
     if (isValid())
@@ -716,6 +941,26 @@ void CodecContext2::setStrict(int strict) noexcept
     RAW_SET2(isValid(), strict_std_compliance, strict);
 }
 
+int CodecContext2::threadCount() const noexcept
+{
+    return RAW_GET2(isValid(), thread_count, 0);
+}
+
+void CodecContext2::setThreadCount(int count) noexcept
+{
+    RAW_SET2(isValid() && !isOpened(), thread_count, count);
+}
+
+int CodecContext2::threadType() const noexcept
+{
+    return RAW_GET2(isValid(), thread_type, 0);
+}
+
+void CodecContext2::setThreadType(int type) noexcept
+{
+    RAW_SET2(isValid() && !isOpened(), thread_type, type);
+}
+
 int64_t CodecContext2::bitRate() const noexcept
 {
     return RAW_GET2(isValid(), bit_rate, int64_t(0));
@@ -871,6 +1116,7 @@ bool CodecContext2::checkCodec(const Codec &codec, Direction direction, AVMediaT
 void CodecContext2::open(const Codec &codec, AVDictionary **options, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_TRACE("codec_open");
 
     if (isOpened() || !isValid()) {
         throws_if(ec, isOpened() ? Errors::CodecAlreadyOpened : Errors::CodecInvalid);
@@ -884,6 +1130,10 @@ void CodecContext2::open(const Codec &codec, AVDictionary **options, OptionalErr
 
 std::pair<int, const error_category *> CodecContext2::decodeCommon(AVFrame *outFrame, const Packet &inPacket, size_t offset, int &frameFinished, int (*decodeProc)(AVCodecContext *, AVFrame *, int *, const AVPacket *)) noexcept
 {
+    AVCPP_INSTRUMENT("decode", this, m_raw && m_raw->codec ? m_raw->codec->name : nullptr);
+    AVCPP_TRACE_AT("decode", inPacket.streamIndex(), inPacket.pts().timestamp());
+    AVCPP_INSTRUMENT_BYTES(inPacket.size());
+
     if (!isValid())
         return make_error_pair(Errors::CodecInvalid);
 
@@ -917,8 +1167,11 @@ std::pair<int, const error_category *> CodecContext2::decodeCommon(AVFrame *outF
     return make_error_pair(decodeProc(m_raw, outFrame, &frameFinished, processPkt));
 }
 
-std::pair<int, const error_category *> CodecContext2::encodeCommon(Packet &outPacket, const AVFrame *inFrame, int &gotPacket, int (*encodeProc)(AVCodecContext *, AVPacket *, const AVFrame *, int *)) noexcept
+std::pair<int, const error_category *> CodecContext2::encodeCommon(AVPacket *outPacket, const AVFrame *inFrame, int &gotPacket, int (*encodeProc)(AVCodecContext *, AVPacket *, const AVFrame *, int *)) noexcept
 {
+    AVCPP_INSTRUMENT("encode", this, m_raw && m_raw->codec ? m_raw->codec->name : nullptr);
+    AVCPP_TRACE_AT("encode", -1, inFrame ? inFrame->pts : NoPts);
+
     if (!isValid()) {
         fflog(AV_LOG_ERROR, "Invalid context\n");
         return make_error_pair(Errors::CodecInvalid);
@@ -934,9 +1187,11 @@ std::pair<int, const error_category *> CodecContext2::encodeCommon(Packet &outPa
         return make_error_pair(Errors::CodecInvalidEncodeProc);
     }
 
-    int stat = encodeProc(m_raw, outPacket.raw(), inFrame, &gotPacket);
-    if (stat) {
+    int stat = encodeProc(m_raw, outPacket, inFrame, &gotPacket);
+    if (stat && stat != AVERROR(EAGAIN) && stat != AVERROR_EOF) {
         fflog(AV_LOG_ERROR, "Encode error: %d, %s\n", stat, error2string(stat).c_str());
+    } else if (gotPacket) {
+        AVCPP_INSTRUMENT_BYTES(outPacket->size);
     }
     return make_error_pair(stat);
 }
@@ -984,6 +1239,26 @@ AudioSamples AudioDecoderContext::decode(const Packet &inPacket, size_t offset,
     return outSamples;
 }
 
+Result<AudioSamples> AudioDecoderContext::tryDecode(const Packet &inPacket)
+{
+    auto res = tryDecodeCommon<AudioSamples>(inPacket, decode_audio_send_status);
+#if !AVCPP_API_NEW_CHANNEL_LAYOUT
+    if (res && res->channelsCount() && !res->channelsLayout())
+        av::frame::set_channel_layout(res->raw(), av_get_default_channel_layout(res->channelsCount()));
+#endif
+    return res;
+}
+
+Result<AudioSamples> AudioDecoderContext::tryDecode()
+{
+    auto res = tryDecodeCommon<AudioSamples>(empty_packet(), decode_receive_status);
+#if !AVCPP_API_NEW_CHANNEL_LAYOUT
+    if (res && res->channelsCount() && !res->channelsLayout())
+        av::frame::set_channel_layout(res->raw(), av_get_default_channel_layout(res->channelsCount()));
+#endif
+    return res;
+}
+
 AudioEncoderContext::AudioEncoderContext(AudioEncoderContext &&other)
     : Parent(std::move(other))
 {
@@ -1022,6 +1297,16 @@ Packet AudioEncoderContext::encode(const AudioSamples &inSamples, OptionalErrorC
     return outPacket;
 }
 
+Result<Packet> AudioEncoderContext::tryEncode(const AudioSamples &inSamples)
+{
+    return tryEncodeCommon(inSamples, encode_audio_send_status);
+}
+
+Result<Packet> AudioEncoderContext::tryEncode()
+{
+    return tryEncodeCommon(AudioSamples(nullptr), encode_receive_status);
+}
+
 template<typename T>
 std::pair<int, const std::error_category*>
 CodecContext2::decodeCommon(T &outFrame,
@@ -1037,6 +1322,13 @@ CodecContext2::decodeCommon(T &outFrame,
     if (!frameFinished)
         return std::make_pair(0u, nullptr);
 
+    finishDecoded(outFrame, inPacket);
+    return st;
+}
+
+template<typename T>
+void CodecContext2::finishDecoded(T &outFrame, const Packet &inPacket)
+{
     // Dial with PTS/DTS in packet/stream timebase
 
     if (inPacket.raw() && inPacket.timeBase() != Rational())
@@ -1070,8 +1362,6 @@ CodecContext2::decodeCommon(T &outFrame,
 #endif // if AVCPP_HAS_AVFORMAT
 
     outFrame.setComplete(true);
-
-    return st;
 }
 
 template<typename T>
@@ -1081,12 +1371,19 @@ CodecContext2::encodeCommon(Packet &outPacket,
              int &gotPacket,
              int (*encodeProc)(AVCodecContext *, AVPacket *, const AVFrame *, int *))
 {
-    auto st = encodeCommon(outPacket, inFrame.raw(), gotPacket, encodeProc);
+    auto st = encodeCommon(outPacket.raw(), inFrame.raw(), gotPacket, encodeProc);
     if (std::get<1>(st))
         return st;
     if (!gotPacket)
         return std::make_pair(0u, nullptr);
 
+    finishEncoded(outPacket, inFrame);
+    return st;
+}
+
+template<typename T>
+void CodecContext2::finishEncoded(Packet &outPacket, const T &inFrame)
+{
     if (inFrame && inFrame.timeBase() != Rational()) {
         outPacket.setTimeBase(inFrame.timeBase());
         outPacket.setStreamIndex(inFrame.streamIndex());
@@ -1117,8 +1414,48 @@ CodecContext2::encodeCommon(Packet &outPacket,
     }
 
     outPacket.setComplete(true);
+}
 
-    return st;
+template<typename T>
+Result<T> CodecContext2::tryDecodeCommon(const Packet &inPacket,
+                                         int (*decodeProc)(AVCodecContext *, AVFrame *, int *, const AVPacket *))
+{
+    // Received into the kept frame: Again/Eof calls do not allocate
+    if (!m_receiveFrame && !(m_receiveFrame = av_frame_alloc()))
+        return make_result_status<T>(AVERROR(ENOMEM), ffmpeg_category());
+
+    int gotFrame = 0;
+    auto st = decodeCommon(m_receiveFrame, inPacket, 0, gotFrame, decodeProc);
+    if (get<1>(st))
+        return make_try_result<T>(st);
+    if (!gotFrame)
+        return Result<T>::again();
+
+    T outFrame;
+    av_frame_move_ref(outFrame.raw(), m_receiveFrame);
+    finishDecoded(outFrame, inPacket);
+    return Result<T>(std::move(outFrame));
+}
+
+template<typename T>
+Result<Packet> CodecContext2::tryEncodeCommon(const T &inFrame,
+                                              int (*encodeProc)(AVCodecContext *, AVPacket *, const AVFrame *, int *))
+{
+    // Received into the kept packet: Again/Eof calls do not allocate
+    if (!m_receivePacket && !(m_receivePacket = av_packet_alloc()))
+        return make_result_status<Packet>(AVERROR(ENOMEM), ffmpeg_category());
+
+    int gotPacket = 0;
+    auto st = encodeCommon(m_receivePacket, inFrame.raw(), gotPacket, encodeProc);
+    if (get<1>(st))
+        return make_try_result<Packet>(st);
+    if (!gotPacket)
+        return Result<Packet>::again();
+
+    Packet outPacket;
+    av_packet_move_ref(outPacket.raw(), m_receivePacket);
+    finishEncoded(outPacket, inFrame);
+    return Result<Packet>(std::move(outPacket));
 }
 
 
@@ -6,6 +6,7 @@
 #include "stream.h"
 #include "avutils.h"
 #include "averror.h"
+#include "result.h"
 #include "pixelformat.h"
 #include "sampleformat.h"
 #include "avlog.h"
@@ -93,12 +94,29 @@ public:
     void copyContextFrom(const CodecContext2 &other, OptionalErrorCode ec = throws());
     /// @}
 
+    /**
+     * Drop buffered frames/packets and the end-of-stream state with avcodec_flush_buffers(): opened context can be
+     * reused for the next stream with the same parameters instead of the new avcodec_open2() call.
+     *
+     * Encoders support it only with AV_CODEC_CAP_ENCODER_FLUSH, Errors::CodecFlushUnsupported otherwise.
+     */
+    void flushBuffers(OptionalErrorCode ec = throws());
+    bool canFlushBuffers() const noexcept;
+
     Rational timeBase() const noexcept;
     void setTimeBase(const Rational &value) noexcept;
 
 #if AVCPP_HAS_AVFORMAT
     const Stream& stream() const noexcept;
 #endif // if AVCPP_HAS_AVFORMAT
+
+    /**
+     * Forget the stream the context is created from, so context can outlive the FormatContext (e.g. kept in the
+     * CodecContextPool). Contexts owned by the stream (FFmpeg without codecpar) can't be detached.
+     *
+     * @return true if context is not bound to the stream anymore
+     */
+    bool detachStream() noexcept;
     Codec codec() const noexcept;
 
     void setOption(const std::string &key, const std::string &val, OptionalErrorCode ec = throws());
@@ -114,6 +132,14 @@ public:
     int strict() const noexcept;
     void setStrict(int strict) noexcept;
 
+    // Codec internal threading, must be set before open(). Thread count 0 means auto: FFmpeg creates threads by
+    // the CPU count, 1 disables internal threads (useful when parallelism comes from the outside, like JobScheduler)
+    int  threadCount() const noexcept;
+    void setThreadCount(int count) noexcept;
+    /// FF_THREAD_FRAME and/or FF_THREAD_SLICE
+    int  threadType() const noexcept;
+    void setThreadType(int type) noexcept;
+
     int64_t bitRate() const noexcept;
     std::pair<int64_t, int64_t> bitRateRange() const noexcept;
     void setBitRate(int64_t bitRate) noexcept;
@@ -154,9 +180,15 @@ protected:
                  int (*decodeProc)(AVCodecContext*, AVFrame*,int *, const AVPacket *)) noexcept;
 
     std::pair<int, const std::error_category*>
-    encodeCommon(class Packet &outPacket, const AVFrame *inFrame, int &gotPacket,
+    encodeCommon(AVPacket *outPacket, const AVFrame *inFrame, int &gotPacket,
                          int (*encodeProc)(AVCodecContext*, AVPacket*,const AVFrame*, int*)) noexcept;
 
+    // Timestamps, time base and stream index of the received frame/packet
+    template<typename T>
+    void finishDecoded(T &outFrame, const class Packet &inPacket);
+    template<typename T>
+    void finishEncoded(class Packet &outPacket, const T &inFrame);
+
 public:
     template<typename T>
     std::pair<int, const std::error_category*>
@@ -173,10 +205,22 @@ public:
                  int &gotPacket,
                  int (*encodeProc)(AVCodecContext *, AVPacket *, const AVFrame *, int *));
 
+protected:
+    template<typename T>
+    Result<T> tryDecodeCommon(const class Packet &inPacket,
+                              int (*decodeProc)(AVCodecContext *, AVFrame *, int *, const AVPacket *));
+
+    template<typename T>
+    Result<class Packet> tryEncodeCommon(const T &inFrame,
+                                         int (*encodeProc)(AVCodecContext *, AVPacket *, const AVFrame *, int *));
+
 private:
 #if AVCPP_HAS_AVFORMAT
     Stream m_stream;
 #endif // if AVCPP_HAS_AVFORMAT
+    // Kept between tryDecode()/tryEncode() calls, not moved with the context: always blank between calls
+    AVFrame  *m_receiveFrame  = nullptr;
+    AVPacket *m_receivePacket = nullptr;
 };
 
 
@@ -443,6 +487,27 @@ public:
                       OptionalErrorCode ec = throws(),
                       bool    autoAllocateFrame = true);
 
+    /**
+     * @brief tryDecode - non-throwing decode for the hot loops
+     *
+     * Sends packet (empty one starts draining) and receives one frame. Remaining frames of the packet must be
+     * received with tryDecode() before the next packet, otherwise Errors::CodecOutputPending is returned.
+     *
+     * @code
+     * for (auto frame = dec.tryDecode(pkt); frame; frame = dec.tryDecode())
+     *     process(*frame);
+     * @endcode
+     *
+     * @param packet  packet to decode
+     * @return frame; Again if decoder needs more input; Eof if decoder is drained; Error otherwise
+     */
+    Result<VideoFrame> tryDecode(const Packet &packet);
+
+    /**
+     * @brief tryDecode - receive next pending frame without new input
+     */
+    Result<VideoFrame> tryDecode();
+
 
 private:
     VideoFrame decodeVideo(OptionalErrorCode ec,
@@ -489,6 +554,22 @@ public:
      */
     Packet encode(const VideoFrame &inFrame, OptionalErrorCode ec = throws());
 
+    /**
+     * @brief tryEncode - non-throwing encode for the hot loops
+     *
+     * Sends frame (null one starts draining) and receives one packet. Remaining packets must be received
+     * with tryEncode() before the next frame, otherwise Errors::CodecOutputPending is returned.
+     *
+     * @param inFrame  frame to encode
+     * @return packet; Again if encoder needs more input; Eof if encoder is drained; Error otherwise
+     */
+    Result<Packet> tryEncode(const VideoFrame &inFrame);
+
+    /**
+     * @brief tryEncode - receive next pending packet without new input
+     */
+    Result<Packet> tryEncode();
+
 };
 
 
@@ -601,6 +682,12 @@ public:
     AudioSamples decode(const Packet &inPacket, OptionalErrorCode ec = throws());
     AudioSamples decode(const Packet &inPacket, size_t offset, OptionalErrorCode ec = throws());
 
+    /**
+     * Non-throwing decode, see VideoDecoderContext::tryDecode()
+     */
+    Result<AudioSamples> tryDecode(const Packet &inPacket);
+    Result<AudioSamples> tryDecode();
+
 };
 
 
@@ -618,6 +705,12 @@ public:
     Packet encode(OptionalErrorCode ec = throws());
     Packet encode(const AudioSamples &inSamples, OptionalErrorCode ec = throws());
 
+    /**
+     * Non-throwing encode, see VideoEncoderContext::tryEncode()
+     */
+    Result<Packet> tryEncode(const AudioSamples &inSamples);
+    Result<Packet> tryEncode();
+
 };
 
 
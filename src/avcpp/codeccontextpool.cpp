@@ -0,0 +1,190 @@
+#include "codeccontextpool.h"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+// Options that differ from the defaults. Runtime state of the not opened context is not there.
+string serialize_options(void *obj)
+{
+    if (!obj || !*static_cast<const AVClass**>(obj))
+        return {};
+
+    char *buffer = nullptr;
+    if (av_opt_serialize(obj, 0, AV_OPT_SERIALIZE_SKIP_DEFAULTS, &buffer, '=', ';') < 0) {
+        av_freep(&buffer);
+        return {};
+    }
+
+    string out = buffer ? buffer : "";
+    av_freep(&buffer);
+    return out;
+}
+
+} // anonymous namespace
+
+CodecContextPool::CodecContextPool()
+    : CodecContextPool(Options{})
+{
+}
+
+CodecContextPool::CodecContextPool(const Options &options)
+    : m_options(options)
+{
+}
+
+CodecContextPool::~CodecContextPool()
+{
+    clear();
+}
+
+string CodecContextPool::makeKey(const CodecContext2 &context, const Dictionary &options, const type_info &type)
+{
+    auto const raw = context.raw();
+    auto const codec = raw->codec;
+
+    ostringstream ss;
+    ss << type.name()
+       << '|' << static_cast<const void*>(codec) << ':' << (codec ? codec->name : "") << ':' << raw->codec_id
+       << '|' << raw->codec_type
+       << '|' << raw->time_base.num << '/' << raw->time_base.den
+       << '|' << raw->framerate.num << '/' << raw->framerate.den
+       << '|' << raw->width << 'x' << raw->height << ':' << raw->pix_fmt
+       << '|' << raw->sample_rate << ':' << raw->sample_fmt
+       << ':' << codec_context::audio::get_channel_layout_mask(raw)
+       << ':' << codec_context::audio::get_channels(raw)
+       << '|' << raw->flags << ':' << raw->flags2
+       << '|' << serialize_options(const_cast<AVCodecContext*>(raw));
+
+    if (codec && codec->priv_class)
+        ss << '|' << serialize_options(raw->priv_data);
+
+    ss << '|' << raw->extradata_size << ':';
+    if (raw->extradata && raw->extradata_size > 0)
+        ss.write(reinterpret_cast<const char*>(raw->extradata), raw->extradata_size);
+
+    // Dictionary keeps insertion order
+    vector<pair<string, string>> opts;
+    for (auto const &entry : options)
+        opts.emplace_back(entry.key(), entry.value());
+    sort(opts.begin(), opts.end());
+
+    ss << '|';
+    for (auto const &opt : opts)
+        ss << opt.first << '=' << opt.second << ';';
+
+    return ss.str();
+}
+
+CodecContextPool::Holder CodecContextPool::take(const string &key)
+{
+    list<Entry> evicted;
+    Holder      out{nullptr, [](void*) {}};
+
+    {
+        lock_guard lock{m_mutex};
+        evictLocked(evicted);
+
+        auto it = find_if(m_idle.begin(), m_idle.end(), [&key](const Entry &entry) {
+            return entry.key == key;
+        });
+
+        if (it != m_idle.end()) {
+            out = std::move(it->context);
+            m_idle.erase(it);
+            ++m_stats.hits;
+        } else {
+            ++m_stats.misses;
+        }
+    }
+
+    return out;
+}
+
+void CodecContextPool::put(string key, CodecContext2 &context, Holder holder)
+{
+    // Context is not shared yet: reset it outside of the lock
+    bool reusable = context.detachStream() && context.canFlushBuffers();
+    if (reusable) {
+        error_code ec;
+        context.flushBuffers(ec);
+        reusable = !ec;
+    }
+
+    list<Entry> evicted;
+    {
+        lock_guard lock{m_mutex};
+        if (!reusable || m_options.maxIdle == 0) {
+            ++m_stats.discarded;
+        } else {
+            m_idle.push_front(Entry{std::move(key), std::move(holder), chrono::steady_clock::now()});
+            ++m_stats.returned;
+        }
+        evictLocked(evicted);
+    }
+
+    // holder and evicted contexts are destroyed here
+}
+
+void CodecContextPool::evictLocked(list<Entry> &evicted)
+{
+    if (m_options.maxIdleTime.count() > 0) {
+        auto const deadline = chrono::steady_clock::now() - m_options.maxIdleTime;
+        // Most recently returned first: expired ones are at the tail
+        while (!m_idle.empty() && m_idle.back().released < deadline) {
+            evicted.splice(evicted.end(), m_idle, prev(m_idle.end()));
+            ++m_stats.evicted;
+        }
+    }
+
+    while (m_idle.size() > m_options.maxIdle) {
+        evicted.splice(evicted.end(), m_idle, prev(m_idle.end()));
+        ++m_stats.evicted;
+    }
+}
+
+void CodecContextPool::evictExpired()
+{
+    list<Entry> evicted;
+    {
+        lock_guard lock{m_mutex};
+        evictLocked(evicted);
+    }
+}
+
+void CodecContextPool::clear()
+{
+    list<Entry> evicted;
+    {
+        lock_guard lock{m_mutex};
+        m_stats.evicted += m_idle.size();
+        evicted.swap(m_idle);
+    }
+}
+
+size_t CodecContextPool::idleCount() const
+{
+    lock_guard lock{m_mutex};
+    return m_idle.size();
+}
+
+CodecContextPool::Stats CodecContextPool::stats() const
+{
+    lock_guard lock{m_mutex};
+    Stats out = m_stats;
+    out.idle = m_idle.size();
+    return out;
+}
+
+} // namespace av
@@ -0,0 +1,253 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <type_traits>
+
+#include "averror.h"
+#include "avutils.h"
+#include "codeccontext.h"
+#include "dictionary.h"
+
+namespace av {
+
+class CodecContextPool;
+
+/**
+ * @brief The PooledCodecContext class
+ *
+ * Opened codec context leased from the CodecContextPool. Returned to the pool on destruction or release().
+ * Lease must not outlive the pool.
+ */
+template<typename Context>
+class PooledCodecContext : public noncopyable
+{
+public:
+    PooledCodecContext() = default;
+
+    PooledCodecContext(PooledCodecContext &&other) noexcept
+    {
+        swap(other);
+    }
+
+    PooledCodecContext& operator=(PooledCodecContext &&rhs) noexcept
+    {
+        if (this != &rhs) {
+            PooledCodecContext(std::move(rhs)).swap(*this);
+        }
+        return *this;
+    }
+
+    ~PooledCodecContext()
+    {
+        release();
+    }
+
+    Context& operator*() const noexcept { return *m_context; }
+    Context* operator->() const noexcept { return m_context.get(); }
+    Context* get() const noexcept { return m_context.get(); }
+
+    explicit operator bool() const noexcept { return !!m_context; }
+
+    /**
+     * Context is taken from the idle ones: avcodec_open2() is skipped
+     */
+    bool isReused() const noexcept { return m_reused; }
+
+    /**
+     * Return context to the pool: it is flushed and kept idle till acquired again or evicted
+     */
+    void release();
+
+    /**
+     * Destroy context without returning to the pool, e.g. after codec error
+     */
+    void discard() noexcept
+    {
+        m_context.reset();
+        m_pool = nullptr;
+    }
+
+    void swap(PooledCodecContext &other) noexcept
+    {
+        std::swap(m_pool, other.m_pool);
+        std::swap(m_key, other.m_key);
+        std::swap(m_context, other.m_context);
+        std::swap(m_reused, other.m_reused);
+    }
+
+private:
+    friend class CodecContextPool;
+
+    PooledCodecContext(CodecContextPool *pool, std::string key, std::unique_ptr<Context> context, bool reused)
+        : m_pool(pool),
+          m_key(std::move(key)),
+          m_context(std::move(context)),
+          m_reused(reused)
+    {
+    }
+
+private:
+    CodecContextPool        *m_pool = nullptr;
+    std::string              m_key;
+    std::unique_ptr<Context> m_context;
+    bool                     m_reused = false;
+};
+
+/**
+ * @brief The CodecContextPool class
+ *
+ * Already opened decoder and encoder contexts for short jobs: avcodec_open2() of the heavy encoders (libx264 and
+ * friends) takes a large fraction of a few-seconds job.
+ *
+ * Caller configures not opened context as usual and acquires it. Contexts are keyed by the context type, codec and
+ * parameters: codec context and codec private options that differ from the defaults, time base, extradata and
+ * the options passed to open. If idle context with the same key exists, it is returned and configured one is just
+ * destroyed, otherwise configured context is opened.
+ *
+ * Returned contexts are flushed with avcodec_flush_buffers() and detached from the stream. Encoders without
+ * AV_CODEC_CAP_ENCODER_FLUSH and contexts owned by the stream can't be reset, they are destroyed on return.
+ * Idle contexts are evicted by LRU over Options::maxIdle and by Options::maxIdleTime.
+ *
+ * Pool is thread-safe, leases are not.
+ *
+ * @code
+ * CodecContextPool pool;
+ * ...
+ * VideoEncoderContext enc{findEncodingCodec("libx264")};
+ * enc.setWidth(1280);
+ * ...
+ * auto lease = pool.acquire(std::move(enc), {{"preset", "veryfast"}});
+ * auto pkt = lease->encode(frame);
+ * @endcode
+ */
+class CodecContextPool : public noncopyable
+{
+public:
+    struct Options
+    {
+        size_t                    maxIdle     = 8;                        ///< idle contexts kept, LRU evicted over it
+        std::chrono::milliseconds maxIdleTime = std::chrono::seconds(60); ///< 0 - unlimited
+    };
+
+    struct Stats
+    {
+        uint64_t hits      = 0; ///< acquired from the idle contexts
+        uint64_t misses    = 0; ///< opened
+        uint64_t returned  = 0; ///< kept idle on return
+        uint64_t discarded = 0; ///< destroyed on return: can't be reset
+        uint64_t evicted   = 0; ///< idle destroyed by LRU or idle time
+        size_t   idle      = 0;
+    };
+
+    CodecContextPool();
+    explicit CodecContextPool(const Options &options);
+    ~CodecContextPool();
+
+    /**
+     * Acquire opened context with the parameters of the configured one.
+     *
+     * @param configured  valid not opened context
+     * @param options     codec options passed to open(), part of the key
+     * @param ec          open() errors, Errors::CodecAlreadyOpened, Errors::CodecInvalid
+     */
+    template<typename Context>
+    PooledCodecContext<Context> acquire(Context &&configured, const Dictionary &options, OptionalErrorCode ec = throws())
+    {
+        static_assert(!std::is_reference_v<Context>, "Configured context must be moved into the pool");
+        static_assert(std::is_base_of_v<CodecContext2, Context>, "Codec context is expected");
+        clear_if(ec);
+
+        if (!configured.isValid() || configured.isOpened()) {
+            throws_if(ec, configured.isOpened() ? Errors::CodecAlreadyOpened : Errors::CodecInvalid);
+            return {};
+        }
+
+        auto key = makeKey(configured, options, typeid(Context));
+        if (auto idle = take(key)) {
+            return {this, std::move(key), std::unique_ptr<Context>(static_cast<Context*>(idle.release())), true};
+        }
+
+        auto context = std::make_unique<Context>(std::move(configured));
+        Dictionary opts = options;
+        context->open(opts, ec);
+        if (is_error(ec))
+            return {};
+        return {this, std::move(key), std::move(context), false};
+    }
+
+    template<typename Context>
+    PooledCodecContext<Context> acquire(Context &&configured, OptionalErrorCode ec = throws())
+    {
+        return acquire(std::move(configured), Dictionary(), ec);
+    }
+
+    /**
+     * Destroy idle contexts that exceeded Options::maxIdleTime. Called by acquire and release too.
+     */
+    void evictExpired();
+
+    /**
+     * Destroy all idle contexts
+     */
+    void clear();
+
+    size_t idleCount() const;
+    Stats  stats() const;
+
+    const Options& options() const noexcept { return m_options; }
+
+private:
+    template<typename Context>
+    friend class PooledCodecContext;
+
+    // Type-erased owner of the idle context
+    using Holder = std::unique_ptr<void, void(*)(void*)>;
+
+    struct Entry
+    {
+        std::string                           key;
+        Holder                                context;
+        std::chrono::steady_clock::time_point released;
+    };
+
+    static std::string makeKey(const CodecContext2 &context, const Dictionary &options, const std::type_info &type);
+
+    Holder take(const std::string &key);
+    void   put(std::string key, CodecContext2 &context, Holder holder);
+
+    template<typename Context>
+    void put(std::string key, std::unique_ptr<Context> context)
+    {
+        auto &ref = *context;
+        put(std::move(key), ref, Holder(context.release(), [](void *ptr) { delete static_cast<Context*>(ptr); }));
+    }
+
+    // Must be called with the lock held: evicted contexts are destroyed by the caller outside of the lock
+    void evictLocked(std::list<Entry> &evicted);
+
+private:
+    const Options      m_options;
+
+    mutable std::mutex m_mutex;
+    std::list<Entry>   m_idle; // most recently returned first
+    Stats              m_stats;
+};
+
+template<typename Context>
+void PooledCodecContext<Context>::release()
+{
+    if (m_context && m_pool)
+        m_pool->put(std::move(m_key), std::move(m_context));
+    m_context.reset();
+    m_pool = nullptr;
+}
+
+} // namespace av
@@ -0,0 +1,254 @@
+#include <cstring>
+#include <climits>
+
+#include "avcompat.h"
+#include "avlog.h"
+
+#include "codecparser.h"
+
+using namespace std;
+
+namespace av {
+
+CodecParser::CodecParser(AVCodecID codecId, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    m_raw = av_parser_init(codecId);
+    if (!m_raw) {
+        throws_if(ec, Errors::ParserNotFound);
+        return;
+    }
+
+    m_ctx = avcodec_alloc_context3(nullptr);
+    if (!m_ctx) {
+        av_parser_close(m_raw);
+        m_raw = nullptr;
+        throws_if(ec, AVERROR(ENOMEM), ffmpeg_category());
+        return;
+    }
+
+    m_ctx->codec_id   = codecId;
+    m_ctx->codec_type = avcodec_get_type(codecId);
+}
+
+CodecParser::CodecParser(const Codec &codec, OptionalErrorCode ec)
+    : CodecParser(codec.id(), ec)
+{
+}
+
+CodecParser::~CodecParser()
+{
+    if (m_raw)
+        av_parser_close(m_raw);
+    avcodec_free_context(&m_ctx);
+}
+
+CodecParser::CodecParser(CodecParser &&other)
+{
+    swap(other);
+}
+
+CodecParser &CodecParser::operator=(CodecParser &&rhs)
+{
+    if (this == &rhs)
+        return *this;
+    CodecParser(std::move(rhs)).swap(*this);
+    return *this;
+}
+
+void CodecParser::swap(CodecParser &other) noexcept
+{
+    using std::swap;
+    swap(m_raw,         other.m_raw);
+    swap(m_ctx,         other.m_ctx);
+    swap(m_timeBase,    other.m_timeBase);
+    swap(m_streamIndex, other.m_streamIndex);
+    swap(m_inputPadded, other.m_inputPadded);
+    swap(m_pts,         other.m_pts);
+    swap(m_dts,         other.m_dts);
+    swap(m_pos,         other.m_pos);
+}
+
+AVCodecID CodecParser::codecId() const noexcept
+{
+    return m_ctx ? m_ctx->codec_id : AV_CODEC_ID_NONE;
+}
+
+void CodecParser::setTimeBase(const Rational &tb) noexcept
+{
+    m_timeBase = tb;
+}
+
+const Rational &CodecParser::timeBase() const noexcept
+{
+    return m_timeBase;
+}
+
+void CodecParser::setStreamIndex(int index) noexcept
+{
+    m_streamIndex = index;
+}
+
+int CodecParser::streamIndex() const noexcept
+{
+    return m_streamIndex;
+}
+
+void CodecParser::setInputPadded(bool padded) noexcept
+{
+    m_inputPadded = padded;
+}
+
+bool CodecParser::isInputPadded() const noexcept
+{
+    return m_inputPadded;
+}
+
+void CodecParser::setCompleteFrames(bool complete) noexcept
+{
+    if (!m_raw)
+        return;
+    if (complete)
+        m_raw->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+    else
+        m_raw->flags &= ~PARSER_FLAG_COMPLETE_FRAMES;
+}
+
+void CodecParser::setChunkTimestamps(const Timestamp &pts, const Timestamp &dts, int64_t pos) noexcept
+{
+    m_pts = pts.isNoPts() || m_timeBase == Rational() ? av::NoPts : pts.timestamp(m_timeBase);
+    m_dts = dts.isNoPts() || m_timeBase == Rational() ? av::NoPts : dts.timestamp(m_timeBase);
+    m_pos = pos;
+}
+
+size_t CodecParser::parse(const uint8_t *data, size_t size, Packet &packet, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!data || !size) {
+        packet.reset();
+        return 0;
+    }
+    return parseCommon(data, size, nullptr, packet, ec);
+}
+
+size_t CodecParser::parse(const Packet &chunk, size_t offset, Packet &packet, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (chunk.isNull() || offset >= chunk.size()) {
+        packet.reset();
+        return 0;
+    }
+    return parseCommon(chunk.data() + offset, chunk.size() - offset, chunk.raw()->buf, packet, ec);
+}
+
+bool CodecParser::flush(Packet &packet, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    parseCommon(nullptr, 0, nullptr, packet, ec);
+    return packet.isComplete();
+}
+
+size_t CodecParser::parseCommon(const uint8_t *data, size_t size, const AVBufferRef *owner, Packet &packet,
+                                OptionalErrorCode ec)
+{
+    packet.reset();
+
+    if (!m_raw || !m_ctx) {
+        throws_if(ec, Errors::Unallocated);
+        return 0;
+    }
+
+    if (size > size_t(INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)) {
+        throws_if(ec, Errors::OutOfRange);
+        return 0;
+    }
+
+    uint8_t *out = nullptr;
+    int outSize = 0;
+
+    auto const sts = av_parser_parse2(m_raw, m_ctx, &out, &outSize, data, int(size), m_pts, m_dts, m_pos);
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return 0;
+    }
+
+    // Timestamps are applied only once per chunk
+    m_pts = av::NoPts;
+    m_dts = av::NoPts;
+    m_pos = -1;
+
+    if (!out || outSize <= 0)
+        return size_t(sts);
+
+    auto pkt = packet.raw();
+
+    // Packet inside current ref-counted chunk: reference it. Otherwise it is assembled by the parser from several
+    // chunks and placed into internal buffer that will be reused on the next call, or the caller memory is not owned
+    // by anybody and can be reused after the call: copy.
+    const bool inChunk = owner &&
+                         out >= data &&
+                         out + outSize <= data + size &&
+                         (m_inputPadded || out + outSize + AV_INPUT_BUFFER_PADDING_SIZE <= owner->data + owner->size);
+
+    if (inChunk) {
+        pkt->buf = av_buffer_ref(owner);
+        if (!pkt->buf) {
+            throws_if(ec, AVERROR(ENOMEM), ffmpeg_category());
+            return size_t(sts);
+        }
+        pkt->data = out;
+        pkt->size = outSize;
+    } else {
+        auto err = av_new_packet(pkt, outSize);
+        if (err < 0) {
+            throws_if(ec, err, ffmpeg_category());
+            return size_t(sts);
+        }
+        std::memcpy(pkt->data, out, size_t(outSize));
+    }
+
+    pkt->pts          = m_raw->pts;
+    pkt->dts          = m_raw->dts;
+    pkt->pos          = m_raw->pos;
+    pkt->stream_index = m_streamIndex;
+    if (m_raw->key_frame == 1)
+        pkt->flags |= AV_PKT_FLAG_KEY;
+
+    packet.setTimeBase(m_timeBase);
+    packet.setComplete(true);
+
+    return size_t(sts);
+}
+
+bool CodecParser::isKeyFrame() const noexcept
+{
+    return RAW_GET(key_frame, 0) == 1;
+}
+
+AVPictureType CodecParser::pictureType() const noexcept
+{
+    return m_raw ? static_cast<AVPictureType>(m_raw->pict_type) : AV_PICTURE_TYPE_NONE;
+}
+
+int CodecParser::width() const noexcept
+{
+    return RAW_GET(width, 0);
+}
+
+int CodecParser::height() const noexcept
+{
+    return RAW_GET(height, 0);
+}
+
+int CodecParser::format() const noexcept
+{
+    return RAW_GET(format, -1);
+}
+
+const AVCodecContext *CodecParser::codecContext() const noexcept
+{
+    return m_ctx;
+}
+
+} // namespace av
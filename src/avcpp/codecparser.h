@@ -0,0 +1,238 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <type_traits>
+
+#if AVCPP_CXX_STANDARD >= 20
+#include <span>
+#endif
+
+#include "ffmpeg.h"
+#include "avutils.h"
+#include "averror.h"
+#include "rational.h"
+#include "timestamp.h"
+#include "packet.h"
+#include "codec.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace av {
+
+/**
+ * @brief The CodecParser class
+ *
+ * Wrapper for the AVCodecParserContext: splits raw elementary stream (H.264 Annex B, MPEG-4 part 2, ADTS AAC and so
+ * on) into the packets suitable for the decoder without demuxer.
+ *
+ * Input data provided by chunks of arbitrary size. Chunks passed as raw memory are not owned by the parser and can
+ * be reused by the caller right after the call, so the output packets are always copied from them. Chunks passed as
+ * ref-counted Packet are referenced instead: output packet that fully lays inside such chunk shares its buffer, no
+ * data copy happens in that case. Data is copied only when packet crosses chunk boundary (parser accumulates data
+ * internally). Referenced packets are read-only.
+ *
+ * FFmpeg requires AV_INPUT_BUFFER_PADDING_SIZE readable bytes after packet payload. If the chunk buffer does not
+ * contain such padding after the packet end, packet is copied. Use setInputPadded(true) to signal that chunk buffers
+ * always have a padding and avoid such copying.
+ *
+ * Simple usage:
+ * @code
+ * CodecParser parser{AV_CODEC_ID_H264};
+ * while (auto size = read(chunk)) {
+ *     parser.parseAll(std::span{chunk.data(), size}, [&](Packet &pkt) {
+ *         auto frame = decoder.decode(pkt);
+ *     });
+ * }
+ * // or, without copy: parser.parseAll(Packet{chunk}, ...)
+ * parser.flushAll([&](Packet &pkt) {...});
+ * @endcode
+ */
+class CodecParser : public FFWrapperPtr<AVCodecParserContext>, public noncopyable
+{
+public:
+    CodecParser() = default;
+    explicit CodecParser(AVCodecID codecId, OptionalErrorCode ec = throws());
+    explicit CodecParser(const Codec &codec, OptionalErrorCode ec = throws());
+
+    ~CodecParser();
+
+    CodecParser(CodecParser &&other);
+    CodecParser& operator=(CodecParser &&rhs);
+
+    void swap(CodecParser &other) noexcept;
+
+    AVCodecID codecId() const noexcept;
+
+    /**
+     * Time base of the timestamps passed via setChunkTimestamps(). It will be assigned to the output packets.
+     */
+    void setTimeBase(const Rational &tb) noexcept;
+    const Rational& timeBase() const noexcept;
+
+    /**
+     * Stream index assigned to the output packets
+     */
+    void setStreamIndex(int index) noexcept;
+    int  streamIndex() const noexcept;
+
+    /**
+     * Mark that buffer of every ref-counted input chunk followed by AV_INPUT_BUFFER_PADDING_SIZE readable bytes, so
+     * packets ended at the buffer end can be referenced instead of copy.
+     */
+    void setInputPadded(bool padded) noexcept;
+    bool isInputPadded() const noexcept;
+
+    /**
+     * Signal that each input chunk contains complete frames: parser does not combine frames from multiple chunks
+     * in this case and only extracts frame properties.
+     */
+    void setCompleteFrames(bool complete) noexcept;
+
+    /**
+     * Timestamps and position of the next passed chunk. Parser maps them to the output packets. Timestamps applied
+     * only to the next one parse() call.
+     */
+    void setChunkTimestamps(const Timestamp &pts, const Timestamp &dts, int64_t pos = -1) noexcept;
+
+    /**
+     * Parse chunk of the data. Only one packet can be produced per call, so parsing must be repeated with the
+     * rest of the data until all data consumed. Output packet holds a copy of the data.
+     *
+     * @param[in]  data    chunk data
+     * @param[in]  size    chunk size
+     * @param[out] packet  output packet, packet.isComplete() signals that it contains data
+     * @param      ec      error code
+     * @return count of consumed bytes
+     */
+    size_t parse(const uint8_t *data, size_t size, Packet &packet, OptionalErrorCode ec = throws());
+
+#if AVCPP_CXX_STANDARD >= 20
+    size_t parse(std::span<const uint8_t> data, Packet &packet, OptionalErrorCode ec = throws())
+    {
+        return parse(data.data(), data.size(), packet, ec);
+    }
+#endif
+
+    /**
+     * Parse ref-counted chunk starting from the offset. Output packet references the chunk buffer when possible.
+     * Chunk without buffer is handled like raw memory.
+     *
+     * @return count of consumed bytes
+     */
+    size_t parse(const Packet &chunk, size_t offset, Packet &packet, OptionalErrorCode ec = throws());
+
+    /**
+     * Parse whole chunk and pass all produced packets into callback with signature `void(Packet &pkt)`. Packet can be
+     * moved out from the callback.
+     *
+     * @return count of the produced packets
+     */
+    template<typename Callable>
+    size_t parseAll(const uint8_t *data, size_t size, Callable &&callable, OptionalErrorCode ec = throws())
+    {
+        clear_if(ec);
+        size_t count = 0;
+        Packet pkt;
+        do {
+            auto consumed = parse(data, size, pkt, ec);
+            if (is_error(ec))
+                return count;
+            data += consumed;
+            size -= consumed;
+            if (pkt.isComplete()) {
+                ++count;
+                callable(pkt);
+            } else if (consumed == 0) {
+                break;
+            }
+        } while (size);
+        return count;
+    }
+
+#if AVCPP_CXX_STANDARD >= 20
+    template<typename Callable>
+    size_t parseAll(std::span<const uint8_t> data, Callable &&callable, OptionalErrorCode ec = throws())
+    {
+        return parseAll(data.data(), data.size(), std::forward<Callable>(callable), ec);
+    }
+#endif
+
+    template<typename Callable>
+    size_t parseAll(const Packet &chunk, Callable &&callable, OptionalErrorCode ec = throws())
+    {
+        clear_if(ec);
+        size_t count = 0;
+        size_t offset = 0;
+        Packet pkt;
+        while (offset < chunk.size()) {
+            auto consumed = parse(chunk, offset, pkt, ec);
+            if (is_error(ec))
+                return count;
+            offset += consumed;
+            if (pkt.isComplete()) {
+                ++count;
+                callable(pkt);
+            } else if (consumed == 0) {
+                break;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Signal end of stream and get buffered packet.
+     *
+     * @return true if packet produced
+     */
+    bool flush(Packet &packet, OptionalErrorCode ec = throws());
+
+    /**
+     * Flush all buffered packets into callback.
+     *
+     * @return count of the produced packets
+     */
+    template<typename Callable>
+    size_t flushAll(Callable &&callable, OptionalErrorCode ec = throws())
+    {
+        size_t count = 0;
+        Packet pkt;
+        while (flush(pkt, ec)) {
+            ++count;
+            callable(pkt);
+        }
+        return count;
+    }
+
+    //
+    // Properties of the last parsed frame
+    //
+    bool          isKeyFrame() const noexcept;
+    AVPictureType pictureType() const noexcept;
+    int           width() const noexcept;
+    int           height() const noexcept;
+    int           format() const noexcept;
+
+    /**
+     * Access to the internal codec context used by parser. Parsers can fill some of the stream properties, like
+     * profile, level, extradata and so on.
+     */
+    const AVCodecContext* codecContext() const noexcept;
+
+private:
+    size_t parseCommon(const uint8_t *data, size_t size, const AVBufferRef *owner, Packet &packet,
+                       OptionalErrorCode ec);
+
+private:
+    AVCodecContext *m_ctx = nullptr;
+    Rational        m_timeBase;
+    int             m_streamIndex = -1;
+    bool            m_inputPadded = false;
+    int64_t         m_pts = av::NoPts;
+    int64_t         m_dts = av::NoPts;
+    int64_t         m_pos = -1;
+};
+
+} // namespace av
@@ -0,0 +1,252 @@
+#include "coroutines.h"
+
+#if AVCPP_CXX_STANDARD >= 20
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+// Timer thread shared by the SchedulerExecutors: delayed functions are run on it when due, so they must be short
+// (post to the scheduler). Functions are run under the lock: cancel() returns when no function of the owner runs.
+class TimerThread
+{
+public:
+    static TimerThread& instance()
+    {
+        static TimerThread timer;
+        return timer;
+    }
+
+    ~TimerThread()
+    {
+        {
+            lock_guard lock{m_mutex};
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    void add(const void *owner, chrono::steady_clock::time_point due, std::function<void()> fn)
+    {
+        {
+            lock_guard lock{m_mutex};
+            if (!m_thread.joinable())
+                m_thread = std::thread([this] { loop(); });
+            m_timers.emplace(due, Timer{owner, std::move(fn)});
+        }
+        m_cond.notify_all();
+    }
+
+    void cancel(const void *owner)
+    {
+        lock_guard lock{m_mutex};
+        std::erase_if(m_timers, [owner](auto const &item) { return item.second.owner == owner; });
+    }
+
+private:
+    struct Timer
+    {
+        const void           *owner;
+        std::function<void()> fn;
+    };
+
+    void loop()
+    {
+        unique_lock lock{m_mutex};
+        while (!m_stop) {
+            if (m_timers.empty()) {
+                m_cond.wait(lock);
+                continue;
+            }
+            auto const first = m_timers.begin();
+            if (first->first > chrono::steady_clock::now()) {
+                m_cond.wait_until(lock, first->first);
+                continue;
+            }
+            auto fn = std::move(first->second.fn);
+            m_timers.erase(first);
+            fn();
+        }
+    }
+
+private:
+    std::mutex                                             m_mutex;
+    std::condition_variable                                m_cond;
+    std::multimap<chrono::steady_clock::time_point, Timer> m_timers;
+    std::thread                                            m_thread;
+    bool                                                   m_stop = false;
+};
+
+} // anonymous namespace
+
+//
+// Executor
+//
+
+void Executor::postAfter(std::chrono::nanoseconds /*delay*/, std::function<void()> fn)
+{
+    post(std::move(fn));
+}
+
+//
+// ManualExecutor
+//
+
+void ManualExecutor::post(std::function<void()> fn)
+{
+    {
+        lock_guard lock{m_mutex};
+        m_queue.push_back(std::move(fn));
+    }
+    m_cond.notify_all();
+}
+
+void ManualExecutor::postAfter(std::chrono::nanoseconds delay, std::function<void()> fn)
+{
+    {
+        lock_guard lock{m_mutex};
+        m_delayed.emplace(Clock::now() + delay, std::move(fn));
+    }
+    m_cond.notify_all();
+}
+
+void ManualExecutor::queueDueLocked(std::chrono::steady_clock::time_point now)
+{
+    while (!m_delayed.empty() && m_delayed.begin()->first <= now) {
+        m_queue.push_back(std::move(m_delayed.begin()->second));
+        m_delayed.erase(m_delayed.begin());
+    }
+}
+
+bool ManualExecutor::runOne()
+{
+    std::function<void()> fn;
+    {
+        lock_guard lock{m_mutex};
+        if (m_queue.empty() && !m_delayed.empty())
+            queueDueLocked(Clock::now());
+        if (m_queue.empty())
+            return false;
+        fn = std::move(m_queue.front());
+        m_queue.pop_front();
+    }
+    fn();
+    return true;
+}
+
+size_t ManualExecutor::run()
+{
+    size_t count = 0;
+    while (runOne())
+        ++count;
+    return count;
+}
+
+bool ManualExecutor::waitDelayed()
+{
+    unique_lock lock{m_mutex};
+    while (m_queue.empty()) {
+        if (m_delayed.empty())
+            return false;
+        auto const due = m_delayed.begin()->first;
+        if (due <= Clock::now()) {
+            queueDueLocked(Clock::now());
+            break;
+        }
+        m_cond.wait_until(lock, due);
+    }
+    return true;
+}
+
+size_t ManualExecutor::pending() const
+{
+    lock_guard lock{m_mutex};
+    return m_queue.size();
+}
+
+size_t ManualExecutor::delayed() const
+{
+    lock_guard lock{m_mutex};
+    return m_delayed.size();
+}
+
+//
+// SchedulerExecutor
+//
+
+SchedulerExecutor::SchedulerExecutor(JobScheduler &scheduler, std::shared_ptr<Job> job)
+    : m_scheduler(scheduler),
+      m_job(std::move(job))
+{
+    if (!m_job)
+        m_job = m_scheduler.createJob("coroutines");
+}
+
+SchedulerExecutor::~SchedulerExecutor()
+{
+    TimerThread::instance().cancel(this);
+}
+
+void SchedulerExecutor::post(std::function<void()> fn)
+{
+    m_scheduler.post(m_job, std::move(fn));
+}
+
+void SchedulerExecutor::postAfter(std::chrono::nanoseconds delay, std::function<void()> fn)
+{
+    TimerThread::instance().add(this, chrono::steady_clock::now() + delay,
+                                [&scheduler = m_scheduler, job = m_job, fn = std::move(fn)]() mutable {
+                                    scheduler.post(job, std::move(fn));
+                                });
+}
+
+#if AVCPP_HAS_AVFORMAT
+//
+// AsyncDemuxer
+//
+
+AsyncDemuxer::AsyncDemuxer(FormatContext &ctx, Executor &executor) noexcept
+    : m_ctx(ctx),
+      m_executor(executor)
+{
+}
+
+bool AsyncDemuxer::tryRead(Packet &packet, std::error_code &error)
+{
+    error.clear();
+    packet = Packet();
+    // Single attempt: retries are delayed by the executor instead of the busy loop
+    auto const st = m_ctx.readPacketCommon(packet, 0);
+    if (st.second && st.second == &ffmpeg_category() && st.first == AVERROR(EAGAIN))
+        return false;
+    if (st.second)
+        error = std::error_code(st.first, *st.second);
+    m_retryDelay = MinRetryDelay;
+    return true;
+}
+
+void AsyncDemuxer::retry(std::coroutine_handle<> handle, Packet &packet, std::error_code &error)
+{
+    ++m_retries;
+    auto const delay = m_retryDelay;
+    m_retryDelay = std::min(m_retryDelay * 2, MaxRetryDelay);
+    // Packet and error are members of the awaiter: alive while coroutine is suspended
+    m_executor.postAfter(delay, [this, handle, &packet, &error] {
+        if (tryRead(packet, error))
+            handle.resume();
+        else
+            retry(handle, packet, error);
+    });
+}
+#endif // if AVCPP_HAS_AVFORMAT
+
+} // namespace av
+
+#endif // if AVCPP_CXX_STANDARD >= 20
@@ -0,0 +1,600 @@
+#pragma once
+
+#include "avcompat.h"
+
+#if AVCPP_CXX_STANDARD >= 20
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "avutils.h"
+#include "averror.h"
+#include "packet.h"
+#include "frame.h"
+#include "jobscheduler.h"
+
+#if AVCPP_HAS_AVFORMAT
+#include "formatcontext.h"
+#endif // if AVCPP_HAS_AVFORMAT
+
+namespace av {
+
+/**
+ * @brief The Executor class
+ *
+ * Runs coroutines continuations. Implement it to drive coroutines from the own event loop.
+ */
+class Executor
+{
+public:
+    virtual ~Executor() = default;
+
+    /**
+     * Queue function to run later. Can be called from any thread.
+     */
+    virtual void post(std::function<void()> fn) = 0;
+
+    /**
+     * Queue function to run not earlier than after the delay. Can be called from any thread.
+     *
+     * Default implementation has no timers and posts at once: override it for the executors that wait on
+     * not-ready inputs, see AsyncDemuxer.
+     */
+    virtual void postAfter(std::chrono::nanoseconds delay, std::function<void()> fn);
+
+    /**
+     * Awaitable: continue coroutine on this executor. Also used to yield to other coroutines.
+     */
+    auto schedule() noexcept
+    {
+        struct Awaiter
+        {
+            Executor &executor;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { executor.post([handle] { handle.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+};
+
+/**
+ * Single thread event loop: functions are queued by post() and run by the thread that calls run(). Delayed functions
+ * join the queue when their time comes, run() does not wait for them.
+ *
+ * @code
+ * do {
+ *     executor.run();
+ * } while (executor.waitDelayed());
+ * @endcode
+ */
+class ManualExecutor : public Executor, public noncopyable
+{
+public:
+    void post(std::function<void()> fn) override;
+    void postAfter(std::chrono::nanoseconds delay, std::function<void()> fn) override;
+
+    /**
+     * Run single queued function
+     * @return false if queue is empty
+     */
+    bool runOne();
+
+    /**
+     * Run queued functions, including newly posted ones and the due delayed ones, till queue is empty
+     * @return count of run functions
+     */
+    size_t run();
+
+    /**
+     * Block till some function is queued: the first delayed one is due or other thread posts
+     * @return false if there is nothing to wait for: queue and delayed functions are empty
+     */
+    bool waitDelayed();
+
+    /// Queued functions, ready to run
+    size_t pending() const;
+
+    /// Delayed functions, not due yet
+    size_t delayed() const;
+
+private:
+    void queueDueLocked(std::chrono::steady_clock::time_point now);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    mutable std::mutex                                      m_mutex;
+    std::condition_variable                                 m_cond;
+    std::deque<std::function<void()>>                       m_queue;
+    std::multimap<Clock::time_point, std::function<void()>> m_delayed;
+};
+
+/**
+ * Run coroutines as tasks of the JobScheduler job
+ */
+class SchedulerExecutor : public Executor
+{
+public:
+    SchedulerExecutor(JobScheduler &scheduler, std::shared_ptr<Job> job);
+    ~SchedulerExecutor();
+
+    /**
+     * Delayed functions are posted to the scheduler by the timer thread shared by all SchedulerExecutors. Ones
+     * not due yet are dropped with the executor.
+     */
+    void postAfter(std::chrono::nanoseconds delay, std::function<void()> fn) override;
+    void post(std::function<void()> fn) override;
+
+    const std::shared_ptr<Job>& job() const noexcept { return m_job; }
+
+private:
+    JobScheduler        &m_scheduler;
+    std::shared_ptr<Job> m_job;
+};
+
+template<typename T = void>
+class Task;
+
+namespace coro_detail {
+
+class TaskPromiseBase
+{
+public:
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            // Symmetric transfer: no stack growth on long chains of the awaited tasks
+            auto continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr      error;
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U &&value)
+    {
+        m_value.emplace(std::forward<U>(value));
+    }
+
+    T result()
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void result() const
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+} // namespace coro_detail
+
+/**
+ * @brief The Task class
+ *
+ * Lazy coroutine: starts when awaited (co_await task) or spawned, see spawn(). Result or exception is passed to the
+ * awaiting coroutine.
+ */
+template<typename T>
+class Task
+{
+public:
+    using promise_type = coro_detail::TaskPromise<T>;
+    using handle_type  = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(handle_type handle) noexcept : m_handle(handle) {}
+
+    Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    Task& operator=(Task &&other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    bool isValid() const noexcept { return bool(m_handle); }
+    bool isDone() const noexcept { return m_handle && m_handle.done(); }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            handle_type handle;
+
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+            {
+                handle.promise().continuation = continuation;
+                return handle;
+            }
+
+            T await_resume()
+            {
+                if (!handle)
+                    throw Exception(make_error_code(Errors::Unallocated));
+                return handle.promise().result();
+            }
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    handle_type m_handle;
+};
+
+namespace coro_detail {
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+}
+
+// Fire-and-forget coroutine: frame is destroyed on completion
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+inline Detached runDetached(Executor &executor, Task<void> task, std::function<void(std::exception_ptr)> done)
+{
+    co_await executor.schedule();
+
+    std::exception_ptr error;
+    try {
+        co_await std::move(task);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    if (done)
+        done(error);
+}
+
+} // namespace coro_detail
+
+/**
+ * Start task on the executor without waiting for it.
+ *
+ * @param done  called on completion with the task exception or null. Exception is dropped if not set.
+ */
+inline void spawn(Executor &executor, Task<void> task, std::function<void(std::exception_ptr)> done = {})
+{
+    coro_detail::runDetached(executor, std::move(task), std::move(done));
+}
+
+/**
+ * @brief The Generator class
+ *
+ * Lazy synchronous sequence: values are produced by co_yield on iteration. Yielded values are referenced, not
+ * copied, and can be moved out by the consumer.
+ *
+ * @code
+ * for (auto &frame : decodeFrames(decoder, packets(ictx), videoStream))
+ *     process(std::move(frame));
+ * @endcode
+ */
+template<typename T>
+class Generator
+{
+public:
+    struct promise_type
+    {
+        Generator get_return_object() noexcept
+        {
+            return Generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        std::suspend_always final_suspend() const noexcept { return {}; }
+
+        std::suspend_always yield_value(T &item) noexcept
+        {
+            value = std::addressof(item);
+            return {};
+        }
+
+        std::suspend_always yield_value(T &&item) noexcept
+        {
+            value = std::addressof(item);
+            return {};
+        }
+
+        void return_void() const noexcept {}
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        // Synchronous: no co_await inside generators
+        template<typename U>
+        std::suspend_never await_transform(U &&) = delete;
+
+        T                 *value = nullptr;
+        std::exception_ptr error;
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = T*;
+        using reference         = T&;
+
+        iterator() = default;
+        explicit iterator(handle_type handle) noexcept : m_handle(handle) {}
+
+        reference operator*() const noexcept { return *m_handle.promise().value; }
+        pointer operator->() const noexcept { return m_handle.promise().value; }
+
+        iterator& operator++()
+        {
+            Generator::advance(m_handle);
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator &it, std::default_sentinel_t) noexcept
+        {
+            return !it.m_handle || it.m_handle.done();
+        }
+
+    private:
+        handle_type m_handle;
+    };
+
+    Generator() = default;
+    explicit Generator(handle_type handle) noexcept : m_handle(handle) {}
+
+    Generator(Generator &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    Generator& operator=(Generator &&other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+
+    ~Generator()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    /**
+     * Start iteration. Generator can be iterated once.
+     */
+    iterator begin()
+    {
+        advance(m_handle);
+        return iterator{m_handle};
+    }
+
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+    static void advance(handle_type handle)
+    {
+        if (!handle || handle.done())
+            return;
+        handle.resume();
+        if (handle.promise().error)
+            std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+    }
+
+private:
+    handle_type m_handle;
+};
+
+#if AVCPP_HAS_AVFORMAT
+/**
+ * @brief The AsyncDemuxer class
+ *
+ * Awaitable packets reading. If input returns EAGAIN (non-blocking custom IO or network input opened with
+ * the "nonblock" flag), coroutine is suspended and reading is retried from the executor after a delay, so other
+ * coroutines run meanwhile. Delay grows twice on every EAGAIN in a row, from MinRetryDelay up to MaxRetryDelay: idle
+ * inputs do not load the executor. One thread can serve many inputs this way.
+ *
+ * @code
+ * Task<> process(AsyncDemuxer &demuxer)
+ * {
+ *     while (auto pkt = co_await demuxer.next()) {
+ *         ...
+ *     }
+ * }
+ * @endcode
+ */
+class AsyncDemuxer : public noncopyable
+{
+    struct NextAwaiter
+    {
+        AsyncDemuxer     &demuxer;
+        OptionalErrorCode ec;
+        Packet            packet;
+        std::error_code   error;
+
+        bool await_ready() { return demuxer.tryRead(packet, error); }
+        void await_suspend(std::coroutine_handle<> handle) { demuxer.retry(handle, packet, error); }
+
+        Packet await_resume()
+        {
+            clear_if(ec);
+            if (error)
+                throws_if(ec, error.value(), error.category());
+            return std::move(packet);
+        }
+    };
+
+public:
+    static constexpr std::chrono::microseconds MinRetryDelay{500};
+    static constexpr std::chrono::microseconds MaxRetryDelay{50'000};
+
+    AsyncDemuxer(FormatContext &ctx, Executor &executor) noexcept;
+
+    /**
+     * Awaitable: read next packet. Null packet means EOF.
+     */
+    NextAwaiter next(OptionalErrorCode ec = throws()) { return NextAwaiter{*this, ec, Packet(), {}}; }
+
+    /**
+     * Count of reading retries on EAGAIN
+     */
+    uint64_t retries() const noexcept { return m_retries; }
+
+    FormatContext& context() noexcept { return m_ctx; }
+
+private:
+    bool tryRead(Packet &packet, std::error_code &error);
+    void retry(std::coroutine_handle<> handle, Packet &packet, std::error_code &error);
+
+private:
+    FormatContext            &m_ctx;
+    Executor                 &m_executor;
+    uint64_t                  m_retries = 0;
+    std::chrono::microseconds m_retryDelay = MinRetryDelay;
+};
+
+/**
+ * Packets of the input till EOF, blocking reads
+ */
+inline Generator<Packet> packets(FormatContext &ctx)
+{
+    while (true) {
+        auto pkt = ctx.readPacket();
+        if (!pkt)
+            co_return;
+        co_yield std::move(pkt);
+    }
+}
+#endif // if AVCPP_HAS_AVFORMAT
+
+/**
+ * Decoded frames of the packets sequence. Decoder is flushed after the last packet.
+ *
+ * @param streamIndex  packets of other streams are ignored, -1 - decode all
+ */
+template<typename Decoder>
+auto decodeFrames(Decoder &decoder, Generator<Packet> packets, int streamIndex = -1)
+    -> Generator<decltype(decoder.decode(std::declval<const Packet&>()))>
+{
+    for (auto &pkt : packets) {
+        if (streamIndex >= 0 && pkt.streamIndex() != streamIndex)
+            continue;
+        auto frame = decoder.decode(pkt);
+        if (frame)
+            co_yield std::move(frame);
+    }
+
+    while (true) {
+        auto frame = decoder.decode(Packet());
+        if (!frame)
+            break;
+        co_yield std::move(frame);
+    }
+}
+
+/**
+ * Encoded packets of the frames sequence. Encoder is flushed after the last frame.
+ */
+template<typename Encoder, typename Frame>
+Generator<Packet> encodePackets(Encoder &encoder, Generator<Frame> frames)
+{
+    for (auto &frame : frames) {
+        auto pkt = encoder.encode(frame);
+        if (pkt)
+            co_yield std::move(pkt);
+    }
+
+    while (true) {
+        auto pkt = encoder.encode();
+        if (!pkt)
+            break;
+        co_yield std::move(pkt);
+    }
+}
+
+} // namespace av
+
+#endif // if AVCPP_CXX_STANDARD >= 20
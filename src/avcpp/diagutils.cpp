@@ -0,0 +1,43 @@
+#include "diagutils.h"
+
+#include <atomic>
+
+using namespace std;
+
+namespace av {
+
+namespace internal {
+
+uint32_t thread_id() noexcept
+{
+    static atomic<uint32_t> next{1};
+    thread_local uint32_t id = next.fetch_add(1, memory_order_relaxed);
+    return id;
+}
+
+size_t round_pow2(size_t value) noexcept
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+string escape(string_view str)
+{
+    string out;
+    out.reserve(str.size());
+    for (auto ch : str) {
+        switch (ch) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            default:   out += ch;
+        }
+    }
+    return out;
+}
+
+} // ::internal
+
+} // namespace av
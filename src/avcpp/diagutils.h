@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace av {
+
+namespace internal {
+
+/**
+ * Sequential id of the current thread, starting from 1. Shared by the Tracer and LogSink: logs and traces of the
+ * same thread have the same id.
+ */
+uint32_t thread_id() noexcept;
+
+/**
+ * Smallest power of two not less than value
+ */
+size_t round_pow2(size_t value) noexcept;
+
+/**
+ * Escape quotes, backslashes and newlines: JSON strings and Prometheus label values
+ */
+std::string escape(std::string_view str);
+
+} // ::internal
+
+} // namespace av
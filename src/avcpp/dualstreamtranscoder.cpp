@@ -0,0 +1,170 @@
+#include "dualstreamtranscoder.h"
+
+#if AVCPP_HAS_AVFORMAT
+
+#include <vector>
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+// Output of the branch: packets go to the shared muxer, stream is finished on EOF
+struct MuxSink
+{
+    InterleavingMuxer &muxer;
+    int                stream;
+    uint64_t          &count;
+
+    void operator()(Packet &&pkt)
+    {
+        pkt.setStreamIndex(stream);
+        muxer.write(std::move(pkt));
+        ++count;
+    }
+
+    void finish()
+    {
+        muxer.finishStream(size_t(stream));
+    }
+};
+
+} // anonymous namespace
+
+DualStreamTranscoder::DualStreamTranscoder(FormatContext &input, FormatContext &output)
+    : DualStreamTranscoder(input, output, Options{})
+{
+}
+
+DualStreamTranscoder::DualStreamTranscoder(FormatContext &input, FormatContext &output, const Options &options)
+    : m_input(input),
+      m_output(output),
+      m_options(options)
+{
+}
+
+void DualStreamTranscoder::setVideo(int inputStream, VideoDecoderContext &decoder, VideoEncoderContext &encoder,
+                                    int outputStream, VideoRescaler *rescaler)
+{
+    m_video = {inputStream, outputStream, &decoder, &encoder, rescaler};
+}
+
+void DualStreamTranscoder::setAudio(int inputStream, AudioDecoderContext &decoder, AudioEncoderContext &encoder,
+                                    int outputStream, AudioResampler *resampler)
+{
+    m_audio = {inputStream, outputStream, &decoder, &encoder, resampler};
+}
+
+void DualStreamTranscoder::transcode(OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (!m_video.decoder && !m_audio.decoder) {
+        throws_if(ec, Errors::InvalidArgument);
+        return;
+    }
+
+    m_stats = Stats{};
+
+    InterleavingMuxer muxer{m_output, m_options.lookahead};
+    Pipeline pl{m_options.queueCapacity};
+
+    // Demuxed packets are routed by stream: other streams are dropped
+    auto const videoInput = m_video.decoder ? m_video.inputStream : -1;
+    auto const audioInput = m_audio.decoder ? m_audio.inputStream : -1;
+    size_t const videoIndex = 0;
+    size_t const audioIndex = m_video.decoder ? 1 : 0;
+    size_t const branches   = (m_video.decoder ? 1 : 0) + (m_audio.decoder ? 1 : 0);
+
+    auto packets = pl.source<Packet>(pipeline::demux(m_input));
+    auto routed  = pl.split(packets, branches, [=](const Packet &pkt) -> size_t {
+        if (pkt.streamIndex() == videoInput)
+            return videoIndex;
+        if (pkt.streamIndex() == audioInput)
+            return audioIndex;
+        return branches;
+    });
+
+    if (m_video.decoder) {
+        auto const &video = m_video;
+        auto frames = pl.stage<VideoFrame>(routed[videoIndex], pipeline::decode(*video.decoder));
+        if (video.converter)
+            frames = pl.stage<VideoFrame>(frames, pipeline::rescale(*video.converter));
+
+        auto prepared = pl.stage<VideoFrame>(frames,
+            [&video, &count = m_stats.videoFrames](VideoFrame &&frame, const PipelineEmitter<VideoFrame> &emit) {
+                frame.setTimeBase(video.encoder->timeBase());
+                frame.setStreamIndex(video.outputStream);
+                frame.setPictureType();
+                ++count;
+                emit(std::move(frame));
+            });
+
+        auto encoded = pl.stage<Packet>(prepared, pipeline::encode(*video.encoder));
+        pl.sink(encoded, MuxSink{muxer, video.outputStream, m_stats.videoPackets});
+    }
+
+    if (m_audio.decoder) {
+        auto const &audio = m_audio;
+        auto samples = pl.stage<AudioSamples>(routed[audioIndex], pipeline::decode(*audio.decoder));
+        if (audio.converter)
+            samples = pl.stage<AudioSamples>(samples, pipeline::resample(*audio.converter, size_t(audio.encoder->frameSize())));
+
+        auto prepared = pl.stage<AudioSamples>(samples,
+            [&audio, &count = m_stats.audioFrames](AudioSamples &&samples, const PipelineEmitter<AudioSamples> &emit) {
+                samples.setTimeBase(audio.encoder->timeBase());
+                samples.setStreamIndex(audio.outputStream);
+                ++count;
+                emit(std::move(samples));
+            });
+
+        auto encoded = pl.stage<Packet>(prepared, pipeline::encode(*audio.encoder));
+        pl.sink(encoded, MuxSink{muxer, audio.outputStream, m_stats.audioPackets});
+    }
+
+    {
+        lock_guard lock{m_mutex};
+        if (m_cancelled) {
+            m_cancelled = false;
+            return;
+        }
+        pl.run(ec);
+        if (ec && *ec)
+            return;
+        m_pipeline = &pl;
+    }
+
+    auto const detach = [this] {
+        lock_guard lock{m_mutex};
+        m_pipeline  = nullptr;
+        m_cancelled = false;
+    };
+
+    try {
+        pl.wait(ec);
+    } catch (...) {
+        detach();
+        throw;
+    }
+    detach();
+
+    if (!ec || !*ec) {
+        if (!pl.isCancelled())
+            muxer.flush(ec);
+    }
+
+    m_stats.muxer = muxer.stats();
+}
+
+void DualStreamTranscoder::cancel()
+{
+    lock_guard lock{m_mutex};
+    m_cancelled = true;
+    if (m_pipeline)
+        m_pipeline->cancel();
+}
+
+} // namespace av
+
+#endif // if AVCPP_HAS_AVFORMAT
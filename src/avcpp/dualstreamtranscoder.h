@@ -0,0 +1,111 @@
+#pragma once
+
+#include "avcompat.h"
+
+#if AVCPP_HAS_AVFORMAT
+
+#include <cstdint>
+#include <mutex>
+
+#include "pipeline.h"
+#include "interleavingmuxer.h"
+
+namespace av {
+
+/**
+ * @brief The DualStreamTranscoder class
+ *
+ * Transcodes video and audio streams of the input at once: every media type is decoded, converted and encoded on
+ * own threads, encoded packets are written by the InterleavingMuxer. Cheap audio encoding is hidden behind the
+ * video one instead of waiting for it.
+ *
+ * Contexts are referenced, not copied, and must outlive transcode(). Decoders and encoders must be opened and
+ * output header written before transcode(), trailer - after it.
+ *
+ * @code
+ * DualStreamTranscoder tr{ictx, octx};
+ * tr.setVideo(videoStream, vdec, venc, 0);
+ * tr.setAudio(audioStream, adec, aenc, 1, &resampler);
+ * octx.writeHeader();
+ * tr.transcode();
+ * octx.writeTrailer();
+ * @endcode
+ */
+class DualStreamTranscoder : public noncopyable
+{
+public:
+    struct Options
+    {
+        size_t queueCapacity = 16; ///< capacity of the queues between stages
+        size_t lookahead     = 64; ///< InterleavingMuxer lookahead
+    };
+
+    /**
+     * Counters of the last transcode() call
+     */
+    struct Stats
+    {
+        uint64_t                 videoFrames  = 0;
+        uint64_t                 audioFrames  = 0;
+        uint64_t                 videoPackets = 0;
+        uint64_t                 audioPackets = 0;
+        InterleavingMuxer::Stats muxer;
+    };
+
+    DualStreamTranscoder(FormatContext &input, FormatContext &output);
+    DualStreamTranscoder(FormatContext &input, FormatContext &output, const Options &options);
+
+    /**
+     * @param rescaler  optional: convert decoded frames to the encoder size and pixel format
+     */
+    void setVideo(int inputStream, VideoDecoderContext &decoder, VideoEncoderContext &encoder, int outputStream,
+                  VideoRescaler *rescaler = nullptr);
+
+    /**
+     * @param resampler  optional: convert decoded samples to the encoder format and frame size
+     */
+    void setAudio(int inputStream, AudioDecoderContext &decoder, AudioEncoderContext &encoder, int outputStream,
+                  AudioResampler *resampler = nullptr);
+
+    /**
+     * Transcode till the input EOF. Blocks caller.
+     */
+    void transcode(OptionalErrorCode ec = throws());
+
+    /**
+     * Stop transcode() from other thread
+     */
+    void cancel();
+
+    /**
+     * Valid after transcode() returns
+     */
+    const Stats& stats() const noexcept { return m_stats; }
+
+private:
+    template<typename Decoder, typename Encoder, typename Converter>
+    struct Branch
+    {
+        int        inputStream  = -1;
+        int        outputStream = -1;
+        Decoder   *decoder      = nullptr;
+        Encoder   *encoder      = nullptr;
+        Converter *converter    = nullptr;
+    };
+
+    FormatContext &m_input;
+    FormatContext &m_output;
+    Options        m_options;
+    Stats          m_stats;
+
+    Branch<VideoDecoderContext, VideoEncoderContext, VideoRescaler>  m_video;
+    Branch<AudioDecoderContext, AudioEncoderContext, AudioResampler> m_audio;
+
+    std::mutex m_mutex;
+    Pipeline  *m_pipeline = nullptr;
+    bool       m_cancelled = false;
+};
+
+} // namespace av
+
+#endif // if AVCPP_HAS_AVFORMAT
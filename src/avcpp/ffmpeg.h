@@ -31,12 +31,16 @@ struct FFWrapperPtr
 
     void _log(int level, const char *fmt) const
     {
+        if (level > av_log_get_level())
+            return;
         av_log(m_raw, level, fmt);
     }
 
     template<typename... Args>
     void _log(int level, const char* fmt, const Args&... args) const
     {
+        if (level > av_log_get_level())
+            return;
         av_log(m_raw, level, fmt, args...);
     }
 
@@ -75,12 +79,16 @@ struct FFWrapperRef
 
     void _log(int level, const char *fmt) const
     {
+        if (level > av_log_get_level())
+            return;
         av_log(&m_raw, level, fmt);
     }
 
     template<typename... Args>
     void _log(int level, const char* fmt, const Args&... args) const
     {
+        if (level > av_log_get_level())
+            return;
         av_log(&m_raw, level, fmt, args...);
     }
 
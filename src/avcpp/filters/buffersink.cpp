@@ -1,6 +1,8 @@
 #include <cassert>
 
 #include "buffersink.h"
+#include "instrumentation.h"
+#include "tracing.h"
 
 #if AVCPP_HAS_AVFILTER
 
@@ -64,6 +66,16 @@ bool BufferSinkFilterContext::getAudioFrame(AudioSamples &samples, OptionalError
     return getAudioFrame(samples, 0, ec);
 }
 
+Result<VideoFrame> BufferSinkFilterContext::tryGetVideoFrame(int flags)
+{
+    return tryGetFrame<VideoFrame>(FilterMediaType::Video, flags);
+}
+
+Result<AudioSamples> BufferSinkFilterContext::tryGetAudioFrame(int flags)
+{
+    return tryGetFrame<AudioSamples>(FilterMediaType::Audio, flags);
+}
+
 bool BufferSinkFilterContext::getAudioSamples(AudioSamples &samples, size_t samplesCount, OptionalErrorCode ec)
 {
     if (m_type != FilterMediaType::Audio) {
@@ -124,35 +136,66 @@ FilterMediaType BufferSinkFilterContext::checkFilter(const Filter &filter) noexc
 bool BufferSinkFilterContext::getFrame(AVFrame *frame, int flags, OptionalErrorCode ec)
 {
     clear_if(ec);
-    if (!m_sink) {
-        throws_if(ec, Errors::Unallocated);
+
+    auto st = getFrameCommon(frame, flags);
+    if (get<1>(st)) {
+        throws_if(ec, get<0>(st), *get<1>(st));
         return false;
     }
-
-    if (m_req == ReqGetSamples) {
-        throws_if(ec, Errors::MixBufferSinkAccess);
+    if (get<0>(st) < 0) {
+        // AVERROR_EOF or AVERROR(EAGAIN)
+        if (ec) {
+            *ec = make_ffmpeg_error(get<0>(st));
+        }
         return false;
     }
+    return true;
+}
+
+std::pair<int, const error_category*> BufferSinkFilterContext::getFrameCommon(AVFrame *frame, int flags)
+{
+    AVCPP_INSTRUMENT("buffersink", m_sink.raw(), m_sink.raw() ? m_sink.raw()->name : nullptr);
+    AVCPP_TRACE("filter_pull");
+    if (!m_sink)
+        return {static_cast<int>(Errors::Unallocated), &avcpp_category()};
+
+    if (m_req == ReqGetSamples)
+        return {static_cast<int>(Errors::MixBufferSinkAccess), &avcpp_category()};
 
     m_req = ReqGetFrame;
 
     int sts = av_buffersink_get_frame_flags(m_sink.raw(), frame, flags);
     if (sts < 0) {
-        if (sts == AVERROR_EOF || sts == AVERROR(EAGAIN)) {
-            if (ec) {
-                *ec = make_ffmpeg_error(sts);
-            }
-        } else {
-            throws_if(ec, sts, ffmpeg_category());
-        }
-        return false;
+        if (sts == AVERROR_EOF || sts == AVERROR(EAGAIN))
+            return {sts, nullptr};
+        return {sts, &ffmpeg_category()};
     }
-    return true;
+    AVCPP_INSTRUMENT_BYTES(Instrumentation::frameBytes(frame));
+    AVCPP_TRACE_STREAM(-1, frame->pts);
+    return {0, nullptr};
+}
+
+template<typename T>
+Result<T> BufferSinkFilterContext::tryGetFrame(FilterMediaType type, int flags)
+{
+    if (m_type != type)
+        return Result<T>::error(Errors::IncorrectBufferSinkMediaType);
+
+    T frame;
+    auto st = getFrameCommon(frame.raw(), flags);
+    if (get<1>(st))
+        return Result<T>::error(get<0>(st), *get<1>(st));
+    if (get<0>(st) < 0)
+        return make_result_status<T>(get<0>(st));
+    frame.setComplete(true);
+    return Result<T>(std::move(frame));
 }
 
 bool BufferSinkFilterContext::getSamples(AVFrame *frame, int nbSamples, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_INSTRUMENT("buffersink", m_sink.raw(), m_sink.raw() ? m_sink.raw()->name : nullptr);
+    AVCPP_TRACE("filter_pull");
     if (!m_sink) {
         throws_if(ec, Errors::Unallocated);
         return false;
@@ -176,6 +219,8 @@ bool BufferSinkFilterContext::getSamples(AVFrame *frame, int nbSamples, Optional
         }
         return false;
     }
+    AVCPP_INSTRUMENT_BYTES(Instrumentation::frameBytes(frame));
+    AVCPP_TRACE_STREAM(-1, frame->pts);
     return true;
 }
 
@@ -10,6 +10,7 @@
 #include "avcpp/ffmpeg.h"
 #include "avcpp/rational.h"
 #include "avcpp/averror.h"
+#include "avcpp/result.h"
 #include "avcpp/frame.h"
 #include "filter.h"
 #include "filtercontext.h"
@@ -40,6 +41,15 @@ public:
     bool getAudioFrame(AudioSamples &samples, OptionalErrorCode ec = throws());
     bool getAudioSamples(AudioSamples &samples, size_t samplesCount, OptionalErrorCode ec = throws());
 
+    /// @{
+    /**
+     * Non-throwing getVideoFrame()/getAudioFrame()
+     * @return frame; Again if filter graph needs more input; Eof if graph is flushed; Error otherwise
+     */
+    Result<VideoFrame>   tryGetVideoFrame(int flags = 0);
+    Result<AudioSamples> tryGetAudioFrame(int flags = 0);
+    /// @}
+
     void     setFrameSize(unsigned size, OptionalErrorCode ec = throws());
     Rational frameRate(OptionalErrorCode ec = throws());
 
@@ -51,6 +61,12 @@ private:
     bool getFrame(AVFrame *frame, int flags, OptionalErrorCode ec);
     bool getSamples(AVFrame *frame, int nbSamples, OptionalErrorCode ec);
 
+    // AVERROR_EOF and AVERROR(EAGAIN) are returned with null category
+    std::pair<int, const std::error_category*> getFrameCommon(AVFrame *frame, int flags);
+
+    template<typename T>
+    Result<T> tryGetFrame(FilterMediaType type, int flags);
+
 private:
     FilterContext   m_sink;
     FilterMediaType m_type = FilterMediaType::Unknown;
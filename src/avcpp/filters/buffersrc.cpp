@@ -1,6 +1,8 @@
 #include <cassert>
 
 #include "buffersrc.h"
+#include "instrumentation.h"
+#include "tracing.h"
 
 #if AVCPP_HAS_AVFILTER
 
@@ -98,6 +100,9 @@ FilterMediaType BufferSrcFilterContext::checkFilter(const Filter &filter)
 void BufferSrcFilterContext::addFrame(AVFrame *frame, int flags, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_INSTRUMENT("buffersrc", m_src.raw(), m_src.raw() ? m_src.raw()->name : nullptr);
+    AVCPP_INSTRUMENT_BYTES(Instrumentation::frameBytes(frame));
+    AVCPP_TRACE_AT("filter_push", -1, frame ? frame->pts : NoPts);
     int sts = av_buffersrc_add_frame_flags(m_src.raw(), frame, flags);
     if (sts < 0) {
         throws_if(ec, sts, ffmpeg_category());
@@ -108,6 +113,9 @@ void BufferSrcFilterContext::addFrame(AVFrame *frame, int flags, OptionalErrorCo
 void BufferSrcFilterContext::writeFrame(const AVFrame *frame, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_INSTRUMENT("buffersrc", m_src.raw(), m_src.raw() ? m_src.raw()->name : nullptr);
+    AVCPP_INSTRUMENT_BYTES(Instrumentation::frameBytes(frame));
+    AVCPP_TRACE_AT("filter_push", -1, frame ? frame->pts : NoPts);
     int sts = av_buffersrc_write_frame(m_src.raw(), frame);
     if (sts < 0) {
         throws_if(ec, sts, ffmpeg_category());
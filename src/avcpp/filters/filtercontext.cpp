@@ -2,6 +2,7 @@
 #include <cassert>
 
 #include "filtercontext.h"
+#include "instrumentation.h"
 
 #if AVCPP_HAS_AVFILTER
 
@@ -62,6 +63,7 @@ void FilterContext::init(const string& args, OptionalErrorCode ec)
 
 void FilterContext::free()
 {
+    AVCPP_INSTRUMENT_FORGET(m_raw);
     avfilter_free(m_raw);
 }
 
@@ -8,6 +8,7 @@
 
 #include "avcpp/avutils.h"
 #include "avcpp/avlog.h"
+#include "avcpp/instrumentation.h"
 
 #if AVCPP_HAS_AVFILTER
 
@@ -26,6 +27,11 @@ FilterGraph::FilterGraph(decltype(nullptr))
 
 FilterGraph::~FilterGraph()
 {
+#if AVCPP_ENABLE_INSTRUMENTATION
+    // BufferSrc/BufferSink metrics are keyed by the filter context: addresses are reused by the next graph
+    for (unsigned i = 0; m_raw && i < m_raw->nb_filters; ++i)
+        AVCPP_INSTRUMENT_FORGET(m_raw->filters[i]);
+#endif
     avfilter_graph_free(&m_raw);
 }
 
@@ -12,6 +12,8 @@
 #include "formatcontext.h"
 #include "codeccontext.h"
 #include "codecparameters.h"
+#include "instrumentation.h"
+#include "tracing.h"
 
 #if !AVCPP_API_AVFORMAT_URL
 extern "C"
@@ -90,6 +92,7 @@ FormatContext::FormatContext()
 
 FormatContext::~FormatContext()
 {
+    AVCPP_INSTRUMENT_FORGET(this);
     if (isOpened())
         close();
     else if (m_raw)
@@ -343,6 +346,7 @@ void FormatContext::seek(const Timestamp &timestamp, size_t streamIndex, bool an
 void FormatContext::seek(int64_t position, int streamIndex, int flags, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_TRACE_AT("seek", streamIndex, position);
     const auto sts = av_seek_frame(m_raw, streamIndex, position, flags);
     if (sts < 0) {
         throws_if(ec, sts, ffmpeg_category());
@@ -441,6 +445,7 @@ void FormatContext::openInput(const string &uri, Dictionary &&formatOptions, Inp
 void FormatContext::openInput(const std::string &uri, InputFormat format, AVDictionary **options, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_TRACE("open_input");
 
     if (m_isOpened)
     {
@@ -519,47 +524,75 @@ Packet FormatContext::readPacket(OptionalErrorCode ec)
 {
     clear_if(ec);
 
-    if (!m_raw)
-    {
-        throws_if(ec, Errors::Unallocated);
-        return Packet();
+    Packet packet;
+    auto st = readPacketCommon(packet);
+    if (get<1>(st))
+        throws_if(ec, get<0>(st), *get<1>(st));
+    return packet;
+}
+
+Result<Packet> FormatContext::tryReadPacket()
+{
+    // Read into the kept packet: Again/Eof calls do not allocate
+    auto st = readPacketCommon(m_receivePacket);
+    if (get<1>(st) || get<0>(st) == AVERROR_EOF) {
+        av_packet_unref(m_receivePacket.raw());
+        if (get<1>(st))
+            return make_result_status<Packet>(get<0>(st), *get<1>(st));
+        return Result<Packet>::eof();
     }
+    return Result<Packet>(std::exchange(m_receivePacket, Packet()));
+}
+
+std::pair<int, const error_category *> FormatContext::readPacketCommon(Packet &packet, int retryCount)
+{
+    AVCPP_INSTRUMENT("demux", this, m_raw && m_raw->iformat ? m_raw->iformat->name : nullptr);
+    AVCPP_TRACE("read_packet");
+
+    if (!m_raw)
+        return {static_cast<int>(Errors::Unallocated), &avcpp_category()};
 
     if (!m_streamsInfoFound)
     {
         fflog(AV_LOG_ERROR, "Streams does not found. Try call findStreamInfo()\n");
-        throws_if(ec, Errors::FormatNoStreams);
-        return Packet();
+        return {static_cast<int>(Errors::FormatNoStreams), &avcpp_category()};
     }
 
-    Packet packet;
-
     int sts = 0;
     int tries = 0;
-    const int retryCount = 5;
     do
     {
         resetSocketAccess();
         sts = av_read_frame(m_raw, packet.raw());
         ++tries;
+        // Not ready input is not an error: AVIO keeps it otherwise and fails the next successful reads
+        if (sts == AVERROR(EAGAIN) && m_raw->pb && m_raw->pb->error == AVERROR(EAGAIN)) {
+            m_raw->pb->error       = 0;
+            m_raw->pb->eof_reached = 0;
+        }
     }
     while (sts == AVERROR(EAGAIN) && (retryCount < 0 || tries <= retryCount));
 
     // End of file
     if (sts == AVERROR_EOF /*|| avio_feof(m_raw->pb)*/) {
-        auto ec_tmp = std::error_code(sts, ffmpeg_category());
-        fflog(AV_LOG_DEBUG,
-              "EOF reaches, error=%d, %s, isNull: %d, stream_index: %d, payload: %p\n",
-              sts,
-              ec_tmp.message().c_str(),
-              packet.isNull(),
-              packet.streamIndex(),
-              packet.data());
-        av_pkt_dump_log2(m_raw, AV_LOG_DEBUG, packet.raw(), 0, m_raw->streams[packet.streamIndex()]);
+        // Skip message formatting when it is filtered out anyway
+        if (av_log_get_level() >= AV_LOG_DEBUG) {
+            auto ec_tmp = std::error_code(sts, ffmpeg_category());
+            fflog(AV_LOG_DEBUG,
+                  "EOF reaches, error=%d, %s, isNull: %d, stream_index: %d, payload: %p\n",
+                  sts,
+                  ec_tmp.message().c_str(),
+                  packet.isNull(),
+                  packet.streamIndex(),
+                  packet.data());
+            // Packet is empty on the real EOF: stream index is not valid
+            if (packet && packet.streamIndex() >= 0 && unsigned(packet.streamIndex()) < m_raw->nb_streams)
+                av_pkt_dump_log2(m_raw, AV_LOG_DEBUG, packet.raw(), 0, m_raw->streams[packet.streamIndex()]);
+        }
         if (packet)
             sts = 0; // not an error
         else
-            return packet;
+            return {AVERROR_EOF, nullptr};
     }
 
     if (sts == 0)
@@ -568,23 +601,18 @@ Packet FormatContext::readPacket(OptionalErrorCode ec)
         if (pberr)
         {
             // TODO: need verification
-            throws_if(ec, pberr, ffmpeg_category());
-            return packet;
+            return {pberr, &ffmpeg_category()};
         }
     }
     else
     {
-        throws_if(ec, sts, ffmpeg_category());
-        return packet;
+        return {sts, &ffmpeg_category()};
     }
 
     if (packet.streamIndex() >= 0)
     {
         if ((size_t)packet.streamIndex() > streamsCount())
-        {
-            throws_if(ec, Errors::FormatInvalidStreamIndex);
-            return packet;
-        }
+            return {static_cast<int>(Errors::FormatInvalidStreamIndex), &avcpp_category()};
 
         packet.setTimeBase(m_raw->streams[packet.streamIndex()]->time_base);
 
@@ -600,8 +628,10 @@ Packet FormatContext::readPacket(OptionalErrorCode ec)
     }
 
     packet.setComplete(true);
+    AVCPP_INSTRUMENT_BYTES(packet.size());
+    AVCPP_TRACE_STREAM(packet.streamIndex(), packet.pts().timestamp());
 
-    return packet;
+    return {0, nullptr};
 }
 
 void FormatContext::openOutput(const string &uri, OptionalErrorCode ec)
@@ -645,6 +675,7 @@ void FormatContext::openOutput(const std::string &uri, Dictionary &&options, Out
 void FormatContext::openOutput(const string &uri, OutputFormat format, AVDictionary **options, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_TRACE("open_output");
     if (!m_raw)
     {
         throws_if(ec, Errors::Unallocated);
@@ -852,6 +883,7 @@ void FormatContext::writeHeader(Dictionary &&options, OptionalErrorCode ec)
 void FormatContext::writeHeader(AVDictionary **options, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_TRACE("write_header");
 
     if (m_headerWriten) {
         // TBD: just silent it?
@@ -960,23 +992,39 @@ void FormatContext::writePacket(const Packet &pkt, OptionalErrorCode ec, int(*wr
 {
     clear_if(ec);
 
+    auto st = writePacketCommon(pkt, write_proc);
+    if (get<1>(st))
+        throws_if(ec, get<0>(st), *get<1>(st));
+}
+
+Result<void> FormatContext::tryWritePacket(const Packet &pkt)
+{
+    auto st = writePacketCommon(pkt, av_interleaved_write_frame);
+    if (get<1>(st))
+        return make_result_status<void>(get<0>(st), *get<1>(st));
+    return {};
+}
+
+Result<void> FormatContext::tryWritePacketDirect(const Packet &pkt)
+{
+    auto st = writePacketCommon(pkt, av_write_frame);
+    if (get<1>(st))
+        return make_result_status<void>(get<0>(st), *get<1>(st));
+    return {};
+}
+
+std::pair<int, const error_category *> FormatContext::writePacketCommon(const Packet &pkt, int (*write_proc)(AVFormatContext *, AVPacket *))
+{
+    AVCPP_TRACE_AT("write_packet", pkt.streamIndex(), pkt.pts().timestamp());
+
     if (!isOpened())
-    {
-        throws_if(ec, Errors::FormatNotOpened);
-        return;
-    }
+        return {static_cast<int>(Errors::FormatNotOpened), &avcpp_category()};
 
     if (!isOutput())
-    {
-        throws_if(ec, Errors::FormatInvalidDirection);
-        return;
-    }
+        return {static_cast<int>(Errors::FormatInvalidDirection), &avcpp_category()};
 
     if (!m_headerWriten)
-    {
-        throws_if(ec, Errors::FormatHeaderNotWriten);
-        return;
-    }
+        return {static_cast<int>(Errors::FormatHeaderNotWriten), &avcpp_category()};
 
     // Make reference to packet
     auto writePkt = pkt;
@@ -987,8 +1035,7 @@ void FormatContext::writePacket(const Packet &pkt, OptionalErrorCode ec, int(*wr
 
         if (st.isNull()) {
             fflog(AV_LOG_WARNING, "Required stream does not exists: %d, total=%ld\n", streamIndex, streamsCount());
-            throws_if(ec, Errors::FormatInvalidStreamIndex);
-            return;
+            return {static_cast<int>(Errors::FormatInvalidStreamIndex), &avcpp_category()};
         }
 
         // Set packet time base to stream one
@@ -1001,12 +1048,14 @@ void FormatContext::writePacket(const Packet &pkt, OptionalErrorCode ec, int(*wr
     int sts = write_proc(m_raw, writePkt.isNull() ? nullptr : writePkt.raw());
     sts = checkPbError(sts);
     if (sts < 0)
-        throws_if(ec, sts, ffmpeg_category());
+        return {sts, &ffmpeg_category()};
+    return {0, nullptr};
 }
 
 void FormatContext::writeFrame(AVFrame *frame, int streamIndex, OptionalErrorCode ec, int (*write_proc)(AVFormatContext *, int, AVFrame *))
 {
     clear_if(ec);
+    AVCPP_TRACE_AT("write_frame", streamIndex, frame ? frame->pts : NoPts);
 
     if (!isOpened())
     {
@@ -1063,6 +1112,7 @@ Stream FormatContext::addStream(const CodecContext2 &ctx, OptionalErrorCode ec)
 void FormatContext::writeTrailer(OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_TRACE("write_trailer");
 
     if (!isOpened())
     {
@@ -1129,6 +1179,7 @@ void FormatContext::resetSocketAccess()
 void FormatContext::findStreamInfo(AVDictionary **options, size_t optionsCount, OptionalErrorCode ec)
 {
     clear_if(ec);
+    AVCPP_TRACE("find_stream_info");
 
     if (options && optionsCount != streamsCount())
     {
@@ -13,6 +13,7 @@
 #include "codec.h"
 #include "dictionary.h"
 #include "averror.h"
+#include "result.h"
 
 #if AVCPP_HAS_AVFORMAT
 
@@ -256,6 +257,12 @@ public:
 
     Packet readPacket(OptionalErrorCode ec = throws());
 
+    /**
+     * @brief tryReadPacket - non-throwing readPacket() for the hot loops
+     * @return packet; Eof at the end of stream; Again if input is still not ready after retries; Error otherwise
+     */
+    Result<Packet> tryReadPacket();
+
     //
     // Output
     //
@@ -315,6 +322,14 @@ public:
     void writePacketDirect(OptionalErrorCode ec = throws());
     void writePacketDirect(const Packet &pkt, OptionalErrorCode ec = throws());
 
+    /// @{
+    /**
+     * Non-throwing writePacket() and writePacketDirect(): empty packet flushes the interleaving queue
+     */
+    Result<void> tryWritePacket(const Packet &pkt);
+    Result<void> tryWritePacketDirect(const Packet &pkt);
+    /// @}
+
     bool checkUncodedFrameWriting(size_t streamIndex, std::error_code &ec) noexcept;
     bool checkUncodedFrameWriting(size_t streamIndex) noexcept;
 
@@ -326,12 +341,18 @@ public:
     void writeTrailer(OptionalErrorCode ec = throws());
 
 private:
+    // Reads without the EAGAIN busy loop
+    friend class AsyncDemuxer;
+
     void openInput(const std::string& uri, InputFormat format, AVDictionary **options, OptionalErrorCode ec);
     void openOutput(const std::string& uri, OutputFormat format, AVDictionary **options, OptionalErrorCode ec);
     bool initOutput(Dictionary &options, bool closeOnError, OptionalErrorCode ec);
     bool initOutput(AVDictionary **options, OptionalErrorCode ec);
     void writeHeader(AVDictionary **options, OptionalErrorCode ec);
     void writePacket(const Packet &pkt, OptionalErrorCode ec, int(*write_proc)(AVFormatContext *, AVPacket *));
+    // retryCount: extra reads on EAGAIN, negative - till the input is ready
+    std::pair<int, const std::error_category*> readPacketCommon(Packet &packet, int retryCount = 5);
+    std::pair<int, const std::error_category*> writePacketCommon(const Packet &pkt, int(*write_proc)(AVFormatContext *, AVPacket *));
     void writeFrame(AVFrame *frame, int streamIndex, OptionalErrorCode ec, int(*write_proc)(AVFormatContext*,int,AVFrame*));
 
     Stream addStream(const class CodecContext2 &ctx, OptionalErrorCode ec);
@@ -359,6 +380,9 @@ private:
     bool                                               m_streamsInfoFound = false;
     bool                                               m_headerWriten     = false;
     bool                                               m_substractStartTime = false;
+
+    // Kept between tryReadPacket() calls, blank between them
+    Packet                                             m_receivePacket;
 };
 
 } // namespace av
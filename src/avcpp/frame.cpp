@@ -1,11 +1,14 @@
 #include "frame.h"
 
+#include <utility>
+
 using namespace std;
 
 extern "C" {
 #include <libavutil/version.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/avassert.h>
+#include <libavutil/pixdesc.h>
 }
 
 
@@ -167,6 +170,7 @@ VideoFrame::VideoFrame(PixelFormat pixelFormat, int width, int height, int align
     m_raw->width  = width;
     m_raw->height = height;
     av_frame_get_buffer(m_raw, align);
+    AVCPP_MEMORY_TRACK(m_memoryTag, m_raw);
 }
 
 VideoFrame::VideoFrame(const uint8_t *data, size_t size, PixelFormat pixelFormat, int width, int height, int align)
@@ -354,6 +358,99 @@ bool VideoFrame::copyToBuffer(std::vector<uint8_t> &dst, int align, OptionalErro
     return copyToBuffer(dst.data(), dst.size(), align, ec);
 }
 
+namespace {
+// Offsets and sizes of the planes are computed like av_frame_apply_cropping() does: planes 1 and 2 are
+// subsampled chroma, alpha plane is full size
+int plane_shift_x(const AVPixFmtDescriptor *desc, size_t plane) noexcept
+{
+    return (plane == 1 || plane == 2) ? desc->log2_chroma_w : 0;
+}
+
+int plane_shift_y(const AVPixFmtDescriptor *desc, size_t plane) noexcept
+{
+    return (plane == 1 || plane == 2) ? desc->log2_chroma_h : 0;
+}
+
+const AVPixFmtDescriptor* software_pixfmt_desc(const AVFrame *frame) noexcept
+{
+    auto const desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM)))
+        return nullptr;
+    return desc;
+}
+} // anonymous namespace
+
+VideoFrame VideoFrame::cropView(const Rect &rect, OptionalErrorCode ec) const
+{
+    clear_if(ec);
+
+    auto const desc = isValid() && !isHwFrame() ? software_pixfmt_desc(m_raw) : nullptr;
+    if (!desc) {
+        throws_if(ec, Errors::FrameInvalid);
+        return {};
+    }
+
+    if (rect.getWidth() <= 0 || rect.getHeight() <= 0 || rect.getX() < 0 || rect.getY() < 0 ||
+        rect.getX() + rect.getWidth() > width() || rect.getY() + rect.getHeight() > height())
+    {
+        throws_if(ec, Errors::InvalidArgument);
+        return {};
+    }
+
+    // Chroma sample covers several pixels: origin must be on its grid
+    int const x = rect.getX() & ~((1 << desc->log2_chroma_w) - 1);
+    int const y = rect.getY() & ~((1 << desc->log2_chroma_h) - 1);
+
+    int maxStep[4];
+    av_image_fill_max_pixsteps(maxStep, nullptr, desc);
+
+    // Buffers are referenced, not copied
+    VideoFrame out{*this};
+    auto frame = out.raw();
+
+    for (size_t i = 0; i < 4 && frame->data[i]; ++i) {
+        // Palette
+        if ((desc->flags & AV_PIX_FMT_FLAG_PAL) && i == 1)
+            break;
+        frame->data[i] += ptrdiff_t(y >> plane_shift_y(desc, i)) * frame->linesize[i] +
+                          ptrdiff_t(x >> plane_shift_x(desc, i)) * maxStep[i];
+    }
+
+    frame->width  = rect.getX() + rect.getWidth() - x;
+    frame->height = rect.getY() + rect.getHeight() - y;
+
+    return out;
+}
+
+PlaneView<const uint8_t> VideoFrame::planeBytes(size_t index) const noexcept
+{
+    if (!isValid() || isHwFrame() || index >= 4 || !m_raw->data[index])
+        return {};
+
+    auto const desc = software_pixfmt_desc(m_raw);
+    if (!desc)
+        return {};
+
+    // AVPALETTE_SIZE bytes of 32-bit ARGB entries
+    if ((desc->flags & AV_PIX_FMT_FLAG_PAL) && index == 1)
+        return {m_raw->data[1], AVPALETTE_SIZE, 1, AVPALETTE_SIZE};
+
+    auto const bytes = av_image_get_linesize(static_cast<AVPixelFormat>(m_raw->format), m_raw->width, int(index));
+    if (bytes <= 0)
+        return {};
+
+    return {m_raw->data[index], bytes, AV_CEIL_RSHIFT(m_raw->height, plane_shift_y(desc, index)), m_raw->linesize[index]};
+}
+
+PlaneView<uint8_t> VideoFrame::planeBytes(size_t index) noexcept
+{
+    // Copy-on-write is done by the mutable data()
+    if (index < 4 && m_raw && m_raw->data[index] && !data(index))
+        return {};
+    auto const view = std::as_const(*this).planeBytes(index);
+    return {const_cast<uint8_t*>(view.data()), view.width(), view.height(), view.stride()};
+}
+
 namespace {
 VideoFrame _wrap(const void *data, size_t size, PixelFormat pixelFormat, int width, int height, int align,
                  void (*deleter)(void *opaque, uint8_t *data), void *opaque)
@@ -421,6 +518,7 @@ int AudioSamples::init(SampleFormat sampleFormat, int samplesCount, uint64_t cha
     av::frame::set_channel_layout(m_raw, channelLayout);
 
     av_frame_get_buffer(m_raw, align);
+    AVCPP_MEMORY_TRACK(m_memoryTag, m_raw);
     return 0;
 }
 
@@ -541,6 +639,7 @@ FrameCommon::FrameCommon() {
 }
 
 FrameCommon::~FrameCommon() {
+    AVCPP_MEMORY_UNTRACK(m_memoryTag);
     av_frame_free(&m_raw);
 }
 
@@ -549,6 +648,7 @@ FrameCommon::FrameCommon(const AVFrame *frame) {
         m_raw = av_frame_alloc();
         m_raw->opaque = this;
         av_frame_ref(m_raw, frame);
+        AVCPP_MEMORY_TRACK(m_memoryTag, m_raw);
     }
 }
 
@@ -563,6 +663,7 @@ FrameCommon::FrameCommon(FrameCommon &&other) : FrameCommon(nullptr) {
         m_raw->opaque = this;
         av_frame_move_ref(m_raw, other.m_raw);
         copyInfoFrom(other);
+        AVCPP_MEMORY_SWAP(m_memoryTag, other.m_memoryTag);
     }
 }
 
@@ -639,6 +740,8 @@ void FrameCommon::setStreamIndex(int streamIndex) {
 
 void FrameCommon::setComplete(bool isComplete) {
     m_isComplete = isComplete;
+    if (isComplete)
+        AVCPP_MEMORY_TRACK(m_memoryTag, m_raw);
 }
 
 bool FrameCommon::isComplete() const { return m_isComplete; }
@@ -659,6 +762,13 @@ bool FrameCommon::isHwFrame() const
 uint8_t *FrameCommon::data(size_t plane) {
     if (!m_raw || plane >= size_t(AV_NUM_DATA_POINTERS + m_raw->nb_extended_buf))
         return nullptr;
+    // Not referenced data is not owned by the frame: nothing to copy
+    if (m_copyOnWrite && isReferenced() && !isWritable()) {
+        std::error_code ec;
+        makeWritable(ec);
+        if (ec)
+            return nullptr;
+    }
     return m_raw->extended_data[plane];
 }
 
@@ -668,6 +778,26 @@ const uint8_t *FrameCommon::data(size_t plane) const {
     return m_raw->extended_data[plane];;
 }
 
+bool FrameCommon::isWritable() const {
+    return m_raw && av_frame_is_writable(m_raw);
+}
+
+void FrameCommon::makeWritable(OptionalErrorCode ec) {
+    clear_if(ec);
+    if (!m_raw) {
+        throws_if(ec, Errors::Unallocated);
+        return;
+    }
+
+    auto const sts = av_frame_make_writable(m_raw);
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return;
+    }
+    // Buffers can be replaced
+    AVCPP_MEMORY_TRACK(m_memoryTag, m_raw);
+}
+
 size_t FrameCommon::size(size_t plane) const {
     if (!m_raw || plane >= size_t(AV_NUM_DATA_POINTERS + m_raw->nb_extended_buf))
         return 0;
@@ -735,7 +865,9 @@ void FrameCommon::swap(FrameCommon &other)
     FRAME_SWAP(m_timeBase);
     FRAME_SWAP(m_streamIndex);
     FRAME_SWAP(m_isComplete);
+    FRAME_SWAP(m_copyOnWrite);
 #undef FRAME_SWAP
+    AVCPP_MEMORY_SWAP(m_memoryTag, other.m_memoryTag);
 }
 
 #if AVCPP_HAS_FRAME_SIDE_DATA
@@ -844,6 +976,7 @@ void FrameCommon::copyInfoFrom(const FrameCommon &other)
     m_timeBase    = other.m_timeBase;
     m_streamIndex = other.m_streamIndex;
     m_isComplete  = other.m_isComplete;
+    m_copyOnWrite = other.m_copyOnWrite;
 }
 
 void FrameCommon::clone(FrameCommon &dst, size_t align) const
@@ -857,10 +990,13 @@ void FrameCommon::clone(FrameCommon &dst, size_t align) const
     frame::priv::channel_layout_copy(*dst.m_raw, *m_raw);
 
     dst.copyInfoFrom(*this);
+    // Own buffers
+    dst.m_copyOnWrite = false;
 
     av_frame_get_buffer(dst.m_raw, align);
     av_frame_copy(dst.m_raw, m_raw);
     av_frame_copy_props(dst.m_raw, m_raw);
+    AVCPP_MEMORY_TRACK(dst.m_memoryTag, dst.m_raw);
 }
 
 #if AVCPP_HAS_FRAME_SIDE_DATA
@@ -15,7 +15,10 @@
 #include "ffmpeg.h"
 #include "rational.h"
 #include "timestamp.h"
+#include "memoryaccounting.h"
 #include "pixelformat.h"
+#include "planeview.h"
+#include "rect.h"
 #include "sampleformat.h"
 
 extern "C" {
@@ -79,6 +82,10 @@ public:
      * Buffer size must be: size + AV_INPUT_BUFFER_PADDING_SIZE
      */
     struct wrap_data_static {};
+    /**
+     * Copy-on-write clone(): buffers are shared till the first mutable data() access
+     */
+    struct copy_on_write {};
 
     FrameCommon();
     FrameCommon(const AVFrame *frame);
@@ -112,9 +119,28 @@ public:
 
     bool isHwFrame() const;
 
+    /**
+     * Mutable access makes data writable first for the copy-on-write frames, null if it fails
+     */
     uint8_t *data(size_t plane = 0);
     const uint8_t *data(size_t plane = 0) const;
 
+    /**
+     * Buffers are not shared with other frames, data can be changed in place
+     */
+    bool isWritable() const;
+    /**
+     * Deep copy of the shared buffers with av_frame_make_writable(), no-op for the writable frame
+     */
+    void makeWritable(OptionalErrorCode ec = throws());
+
+    /**
+     * Copy-on-write frame calls makeWritable() on the mutable data() access. Changes via raw() are not tracked.
+     * Copies of the copy-on-write frame are copy-on-write too.
+     */
+    bool isCopyOnWrite() const noexcept { return m_copyOnWrite; }
+    void setCopyOnWrite(bool copyOnWrite) noexcept { m_copyOnWrite = copyOnWrite; }
+
     size_t size(size_t plane) const;
     size_t size() const;
 
@@ -220,6 +246,10 @@ protected:
     Rational             m_timeBase{};
     int                  m_streamIndex {-1};
     bool                 m_isComplete  {false};
+    bool                 m_copyOnWrite {false};
+#if AVCPP_ENABLE_INSTRUMENTATION
+    MemoryTag            m_memoryTag;
+#endif
 };
 
 template<typename T>
@@ -252,6 +282,18 @@ public:
         FrameCommon::clone(result, align);
         return result;
     }
+
+    /**
+     * Clone without copying: buffers are shared and both frames become copy-on-write, so the deep copy is done only
+     * by the first of them that is changed via data(). Cheap for clones that are only read.
+     *
+     * Source is changed (marked copy-on-write), so it is not const: it must not be cloned concurrently with other
+     * access. For the read-only source, copy it and setCopyOnWrite(true) on the copy.
+     */
+    T clone(copy_on_write) {
+        m_copyOnWrite = true;
+        return T{static_cast<const T&>(*this)};
+    }
 };
 
 static_assert(std::is_copy_assignable_v<FrameCommon> == false);
@@ -313,6 +355,42 @@ public:
     bool                   copyToBuffer(uint8_t *dst, size_t size, int align = 1, OptionalErrorCode ec = throws());
     bool                   copyToBuffer(std::vector<uint8_t>& dst, int align = 1, OptionalErrorCode ec = throws());
 
+    /**
+     * Region of the frame without copying: new frame references the same buffers with the adjusted data pointers
+     * and size. Writing into the view changes the source frame too.
+     *
+     * Origin of the rect is moved to the left/top to the chroma subsampling grid, right and bottom edges are kept.
+     * Hardware and bitstream pixel formats are not supported.
+     *
+     * @param rect  region, must be inside the frame
+     * @param ec    Errors::InvalidArgument for the empty or outside rect, Errors::FrameInvalid
+     */
+    VideoFrame             cropView(const Rect &rect, OptionalErrorCode ec = throws()) const;
+
+    /**
+     * Strided view of the plane pixels in place, see PlaneView. Plane size honours chroma subsampling.
+     * Empty view for the missing plane, hardware frames or if the line is not a multiple of sizeof(T).
+     *
+     * @code
+     * auto luma = frame.plane(0);
+     * for (int y = 0; y < luma.height(); ++y)
+     *     sum += std::accumulate(luma.row(y), luma.row(y) + luma.width(), 0);
+     *
+     * auto const y10 = frame10bit.plane<uint16_t>(0);
+     * @endcode
+     */
+    template<typename T = uint8_t>
+    PlaneView<T>           plane(size_t index)
+    {
+        return planeBytes(index).template as<T>();
+    }
+
+    template<typename T = uint8_t>
+    PlaneView<const T>     plane(size_t index) const
+    {
+        return planeBytes(index).template as<const T>();
+    }
+
 
     /**
      * Wrap external data into VideoFrame object ready to use with FFmpeg/AvCpp.
@@ -362,6 +440,10 @@ public:
     static VideoFrame wrap(std::span<const std::byte> data, void (*deleter)(void *opaque, uint8_t *data),
                            void *opaque, PixelFormat pixelFormat, int width, int height, int align = 1);
 #endif
+
+private:
+    PlaneView<const uint8_t> planeBytes(size_t index) const noexcept;
+    PlaneView<uint8_t>       planeBytes(size_t index) noexcept;
 };
 
 static_assert(std::is_copy_assignable_v<VideoFrame> == true);
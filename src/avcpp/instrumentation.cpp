@@ -0,0 +1,338 @@
+#include "instrumentation.h"
+#include "diagutils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <locale>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+atomic_bool s_enabled{false};
+
+// Metrics of the object and operation, updated without locks
+struct Counters
+{
+    string                                             kind;
+    string                                             label;
+    uintptr_t                                          object = 0;
+    atomic<uint64_t>                                   calls{0};
+    atomic<uint64_t>                                   bytes{0};
+    atomic<uint64_t>                                   count{0};
+    atomic<int64_t>                                    sum{0}; // nanoseconds
+    array<atomic<uint64_t>, LatencyHistogram::Buckets> buckets{};
+    atomic_bool                                        retired{false}; // forgotten: object address can be reused
+
+    InstrumentationMetrics metrics() const
+    {
+        InstrumentationMetrics m;
+        m.kind   = kind;
+        m.label  = label;
+        m.object = object;
+        m.calls  = calls.load(memory_order_relaxed);
+        m.bytes  = bytes.load(memory_order_relaxed);
+        m.latency.count = count.load(memory_order_relaxed);
+        m.latency.sum   = chrono::nanoseconds(sum.load(memory_order_relaxed));
+        for (size_t i = 0; i < LatencyHistogram::Buckets; ++i)
+            m.latency.counts[i] = buckets[i].load(memory_order_relaxed);
+        return m;
+    }
+};
+
+struct Registry
+{
+    std::mutex                                     access;
+    map<const void*, vector<shared_ptr<Counters>>> objects;
+};
+
+Registry& registry()
+{
+    static Registry reg;
+    return reg;
+}
+
+// Registered under the registry lock
+shared_ptr<Counters> register_counters(const char *kind, const void *object, const char *label)
+{
+    auto &reg = registry();
+    lock_guard lock{reg.access};
+
+    // Objects have one or two operations: linear search is enough
+    auto &counters = reg.objects[object];
+    auto it = std::find_if(counters.begin(), counters.end(), [kind](const shared_ptr<Counters> &c) {
+        return c->kind == kind;
+    });
+    if (it != counters.end())
+        return *it;
+
+    auto c = make_shared<Counters>();
+    c->kind   = kind;
+    c->label  = label ? label : "";
+    c->object = reinterpret_cast<uintptr_t>(object);
+    counters.push_back(c);
+    return c;
+}
+
+// Per-thread shard of the registry: hooked calls find their counters without the global lock
+struct ThreadCache
+{
+    struct Entry
+    {
+        const void          *object;
+        const char          *kind;
+        shared_ptr<Counters> counters;
+    };
+
+    static constexpr size_t PruneSize = 64;
+
+    vector<Entry> entries;
+
+    Counters& find(const char *kind, const void *object, const char *label)
+    {
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->object != object || (it->kind != kind && strcmp(it->kind, kind) != 0))
+                continue;
+            if (!it->counters->retired.load(memory_order_acquire))
+                return *it->counters;
+            entries.erase(it);
+            break;
+        }
+
+        if (entries.size() >= PruneSize) {
+            entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry &e) {
+                return e.counters->retired.load(memory_order_acquire);
+            }), entries.end());
+        }
+
+        entries.push_back({object, kind, register_counters(kind, object, label)});
+        return *entries.back().counters;
+    }
+};
+
+void retire(vector<shared_ptr<Counters>> &counters) noexcept
+{
+    for (auto &c : counters)
+        c->retired.store(true, memory_order_release);
+}
+
+string object_id(uintptr_t object)
+{
+    ostringstream ss;
+    ss << "0x" << hex << object;
+    return ss.str();
+}
+
+} // anonymous namespace
+
+void LatencyHistogram::add(std::chrono::nanoseconds latency) noexcept
+{
+    ++counts[bucket(latency)];
+    ++count;
+    sum += latency;
+}
+
+size_t LatencyHistogram::bucket(std::chrono::nanoseconds latency) noexcept
+{
+    auto const us = std::max<int64_t>(chrono::duration_cast<chrono::microseconds>(latency).count(), 0);
+    size_t index = 0;
+    while (index + 1 < Buckets && (int64_t(1) << index) < us)
+        ++index;
+    return index;
+}
+
+std::chrono::microseconds LatencyHistogram::upperBound(size_t bucket) noexcept
+{
+    if (bucket + 1 >= Buckets)
+        return chrono::microseconds::max();
+    return chrono::microseconds(int64_t(1) << bucket);
+}
+
+std::chrono::microseconds LatencyHistogram::quantile(double q) const noexcept
+{
+    if (!count)
+        return chrono::microseconds::zero();
+    auto const rank = uint64_t(std::ceil(std::clamp(q, 0.0, 1.0) * double(count)));
+    uint64_t acc = 0;
+    for (size_t i = 0; i < Buckets; ++i) {
+        acc += counts[i];
+        if (acc >= rank && acc)
+            return upperBound(i);
+    }
+    return upperBound(Buckets - 1);
+}
+
+void Instrumentation::setEnabled(bool enable) noexcept
+{
+    s_enabled.store(enable, memory_order_relaxed);
+}
+
+bool Instrumentation::isEnabled() noexcept
+{
+    return s_enabled.load(memory_order_relaxed);
+}
+
+std::vector<InstrumentationMetrics> Instrumentation::snapshot()
+{
+    auto &reg = registry();
+    vector<InstrumentationMetrics> result;
+    lock_guard lock{reg.access};
+    for (auto const &[object, counters] : reg.objects) {
+        for (auto const &c : counters)
+            result.push_back(c->metrics());
+    }
+    return result;
+}
+
+void Instrumentation::reset()
+{
+    auto &reg = registry();
+    lock_guard lock{reg.access};
+    for (auto &[object, counters] : reg.objects)
+        retire(counters);
+    reg.objects.clear();
+}
+
+void Instrumentation::forget(const void *object) noexcept
+{
+    auto &reg = registry();
+    lock_guard lock{reg.access};
+    auto it = reg.objects.find(object);
+    if (it == reg.objects.end())
+        return;
+    retire(it->second);
+    reg.objects.erase(it);
+}
+
+void Instrumentation::record(const char *kind, const void *object, const char *label,
+                             std::chrono::nanoseconds latency, uint64_t bytes)
+{
+    thread_local ThreadCache cache;
+    auto &c = cache.find(kind, object, label);
+
+    c.calls.fetch_add(1, memory_order_relaxed);
+    c.bytes.fetch_add(bytes, memory_order_relaxed);
+    c.count.fetch_add(1, memory_order_relaxed);
+    c.sum.fetch_add(latency.count(), memory_order_relaxed);
+    c.buckets[LatencyHistogram::bucket(latency)].fetch_add(1, memory_order_relaxed);
+}
+
+uint64_t Instrumentation::frameBytes(const AVFrame *frame) noexcept
+{
+    if (!frame)
+        return 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; ++i)
+        total += uint64_t(frame->buf[i]->size);
+    for (int i = 0; i < frame->nb_extended_buf; ++i)
+        total += uint64_t(frame->extended_buf[i]->size);
+    return total;
+}
+
+std::string Instrumentation::toPrometheus(const std::vector<InstrumentationMetrics> &metrics, std::string_view prefix)
+{
+    ostringstream ss;
+    ss.imbue(locale::classic());
+    auto const labels = [](const InstrumentationMetrics &m) {
+        return "kind=\"" + internal::escape(m.kind) + "\",label=\"" + internal::escape(m.label) + "\",object=\"" + object_id(m.object) + "\"";
+    };
+
+    ss << "# HELP " << prefix << "_calls_total Instrumented calls\n"
+       << "# TYPE " << prefix << "_calls_total counter\n";
+    for (auto const &m : metrics)
+        ss << prefix << "_calls_total{" << labels(m) << "} " << m.calls << '\n';
+
+    ss << "# HELP " << prefix << "_bytes_total Processed payload bytes\n"
+       << "# TYPE " << prefix << "_bytes_total counter\n";
+    for (auto const &m : metrics)
+        ss << prefix << "_bytes_total{" << labels(m) << "} " << m.bytes << '\n';
+
+    ss << "# HELP " << prefix << "_latency_seconds Call latency\n"
+       << "# TYPE " << prefix << "_latency_seconds histogram\n";
+    for (auto const &m : metrics) {
+        auto const lbl = labels(m);
+        uint64_t acc = 0;
+        for (size_t i = 0; i < LatencyHistogram::Buckets; ++i) {
+            acc += m.latency.counts[i];
+            ss << prefix << "_latency_seconds_bucket{" << lbl << ",le=\"";
+            if (i + 1 < LatencyHistogram::Buckets)
+                ss << double(LatencyHistogram::upperBound(i).count()) / 1e6;
+            else
+                ss << "+Inf";
+            ss << "\"} " << acc << '\n';
+        }
+        ss << prefix << "_latency_seconds_sum{" << lbl << "} " << double(m.latency.sum.count()) / 1e9 << '\n'
+           << prefix << "_latency_seconds_count{" << lbl << "} " << m.latency.count << '\n';
+    }
+
+    return ss.str();
+}
+
+std::string Instrumentation::toJson(const std::vector<InstrumentationMetrics> &metrics)
+{
+    ostringstream ss;
+    ss.imbue(locale::classic());
+    ss << "{\"objects\":[";
+    for (size_t n = 0; n < metrics.size(); ++n) {
+        auto const &m = metrics[n];
+        if (n)
+            ss << ',';
+        ss << "{\"kind\":\"" << internal::escape(m.kind) << "\""
+           << ",\"label\":\"" << internal::escape(m.label) << "\""
+           << ",\"object\":\"" << object_id(m.object) << "\""
+           << ",\"calls\":" << m.calls
+           << ",\"bytes\":" << m.bytes
+           << ",\"latency\":{\"count\":" << m.latency.count
+           << ",\"sum_ns\":" << m.latency.sum.count()
+           << ",\"buckets\":[";
+        for (size_t i = 0; i < LatencyHistogram::Buckets; ++i) {
+            if (i)
+                ss << ',';
+            ss << "{\"le_us\":";
+            if (i + 1 < LatencyHistogram::Buckets)
+                ss << LatencyHistogram::upperBound(i).count();
+            else
+                ss << "null";
+            ss << ",\"count\":" << m.latency.counts[i] << '}';
+        }
+        ss << "]}}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+InstrumentationScope::InstrumentationScope(const char *kind, const void *object, const char *label) noexcept
+    : m_object(object),
+      m_label(label)
+{
+    if (Instrumentation::isEnabled()) {
+        m_kind  = kind;
+        m_start = chrono::steady_clock::now();
+    }
+}
+
+InstrumentationScope::~InstrumentationScope()
+{
+    if (!m_kind)
+        return;
+    try {
+        Instrumentation::record(m_kind, m_object, m_label, chrono::steady_clock::now() - m_start, m_bytes);
+    } catch (...) {
+        // Metrics are not worth an exception from the hot path
+    }
+}
+
+} // namespace av
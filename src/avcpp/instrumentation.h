@@ -0,0 +1,162 @@
+#pragma once
+
+#include "avconfig.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "avutils.h"
+
+struct AVFrame;
+
+namespace av {
+
+/**
+ * @brief The LatencyHistogram class
+ *
+ * Latency distribution with power-of-two buckets: bucket N counts calls that took up to 2^N microseconds, the last
+ * one - all the longer calls.
+ */
+struct LatencyHistogram
+{
+    static constexpr size_t Buckets = 22; // 1us ... ~1s, +Inf
+
+    std::array<uint64_t, Buckets> counts{}; ///< not cumulative
+    uint64_t                      count = 0;
+    std::chrono::nanoseconds      sum{0};
+
+    void add(std::chrono::nanoseconds latency) noexcept;
+
+    /**
+     * Bucket index for the latency
+     */
+    static size_t bucket(std::chrono::nanoseconds latency) noexcept;
+
+    /**
+     * Upper bound of the bucket, duration::max() for the last one
+     */
+    static std::chrono::microseconds upperBound(size_t bucket) noexcept;
+
+    /**
+     * Upper bound of the bucket where the q-quantile (0..1) falls
+     */
+    std::chrono::microseconds quantile(double q) const noexcept;
+};
+
+/**
+ * Metrics of the single instrumented object and operation
+ */
+struct InstrumentationMetrics
+{
+    std::string      kind;       ///< operation: "demux", "decode", "encode", "rescale"...
+    std::string      label;      ///< codec or format name when known
+    uintptr_t        object = 0; ///< address of the object
+    uint64_t         calls  = 0;
+    uint64_t         bytes  = 0; ///< payload processed: packet size for demux/decode/encode, frame size otherwise
+    LatencyHistogram latency;
+};
+
+/**
+ * @brief The Instrumentation class
+ *
+ * Call counts, bytes and latency histograms of the hot calls: FormatContext::readPacket(), decoding and encoding in
+ * CodecContext2, VideoRescaler::rescale(), AudioResampler::push()/pop() and BufferSrc/BufferSink filter contexts.
+ *
+ * Hooks are compiled in only with the AV_ENABLE_INSTRUMENTATION build option (AVCPP_ENABLE_INSTRUMENTATION in
+ * avconfig.h), otherwise they are empty macros and cost nothing. Compiled-in hooks are disabled at runtime by
+ * default: the only cost is an atomic flag check per call.
+ *
+ * Metrics are kept per object and dropped with the object. Counters of the object are atomics found via per-thread
+ * cache: the global lock is taken only when the thread meets the object for the first time and by snapshot(),
+ * forget() and reset(), so hooked calls of the different threads are not serialized.
+ *
+ * @code
+ * Instrumentation::setEnabled(true);
+ * ...
+ * auto metrics = Instrumentation::snapshot();
+ * http_reply(Instrumentation::toPrometheus(metrics));
+ * @endcode
+ */
+class Instrumentation
+{
+public:
+    static constexpr bool isCompiled() noexcept
+    {
+        return AVCPP_ENABLE_INSTRUMENTATION;
+    }
+
+    static void setEnabled(bool enable) noexcept;
+    static bool isEnabled() noexcept;
+
+    static std::vector<InstrumentationMetrics> snapshot();
+    static void reset();
+
+    /**
+     * Drop metrics of the object. Called by destructors of the instrumented classes.
+     */
+    static void forget(const void *object) noexcept;
+
+    /**
+     * Account single call. Used by the hooks, can be used for the user-side objects too.
+     */
+    static void record(const char *kind, const void *object, const char *label,
+                       std::chrono::nanoseconds latency, uint64_t bytes);
+
+    /**
+     * Size of the frame buffers, for the hooks that deal with raw frames
+     */
+    static uint64_t frameBytes(const AVFrame *frame) noexcept;
+
+    /**
+     * Prometheus text exposition format: <prefix>_calls_total and <prefix>_bytes_total counters,
+     * <prefix>_latency_seconds histogram, labeled by kind, label and object.
+     */
+    static std::string toPrometheus(const std::vector<InstrumentationMetrics> &metrics,
+                                    std::string_view prefix = "avcpp");
+
+    /**
+     * JSON: {"objects": [{"kind", "label", "object", "calls", "bytes", "latency": {"count", "sum_ns", "buckets":
+     * [{"le_us", "count"}...]}}...]}. Buckets are not cumulative, the last one has "le_us": null.
+     */
+    static std::string toJson(const std::vector<InstrumentationMetrics> &metrics);
+};
+
+/**
+ * @brief The InstrumentationScope class
+ *
+ * Measures lifetime of itself and records it on destruction if instrumentation is enabled.
+ */
+class InstrumentationScope : public noncopyable
+{
+public:
+    InstrumentationScope(const char *kind, const void *object, const char *label = nullptr) noexcept;
+    ~InstrumentationScope();
+
+    void addBytes(uint64_t bytes) noexcept
+    {
+        m_bytes += bytes;
+    }
+
+private:
+    const char                           *m_kind = nullptr;
+    const void                           *m_object;
+    const char                           *m_label;
+    uint64_t                              m_bytes = 0;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace av
+
+#if AVCPP_ENABLE_INSTRUMENTATION
+#  define AVCPP_INSTRUMENT(kind, object, label) ::av::InstrumentationScope avcpp_instrument_scope_{kind, object, label}
+#  define AVCPP_INSTRUMENT_BYTES(bytes) avcpp_instrument_scope_.addBytes(uint64_t(bytes))
+#  define AVCPP_INSTRUMENT_FORGET(object) ::av::Instrumentation::forget(object)
+#else
+#  define AVCPP_INSTRUMENT(kind, object, label) do {} while (0)
+#  define AVCPP_INSTRUMENT_BYTES(bytes) do {} while (0)
+#  define AVCPP_INSTRUMENT_FORGET(object) do {} while (0)
+#endif
@@ -0,0 +1,142 @@
+#include "interleavingmuxer.h"
+
+#if AVCPP_HAS_AVFORMAT
+
+#include <algorithm>
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+Timestamp order_ts(const Packet &pkt)
+{
+    auto ts = pkt.dts();
+    return ts.isNoPts() ? pkt.pts() : ts;
+}
+
+} // anonymous namespace
+
+InterleavingMuxer::InterleavingMuxer(FormatContext &ctx, size_t lookahead)
+    : m_ctx(ctx),
+      m_lookahead(lookahead ? lookahead : 1),
+      m_streams(ctx.streamsCount())
+{
+}
+
+void InterleavingMuxer::write(Packet &&packet, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    lock_guard lock{m_mutex};
+    if (m_error) {
+        throws_if(ec, m_error.value(), m_error.category());
+        return;
+    }
+
+    auto const index = size_t(packet.streamIndex());
+    if (index >= m_streams.size()) {
+        throws_if(ec, Errors::InvalidArgument);
+        return;
+    }
+
+    m_streams[index].packets.push_back(std::move(packet));
+    m_stats.maxQueued = std::max(m_stats.maxQueued, ++m_queued);
+
+    writeReady(false, ec);
+}
+
+void InterleavingMuxer::finishStream(size_t streamIndex, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    lock_guard lock{m_mutex};
+    if (streamIndex >= m_streams.size()) {
+        throws_if(ec, Errors::InvalidArgument);
+        return;
+    }
+    m_streams[streamIndex].finished = true;
+
+    if (!m_error)
+        writeReady(false, ec);
+}
+
+void InterleavingMuxer::flush(OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    lock_guard lock{m_mutex};
+    if (m_error) {
+        throws_if(ec, m_error.value(), m_error.category());
+        return;
+    }
+    writeReady(true, ec);
+}
+
+InterleavingMuxer::Stats InterleavingMuxer::stats() const
+{
+    lock_guard lock{m_mutex};
+    return m_stats;
+}
+
+void InterleavingMuxer::writeReady(bool all, OptionalErrorCode ec)
+{
+    while (m_queued) {
+        bool complete = true; // every unfinished stream has packet
+        bool overflow = false;
+        for (auto const &stream : m_streams) {
+            if (stream.packets.empty() && !stream.finished)
+                complete = false;
+            if (stream.packets.size() > m_lookahead)
+                overflow = true;
+        }
+
+        if (!all && !complete && !overflow)
+            break;
+        if (!complete && !all)
+            ++m_stats.forcedWrites;
+
+        if (!writeFirst(ec))
+            break;
+    }
+}
+
+bool InterleavingMuxer::writeFirst(OptionalErrorCode ec)
+{
+    StreamQueue *first = nullptr;
+    for (auto &stream : m_streams) {
+        if (stream.packets.empty())
+            continue;
+        if (!first) {
+            first = &stream;
+            continue;
+        }
+        auto const ts = order_ts(stream.packets.front());
+        // Packets without timestamps do not wait
+        if (ts.isNoPts() || ts < order_ts(first->packets.front()))
+            first = &stream;
+    }
+
+    if (!first)
+        return false;
+
+    auto pkt = std::move(first->packets.front());
+    first->packets.pop_front();
+    --m_queued;
+
+    std::error_code error;
+    m_ctx.writePacketDirect(pkt, error);
+    if (error) {
+        m_error = error;
+        throws_if(ec, error.value(), error.category());
+        return false;
+    }
+
+    ++m_stats.packetsWritten;
+    return true;
+}
+
+} // namespace av
+
+#endif // if AVCPP_HAS_AVFORMAT
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "avcompat.h"
+
+#if AVCPP_HAS_AVFORMAT
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "avutils.h"
+#include "averror.h"
+#include "packet.h"
+#include "formatcontext.h"
+
+namespace av {
+
+/**
+ * @brief The InterleavingMuxer class
+ *
+ * Thread-safe writer of the packets of several streams produced by independent threads (e.g. audio and video
+ * encoders). Packets are written in DTS order: packet is written when every unfinished stream has a queued packet
+ * and its DTS is the smallest one.
+ *
+ * Lookahead is bounded: when some stream queues more than `lookahead` packets (other stream stalls), the smallest
+ * queued packet is written anyway. So producers never block on the muxer and memory is bounded.
+ *
+ * Packets must have time base set (as encoders do) and stream index of the output stream. Packets are written by
+ * FormatContext::writePacketDirect(): muxer interleaving is not needed on top of this one. Header must be written
+ * before, trailer - after flush().
+ */
+class InterleavingMuxer : public noncopyable
+{
+public:
+    struct Stats
+    {
+        uint64_t packetsWritten = 0;
+        uint64_t forcedWrites   = 0; ///< written on the lookahead overflow, can break DTS order
+        size_t   maxQueued      = 0; ///< max packets queued in all streams
+    };
+
+    /**
+     * Streams of the context must be added before
+     *
+     * @param lookahead  max packets queued in the single stream
+     */
+    explicit InterleavingMuxer(FormatContext &ctx, size_t lookahead = 64);
+
+    /**
+     * Queue packet and write ready ones. Can be called from any thread.
+     */
+    void write(Packet &&packet, OptionalErrorCode ec = throws());
+
+    /**
+     * Stream does not receive packets anymore: other streams do not wait for it
+     */
+    void finishStream(size_t streamIndex, OptionalErrorCode ec = throws());
+
+    /**
+     * Write all queued packets in the DTS order
+     */
+    void flush(OptionalErrorCode ec = throws());
+
+    size_t lookahead() const noexcept { return m_lookahead; }
+
+    Stats stats() const;
+
+private:
+    struct StreamQueue
+    {
+        std::deque<Packet> packets;
+        bool               finished = false;
+    };
+
+    void writeReady(bool all, OptionalErrorCode ec);
+    bool writeFirst(OptionalErrorCode ec);
+
+private:
+    FormatContext           &m_ctx;
+    size_t                   m_lookahead;
+    mutable std::mutex       m_mutex;
+    std::vector<StreamQueue> m_streams;
+    size_t                   m_queued = 0;
+    Stats                    m_stats;
+    std::error_code          m_error;
+};
+
+} // namespace av
+
+#endif // if AVCPP_HAS_AVFORMAT
@@ -0,0 +1,283 @@
+#include "jobscheduler.h"
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+#include "codeccontext.h"
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+thread_local const JobScheduler *t_scheduler = nullptr;
+thread_local int                 t_worker    = -1;
+
+// Every Nth pick starts from the lowest priority: avoid starvation
+constexpr unsigned LowPriorityPickPeriod = 8;
+
+chrono::nanoseconds thread_cpu_time() noexcept
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return chrono::nanoseconds{0};
+    auto const to100ns = [](const FILETIME &ft) {
+        return (uint64_t(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    };
+    return chrono::nanoseconds{int64_t(to100ns(kernel) + to100ns(user)) * 100};
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return chrono::nanoseconds{0};
+    return chrono::seconds{ts.tv_sec} + chrono::nanoseconds{ts.tv_nsec};
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch());
+#endif
+}
+
+void atomic_max(std::atomic<int64_t> &target, int64_t value) noexcept
+{
+    auto cur = target.load(std::memory_order_relaxed);
+    while (cur < value && !target.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+        ;
+}
+
+} // anonymous namespace
+
+//
+// Job
+//
+
+Job::Job(std::string name, JobPriority priority)
+    : m_name(std::move(name)),
+      m_priority(priority)
+{
+}
+
+JobStats Job::stats() const noexcept
+{
+    JobStats stats;
+    stats.cpuTime         = chrono::nanoseconds{m_cpuNs.load(std::memory_order_relaxed)};
+    stats.wallTime        = chrono::nanoseconds{m_wallNs.load(std::memory_order_relaxed)};
+    stats.queueLatency    = chrono::nanoseconds{m_latencyNs.load(std::memory_order_relaxed)};
+    stats.maxQueueLatency = chrono::nanoseconds{m_maxLatencyNs.load(std::memory_order_relaxed)};
+    stats.tasks           = m_tasks.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Job::wait()
+{
+    unique_lock lock{m_waitMutex};
+    m_waitCond.wait(lock, [this] { return m_pending.load(std::memory_order_acquire) == 0; });
+}
+
+void Job::account(chrono::nanoseconds latency, chrono::nanoseconds cpu, chrono::nanoseconds wall) noexcept
+{
+    m_cpuNs.fetch_add(cpu.count(), std::memory_order_relaxed);
+    m_wallNs.fetch_add(wall.count(), std::memory_order_relaxed);
+    m_latencyNs.fetch_add(latency.count(), std::memory_order_relaxed);
+    atomic_max(m_maxLatencyNs, latency.count());
+    m_tasks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Job::taskPosted() noexcept
+{
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Job::taskDone() noexcept
+{
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        lock_guard lock{m_waitMutex};
+        m_waitCond.notify_all();
+    }
+}
+
+//
+// JobScheduler
+//
+
+JobScheduler::JobScheduler(size_t threads)
+{
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    m_workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        m_workers.push_back(make_unique<Worker>());
+
+    // Start after all workers are created: they steal from each other
+    for (size_t i = 0; i < threads; ++i)
+        m_workers[i]->thread = std::thread([this, i] { workerProc(i); });
+}
+
+JobScheduler::~JobScheduler()
+{
+    {
+        lock_guard lock{m_sleepMutex};
+        m_stop = true;
+    }
+    m_sleepCond.notify_all();
+
+    for (auto &worker : m_workers) {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+
+    // Release jobs waiters of the dropped tasks
+    for (auto &worker : m_workers) {
+        for (auto &queue : worker->queues) {
+            for (auto &task : queue)
+                task.job->taskDone();
+        }
+    }
+}
+
+std::shared_ptr<Job> JobScheduler::createJob(std::string name, JobPriority priority)
+{
+    return make_shared<Job>(std::move(name), priority);
+}
+
+void JobScheduler::post(const std::shared_ptr<Job> &job, std::function<void()> task)
+{
+    auto const prio = size_t(job->priority());
+    job->taskPosted();
+
+    // Locality: own tasks to the own queue
+    size_t index;
+    if (t_scheduler == this)
+        index = size_t(t_worker);
+    else
+        index = m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+
+    // Counted before pushing: counter never goes below real tasks count
+    m_queued.fetch_add(1, std::memory_order_release);
+    {
+        auto &worker = *m_workers[index];
+        lock_guard lock{worker.mutex};
+        worker.queues[prio].push_back({job, std::move(task), chrono::steady_clock::now()});
+    }
+
+    lock_guard lock{m_sleepMutex};
+    if (m_sleepers)
+        m_sleepCond.notify_one();
+}
+
+int JobScheduler::currentWorker() const noexcept
+{
+    return t_scheduler == this ? t_worker : -1;
+}
+
+void JobScheduler::prepareCodecContext(CodecContext2 &ctx, int threads) noexcept
+{
+    if (threads < 1)
+        threads = 1;
+    ctx.setThreadCount(threads);
+    if (threads > 1)
+        ctx.setThreadType(FF_THREAD_SLICE); // frame threading adds latency and own threads per frame
+}
+
+bool JobScheduler::popLocal(Worker &worker, bool lowFirst, Task &task)
+{
+    lock_guard lock{worker.mutex};
+    for (int i = 0; i < 3; ++i) {
+        auto &queue = worker.queues[lowFirst ? i : 2 - i];
+        if (!queue.empty()) {
+            task = std::move(queue.front());
+            queue.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobScheduler::steal(size_t thief, bool lowFirst, Task &task)
+{
+    // Owner takes from the front and thieves from the back: they rarely contend for the same task
+    // First pass skips busy workers, second one waits for them
+    auto const count = m_workers.size();
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t n = 1; n < count; ++n) {
+            auto &victim = *m_workers[(thief + n) % count];
+            unique_lock lock{victim.mutex, std::defer_lock};
+            if (pass == 0) {
+                if (!lock.try_lock())
+                    continue;
+            } else {
+                lock.lock();
+            }
+            for (int i = 0; i < 3; ++i) {
+                auto &queue = victim.queues[lowFirst ? i : 2 - i];
+                if (!queue.empty()) {
+                    task = std::move(queue.back());
+                    queue.pop_back();
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void JobScheduler::execute(Task &task)
+{
+    auto const start = chrono::steady_clock::now();
+    auto const cpuStart = thread_cpu_time();
+
+    try {
+        task.fn();
+    } catch (...) {
+        // Tasks must handle own errors, do not let them kill the worker
+    }
+
+    auto const cpuEnd = thread_cpu_time();
+    auto const end = chrono::steady_clock::now();
+
+    task.job->account(chrono::duration_cast<chrono::nanoseconds>(start - task.posted),
+                      cpuEnd - cpuStart,
+                      chrono::duration_cast<chrono::nanoseconds>(end - start));
+
+    // Release task resources before signaling completion
+    task.fn = nullptr;
+    auto job = std::move(task.job);
+    job->taskDone();
+}
+
+void JobScheduler::workerProc(size_t index)
+{
+    t_scheduler = this;
+    t_worker    = int(index);
+
+    auto &self = *m_workers[index];
+    Task task;
+
+    while (!m_stop.load(std::memory_order_acquire)) {
+        auto const lowFirst = (++self.picks % LowPriorityPickPeriod) == 0;
+
+        // Cheap check before touching other workers queues
+        if (m_queued.load(std::memory_order_acquire) &&
+            (popLocal(self, lowFirst, task) || steal(index, lowFirst, task)))
+        {
+            m_queued.fetch_sub(1, std::memory_order_acq_rel);
+            execute(task);
+            continue;
+        }
+
+        unique_lock lock{m_sleepMutex};
+        ++m_sleepers;
+        m_sleepCond.wait(lock, [this] {
+            return m_stop.load(std::memory_order_acquire) || m_queued.load(std::memory_order_acquire);
+        });
+        --m_sleepers;
+    }
+
+    t_scheduler = nullptr;
+    t_worker    = -1;
+}
+
+} // namespace av
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "avutils.h"
+
+namespace av {
+
+class CodecContext2;
+
+enum class JobPriority
+{
+    Low = 0,
+    Normal,
+    High,
+};
+
+/**
+ * Job counters. Times accumulated over all job tasks.
+ */
+struct JobStats
+{
+    std::chrono::nanoseconds cpuTime{0};           ///< thread CPU time spent in the job tasks
+    std::chrono::nanoseconds wallTime{0};          ///< wall clock time spent in the job tasks
+    std::chrono::nanoseconds queueLatency{0};      ///< total time from task posting till start
+    std::chrono::nanoseconds maxQueueLatency{0};
+    uint64_t                 tasks = 0;            ///< completed tasks
+
+    std::chrono::nanoseconds averageQueueLatency() const noexcept
+    {
+        return tasks ? queueLatency / int64_t(tasks) : std::chrono::nanoseconds{0};
+    }
+};
+
+/**
+ * @brief The Job class
+ *
+ * Group of tasks sharing priority and counters, e.g. single transcoding. Created by JobScheduler::createJob().
+ */
+class Job : public noncopyable
+{
+public:
+    const std::string& name() const noexcept { return m_name; }
+
+    JobPriority priority() const noexcept { return m_priority.load(std::memory_order_relaxed); }
+    /// Affects tasks posted after the call
+    void setPriority(JobPriority priority) noexcept { m_priority.store(priority, std::memory_order_relaxed); }
+
+    JobStats stats() const noexcept;
+
+    /// Tasks posted and not completed yet
+    size_t pendingTasks() const noexcept { return m_pending.load(std::memory_order_acquire); }
+
+    /**
+     * Wait till all posted tasks are completed. Must not be called from the scheduler thread.
+     */
+    void wait();
+
+    // Internal: use JobScheduler::createJob()
+    Job(std::string name, JobPriority priority);
+
+private:
+    friend class JobScheduler;
+
+    void account(std::chrono::nanoseconds latency, std::chrono::nanoseconds cpu, std::chrono::nanoseconds wall) noexcept;
+    void taskPosted() noexcept;
+    void taskDone() noexcept;
+
+private:
+    std::string              m_name;
+    std::atomic<JobPriority> m_priority;
+
+    std::atomic<int64_t>  m_cpuNs{0};
+    std::atomic<int64_t>  m_wallNs{0};
+    std::atomic<int64_t>  m_latencyNs{0};
+    std::atomic<int64_t>  m_maxLatencyNs{0};
+    std::atomic<uint64_t> m_tasks{0};
+
+    std::atomic<size_t>     m_pending{0};
+    std::mutex              m_waitMutex;
+    std::condition_variable m_waitCond;
+};
+
+/**
+ * @brief The JobScheduler class
+ *
+ * Fixed size work-stealing thread pool to run tasks of many concurrent jobs (transcodings) without thread per job.
+ *
+ * - Every worker has own task deques (one per priority). Tasks posted from the worker thread go to the own deques,
+ *   other ones are spread over workers in round-robin. Idle worker steals tasks from the others.
+ * - Higher priority tasks are taken first. To avoid starvation, every 8th pick starts from the lowest priority.
+ * - Deques are FIFO for the owner: long running tasks that re-post themselves (like Pipeline stages) yield to other
+ *   jobs tasks of the same priority, it gives fairness between jobs.
+ *
+ * Tasks must not block: Pipeline run on the scheduler uses non-blocking stages for that reason.
+ *
+ * Codecs have own thread pools by default, that thrash with scheduler threads when many jobs run in parallel. Use
+ * prepareCodecContext() before opening codecs to disable them.
+ */
+class JobScheduler : public noncopyable
+{
+public:
+    /**
+     * @param threads  workers count, 0 - hardware concurrency
+     */
+    explicit JobScheduler(size_t threads = 0);
+
+    /**
+     * Stops workers. Tasks that are not started are dropped.
+     */
+    ~JobScheduler();
+
+    std::shared_ptr<Job> createJob(std::string name = {}, JobPriority priority = JobPriority::Normal);
+
+    /**
+     * Post task of the job. Exceptions thrown by the task are caught and dropped: handle errors inside the task.
+     */
+    void post(const std::shared_ptr<Job> &job, std::function<void()> task);
+
+    size_t threadsCount() const noexcept { return m_workers.size(); }
+
+    /**
+     * Index of the current worker in the scheduler it belongs or -1 if called outside of the scheduler thread
+     */
+    int currentWorker() const noexcept;
+
+    /**
+     * Configure codec context to not spawn own threads. Must be called before open().
+     *
+     * @param threads  codec internal threads, 1 - none, values greater than 1 enables slice threading only
+     */
+    static void prepareCodecContext(CodecContext2 &ctx, int threads = 1) noexcept;
+
+private:
+    struct Task
+    {
+        std::shared_ptr<Job>                  job;
+        std::function<void()>                 fn;
+        std::chrono::steady_clock::time_point posted;
+    };
+
+    struct Worker
+    {
+        std::mutex      mutex;
+        std::deque<Task> queues[3]; // by JobPriority
+        std::thread     thread;
+        unsigned        picks = 0;
+    };
+
+    void workerProc(size_t index);
+    bool popLocal(Worker &worker, bool lowFirst, Task &task);
+    bool steal(size_t thief, bool lowFirst, Task &task);
+    void execute(Task &task);
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t>                  m_nextWorker{0};
+    std::atomic<size_t>                  m_queued{0};
+    std::atomic_bool                     m_stop{false};
+
+    std::mutex              m_sleepMutex;
+    std::condition_variable m_sleepCond;
+    size_t                  m_sleepers = 0;
+};
+
+} // namespace av
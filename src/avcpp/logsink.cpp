@@ -0,0 +1,414 @@
+#include "logsink.h"
+#include "diagutils.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavutil/log.h>
+}
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+struct Entry
+{
+    int        level;
+    const void *context;
+    int64_t    time; // system clock, nanoseconds
+    uint32_t   thread;
+    uint32_t   tagLength;
+    uint32_t   messageLength;
+    uint64_t   suppressed;
+    char       tag[LogSink::TagSize];
+    char       message[LogSink::MessageSize];
+};
+
+// Single producer (logging thread), single consumer (drain)
+struct Ring
+{
+    Ring(size_t capacity, uint64_t generation, uint32_t thread)
+        : entries(capacity),
+          mask(capacity - 1),
+          generation(generation),
+          thread(thread)
+    {
+    }
+
+    vector<Entry>    entries;
+    size_t           mask;
+    atomic<uint64_t> head{0};
+    atomic<uint64_t> tail{0};
+    atomic_bool      alive{true}; // owning thread is running, dead rings are removed by drain() once empty
+    uint64_t         generation;
+    uint32_t         thread;
+};
+
+// Marks the ring of the exited thread dead: FFmpeg spawns frame/slice threads on every avcodec_open2()
+struct RingOwner
+{
+    shared_ptr<Ring> ring;
+
+    ~RingOwner()
+    {
+        reset();
+    }
+
+    void reset(shared_ptr<Ring> next = {}) noexcept
+    {
+        if (ring)
+            ring->alive.store(false, memory_order_release);
+        ring = std::move(next);
+    }
+};
+
+// Rate limit state of the single context. Slots live in the open-addressing table keyed by the context pointer,
+// slots idle in the current second are evicted by the new contexts.
+struct RateSlot
+{
+    atomic<uintptr_t> key{0};        // context pointer + 1, 0 - free slot
+    atomic<int64_t>   window{-1};    // second of the counted messages
+    atomic<uint32_t>  count{0};
+    atomic<uint64_t>  suppressed{0};
+};
+
+constexpr size_t RateSlotsBits = 12;
+constexpr size_t RateSlots     = size_t(1) << RateSlotsBits;
+constexpr size_t RateProbes    = 16;
+
+struct SinkState
+{
+    atomic_bool      installed{false};
+    atomic<uint64_t> generation{0};
+    atomic<unsigned> rateLimit{0};
+    size_t           ringSize = 0;
+
+    std::mutex               access; // rings list
+    vector<shared_ptr<Ring>> rings;
+
+    std::mutex         drainAccess; // consumer side: handler and ring tails
+    LogSink::Handler   handler;
+
+    std::mutex              threadAccess;
+    condition_variable      wakeup;
+    bool                    stop = false;
+    thread                  drainer;
+    chrono::milliseconds    drainInterval{20};
+
+    atomic<uint64_t> written{0};
+    atomic<uint64_t> dropped{0};
+    atomic<uint64_t> suppressed{0};
+
+    array<RateSlot, RateSlots> rateSlots;
+    RateSlot                   rateOverflow; // shared by contexts that find no slot, see rate_slot()
+
+    // Program exits without LogSink::uninstall()
+    ~SinkState();
+};
+
+SinkState& state()
+{
+    static SinkState st;
+    return st;
+}
+
+Ring* thread_ring()
+{
+    thread_local RingOwner owner;
+
+    auto &st = state();
+    auto const generation = st.generation.load(memory_order_acquire);
+    if (owner.ring && owner.ring->generation == generation)
+        return owner.ring.get();
+
+    lock_guard lock{st.access};
+    if (st.generation.load(memory_order_relaxed) != generation || !st.ringSize)
+        return nullptr;
+    auto ring = make_shared<Ring>(st.ringSize, generation, internal::thread_id());
+    st.rings.push_back(ring);
+    owner.reset(std::move(ring));
+    return owner.ring.get();
+}
+
+void reset_slot(RateSlot &slot) noexcept
+{
+    slot.window.store(-1, memory_order_relaxed);
+    slot.count.store(0, memory_order_relaxed);
+    slot.suppressed.store(0, memory_order_relaxed);
+}
+
+// Slot of the context: found, free or evicted one. Concurrent eviction can mix counters of two contexts for a
+// moment: limit is approximate then, not shared.
+RateSlot& rate_slot(SinkState &st, const void *context, int64_t window)
+{
+    auto const key = reinterpret_cast<uintptr_t>(context) + 1;
+    // Fibonacci hashing: neighbour objects get different slots
+    auto const start = size_t((uint64_t(key) * 0x9E3779B97F4A7C15ull) >> (64 - RateSlotsBits));
+
+    RateSlot *idle = nullptr;
+    for (size_t i = 0; i < RateProbes; ++i) {
+        auto &slot = st.rateSlots[(start + i) & (RateSlots - 1)];
+        auto current = slot.key.load(memory_order_acquire);
+        if (current == key)
+            return slot;
+        if (!current) {
+            if (slot.key.compare_exchange_strong(current, key, memory_order_acq_rel))
+                return slot;
+            if (current == key)
+                return slot;
+            continue;
+        }
+        if (!idle && slot.window.load(memory_order_relaxed) != window)
+            idle = &slot;
+    }
+
+    if (idle) {
+        auto current = idle->key.load(memory_order_acquire);
+        if (current != key && idle->key.compare_exchange_strong(current, key, memory_order_acq_rel))
+            reset_slot(*idle);
+        return *idle;
+    }
+
+    // More than RateProbes contexts are active in the same second around this slot
+    return st.rateOverflow;
+}
+
+bool rate_limited(SinkState &st, const void *context, uint64_t &suppressed)
+{
+    auto const limit = st.rateLimit.load(memory_order_relaxed);
+    if (!limit)
+        return false;
+
+    auto const window = chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    auto &slot = rate_slot(st, context, window);
+
+    auto current = slot.window.load(memory_order_acquire);
+    if (current != window && slot.window.compare_exchange_strong(current, window, memory_order_acq_rel))
+        slot.count.store(0, memory_order_relaxed);
+
+    if (slot.count.fetch_add(1, memory_order_relaxed) >= limit) {
+        slot.suppressed.fetch_add(1, memory_order_relaxed);
+        st.suppressed.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    suppressed = slot.suppressed.exchange(0, memory_order_relaxed);
+    return false;
+}
+
+void log_callback(void *avcl, int level, const char *fmt, va_list vl)
+{
+    // Same as av_log_default_callback: high bits are flags
+    if (level >= 0)
+        level &= 0xff;
+    if (level > av_log_get_level())
+        return;
+
+    auto &st = state();
+
+    uint64_t suppressed = 0;
+    if (rate_limited(st, avcl, suppressed))
+        return;
+
+    Ring *ring = nullptr;
+    try {
+        ring = thread_ring();
+    } catch (...) {
+    }
+    if (!ring)
+        return;
+
+    auto const head = ring->head.load(memory_order_relaxed);
+    if (head - ring->tail.load(memory_order_acquire) >= ring->entries.size()) {
+        st.dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    auto &entry = ring->entries[head & ring->mask];
+    entry.level      = level;
+    entry.context    = avcl;
+    entry.time       = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    entry.thread     = ring->thread;
+    entry.suppressed = suppressed;
+
+    auto cls = avcl ? *static_cast<const AVClass* const*>(avcl) : nullptr;
+    auto tag = cls && cls->item_name ? cls->item_name(avcl) : nullptr;
+    entry.tagLength = tag ? uint32_t(std::min(strlen(tag), LogSink::TagSize)) : 0;
+    if (entry.tagLength)
+        memcpy(entry.tag, tag, entry.tagLength);
+
+    auto const length = vsnprintf(entry.message, LogSink::MessageSize, fmt, vl);
+    entry.messageLength = length > 0 ? uint32_t(std::min(size_t(length), LogSink::MessageSize - 1)) : 0;
+
+    ring->head.store(head + 1, memory_order_release);
+}
+
+void default_handler(const LogRecord &record)
+{
+    if (!record.tag.empty())
+        fprintf(stderr, "[%.*s @ %p] ", int(record.tag.size()), record.tag.data(), record.context);
+    fprintf(stderr, "%.*s", int(record.message.size()), record.message.data());
+    if (record.suppressed)
+        fprintf(stderr, "  (%llu messages suppressed)\n", static_cast<unsigned long long>(record.suppressed));
+}
+
+void drain(SinkState &st)
+{
+    lock_guard drainLock{st.drainAccess};
+
+    vector<shared_ptr<Ring>> rings;
+    {
+        lock_guard lock{st.access};
+        rings = st.rings;
+    }
+
+    auto const &handler = st.handler ? st.handler : LogSink::Handler{default_handler};
+    bool hasDead = false;
+    for (auto const &ring : rings) {
+        // Checked before the head: nothing is written into the dead ring after it
+        hasDead = hasDead || !ring->alive.load(memory_order_acquire);
+        auto const tail = ring->tail.load(memory_order_relaxed);
+        auto const head = ring->head.load(memory_order_acquire);
+        for (auto index = tail; index < head; ++index) {
+            auto const &entry = ring->entries[index & ring->mask];
+
+            LogRecord record;
+            record.level      = entry.level;
+            record.context    = entry.context;
+            record.tag        = string_view(entry.tag, entry.tagLength);
+            record.message    = string_view(entry.message, entry.messageLength);
+            record.thread     = entry.thread;
+            record.time       = chrono::system_clock::time_point{
+                chrono::duration_cast<chrono::system_clock::duration>(chrono::nanoseconds(entry.time))};
+            record.suppressed = entry.suppressed;
+
+            try {
+                handler(record);
+            } catch (...) {
+                // Logging must not break the drain loop
+            }
+            st.written.fetch_add(1, memory_order_relaxed);
+        }
+        ring->tail.store(head, memory_order_release);
+    }
+
+    if (hasDead) {
+        lock_guard lock{st.access};
+        st.rings.erase(std::remove_if(st.rings.begin(), st.rings.end(), [](const shared_ptr<Ring> &ring) {
+            return !ring->alive.load(memory_order_acquire) &&
+                   ring->tail.load(memory_order_relaxed) == ring->head.load(memory_order_acquire);
+        }), st.rings.end());
+    }
+}
+
+void stop_drainer(SinkState &st)
+{
+    {
+        lock_guard lock{st.threadAccess};
+        st.stop = true;
+    }
+    st.wakeup.notify_all();
+    if (st.drainer.joinable())
+        st.drainer.join();
+}
+
+SinkState::~SinkState()
+{
+    if (installed.exchange(false, memory_order_acq_rel))
+        av_log_set_callback(av_log_default_callback);
+    stop_drainer(*this);
+}
+
+} // anonymous namespace
+
+void LogSink::install()
+{
+    install(Options{});
+}
+
+void LogSink::install(const Options &options)
+{
+    uninstall();
+
+    auto &st = state();
+    {
+        lock_guard drainLock{st.drainAccess};
+        st.handler = options.handler;
+    }
+    {
+        lock_guard lock{st.access};
+        st.rings.clear();
+        st.ringSize = internal::round_pow2(std::max<size_t>(options.ringSize, 2));
+        st.generation.fetch_add(1, memory_order_release);
+    }
+    st.rateLimit.store(options.rateLimit, memory_order_relaxed);
+    for (auto &slot : st.rateSlots) {
+        slot.key.store(0, memory_order_relaxed);
+        reset_slot(slot);
+    }
+    reset_slot(st.rateOverflow);
+
+    st.stop          = false;
+    st.drainInterval = std::max(options.drainInterval, chrono::milliseconds(1));
+    st.drainer = thread([&st] {
+        unique_lock lock{st.threadAccess};
+        while (!st.stop) {
+            st.wakeup.wait_for(lock, st.drainInterval);
+            lock.unlock();
+            drain(st);
+            lock.lock();
+        }
+    });
+
+    st.installed.store(true, memory_order_release);
+    av_log_set_callback(log_callback);
+}
+
+void LogSink::uninstall()
+{
+    auto &st = state();
+    if (!st.installed.exchange(false, memory_order_acq_rel))
+        return;
+
+    av_log_set_callback(av_log_default_callback);
+    stop_drainer(st);
+    drain(st);
+}
+
+bool LogSink::isInstalled() noexcept
+{
+    return state().installed.load(memory_order_acquire);
+}
+
+void LogSink::flush()
+{
+    drain(state());
+}
+
+LogSink::Stats LogSink::stats()
+{
+    auto &st = state();
+    Stats stats;
+    stats.written    = st.written.load(memory_order_relaxed);
+    stats.dropped    = st.dropped.load(memory_order_relaxed);
+    stats.suppressed = st.suppressed.load(memory_order_relaxed);
+    {
+        lock_guard lock{st.access};
+        stats.rings = st.rings.size();
+    }
+    return stats;
+}
+
+} // namespace av
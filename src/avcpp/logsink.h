@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace av {
+
+/**
+ * Single log message passed to the LogSink handler. Views are valid only during the handler call.
+ */
+struct LogRecord
+{
+    int                                   level   = 0;
+    const void                           *context = nullptr; ///< av_log() context: FormatContext, CodecContext2...
+    std::string_view                      tag;               ///< context class item name: codec or format name
+    std::string_view                      message;           ///< formatted, truncated to LogSink::MessageSize
+    uint32_t                              thread  = 0;       ///< sequential thread id, same as TraceEvent::thread
+    std::chrono::system_clock::time_point time;
+    uint64_t                              suppressed = 0;    ///< messages of the same context dropped by the rate
+                                                             ///< limit before this one
+};
+
+/**
+ * @brief The LogSink class
+ *
+ * Replacement of the FFmpeg log callback (av_log() and the avcpp fflog() go through it) for the heavily threaded
+ * applications: the default callback formats under the global lock, so floods of warnings from the broken
+ * stream serialize decoding threads.
+ *
+ * - Level is checked before formatting (av_log_get_level()).
+ * - Messages are formatted into the per-thread lock-free ring: logging threads never wait; when the ring is full
+ *   the message is dropped and counted. Ring of the exited thread is freed once drained.
+ * - Rings are drained by the background thread that calls the handler.
+ * - Rate limit: at most `rateLimit` messages per second from the single context, rest are counted and reported
+ *   in the next passed message of that context. Contexts are tracked in the bounded table, idle ones are evicted;
+ *   only contexts that find no slot (thousands logging in the same second) share the limit.
+ * - Every message is tagged by its context pointer and class item name (codec/format name).
+ *
+ * @code
+ * LogSink::Options opts;
+ * opts.handler = [](const LogRecord &rec) { spdlog::warn("[{}] {}", rec.tag, rec.message); };
+ * LogSink::install(opts);
+ * ...
+ * LogSink::uninstall(); // restores av_log_default_callback, drains the rest
+ * @endcode
+ *
+ * Sink left installed is stopped on the program exit, the rest of the messages is not drained then.
+ */
+class LogSink
+{
+public:
+    static constexpr size_t MessageSize = 480;
+    static constexpr size_t TagSize     = 32;
+
+    using Handler = std::function<void(const LogRecord &record)>;
+
+    struct Options
+    {
+        size_t                    ringSize      = 1024; ///< messages per logging thread
+        unsigned                  rateLimit     = 100;  ///< messages per second per context, 0 - unlimited
+        std::chrono::milliseconds drainInterval{20};
+        Handler                   handler;              ///< stderr if empty, called from the drain thread
+    };
+
+    struct Stats
+    {
+        uint64_t written    = 0; ///< passed to the handler
+        uint64_t dropped    = 0; ///< ring overflow
+        uint64_t suppressed = 0; ///< rate limit
+        size_t   rings      = 0; ///< allocated per-thread rings, rings of the exited threads are freed when drained
+    };
+
+    static void install();
+    static void install(const Options &options);
+    static void uninstall();
+    static bool isInstalled() noexcept;
+
+    /**
+     * Pass all queued messages to the handler from the caller thread
+     */
+    static void flush();
+
+    static Stats stats();
+};
+
+} // namespace av
@@ -0,0 +1,188 @@
+#include "lowlatency.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+// Zero-latency private options of the known encoders. Options absent in the encoder are skipped, so the table is
+// applied as is: x264/x265 - tune, nvenc - zerolatency/delay/rc-lookahead, libvpx - deadline/lag-in-frames.
+const pair<const char*, const char*> zero_latency_options[] = {
+    {"tune",          "zerolatency"},
+    {"zerolatency",   "1"},
+    {"delay",         "0"},
+    {"rc-lookahead",  "0"},
+    {"deadline",      "realtime"},
+    {"lag-in-frames", "0"},
+};
+
+void set_slice_threads(CodecContext2 &ctx, int threads)
+{
+    ctx.setThreadType(FF_THREAD_SLICE);
+    if (threads > 0)
+        ctx.setThreadCount(threads);
+}
+
+} // anonymous namespace
+
+#if AVCPP_HAS_AVFORMAT
+void LowLatencyProfile::applyInput(FormatContext &ctx) const
+{
+    auto raw = ctx.raw();
+    if (!raw)
+        return;
+    raw->flags |= AVFMT_FLAG_NOBUFFER;
+    raw->probesize = probeSize;
+    raw->max_analyze_duration = analyzeDuration;
+    raw->max_delay = maxDelay;
+}
+
+void LowLatencyProfile::applyOutput(FormatContext &ctx) const
+{
+    auto raw = ctx.raw();
+    if (!raw)
+        return;
+    raw->flush_packets = 1;
+    raw->max_delay = maxDelay;
+}
+#endif // if AVCPP_HAS_AVFORMAT
+
+void LowLatencyProfile::applyDecoder(CodecContext2 &ctx) const
+{
+    if (!ctx.isValid())
+        return;
+    ctx.addFlags(AV_CODEC_FLAG_LOW_DELAY);
+    set_slice_threads(ctx, threads);
+}
+
+void LowLatencyProfile::applyEncoder(CodecContext2 &ctx) const
+{
+    if (!ctx.isValid())
+        return;
+
+    ctx.addFlags(AV_CODEC_FLAG_LOW_DELAY);
+    set_slice_threads(ctx, threads);
+
+    auto raw = ctx.raw();
+    raw->max_b_frames = 0;
+    if (gopSize > 0)
+        raw->gop_size = gopSize;
+
+    for (auto const &[key, value] : zero_latency_options) {
+        std::error_code ec;
+        ctx.setOption(key, value, ec);
+    }
+}
+
+
+LatencyTracker::LatencyTracker(std::vector<string> stages, std::chrono::microseconds tolerance, size_t maxPending)
+    : m_tolerance(tolerance.count()),
+      m_maxPending(maxPending ? maxPending : 1)
+{
+    m_stages.resize(stages.size());
+    for (size_t i = 0; i < stages.size(); ++i)
+        m_stages[i].name = std::move(stages[i]);
+    m_total.name = "total";
+}
+
+void LatencyTracker::mark(size_t stage, int streamIndex, const Timestamp &pts)
+{
+    if (stage >= m_stages.size() || pts.isNoPts())
+        return;
+
+    auto const now = Clock::now();
+    auto const key = pts.timestamp(Rational{1, 1000000});
+
+    auto const account = [](StageStats &st, Clock::duration latency) {
+        ++st.count;
+        st.total += latency;
+        st.min = std::min(st.min, latency);
+        st.max = std::max(st.max, latency);
+    };
+
+    lock_guard lock{m_mutex};
+
+    auto &items = m_items[streamIndex];
+
+    if (stage == 0) {
+        ++m_stages[0].count;
+        auto const it = items.insert_or_assign(key, Pending{0, now, now}).first;
+        // Forget the oldest items of the stream: they never reach the last stage
+        while (items.size() > m_maxPending) {
+            auto oldest = items.begin();
+            if (oldest == it)
+                break;
+            items.erase(oldest);
+            ++m_dropped;
+        }
+        return;
+    }
+
+    // Nearest item within tolerance that did not pass this stage yet
+    auto it = items.end();
+    for (auto cur = items.lower_bound(key - m_tolerance); cur != items.end() && cur->first <= key + m_tolerance; ++cur) {
+        if (cur->second.stage >= stage)
+            continue;
+        if (it == items.end() || std::abs(cur->first - key) < std::abs(it->first - key))
+            it = cur;
+    }
+    if (it == items.end()) {
+        ++m_unmatched;
+        return;
+    }
+
+    auto &item = it->second;
+    account(m_stages[stage], now - item.last);
+    item.stage = stage;
+    item.last  = now;
+
+    if (stage + 1 == m_stages.size()) {
+        account(m_total, now - item.first);
+        items.erase(it);
+    }
+}
+
+std::vector<LatencyTracker::StageStats> LatencyTracker::stats() const
+{
+    lock_guard lock{m_mutex};
+    return m_stages;
+}
+
+LatencyTracker::StageStats LatencyTracker::total() const
+{
+    lock_guard lock{m_mutex};
+    return m_total;
+}
+
+uint64_t LatencyTracker::dropped() const
+{
+    lock_guard lock{m_mutex};
+    return m_dropped;
+}
+
+uint64_t LatencyTracker::unmatched() const
+{
+    lock_guard lock{m_mutex};
+    return m_unmatched;
+}
+
+void LatencyTracker::reset()
+{
+    lock_guard lock{m_mutex};
+    for (auto &st : m_stages)
+        st = StageStats{std::move(st.name)};
+    m_total     = StageStats{"total"};
+    m_items.clear();
+    m_dropped   = 0;
+    m_unmatched = 0;
+}
+
+} // namespace av
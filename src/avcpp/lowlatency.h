@@ -0,0 +1,183 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "avutils.h"
+#include "codeccontext.h"
+#include "timestamp.h"
+
+#if AVCPP_HAS_AVFORMAT
+#include "formatcontext.h"
+#endif // if AVCPP_HAS_AVFORMAT
+
+namespace av {
+
+/**
+ * @brief The LowLatencyProfile class
+ *
+ * Settings for the live processing where end-to-end latency matters more than compression efficiency. Applied to
+ * contexts before they are opened:
+ *
+ * - input: no demuxer buffering (AVFMT_FLAG_NOBUFFER), minimal probing;
+ * - output: packets flushed right after write, no muxing delay;
+ * - decoders: AV_CODEC_FLAG_LOW_DELAY, slice threading instead of frame one (frame threading delays output by
+ *   thread count frames);
+ * - encoders: no B-frames and lookahead, short GOP, zero-latency tuning of the known encoders (x264, x265, libvpx,
+ *   nvenc...).
+ *
+ * @code
+ * LowLatencyProfile profile;
+ * profile.applyInput(ictx);
+ * ictx.openInput(uri);
+ * ...
+ * profile.applyDecoder(vdec);
+ * vdec.open();
+ * ...
+ * VideoEncoderContext enc{codec};
+ * ... // size, format, time base, bit rate
+ * profile.applyEncoder(enc);
+ * enc.open();
+ * @endcode
+ */
+class LowLatencyProfile
+{
+public:
+    int64_t probeSize       = 32;  ///< bytes, minimal allowed by FFmpeg
+    int64_t analyzeDuration = 0;   ///< microseconds, 0 - stream parameters from the first packets only
+    int     maxDelay        = 0;   ///< microseconds, muxer/demuxer max delay
+    int     gopSize         = 0;   ///< encoder GOP, 0 - keep encoder one
+    int     threads         = 0;   ///< slice threads for codecs, 0 - auto
+
+#if AVCPP_HAS_AVFORMAT
+    /**
+     * Configure input context. Must be called before FormatContext::openInput().
+     */
+    void applyInput(FormatContext &ctx) const;
+
+    /**
+     * Configure output context. Must be called before FormatContext::writeHeader().
+     */
+    void applyOutput(FormatContext &ctx) const;
+#endif // if AVCPP_HAS_AVFORMAT
+
+    /**
+     * Configure decoder. Must be called before open().
+     */
+    void applyDecoder(CodecContext2 &ctx) const;
+
+    /**
+     * Configure encoder. Must be called before open(), codec must be set: zero-latency tuning is applied through
+     * the codec private options, unknown options are skipped.
+     */
+    void applyEncoder(CodecContext2 &ctx) const;
+};
+
+/**
+ * @brief The LatencyTracker class
+ *
+ * Measures wall-clock latency that every packet/frame accrues at every processing stage. Stages are marked with
+ * mark() in the order they were given to the constructor, items are matched by the stream index and PTS, so
+ * the same item can be followed from the demuxed packet through the decoded frame to the encoded packet. PTS are
+ * compared in microseconds with `tolerance`, so time base changes between stages are allowed.
+ *
+ * Latency of the stage N is a time between marks N-1 and N of the same item. Item is forgotten when the last
+ * stage is marked or when more than `maxPending` items of the same stream wait (dropped frames, for example).
+ *
+ * Thread-safe: stages can be marked from the different threads.
+ *
+ * @code
+ * LatencyTracker tracker{{"demux", "decode", "encode"}};
+ * tracker.mark(0, pkt);   // just read
+ * tracker.mark(1, frame); // decoded
+ * tracker.mark(2, opkt);  // encoded
+ * ...
+ * for (auto const &st : tracker.stats())
+ *     clog << st.name << ": " << st.average().count() << '\n';
+ * @endcode
+ */
+class LatencyTracker : public noncopyable
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct StageStats
+    {
+        std::string     name;
+        uint64_t        count = 0;
+        Clock::duration min   = Clock::duration::max();
+        Clock::duration max   = Clock::duration::zero();
+        Clock::duration total = Clock::duration::zero();
+
+        Clock::duration average() const noexcept
+        {
+            return count ? total / int64_t(count) : Clock::duration::zero();
+        }
+    };
+
+    explicit LatencyTracker(std::vector<std::string> stages,
+                            std::chrono::microseconds tolerance = std::chrono::milliseconds(1),
+                            size_t maxPending = 1024);
+
+    /**
+     * Item with given stream index and PTS reached stage. Items without PTS are skipped.
+     */
+    void mark(size_t stage, int streamIndex, const Timestamp &pts);
+
+    /**
+     * Shortcut for Packet, VideoFrame and AudioSamples
+     */
+    template<typename T>
+    void mark(size_t stage, const T &item)
+    {
+        mark(stage, item.streamIndex(), item.pts());
+    }
+
+    /**
+     * Per-stage latency. First stage is an entry point: only items count is collected.
+     */
+    std::vector<StageStats> stats() const;
+
+    /**
+     * Latency from the first stage to the last one
+     */
+    StageStats total() const;
+
+    /**
+     * Items that did not reach the last stage
+     */
+    uint64_t dropped() const;
+
+    /**
+     * Marks without matched item on the previous stages
+     */
+    uint64_t unmatched() const;
+
+    void reset();
+
+private:
+    struct Pending
+    {
+        size_t            stage;
+        Clock::time_point first;
+        Clock::time_point last;
+    };
+
+    mutable std::mutex                                   m_mutex;
+    std::vector<StageStats>                              m_stages;
+    StageStats                                           m_total;
+    int64_t                                              m_tolerance;
+    size_t                                               m_maxPending; // per stream
+    std::unordered_map<int, std::map<int64_t, Pending>>  m_items;
+    uint64_t                                             m_dropped   = 0;
+    uint64_t                                             m_unmatched = 0;
+};
+
+} // namespace av
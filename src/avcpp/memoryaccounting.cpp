@@ -0,0 +1,320 @@
+#include "memoryaccounting.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include "avcompat.h"
+#include "instrumentation.h"
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/mem.h>
+}
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+struct Counter
+{
+    atomic<int64_t>  objects{0};
+    atomic<int64_t>  bytes{0};
+    atomic<int64_t>  peak{0};
+    atomic<uint64_t> allocations{0};
+
+    void add(int64_t objectsDelta, int64_t bytesDelta, bool allocation) noexcept
+    {
+        if (objectsDelta)
+            objects.fetch_add(objectsDelta, memory_order_relaxed);
+        if (allocation)
+            allocations.fetch_add(1, memory_order_relaxed);
+        if (!bytesDelta)
+            return;
+
+        auto const now = bytes.fetch_add(bytesDelta, memory_order_relaxed) + bytesDelta;
+        auto prev = peak.load(memory_order_relaxed);
+        while (now > prev && !peak.compare_exchange_weak(prev, now, memory_order_relaxed))
+            ;
+    }
+
+    void resetPeak() noexcept
+    {
+        peak.store(bytes.load(memory_order_relaxed), memory_order_relaxed);
+    }
+
+    MemoryCounters load() const noexcept
+    {
+        MemoryCounters out;
+        out.objects     = objects.load(memory_order_relaxed);
+        out.bytes       = bytes.load(memory_order_relaxed);
+        out.peakBytes   = peak.load(memory_order_relaxed);
+        out.allocations = allocations.load(memory_order_relaxed);
+        return out;
+    }
+};
+
+struct OwnerCounters
+{
+    array<Counter, size_t(MemoryKind::Count)> kinds;
+    Counter                                   total;
+
+    void add(MemoryKind kind, int64_t objectsDelta, int64_t bytesDelta, bool allocation) noexcept
+    {
+        kinds[size_t(kind)].add(objectsDelta, bytesDelta, allocation);
+        total.add(objectsDelta, bytesDelta, allocation);
+    }
+
+    void resetPeaks() noexcept
+    {
+        for (auto &counter : kinds)
+            counter.resetPeak();
+        total.resetPeak();
+    }
+
+    MemoryUsage load(string owner) const
+    {
+        MemoryUsage out;
+        out.owner = std::move(owner);
+        for (size_t i = 0; i < kinds.size(); ++i)
+            out.kinds[i] = kinds[i].load();
+        out.total = total.load();
+        return out;
+    }
+};
+
+struct State
+{
+    atomic_bool                                         enabled{false};
+    array<OwnerCounters, MemoryAccounting::MaxOwners>   owners;
+    OwnerCounters                                       all;
+
+    // Owner names are only added: id is an index
+    std::mutex                                          access;
+    vector<string>                                      names{string()};
+};
+
+State& state()
+{
+    static State st;
+    return st;
+}
+
+thread_local MemoryOwnerId t_owner = 0;
+
+void account(MemoryOwnerId owner, MemoryKind kind, int64_t objectsDelta, int64_t bytesDelta, bool allocation) noexcept
+{
+    auto &st = state();
+    st.owners[owner].add(kind, objectsDelta, bytesDelta, allocation);
+    st.all.add(kind, objectsDelta, bytesDelta, allocation);
+}
+
+// Must be called with the access lock held
+MemoryOwnerId find_owner(const State &st, string_view owner) noexcept
+{
+    for (size_t i = 0; i < st.names.size(); ++i) {
+        if (st.names[i] == owner)
+            return MemoryOwnerId(i);
+    }
+    return 0;
+}
+
+struct TrackedBuffer
+{
+    MemoryOwnerId owner;
+    MemoryKind    kind;
+    size_t        size;
+};
+
+void tracked_buffer_free(void *opaque, uint8_t *data)
+{
+    auto info = static_cast<TrackedBuffer*>(opaque);
+    av_free(data);
+    account(info->owner, info->kind, -1, -int64_t(info->size), false);
+    delete info;
+}
+
+} // anonymous namespace
+
+void MemoryAccounting::setEnabled(bool enable) noexcept
+{
+    state().enabled.store(enable, memory_order_relaxed);
+}
+
+bool MemoryAccounting::isEnabled() noexcept
+{
+    return state().enabled.load(memory_order_relaxed);
+}
+
+std::vector<MemoryUsage> MemoryAccounting::snapshot()
+{
+    auto &st = state();
+    vector<string> names;
+    {
+        lock_guard lock{st.access};
+        names = st.names;
+    }
+
+    vector<MemoryUsage> out;
+    out.reserve(names.size());
+    for (size_t i = 0; i < names.size(); ++i)
+        out.push_back(st.owners[i].load(std::move(names[i])));
+    return out;
+}
+
+MemoryUsage MemoryAccounting::usage(std::string_view owner)
+{
+    auto &st = state();
+    MemoryOwnerId id;
+    {
+        lock_guard lock{st.access};
+        id = find_owner(st, owner);
+    }
+    if (!id && !owner.empty()) {
+        MemoryUsage out;
+        out.owner = string(owner);
+        return out;
+    }
+    return st.owners[id].load(string(owner));
+}
+
+MemoryUsage MemoryAccounting::total()
+{
+    return state().all.load({});
+}
+
+void MemoryAccounting::resetPeaks() noexcept
+{
+    auto &st = state();
+    for (auto &owner : st.owners)
+        owner.resetPeaks();
+    st.all.resetPeaks();
+}
+
+void MemoryAccounting::resetPeaks(std::string_view owner)
+{
+    auto &st = state();
+    MemoryOwnerId id;
+    {
+        lock_guard lock{st.access};
+        id = find_owner(st, owner);
+    }
+    if (id || owner.empty())
+        st.owners[id].resetPeaks();
+}
+
+const char *MemoryAccounting::kindName(MemoryKind kind) noexcept
+{
+    switch (kind) {
+        case MemoryKind::Packet:       return "packet";
+        case MemoryKind::VideoFrame:   return "video_frame";
+        case MemoryKind::AudioSamples: return "audio_samples";
+        case MemoryKind::Buffer:       return "buffer";
+        case MemoryKind::BufferPool:   return "buffer_pool";
+        case MemoryKind::Count:        break;
+    }
+    return "unknown";
+}
+
+MemoryOwnerId MemoryAccounting::currentOwner() noexcept
+{
+    return t_owner;
+}
+
+void MemoryAccounting::track(MemoryTag &tag, MemoryKind kind, uint64_t bytes) noexcept
+{
+    if (tag.tracked) {
+        if (tag.kind == kind) {
+            account(tag.owner, kind, 0, int64_t(bytes) - tag.bytes, false);
+            tag.bytes = int64_t(bytes);
+            return;
+        }
+        untrack(tag);
+    }
+
+    if (!isEnabled())
+        return;
+
+    tag.bytes   = int64_t(bytes);
+    tag.owner   = t_owner;
+    tag.kind    = kind;
+    tag.tracked = true;
+    account(tag.owner, kind, 1, tag.bytes, true);
+}
+
+void MemoryAccounting::track(MemoryTag &tag, const AVFrame *frame) noexcept
+{
+    if (!frame || !frame->buf[0]) {
+        untrack(tag);
+        return;
+    }
+    auto const kind = frame->nb_samples > 0 && frame->width == 0 ? MemoryKind::AudioSamples : MemoryKind::VideoFrame;
+    track(tag, kind, Instrumentation::frameBytes(frame));
+}
+
+void MemoryAccounting::track(MemoryTag &tag, const AVPacket *packet) noexcept
+{
+    if (!packet || (!packet->buf && packet->size <= 0)) {
+        untrack(tag);
+        return;
+    }
+    track(tag, MemoryKind::Packet, packet->buf ? uint64_t(packet->buf->size) : uint64_t(packet->size));
+}
+
+void MemoryAccounting::untrack(MemoryTag &tag) noexcept
+{
+    if (!tag.tracked)
+        return;
+    account(tag.owner, tag.kind, -1, -tag.bytes, false);
+    tag = MemoryTag{};
+}
+
+AVBufferRef *MemoryAccounting::allocateBuffer(size_t size, MemoryKind kind, MemoryOwnerId owner) noexcept
+{
+    if (!isEnabled())
+        return av_buffer_alloc(size);
+
+    auto data = static_cast<uint8_t*>(av_malloc(size));
+    if (!data)
+        return nullptr;
+
+    auto info = new (std::nothrow) TrackedBuffer{owner, kind, size};
+    auto buf = info ? av_buffer_create(data, size, tracked_buffer_free, info, 0) : nullptr;
+    if (!buf) {
+        delete info;
+        av_free(data);
+        return nullptr;
+    }
+
+    account(owner, kind, 1, int64_t(size), true);
+    return buf;
+}
+
+AVBufferRef *MemoryAccounting::allocateBuffer(size_t size, MemoryKind kind) noexcept
+{
+    return allocateBuffer(size, kind, t_owner);
+}
+
+
+MemoryOwnerScope::MemoryOwnerScope(std::string_view owner)
+    : m_previous(t_owner)
+{
+    auto &st = state();
+    lock_guard lock{st.access};
+    auto id = find_owner(st, owner);
+    if (!id && !owner.empty() && st.names.size() < MemoryAccounting::MaxOwners) {
+        id = MemoryOwnerId(st.names.size());
+        st.names.emplace_back(owner);
+    }
+    t_owner = id;
+}
+
+MemoryOwnerScope::~MemoryOwnerScope()
+{
+    t_owner = m_previous;
+}
+
+} // namespace av
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "avconfig.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct AVBufferRef;
+struct AVFrame;
+struct AVPacket;
+
+namespace av {
+
+/**
+ * Subsystems the memory is accounted for
+ */
+enum class MemoryKind : uint8_t
+{
+    Packet,       ///< Packet wrappers that hold payload
+    VideoFrame,   ///< VideoFrame wrappers that hold payload
+    AudioSamples, ///< AudioSamples wrappers that hold payload
+    Buffer,       ///< BufferRef(size) allocations
+    BufferPool,   ///< BufferPool allocations, buffers returned to the pool are counted till the pool is gone
+    Count
+};
+
+using MemoryOwnerId = uint16_t;
+
+struct MemoryCounters
+{
+    int64_t  objects     = 0; ///< live objects
+    int64_t  bytes       = 0; ///< live payload bytes
+    int64_t  peakBytes   = 0; ///< high watermark of bytes since start or last resetPeaks()
+    uint64_t allocations = 0; ///< objects accounted in total
+};
+
+/**
+ * Memory of the single owner (or of all owners, see MemoryAccounting::total())
+ */
+struct MemoryUsage
+{
+    std::string                                              owner; ///< empty for the unattributed memory
+    std::array<MemoryCounters, size_t(MemoryKind::Count)>    kinds{};
+    MemoryCounters                                           total; ///< all kinds, peakBytes is a peak of the sum
+
+    const MemoryCounters& operator[](MemoryKind kind) const noexcept
+    {
+        return kinds[size_t(kind)];
+    }
+};
+
+/**
+ * Accounting state of the single object. Embedded into the wrappers when the accounting is compiled in.
+ */
+struct MemoryTag
+{
+    int64_t       bytes   = 0;
+    MemoryOwnerId owner   = 0;
+    MemoryKind    kind    = MemoryKind::Count;
+    bool          tracked = false;
+};
+
+/**
+ * @brief The MemoryAccounting class
+ *
+ * Live objects and payload bytes of the Packet, VideoFrame and AudioSamples wrappers, BufferRef(size) and BufferPool
+ * allocations, broken down per owner. Owner is a name set for the current thread by MemoryOwnerScope (job, pipeline
+ * or context name) at the moment the object gets its payload.
+ *
+ * Wrapper payload is the size of the referenced buffers and it is measured when the library fills the wrapper
+ * (decode, encode, demux, filter and resampler output, allocating constructors) and when the wrapper is copied. Buffer
+ * shared by several wrappers is counted by each of them. BufferRef and BufferPool allocations are exact: they are
+ * released by the buffer free callback.
+ *
+ * Hooks are compiled in only with the AV_ENABLE_INSTRUMENTATION build option (AVCPP_ENABLE_INSTRUMENTATION in
+ * avconfig.h) and disabled at runtime by default. Objects accounted while enabled are released correctly after
+ * disabling.
+ *
+ * @code
+ * MemoryAccounting::setEnabled(true);
+ * {
+ *     MemoryOwnerScope owner{"job-42"};
+ *     MemoryAccounting::resetPeaks("job-42");
+ *     run_job();
+ * }
+ * auto limit = MemoryAccounting::usage("job-42").total.peakBytes;
+ * @endcode
+ */
+class MemoryAccounting
+{
+public:
+    /// Owners above the limit are accounted as unattributed
+    static constexpr size_t MaxOwners = 256;
+
+    static constexpr bool isCompiled() noexcept
+    {
+        return AVCPP_ENABLE_INSTRUMENTATION;
+    }
+
+    static void setEnabled(bool enable) noexcept;
+    static bool isEnabled() noexcept;
+
+    /**
+     * Usage of every owner seen, unattributed memory goes first
+     */
+    static std::vector<MemoryUsage> snapshot();
+    static MemoryUsage usage(std::string_view owner);
+    /**
+     * Usage of all owners together
+     */
+    static MemoryUsage total();
+
+    /**
+     * Reset high watermarks to the current usage: all of them or of the given owner only
+     */
+    static void resetPeaks() noexcept;
+    static void resetPeaks(std::string_view owner);
+
+    static const char* kindName(MemoryKind kind) noexcept;
+
+    /**
+     * Owner of the current thread, 0 for the unattributed
+     */
+    static MemoryOwnerId currentOwner() noexcept;
+
+    /// @{
+    /**
+     * Account object with the given payload size or update size of the accounted one. Used by the hooks, can be
+     * used for the user-side objects too. Frames and packets without buffers are untracked.
+     */
+    static void track(MemoryTag &tag, MemoryKind kind, uint64_t bytes) noexcept;
+    static void track(MemoryTag &tag, const AVFrame *frame) noexcept;
+    static void track(MemoryTag &tag, const AVPacket *packet) noexcept;
+    /// @}
+
+    static void untrack(MemoryTag &tag) noexcept;
+
+    /**
+     * Allocate buffer with av_malloc() that is accounted till the last reference is gone. Plain av_buffer_alloc()
+     * equivalent if accounting disabled.
+     */
+    static AVBufferRef* allocateBuffer(size_t size, MemoryKind kind, MemoryOwnerId owner) noexcept;
+    static AVBufferRef* allocateBuffer(size_t size, MemoryKind kind = MemoryKind::Buffer) noexcept;
+};
+
+/**
+ * @brief The MemoryOwnerScope class
+ *
+ * Sets owner of the memory accounted by the current thread, previous owner is restored on destruction.
+ */
+class MemoryOwnerScope
+{
+public:
+    explicit MemoryOwnerScope(std::string_view owner);
+    ~MemoryOwnerScope();
+
+    MemoryOwnerScope(const MemoryOwnerScope&) = delete;
+    MemoryOwnerScope& operator=(const MemoryOwnerScope&) = delete;
+
+private:
+    MemoryOwnerId m_previous;
+};
+
+} // namespace av
+
+#if AVCPP_ENABLE_INSTRUMENTATION
+#  define AVCPP_MEMORY_TRACK(tag, raw) ::av::MemoryAccounting::track(tag, raw)
+#  define AVCPP_MEMORY_UNTRACK(tag) ::av::MemoryAccounting::untrack(tag)
+#  define AVCPP_MEMORY_SWAP(tag, other) std::swap(tag, other)
+#else
+#  define AVCPP_MEMORY_TRACK(tag, raw) do {} while (0)
+#  define AVCPP_MEMORY_UNTRACK(tag) do {} while (0)
+#  define AVCPP_MEMORY_SWAP(tag, other) do {} while (0)
+#endif
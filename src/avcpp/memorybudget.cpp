@@ -0,0 +1,161 @@
+#include "memorybudget.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace av {
+
+MemoryBudget::MemoryBudget(size_t limit, Policy policy)
+    : m_limit(limit),
+      m_policy(policy)
+{
+}
+
+size_t MemoryBudget::used() const
+{
+    lock_guard lock{m_mutex};
+    return m_used;
+}
+
+bool MemoryBudget::isExhausted() const
+{
+    lock_guard lock{m_mutex};
+    return m_limit && m_used >= m_limit;
+}
+
+bool MemoryBudget::acquire(size_t bytes, const std::atomic_bool *cancelled)
+{
+    unique_lock lock{m_mutex};
+    auto const stopped = [this, cancelled] {
+        return m_cancelled || (cancelled && cancelled->load(memory_order_acquire));
+    };
+
+    if (!fitsLocked(bytes) && !stopped()) {
+        ++m_waits;
+        auto const start = chrono::steady_clock::now();
+        m_cond.wait(lock, [&] { return stopped() || fitsLocked(bytes); });
+        m_stallTime += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+    }
+
+    if (stopped())
+        return false;
+    addLocked(bytes);
+    return true;
+}
+
+bool MemoryBudget::tryAcquire(size_t bytes)
+{
+    lock_guard lock{m_mutex};
+    if (m_cancelled || !fitsLocked(bytes))
+        return false;
+    addLocked(bytes);
+    return true;
+}
+
+void MemoryBudget::forceAcquire(size_t bytes)
+{
+    lock_guard lock{m_mutex};
+    addLocked(bytes);
+}
+
+void MemoryBudget::release(size_t bytes)
+{
+    {
+        lock_guard lock{m_mutex};
+        auto const wasExhausted = m_limit && m_used >= m_limit;
+        m_used -= std::min(bytes, m_used);
+        if (wasExhausted && m_used < m_limit) {
+            for (auto const &listener : m_listeners)
+                listener.second();
+        }
+    }
+    m_cond.notify_all();
+}
+
+void MemoryBudget::countDrop(size_t bytes)
+{
+    lock_guard lock{m_mutex};
+    ++m_drops;
+    m_droppedBytes += bytes;
+}
+
+void MemoryBudget::cancel()
+{
+    {
+        lock_guard lock{m_mutex};
+        m_cancelled = true;
+    }
+    m_cond.notify_all();
+}
+
+bool MemoryBudget::isCancelled() const
+{
+    lock_guard lock{m_mutex};
+    return m_cancelled;
+}
+
+void MemoryBudget::wakeWaiters()
+{
+    {
+        // Flag of the waiter is set before: waiter either sees it or is already waiting
+        lock_guard lock{m_mutex};
+    }
+    m_cond.notify_all();
+}
+
+MemoryBudget::Stats MemoryBudget::stats() const
+{
+    lock_guard lock{m_mutex};
+    Stats out;
+    out.limit        = m_limit;
+    out.used         = m_used;
+    out.peak         = m_peak;
+    out.waits        = m_waits;
+    out.drops        = m_drops;
+    out.droppedBytes = m_droppedBytes;
+    out.stallTime    = m_stallTime;
+    return out;
+}
+
+void MemoryBudget::resetPeak()
+{
+    lock_guard lock{m_mutex};
+    m_peak = m_used;
+}
+
+size_t MemoryBudget::addListener(std::function<void()> listener)
+{
+    lock_guard lock{m_mutex};
+    auto const id = m_nextListener++;
+    m_listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void MemoryBudget::removeListener(size_t id)
+{
+    lock_guard lock{m_mutex};
+    m_listeners.erase(std::remove_if(m_listeners.begin(), m_listeners.end(), [id](auto const &listener) {
+        return listener.first == id;
+    }), m_listeners.end());
+}
+
+size_t MemoryBudget::packetBytes(const AVPacket *packet) noexcept
+{
+    if (!packet)
+        return 0;
+    return packet->buf ? size_t(packet->buf->size) : size_t(std::max(packet->size, 0));
+}
+
+bool MemoryBudget::fitsLocked(size_t bytes) const noexcept
+{
+    return !m_limit || !m_used || m_used + bytes <= m_limit;
+}
+
+void MemoryBudget::addLocked(size_t bytes) noexcept
+{
+    m_used += bytes;
+    m_peak = std::max(m_peak, m_used);
+}
+
+} // namespace av
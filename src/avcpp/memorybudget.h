@@ -0,0 +1,165 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "avutils.h"
+#include "frame.h"
+#include "instrumentation.h"
+#include "packet.h"
+
+namespace av {
+
+/**
+ * @brief The MemoryBudget class
+ *
+ * Limit of the payload bytes held by the pipeline queues, pools and caches. Single budget can be shared by several
+ * pipelines, e.g. all jobs of the process.
+ *
+ * Producers acquire payload size before keeping an item and release it when the item is gone. When budget is
+ * exhausted, producers are blocked (Policy::Block) or items are dropped (Policy::Drop, for live sources where stale
+ * data is useless). Single item bigger than the limit passes when nothing is accounted, so limit never stops
+ * processing completely.
+ *
+ * Payload size is the size of the referenced AVBufferRef's, see payloadBytes().
+ *
+ * Budget is charged by the BoundedQueue (Pipeline), AbrTranscoder and by the BufferPool created with the budget, e.g.
+ * MultiRescaler stage pools (MultiRescaler::Options::memoryBudget). Pools never wait: their allocations run under the
+ * FFmpeg pool lock, so pool memory is force acquired and makes the other producers wait instead. Pooled buffers are
+ * charged till the pool is gone, like with the MemoryAccounting. SwsContext's cached by the VideoRescaler are not
+ * charged: their size is not known, the cache is bounded by the context count (setContextCacheSize()).
+ *
+ * @code
+ * auto budget = std::make_shared<MemoryBudget>(512 * 1024 * 1024);
+ * Pipeline pipeline;
+ * pipeline.setMemoryBudget(budget);
+ * ...
+ * auto stats = budget->stats();
+ * @endcode
+ */
+class MemoryBudget : public noncopyable
+{
+public:
+    enum class Policy
+    {
+        Block, ///< wait for the budget
+        Drop,  ///< drop items that do not fit
+    };
+
+    struct Stats
+    {
+        size_t                   limit = 0;
+        size_t                   used  = 0;
+        size_t                   peak  = 0;        ///< since creation or resetPeak()
+        uint64_t                 waits = 0;        ///< acquire() calls blocked on the budget
+        uint64_t                 drops = 0;        ///< items dropped by Policy::Drop
+        uint64_t                 droppedBytes = 0;
+        std::chrono::nanoseconds stallTime{0};     ///< total time producers were blocked
+    };
+
+    /**
+     * @param limit  bytes, 0 - unlimited (accounting only)
+     */
+    explicit MemoryBudget(size_t limit, Policy policy = Policy::Block);
+
+    size_t limit() const noexcept { return m_limit; }
+    Policy policy() const noexcept { return m_policy; }
+
+    size_t used() const;
+    bool   isExhausted() const;
+
+    /**
+     * Wait till bytes fit into the budget and account them.
+     *
+     * @param cancelled  optional flag of the caller, waiting is interrupted when it is set and wakeWaiters() called
+     * @return false if budget or caller is cancelled, nothing is accounted in that case
+     */
+    bool acquire(size_t bytes, const std::atomic_bool *cancelled = nullptr);
+
+    /**
+     * Account bytes if they fit without waiting
+     */
+    bool tryAcquire(size_t bytes);
+
+    /**
+     * Account bytes ignoring the limit: for producers that can't wait, e.g. decoder flush on JobScheduler
+     */
+    void forceAcquire(size_t bytes);
+
+    void release(size_t bytes);
+
+    /**
+     * Account the item dropped by the producer due to exhausted budget
+     */
+    void countDrop(size_t bytes);
+
+    /**
+     * Fail all current and further acquire() calls
+     */
+    void cancel();
+    bool isCancelled() const;
+
+    /**
+     * Wake up blocked acquire() calls to check own cancel flags
+     */
+    void wakeWaiters();
+
+    Stats stats() const;
+    void  resetPeak();
+
+    /**
+     * Listener is called when exhausted budget gets room: non-blocking producers (Pipeline run on the JobScheduler)
+     * are rescheduled by it. Called under budget lock, must not use the budget.
+     *
+     * @return id for removeListener()
+     */
+    size_t addListener(std::function<void()> listener);
+    void   removeListener(size_t id);
+
+    /**
+     * Payload size of the item: referenced buffers of the Packet, VideoFrame and AudioSamples, 0 for other types
+     */
+    template<typename T>
+    static size_t payloadBytes(const T &item) noexcept
+    {
+        if constexpr (std::is_base_of_v<FrameCommon, T>)
+            return size_t(Instrumentation::frameBytes(item.raw()));
+        else if constexpr (std::is_same_v<T, Packet>)
+            return packetBytes(item.raw());
+        else
+            return 0;
+    }
+
+    static size_t packetBytes(const AVPacket *packet) noexcept;
+
+private:
+    bool fitsLocked(size_t bytes) const noexcept;
+    void addLocked(size_t bytes) noexcept;
+
+private:
+    const size_t            m_limit;
+    const Policy            m_policy;
+
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_cond;
+    size_t                  m_used = 0;
+    size_t                  m_peak = 0;
+    uint64_t                m_waits = 0;
+    uint64_t                m_drops = 0;
+    uint64_t                m_droppedBytes = 0;
+    std::chrono::nanoseconds m_stallTime{0};
+    bool                    m_cancelled = false;
+
+    std::vector<std::pair<size_t, std::function<void()>>> m_listeners;
+    size_t                                                m_nextListener = 0;
+};
+
+} // namespace av
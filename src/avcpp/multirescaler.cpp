@@ -0,0 +1,229 @@
+#include "multirescaler.h"
+
+#include <algorithm>
+#include <numeric>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+using namespace std;
+
+namespace av {
+
+namespace {
+// Line alignment of the pooled frames: SIMD paths of the swscale
+constexpr int FrameAlign = 32;
+} // anonymous namespace
+
+struct MultiRescaler::Stage
+{
+    VideoRescaler                 rescaler;
+    BufferPool                    pool;
+    std::shared_ptr<MemoryBudget> budget;
+    int                           width  = -1;
+    int                           height = -1;
+    PixelFormat                   format = AV_PIX_FMT_NONE;
+
+    Stage(int32_t flags, std::shared_ptr<MemoryBudget> budget)
+        : rescaler(1, 1, AV_PIX_FMT_GRAY8, flags),
+          budget(std::move(budget))
+    {
+    }
+
+    VideoFrame frame(int frameWidth, int frameHeight, PixelFormat frameFormat, OptionalErrorCode ec)
+    {
+        clear_if(ec);
+
+        if (frameWidth != width || frameHeight != height || frameFormat != format || pool.isNull()) {
+            auto const size = av_image_get_buffer_size(frameFormat, frameWidth, frameHeight, FrameAlign);
+            if (size <= 0) {
+                throws_if(ec, Errors::RescalerInvalidParameters);
+                return {};
+            }
+            pool   = BufferPool(size_t(size), budget, ec);
+            if (is_error(ec))
+                return {};
+            width  = frameWidth;
+            height = frameHeight;
+            format = frameFormat;
+        }
+
+        auto buf = pool.get(ec);
+        if (is_error(ec))
+            return {};
+
+        VideoFrame out;
+        auto frame = out.raw();
+
+        frame->format = format;
+        frame->width  = width;
+        frame->height = height;
+        frame->buf[0] = buf.release();
+
+        av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data, format, width, height, FrameAlign);
+        frame->extended_data = frame->data;
+
+        return out;
+    }
+
+    void scale(VideoFrame &dst, const VideoFrame &src, int dstWidth, int dstHeight, PixelFormat dstFormat,
+               OptionalErrorCode ec)
+    {
+        dst = frame(dstWidth, dstHeight, dstFormat, ec);
+        if (is_error(ec))
+            return;
+        rescaler.rescale(dst, src, ec);
+    }
+};
+
+MultiRescaler::MultiRescaler(std::vector<Output> outputs)
+    : MultiRescaler(std::move(outputs), Options{})
+{
+}
+
+MultiRescaler::MultiRescaler(std::vector<Output> outputs, const Options &options)
+    : m_outputs(std::move(outputs)),
+      m_options(options)
+{
+    m_stages.reserve(m_outputs.size());
+    for (auto const &output : m_outputs)
+        m_stages.push_back(std::make_unique<Stage>(output.flags, m_options.memoryBudget));
+    m_conversion = std::make_unique<Stage>(SwsFlagAuto, m_options.memoryBudget);
+
+    if (m_options.scheduler)
+        m_job = m_options.scheduler->createJob("multi-rescaler");
+}
+
+MultiRescaler::~MultiRescaler()
+{
+    if (m_job)
+        m_job->wait();
+}
+
+PixelFormat MultiRescaler::workPixelFormat(const VideoFrame &src) const noexcept
+{
+    if (m_options.workPixelFormat != AV_PIX_FMT_NONE)
+        return m_options.workPixelFormat;
+    if (!m_outputs.empty() && m_outputs.front().pixelFormat != AV_PIX_FMT_NONE)
+        return m_outputs.front().pixelFormat;
+    return src.pixelFormat();
+}
+
+void MultiRescaler::makePlan(int width, int height, PixelFormat workFormat)
+{
+    if (width == m_planWidth && height == m_planHeight && workFormat == m_planFormat && !m_plan.empty())
+        return;
+
+    m_planWidth  = width;
+    m_planHeight = height;
+    m_planFormat = workFormat;
+
+    vector<size_t> order(m_outputs.size());
+    iota(order.begin(), order.end(), size_t(0));
+    stable_sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        return int64_t(m_outputs[lhs].width) * m_outputs[lhs].height >
+               int64_t(m_outputs[rhs].width) * m_outputs[rhs].height;
+    });
+
+    auto const formatOf = [this, workFormat](size_t index) {
+        auto const format = m_outputs[index].pixelFormat;
+        return format == AV_PIX_FMT_NONE ? workFormat : format;
+    };
+
+    m_plan.assign(m_outputs.size(), -1);
+    vector<size_t> level(m_outputs.size(), 0);
+    vector<size_t> done;
+
+    for (auto const index : order) {
+        auto const &output = m_outputs[index];
+
+        if (m_options.cascadeRatio >= 1.0 && formatOf(index) == workFormat) {
+            // Smallest already scaled output that is large enough: least pixels to read
+            for (auto it = done.rbegin(); it != done.rend(); ++it) {
+                auto const &from = m_outputs[*it];
+                if (formatOf(*it) == workFormat &&
+                    from.width  >= output.width  * m_options.cascadeRatio &&
+                    from.height >= output.height * m_options.cascadeRatio)
+                {
+                    m_plan[index] = int(*it);
+                    level[index]  = level[*it] + 1;
+                    break;
+                }
+            }
+        }
+
+        done.push_back(index);
+    }
+
+    m_waves.clear();
+    for (auto const index : order) {
+        if (m_waves.size() <= level[index])
+            m_waves.resize(level[index] + 1);
+        m_waves[level[index]].push_back(index);
+    }
+}
+
+std::vector<VideoFrame> MultiRescaler::rescale(const VideoFrame &src, OptionalErrorCode ec)
+{
+    std::vector<VideoFrame> dst;
+    rescale(dst, src, ec);
+    return dst;
+}
+
+void MultiRescaler::rescale(std::vector<VideoFrame> &dst, const VideoFrame &src, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (!src.isValid() || src.width() <= 0 || src.height() <= 0 || src.pixelFormat() == AV_PIX_FMT_NONE ||
+        any_of(m_outputs.begin(), m_outputs.end(), [](const Output &output) {
+            return output.width <= 0 || output.height <= 0;
+        }))
+    {
+        throws_if(ec, Errors::RescalerInvalidParameters);
+        return;
+    }
+
+    auto const workFormat = workPixelFormat(src);
+    makePlan(src.width(), src.height(), workFormat);
+
+    // Colour conversion once at the source size
+    VideoFrame converted;
+    const VideoFrame *base = &src;
+    if (src.pixelFormat() != workFormat) {
+        m_conversion->scale(converted, src, src.width(), src.height(), workFormat, ec);
+        if (is_error(ec))
+            return;
+        base = &converted;
+    }
+
+    dst.resize(m_outputs.size());
+    vector<error_code> errors(m_outputs.size());
+
+    auto const scaleOutput = [&](size_t index) {
+        auto const &output = m_outputs[index];
+        auto const &from   = m_plan[index] < 0 ? *base : dst[size_t(m_plan[index])];
+        auto const  format = output.pixelFormat == AV_PIX_FMT_NONE ? workFormat : output.pixelFormat;
+        m_stages[index]->scale(dst[index], from, output.width, output.height, format, errors[index]);
+    };
+
+    for (auto const &wave : m_waves) {
+        if (m_job && wave.size() > 1) {
+            for (auto const index : wave)
+                m_options.scheduler->post(m_job, [&scaleOutput, index] { scaleOutput(index); });
+            m_job->wait();
+        } else {
+            for (auto const index : wave)
+                scaleOutput(index);
+        }
+
+        for (auto const index : wave) {
+            if (errors[index]) {
+                throws_if(ec, errors[index].value(), errors[index].category());
+                return;
+            }
+        }
+    }
+}
+
+} // namespace av
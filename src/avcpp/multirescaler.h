@@ -0,0 +1,114 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "averror.h"
+#include "avutils.h"
+#include "buffer.h"
+#include "frame.h"
+#include "jobscheduler.h"
+#include "memorybudget.h"
+#include "videorescaler.h"
+
+namespace av {
+
+/**
+ * @brief The MultiRescaler class
+ *
+ * Scales one source frame into several output sizes (ABR ladder, thumbnails) in one pass:
+ *
+ * - colour conversion into the work pixel format is done once at the source size, instead of per output;
+ * - outputs are produced from the largest to the smallest one and, when Options::cascadeRatio permits, the output
+ *   is downscaled from the previous smaller result instead of the full source (e.g. 360p from 720p instead of 4K);
+ * - output and intermediate frames are taken from per-size BufferPool, no frame allocations in the steady state;
+ * - with Options::scheduler outputs that don't depend on each other are scaled in parallel.
+ *
+ * Outputs keep pts, time base and stream index of the source. Output frames are read-only for the caller: they can
+ * be the source of the smaller outputs of the same call.
+ *
+ * @code
+ * MultiRescaler rescaler{{{1920, 1080}, {1280, 720}, {640, 360}, {320, 180}}};
+ * auto frames = rescaler.rescale(src);
+ * @endcode
+ */
+class MultiRescaler : public noncopyable
+{
+public:
+    struct Output
+    {
+        int         width       = 0;
+        int         height      = 0;
+        PixelFormat pixelFormat = AV_PIX_FMT_NONE; ///< AV_PIX_FMT_NONE - work pixel format
+        int32_t     flags       = SwsFlagAuto;
+
+        Output() = default;
+        Output(int width, int height, PixelFormat pixelFormat = AV_PIX_FMT_NONE, int32_t flags = SwsFlagAuto)
+            : width(width), height(height), pixelFormat(pixelFormat), flags(flags)
+        {
+        }
+    };
+
+    struct Options
+    {
+        /// Pixel format of the colour conversion and cascading. AV_PIX_FMT_NONE - format of the first output or,
+        /// if it is not set too, of the source.
+        PixelFormat   workPixelFormat = AV_PIX_FMT_NONE;
+        /// Output is scaled from the smaller previous output if it is at least cascadeRatio times larger in both
+        /// dimensions. Less than 1 - cascading is disabled.
+        double        cascadeRatio    = 2.0;
+        /// Scale independent outputs in parallel. rescale() must not be called from the scheduler thread then.
+        JobScheduler *scheduler       = nullptr;
+        /// Charged by the stage pools, see BufferPool. Pools of the replaced frame sizes are released when their
+        /// frames are gone.
+        std::shared_ptr<MemoryBudget> memoryBudget;
+    };
+
+    explicit MultiRescaler(std::vector<Output> outputs);
+    MultiRescaler(std::vector<Output> outputs, const Options &options);
+    ~MultiRescaler();
+
+    const std::vector<Output>& outputs() const noexcept { return m_outputs; }
+    const Options& options() const noexcept { return m_options; }
+
+    /**
+     * Frames in the order of outputs()
+     *
+     * @param ec  Errors::RescalerInvalidParameters, sws errors
+     */
+    std::vector<VideoFrame> rescale(const VideoFrame &src, OptionalErrorCode ec = throws());
+    void                    rescale(std::vector<VideoFrame> &dst, const VideoFrame &src, OptionalErrorCode ec = throws());
+
+    /**
+     * Source of every output for the last rescaled source: index of the output it is cascaded from, -1 - converted
+     * source.
+     */
+    const std::vector<int>& plan() const noexcept { return m_plan; }
+
+private:
+    struct Stage;
+
+    PixelFormat workPixelFormat(const VideoFrame &src) const noexcept;
+    void        makePlan(int width, int height, PixelFormat workFormat);
+
+private:
+    std::vector<Output>                 m_outputs;
+    Options                             m_options;
+
+    std::vector<std::unique_ptr<Stage>> m_stages;     // one per output
+    std::unique_ptr<Stage>              m_conversion; // source to work pixel format
+
+    // Plan is rebuilt when source parameters changed
+    int                                 m_planWidth  = -1;
+    int                                 m_planHeight = -1;
+    PixelFormat                         m_planFormat = AV_PIX_FMT_NONE;
+    std::vector<int>                    m_plan;
+    std::vector<std::vector<size_t>>    m_waves;      // outputs in the wave depend on the previous waves only
+
+    std::shared_ptr<Job>                m_job;
+};
+
+} // namespace av
@@ -0,0 +1,461 @@
+#include "nalunits.h"
+
+#if AVCPP_CXX_STANDARD >= 20
+
+#include <bit>
+#include <utility>
+#include <cstring>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define AVCPP_NAL_SSE2 1
+#  include <emmintrin.h>
+#  if defined(__AVX2__)
+#    define AVCPP_NAL_AVX2 1            // enabled by compiler flags, no runtime check needed
+#    include <immintrin.h>
+#  elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#    define AVCPP_NAL_AVX2 1
+#    define AVCPP_NAL_AVX2_RUNTIME 1    // compiled with target attribute, selected in runtime
+#    include <immintrin.h>
+#  endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#  define AVCPP_NAL_NEON 1
+#  include <arm_neon.h>
+#endif
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+using FindStartCodeProc = const uint8_t* (*)(const uint8_t *p, const uint8_t *end) noexcept;
+
+const uint8_t* find_start_code_scalar(const uint8_t *p, const uint8_t *end) noexcept
+{
+    if (end - p < 3)
+        return end;
+
+    // Look at the 3rd byte first: if it greater than 1, start code can't begin at any of the 3 positions
+    const uint8_t *last = end - 2;
+    while (p < last) {
+        if (p[2] > 1)
+            p += 3;
+        else if (p[1] != 0)
+            p += 2;
+        else if (p[0] != 0 || p[2] != 1)
+            p += 1;
+        else
+            return p;
+    }
+    return end;
+}
+
+#if AVCPP_NAL_SSE2
+const uint8_t* find_start_code_sse2(const uint8_t *p, const uint8_t *end) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one  = _mm_set1_epi8(1);
+
+    // Each iteration checks 16 candidate positions and reads 2 extra bytes
+    while (end - p >= 18) {
+        const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+
+        const __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(v0, zero),
+                                                      _mm_cmpeq_epi8(v1, zero)),
+                                        _mm_cmpeq_epi8(v2, one));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+        if (mask)
+            return p + std::countr_zero(mask);
+        p += 16;
+    }
+    return find_start_code_scalar(p, end);
+}
+#endif
+
+#if AVCPP_NAL_AVX2
+#  if AVCPP_NAL_AVX2_RUNTIME
+__attribute__((target("avx2")))
+#  endif
+const uint8_t* find_start_code_avx2(const uint8_t *p, const uint8_t *end) noexcept
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one  = _mm256_set1_epi8(1);
+
+    while (end - p >= 34) {
+        const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        const __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+
+        const __m256i m = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(v0, zero),
+                                                            _mm256_cmpeq_epi8(v1, zero)),
+                                           _mm256_cmpeq_epi8(v2, one));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (mask)
+            return p + std::countr_zero(mask);
+        p += 32;
+    }
+    return find_start_code_sse2(p, end);
+}
+#endif
+
+#if AVCPP_NAL_NEON
+const uint8_t* find_start_code_neon(const uint8_t *p, const uint8_t *end) noexcept
+{
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one  = vdupq_n_u8(1);
+
+    while (end - p >= 18) {
+        const uint8x16_t v0 = vld1q_u8(p);
+        const uint8x16_t v1 = vld1q_u8(p + 1);
+        const uint8x16_t v2 = vld1q_u8(p + 2);
+
+        const uint8x16_t m = vandq_u8(vandq_u8(vceqq_u8(v0, zero), vceqq_u8(v1, zero)), vceqq_u8(v2, one));
+        // Narrow 16x8 bits compare result into 64 bit mask: 4 bits per byte
+        const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (mask)
+            return p + (std::countr_zero(mask) >> 2);
+        p += 16;
+    }
+    return find_start_code_scalar(p, end);
+}
+#endif
+
+struct Scanner
+{
+    FindStartCodeProc proc;
+    const char       *name;
+};
+
+Scanner select_scanner() noexcept
+{
+#if AVCPP_NAL_AVX2 && AVCPP_NAL_AVX2_RUNTIME
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {find_start_code_avx2, "avx2"};
+    return {find_start_code_sse2, "sse2"};
+#elif AVCPP_NAL_AVX2
+    return {find_start_code_avx2, "avx2"};
+#elif AVCPP_NAL_SSE2
+    return {find_start_code_sse2, "sse2"};
+#elif AVCPP_NAL_NEON
+    return {find_start_code_neon, "neon"};
+#else
+    return {find_start_code_scalar, "scalar"};
+#endif
+}
+
+const Scanner& scanner() noexcept
+{
+    static const Scanner s = select_scanner();
+    return s;
+}
+
+uint32_t read_be(const uint8_t *p, int size) noexcept
+{
+    uint32_t val = 0;
+    for (int i = 0; i < size; ++i)
+        val = (val << 8) | p[i];
+    return val;
+}
+
+void write_be(uint8_t *p, int size, uint32_t val) noexcept
+{
+    for (int i = size - 1; i >= 0; --i) {
+        p[i] = uint8_t(val & 0xff);
+        val >>= 8;
+    }
+}
+
+bool is_start_code4(const uint8_t *p, const uint8_t *end) noexcept
+{
+    return end - p >= 4 && p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 1;
+}
+
+bool is_start_code3(const uint8_t *p, const uint8_t *end) noexcept
+{
+    return end - p >= 3 && p[0] == 0 && p[1] == 0 && p[2] == 1;
+}
+
+bool valid_avcc(std::span<const uint8_t> data, int lengthSize) noexcept
+{
+    if (lengthSize != 3 && lengthSize != 4)
+        return false;
+
+    auto p = data.data();
+    auto const end = p + data.size();
+    while (p < end) {
+        if (end - p < lengthSize)
+            return false;
+        auto const len = read_be(p, lengthSize);
+        p += lengthSize;
+        if (size_t(end - p) < len)
+            return false;
+        p += len;
+    }
+    return true;
+}
+
+bool valid_annexb(std::span<const uint8_t> data, int lengthSize) noexcept
+{
+    if (lengthSize != 3 && lengthSize != 4)
+        return false;
+
+    auto p = data.data();
+    auto const end = p + data.size();
+
+    if (data.empty())
+        return true;
+
+    // Length field should be placed instead of the first start code
+    if (lengthSize == 4 ? !is_start_code4(p, end) : !is_start_code3(p, end))
+        return false;
+
+    const uint32_t maxLen = lengthSize == 4 ? UINT32_MAX : 0xffffff;
+
+    while (p < end) {
+        auto const payload = p + lengthSize;
+        auto next = findStartCode(payload, end);
+        if (next != end && lengthSize == 4) {
+            // 3-bytes start code can't be extended in-place
+            if (next == payload || next[-1] != 0)
+                return false;
+            --next;
+        }
+        // Note: for 3-bytes length, zero_byte of the 4-bytes start code becomes trailing zero of the previous NAL
+        if (uint64_t(next - payload) > maxLen)
+            return false;
+        p = next;
+    }
+    return true;
+}
+
+void convert_annexb(std::span<uint8_t> data, int lengthSize) noexcept
+{
+    auto p = data.data();
+    auto const end = p + data.size();
+    while (p < end) {
+        auto const payload = p + lengthSize;
+        auto next = const_cast<uint8_t*>(findStartCode(payload, end));
+        if (next != end && lengthSize == 4)
+            --next;
+        write_be(p, lengthSize, uint32_t(next - payload));
+        p = next;
+    }
+}
+
+void convert_avcc(std::span<uint8_t> data, int lengthSize) noexcept
+{
+    auto p = data.data();
+    auto const end = p + data.size();
+    while (p < end) {
+        auto const len = read_be(p, lengthSize);
+        if (lengthSize == 4) {
+            p[0] = 0; p[1] = 0; p[2] = 0; p[3] = 1;
+        } else {
+            p[0] = 0; p[1] = 0; p[2] = 1;
+        }
+        p += lengthSize + len;
+    }
+}
+
+} // anonymous namespace
+
+const uint8_t *findStartCode(const uint8_t *begin, const uint8_t *end) noexcept
+{
+    if (!begin || end - begin < 3)
+        return end;
+    return scanner().proc(begin, end);
+}
+
+const char *startCodeScannerName() noexcept
+{
+    return scanner().name;
+}
+
+//
+// AnnexBNalIterator
+//
+
+AnnexBNalIterator::AnnexBNalIterator(const uint8_t *begin, const uint8_t *end) noexcept
+    : m_end(end)
+{
+    auto sc = findStartCode(begin, end);
+    if (sc != end && sc > begin && sc[-1] == 0)
+        --sc; // 4-bytes start code
+    m_cur = sc;
+    if (m_cur != m_end)
+        load(m_cur);
+}
+
+void AnnexBNalIterator::load(const uint8_t *startCode) noexcept
+{
+    m_nal.prefixSize = is_start_code4(startCode, m_end) ? 4 : 3;
+
+    auto const payload = startCode + m_nal.prefixSize;
+    auto next = findStartCode(payload, m_end);
+    if (next != m_end && next > payload && next[-1] == 0)
+        --next; // zero_byte of the 4-bytes start code
+
+    m_next = next;
+
+    // Drop trailing_zero_8bits
+    auto nalEnd = next;
+    while (nalEnd > payload && nalEnd[-1] == 0)
+        --nalEnd;
+
+    m_nal.data = {payload, size_t(nalEnd - payload)};
+}
+
+AnnexBNalIterator &AnnexBNalIterator::operator++() noexcept
+{
+    m_cur = m_next;
+    if (m_cur != m_end)
+        load(m_cur);
+    else
+        m_nal = {};
+    return *this;
+}
+
+AnnexBNalIterator AnnexBNalIterator::operator++(int) noexcept
+{
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+}
+
+//
+// LengthPrefixedNalIterator
+//
+
+LengthPrefixedNalIterator::LengthPrefixedNalIterator(const uint8_t *begin, const uint8_t *end, int lengthSize) noexcept
+    : m_cur(begin),
+      m_end(end),
+      m_lengthSize(lengthSize)
+{
+    load();
+}
+
+void LengthPrefixedNalIterator::load() noexcept
+{
+    if (m_lengthSize < 1 || m_lengthSize > 4 || m_end - m_cur < m_lengthSize) {
+        m_cur = m_end;
+        m_nal = {};
+        return;
+    }
+
+    auto const len = read_be(m_cur, m_lengthSize);
+    auto const payload = m_cur + m_lengthSize;
+    if (size_t(m_end - payload) < len) {
+        // Malformed: stop iteration
+        m_cur = m_end;
+        m_nal = {};
+        return;
+    }
+
+    m_nal.prefixSize = uint8_t(m_lengthSize);
+    m_nal.data = {payload, size_t(len)};
+}
+
+LengthPrefixedNalIterator &LengthPrefixedNalIterator::operator++() noexcept
+{
+    if (m_cur == m_end)
+        return *this;
+    m_cur = m_nal.data.data() + m_nal.data.size();
+    load();
+    return *this;
+}
+
+LengthPrefixedNalIterator LengthPrefixedNalIterator::operator++(int) noexcept
+{
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+}
+
+//
+// Helpers
+//
+
+bool isAnnexB(std::span<const uint8_t> data) noexcept
+{
+    auto const begin = data.data();
+    auto const end = begin + data.size();
+    return is_start_code3(begin, end) || is_start_code4(begin, end);
+}
+
+int nalLengthSizeFromExtradata(std::span<const uint8_t> extradata, bool hevc) noexcept
+{
+    // Both records starts with configurationVersion == 1
+    if (extradata.empty() || extradata[0] != 1)
+        return 0;
+
+    if (hevc) {
+        // HEVCDecoderConfigurationRecord: lengthSizeMinusOne at byte 21
+        if (extradata.size() < 23)
+            return 0;
+        return (extradata[21] & 0x03) + 1;
+    }
+
+    // AVCDecoderConfigurationRecord: lengthSizeMinusOne at byte 4
+    if (extradata.size() < 7)
+        return 0;
+    return (extradata[4] & 0x03) + 1;
+}
+
+bool avccToAnnexBInPlace(std::span<uint8_t> data, int lengthSize) noexcept
+{
+    if (!valid_avcc(data, lengthSize))
+        return false;
+    convert_avcc(data, lengthSize);
+    return true;
+}
+
+bool annexBToAvccInPlace(std::span<uint8_t> data, int lengthSize) noexcept
+{
+    if (!valid_annexb(data, lengthSize))
+        return false;
+    convert_annexb(data, lengthSize);
+    return true;
+}
+
+bool avccToAnnexBInPlace(Packet &packet, int lengthSize, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!valid_avcc(std::as_const(packet).span(), lengthSize))
+        return false;
+
+    auto sts = av_packet_make_writable(packet.raw());
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return false;
+    }
+
+    convert_avcc(packet.span(), lengthSize);
+    return true;
+}
+
+bool annexBToAvccInPlace(Packet &packet, int lengthSize, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    if (!valid_annexb(std::as_const(packet).span(), lengthSize))
+        return false;
+
+    auto sts = av_packet_make_writable(packet.raw());
+    if (sts < 0) {
+        throws_if(ec, sts, ffmpeg_category());
+        return false;
+    }
+
+    convert_annexb(packet.span(), lengthSize);
+    return true;
+}
+
+} // namespace av
+
+#endif // AVCPP_CXX_STANDARD >= 20
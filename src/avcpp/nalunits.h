@@ -0,0 +1,204 @@
+#pragma once
+
+#include "avcompat.h"
+
+#if AVCPP_CXX_STANDARD >= 20
+
+#include <span>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+
+#include "packet.h"
+
+namespace av {
+
+/**
+ * Find first Annex B start code prefix (0x00 0x00 0x01) in the given range.
+ *
+ * Scanner is vectorized where possible: SSE2 and AVX2 (selected in runtime, if compiler allows) on x86, NEON on
+ * AArch64 and scalar one for other platforms.
+ *
+ * @param begin  range begin
+ * @param end    range end
+ * @return pointer to the first zero byte of the 3-bytes start code prefix or end if nothing found. Note, 4-bytes
+ *         start code (0x00 0x00 0x00 0x01) is detected at offset 1: check previous byte to find zero_byte.
+ */
+const uint8_t* findStartCode(const uint8_t *begin, const uint8_t *end) noexcept;
+
+/**
+ * Name of the start code scanner implementation selected for the current CPU: "avx2", "sse2", "neon" or "scalar".
+ */
+const char* startCodeScannerName() noexcept;
+
+/**
+ * Single NAL unit view. Does not own data.
+ */
+struct NalUnit
+{
+    /// NAL unit data including NAL header, without start code or length field
+    std::span<const uint8_t> data;
+    /// Size of the start code (3 or 4) or length field size for length prefixed streams
+    uint8_t prefixSize = 0;
+
+    bool empty() const noexcept { return data.empty(); }
+    size_t size() const noexcept { return data.size(); }
+
+    /// H.264 nal_unit_type
+    uint8_t h264Type() const noexcept { return data.empty() ? 0 : (data[0] & 0x1f); }
+    /// HEVC nal_unit_type
+    uint8_t hevcType() const noexcept { return data.empty() ? 0 : ((data[0] >> 1) & 0x3f); }
+};
+
+/**
+ * Forward iterator over NAL units of the Annex B byte stream. Zero-allocation, holds only pointers.
+ * Trailing zero bytes (trailing_zero_8bits) are not included into NAL unit data.
+ */
+class AnnexBNalIterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = NalUnit;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const NalUnit*;
+    using reference         = const NalUnit&;
+
+    AnnexBNalIterator() = default;
+    AnnexBNalIterator(const uint8_t *begin, const uint8_t *end) noexcept;
+
+    reference operator*() const noexcept { return m_nal; }
+    pointer operator->() const noexcept { return &m_nal; }
+
+    AnnexBNalIterator& operator++() noexcept;
+    AnnexBNalIterator operator++(int) noexcept;
+
+    bool operator==(const AnnexBNalIterator &rhs) const noexcept { return m_cur == rhs.m_cur; }
+    bool operator!=(const AnnexBNalIterator &rhs) const noexcept { return m_cur != rhs.m_cur; }
+
+private:
+    void load(const uint8_t *startCode) noexcept;
+
+private:
+    const uint8_t *m_cur  = nullptr; // start code of the current NAL, m_end for the end iterator
+    const uint8_t *m_next = nullptr; // start code of the next NAL or m_end
+    const uint8_t *m_end  = nullptr;
+    NalUnit        m_nal;
+};
+
+/**
+ * Forward iterator over NAL units of the length prefixed stream (AVCC/HVCC, like in MP4 or Matroska). Iteration
+ * stops on the first malformed length.
+ */
+class LengthPrefixedNalIterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = NalUnit;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const NalUnit*;
+    using reference         = const NalUnit&;
+
+    LengthPrefixedNalIterator() = default;
+    LengthPrefixedNalIterator(const uint8_t *begin, const uint8_t *end, int lengthSize) noexcept;
+
+    reference operator*() const noexcept { return m_nal; }
+    pointer operator->() const noexcept { return &m_nal; }
+
+    LengthPrefixedNalIterator& operator++() noexcept;
+    LengthPrefixedNalIterator operator++(int) noexcept;
+
+    bool operator==(const LengthPrefixedNalIterator &rhs) const noexcept { return m_cur == rhs.m_cur; }
+    bool operator!=(const LengthPrefixedNalIterator &rhs) const noexcept { return m_cur != rhs.m_cur; }
+
+private:
+    void load() noexcept;
+
+private:
+    const uint8_t *m_cur  = nullptr;
+    const uint8_t *m_end  = nullptr;
+    int            m_lengthSize = 4;
+    NalUnit        m_nal;
+};
+
+/**
+ * Range of the NAL units of the Annex B stream, usable with range-based for:
+ * @code
+ * for (auto const &nal : AnnexBNalUnits{pkt}) {
+ *     if (nal.h264Type() == 5) // IDR
+ *         ...
+ * }
+ * @endcode
+ */
+class AnnexBNalUnits
+{
+public:
+    explicit AnnexBNalUnits(std::span<const uint8_t> data) noexcept : m_data(data) {}
+    explicit AnnexBNalUnits(const Packet &packet) noexcept : m_data(packet.span()) {}
+
+    AnnexBNalIterator begin() const noexcept { return {m_data.data(), m_data.data() + m_data.size()}; }
+    AnnexBNalIterator end() const noexcept { return {m_data.data() + m_data.size(), m_data.data() + m_data.size()}; }
+
+private:
+    std::span<const uint8_t> m_data;
+};
+
+/**
+ * Range of the NAL units of the length prefixed stream.
+ */
+class LengthPrefixedNalUnits
+{
+public:
+    LengthPrefixedNalUnits(std::span<const uint8_t> data, int lengthSize = 4) noexcept : m_data(data), m_lengthSize(lengthSize) {}
+    LengthPrefixedNalUnits(const Packet &packet, int lengthSize = 4) noexcept : m_data(packet.span()), m_lengthSize(lengthSize) {}
+
+    LengthPrefixedNalIterator begin() const noexcept { return {m_data.data(), m_data.data() + m_data.size(), m_lengthSize}; }
+    LengthPrefixedNalIterator end() const noexcept { return {m_data.data() + m_data.size(), m_data.data() + m_data.size(), m_lengthSize}; }
+
+private:
+    std::span<const uint8_t> m_data;
+    int                      m_lengthSize;
+};
+
+/**
+ * Check that data starts with Annex B start code
+ */
+bool isAnnexB(std::span<const uint8_t> data) noexcept;
+
+/**
+ * Get NAL length field size from the avcC (H.264) or hvcC (HEVC) extradata.
+ *
+ * @return length size (1, 2 or 4) or 0 if extradata is not in the AVCC/HVCC format
+ */
+int nalLengthSizeFromExtradata(std::span<const uint8_t> extradata, bool hevc) noexcept;
+
+/**
+ * Rewrite length prefixed (AVCC) data into Annex B in-place: every length field replaced with start code of the
+ * same size. Possible only for 3 and 4 bytes length fields.
+ *
+ * Data is validated before any modification, so on failure data stays untouched.
+ *
+ * @return true on success, false if sizes do not allow in-place conversion or data is malformed
+ */
+bool avccToAnnexBInPlace(std::span<uint8_t> data, int lengthSize = 4) noexcept;
+
+/**
+ * Rewrite Annex B data into length prefixed (AVCC) in-place: every start code replaced with the length field of the
+ * same size. Possible only when all start codes have size equal to lengthSize and data begins with start code.
+ * Trailing zero bytes are kept as part of the NAL unit payload.
+ *
+ * Data is validated before any modification, so on failure data stays untouched.
+ *
+ * @return true on success, false if sizes do not allow in-place conversion
+ */
+bool annexBToAvccInPlace(std::span<uint8_t> data, int lengthSize = 4) noexcept;
+
+/**
+ * Packet variants. Packet made writable (payload copied if it is shared or read-only) only if conversion is
+ * possible.
+ */
+bool avccToAnnexBInPlace(Packet &packet, int lengthSize = 4, OptionalErrorCode ec = throws());
+bool annexBToAvccInPlace(Packet &packet, int lengthSize = 4, OptionalErrorCode ec = throws());
+
+} // namespace av
+
+#endif // AVCPP_CXX_STANDARD >= 20
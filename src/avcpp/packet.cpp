@@ -45,6 +45,7 @@ Packet::Packet(Packet &&packet)
     m_completeFlag = packet.m_completeFlag;
     m_timeBase = packet.m_timeBase;
     av_packet_move_ref(raw(), packet.raw());
+    AVCPP_MEMORY_SWAP(m_memoryTag, packet.m_memoryTag);
 }
 
 Packet::Packet(const AVPacket *packet, OptionalErrorCode ec)
@@ -73,6 +74,7 @@ Packet::Packet(const uint8_t *data, size_t size, bool /*doAllign*/)
     pkt_data.release();
 
     m_completeFlag = true;
+    AVCPP_MEMORY_TRACK(m_memoryTag, raw());
 }
 
 Packet::Packet(uint8_t *data, size_t size, Packet::wrap_data, OptionalErrorCode ec)
@@ -84,6 +86,7 @@ Packet::Packet(uint8_t *data, size_t size, Packet::wrap_data, OptionalErrorCode
         return;
     }
     m_completeFlag = true;
+    AVCPP_MEMORY_TRACK(m_memoryTag, raw());
 }
 
 Packet::Packet(uint8_t *data, size_t size, Packet::wrap_data_static, OptionalErrorCode ec)
@@ -99,6 +102,7 @@ Packet::Packet(uint8_t *data, size_t size, Packet::wrap_data_static, OptionalErr
     raw()->data = data;
     raw()->size = size;
     m_completeFlag = true;
+    AVCPP_MEMORY_TRACK(m_memoryTag, raw());
 }
 
 #if AVCPP_CXX_STANDARD >= 20
@@ -117,6 +121,7 @@ Packet::Packet(std::span<uint8_t> data, wrap_data_static, OptionalErrorCode ec)
 
 Packet::~Packet()
 {
+    AVCPP_MEMORY_UNTRACK(m_memoryTag);
 #if AVCPP_API_AVCODEC_NEW_INIT_PACKET
     av_packet_free(&m_raw);
 #else
@@ -182,6 +187,7 @@ void Packet::initFromAVPacket(const AVPacket *src, bool deepCopy, OptionalErrorC
     }
 
     m_completeFlag = raw()->size > 0;
+    AVCPP_MEMORY_TRACK(m_memoryTag, raw());
 }
 
 bool Packet::setData(const vector<uint8_t> &newData, OptionalErrorCode ec)
@@ -209,6 +215,7 @@ bool Packet::setData(const uint8_t *newData, size_t size, OptionalErrorCode ec)
     data.release();
 
     m_completeFlag = true;
+    AVCPP_MEMORY_TRACK(m_memoryTag, raw());
 
     return true;
 }
@@ -523,6 +530,25 @@ Packet Packet::clone(OptionalErrorCode ec) const
 void Packet::setComplete(bool complete)
 {
     m_completeFlag = complete;
+    if (complete)
+        AVCPP_MEMORY_TRACK(m_memoryTag, raw());
+}
+
+void Packet::reset()
+{
+#if AVCPP_API_AVCODEC_NEW_INIT_PACKET
+    if (!m_raw)
+        m_raw = av_packet_alloc();
+    else
+        av_packet_unref(m_raw);
+#else
+    avpacket_unref(&m_raw);
+    av_init_packet(&m_raw);
+#endif
+    raw()->stream_index = -1; // no stream
+    m_completeFlag = false;
+    AVCPP_MEMORY_UNTRACK(m_memoryTag);
+    m_timeBase = Rational(0, 0);
 }
 
 Packet &Packet::operator=(const Packet &rhs)
@@ -573,6 +599,7 @@ void Packet::swap(Packet &other)
     swap(m_raw,          other.m_raw);
     swap(m_completeFlag, other.m_completeFlag);
     swap(m_timeBase,     other.m_timeBase);
+    AVCPP_MEMORY_SWAP(m_memoryTag, other.m_memoryTag);
 }
 
 void Packet::setDuration(int duration, const Rational &durationTimeBase)
@@ -15,6 +15,7 @@
 #include "stream.h"
 #include "averror.h"
 #include "timestamp.h"
+#include "memoryaccounting.h"
 
 extern "C" {
 #include <libavutil/attributes.h>
@@ -218,6 +219,12 @@ public:
 
     Packet   clone(OptionalErrorCode ec = throws()) const;
 
+    /**
+     * Release payload and side data and reset all fields, including time base, to the defaults. Packet can be
+     * reused after it without extra allocation of the AVPacket structure.
+     */
+    void     reset();
+
     Packet &operator=(const Packet &rhs);
     Packet &operator=(Packet &&rhs);
 
@@ -234,6 +241,9 @@ public:
 private:
     bool     m_completeFlag;
     Rational m_timeBase;
+#if AVCPP_ENABLE_INSTRUMENTATION
+    MemoryTag m_memoryTag;
+#endif
 };
 
 
@@ -0,0 +1,455 @@
+#include "packettable.h"
+
+#if AVCPP_CXX_STANDARD >= 20
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/mathematics.h>
+}
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+constexpr char     Magic[8]  = {'A', 'V', 'P', 'K', 'T', 'T', 'B', 'L'};
+constexpr uint32_t Version   = 1;
+constexpr uint32_t ByteOrder = 0x01020304;
+
+enum Column
+{
+    ColumnPts,
+    ColumnDts,
+    ColumnSize,
+    ColumnFlags,
+    ColumnOrder,
+    ColumnsCount
+};
+
+struct FileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t streams;
+    uint32_t reserved;
+    uint64_t directoryOffset;
+    uint8_t  padding[32];
+};
+
+struct DirectoryEntry
+{
+    int32_t  streamIndex;
+    int32_t  timeBaseNum;
+    int32_t  timeBaseDen;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t offsets[ColumnsCount];
+};
+
+static_assert(sizeof(FileHeader) == 64);
+static_assert(sizeof(DirectoryEntry) == 64);
+
+constexpr size_t ColumnElementSize[ColumnsCount] = {
+    sizeof(int64_t), sizeof(int64_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint64_t)
+};
+
+constexpr uint64_t align_up(uint64_t value) noexcept
+{
+    return (value + PacketTableAlignment - 1) / PacketTableAlignment * PacketTableAlignment;
+}
+
+struct FileCloser
+{
+    void operator()(FILE *fp) const noexcept { fclose(fp); }
+};
+
+} // anonymous namespace
+
+//
+// PacketTableWriter
+//
+
+#if AVCPP_HAS_AVFORMAT
+PacketTableWriter::PacketTableWriter(FormatContext &ctx)
+{
+    for (size_t i = 0; i < ctx.streamsCount(); ++i) {
+        auto st = ctx.stream(i);
+        addStream(st.index(), st.timeBase());
+    }
+}
+#endif // if AVCPP_HAS_AVFORMAT
+
+void PacketTableWriter::addStream(int index, const Rational &timeBase)
+{
+    columns(index, timeBase).timeBase = timeBase;
+}
+
+PacketTableWriter::Columns &PacketTableWriter::columns(int index, const Rational &timeBase)
+{
+    // Streams count is small: linear search is faster than any map
+    for (auto &cols : m_streams) {
+        if (cols.index == index)
+            return cols;
+    }
+    auto &cols = m_streams.emplace_back();
+    cols.index    = index;
+    cols.timeBase = timeBase;
+    return cols;
+}
+
+void PacketTableWriter::push(const Packet &packet)
+{
+    if (packet.isNull() || packet.size() == 0)
+        return;
+
+    auto &cols = columns(packet.streamIndex(), packet.timeBase());
+
+    auto pts = packet.raw()->pts;
+    auto dts = packet.raw()->dts;
+
+    auto const &srcTb = packet.timeBase();
+    if (srcTb != Rational() && cols.timeBase != Rational() && srcTb != cols.timeBase) {
+        if (pts != av::NoPts)
+            pts = av_rescale_q(pts, srcTb.getValue(), cols.timeBase.getValue());
+        if (dts != av::NoPts)
+            dts = av_rescale_q(dts, srcTb.getValue(), cols.timeBase.getValue());
+    }
+
+    cols.pts.push_back(pts);
+    cols.dts.push_back(dts);
+    cols.size.push_back(uint32_t(packet.size()));
+    cols.flags.push_back(uint32_t(packet.flags()));
+    cols.order.push_back(m_order++);
+}
+
+void PacketTableWriter::reserve(size_t packetsPerStream)
+{
+    for (auto &cols : m_streams) {
+        cols.pts.reserve(packetsPerStream);
+        cols.dts.reserve(packetsPerStream);
+        cols.size.reserve(packetsPerStream);
+        cols.flags.reserve(packetsPerStream);
+        cols.order.reserve(packetsPerStream);
+    }
+}
+
+void PacketTableWriter::save(const std::string &path, OptionalErrorCode ec) const
+{
+    clear_if(ec);
+
+    // Layout: header, columns, directory
+    vector<DirectoryEntry> directory(m_streams.size());
+    uint64_t pos = sizeof(FileHeader);
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        auto const &cols = m_streams[i];
+        auto &entry = directory[i];
+        memset(&entry, 0, sizeof(entry));
+        entry.streamIndex = cols.index;
+        entry.timeBaseNum = cols.timeBase.getNumerator();
+        entry.timeBaseDen = cols.timeBase.getDenominator();
+        entry.count       = cols.size.size();
+        for (int c = 0; c < ColumnsCount; ++c) {
+            pos = align_up(pos);
+            entry.offsets[c] = pos;
+            pos += entry.count * ColumnElementSize[c];
+        }
+    }
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version         = Version;
+    header.byteOrder       = ByteOrder;
+    header.streams         = uint32_t(m_streams.size());
+    header.directoryOffset = align_up(pos);
+
+    unique_ptr<FILE, FileCloser> fp{fopen(path.c_str(), "wb")};
+    if (!fp) {
+        throws_if(ec, errno, std::system_category());
+        return;
+    }
+
+    uint64_t written = 0;
+    int      err     = 0; // errno of the failed call: later calls can change it
+    auto write = [&fp, &written, &err](uint64_t offset, const void *data, size_t size) {
+        static const uint8_t zeros[PacketTableAlignment] = {};
+        while (written < offset) {
+            auto const pad = std::min<uint64_t>(offset - written, sizeof(zeros));
+            errno = 0;
+            if (fwrite(zeros, 1, pad, fp.get()) != pad) {
+                err = errno;
+                return false;
+            }
+            written += pad;
+        }
+        errno = 0;
+        if (size && fwrite(data, 1, size, fp.get()) != size) {
+            err = errno;
+            return false;
+        }
+        written += size;
+        return true;
+    };
+
+    bool ok = write(0, &header, sizeof(header));
+    for (size_t i = 0; ok && i < m_streams.size(); ++i) {
+        auto const &cols = m_streams[i];
+        auto const &entry = directory[i];
+        const void *data[ColumnsCount] = {cols.pts.data(), cols.dts.data(), cols.size.data(),
+                                          cols.flags.data(), cols.order.data()};
+        for (int c = 0; ok && c < ColumnsCount; ++c)
+            ok = write(entry.offsets[c], data[c], entry.count * ColumnElementSize[c]);
+    }
+    ok = ok && write(header.directoryOffset, directory.data(), directory.size() * sizeof(DirectoryEntry));
+
+    if (ok) {
+        errno = 0;
+        if (fflush(fp.get()) != 0) {
+            err = errno;
+            ok  = false;
+        }
+    }
+
+    if (!ok) {
+        // Short write without errno set
+        throws_if(ec, err ? err : EIO, std::system_category());
+        return;
+    }
+}
+
+void PacketTableWriter::clear() noexcept
+{
+    m_streams.clear();
+    m_order = 0;
+}
+
+//
+// PacketTable
+//
+
+PacketTable::PacketTable(const std::string &path, OptionalErrorCode ec)
+{
+    open(path, ec);
+}
+
+PacketTable::~PacketTable()
+{
+    close();
+}
+
+PacketTable::PacketTable(PacketTable &&other) noexcept
+{
+    swap(other);
+}
+
+PacketTable &PacketTable::operator=(PacketTable &&rhs) noexcept
+{
+    if (this != &rhs)
+        PacketTable(std::move(rhs)).swap(*this);
+    return *this;
+}
+
+void PacketTable::swap(PacketTable &other) noexcept
+{
+    using std::swap;
+    swap(m_data, other.m_data);
+    swap(m_size, other.m_size);
+    swap(m_streams, other.m_streams);
+}
+
+void PacketTable::open(const std::string &path, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    close();
+
+#ifdef _WIN32
+    auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throws_if(ec, int(GetLastError()), std::system_category());
+        return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        auto const err = int(GetLastError());
+        CloseHandle(file);
+        throws_if(ec, err, std::system_category());
+        return;
+    }
+
+    if (fileSize.QuadPart < LONGLONG(sizeof(FileHeader))) {
+        CloseHandle(file);
+        throws_if(ec, Errors::PacketTableInvalid);
+        return;
+    }
+
+    // View keeps mapping alive, handles are not needed after mapping
+    auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    auto const mapErr = int(GetLastError());
+    CloseHandle(file);
+    if (!mapping) {
+        throws_if(ec, mapErr, std::system_category());
+        return;
+    }
+
+    auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    auto const viewErr = int(GetLastError());
+    CloseHandle(mapping);
+    if (!view) {
+        throws_if(ec, viewErr, std::system_category());
+        return;
+    }
+
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = size_t(fileSize.QuadPart);
+#else
+    auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throws_if(ec, errno, std::system_category());
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        auto const err = errno;
+        ::close(fd);
+        throws_if(ec, err, std::system_category());
+        return;
+    }
+
+    if (st.st_size < off_t(sizeof(FileHeader))) {
+        ::close(fd);
+        throws_if(ec, Errors::PacketTableInvalid);
+        return;
+    }
+
+    auto const size = size_t(st.st_size);
+    auto addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    auto const err = errno;
+    ::close(fd); // mapping keeps file referenced
+    if (addr == MAP_FAILED) {
+        throws_if(ec, err, std::system_category());
+        return;
+    }
+
+    // Typical access is a sequential scan over columns
+    madvise(addr, size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const uint8_t*>(addr);
+    m_size = size;
+#endif
+
+    if (!parse()) {
+        close();
+        throws_if(ec, Errors::PacketTableInvalid);
+        return;
+    }
+}
+
+void PacketTable::close() noexcept
+{
+    if (m_data) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_streams.clear();
+}
+
+bool PacketTable::parse() noexcept
+{
+    FileHeader header;
+    memcpy(&header, m_data, sizeof(header));
+
+    if (memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.version != Version ||
+        header.byteOrder != ByteOrder)
+        return false;
+
+    // Directory must fit into the file
+    if (header.directoryOffset % alignof(DirectoryEntry) != 0 ||
+        header.directoryOffset > m_size ||
+        (m_size - header.directoryOffset) / sizeof(DirectoryEntry) < header.streams)
+        return false;
+
+    auto const directory = reinterpret_cast<const DirectoryEntry*>(m_data + header.directoryOffset);
+
+    auto column = [this](const DirectoryEntry &entry, int c) -> const void* {
+        auto const offset = entry.offsets[c];
+        auto const elementSize = ColumnElementSize[c];
+        if (offset % elementSize != 0 || offset > m_size || (m_size - offset) / elementSize < entry.count)
+            return nullptr;
+        return m_data + offset;
+    };
+
+    try {
+        m_streams.resize(header.streams);
+    } catch (...) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.streams; ++i) {
+        auto const &entry = directory[i];
+
+        const void *data[ColumnsCount];
+        for (int c = 0; c < ColumnsCount; ++c) {
+            data[c] = column(entry, c);
+            if (!data[c])
+                return false;
+        }
+
+        auto const count = size_t(entry.count);
+        auto &st = m_streams[i];
+        st.streamIndex = entry.streamIndex;
+        st.timeBase    = Rational(entry.timeBaseNum, entry.timeBaseDen);
+        st.pts         = {static_cast<const int64_t*>(data[ColumnPts]), count};
+        st.dts         = {static_cast<const int64_t*>(data[ColumnDts]), count};
+        st.size        = {static_cast<const uint32_t*>(data[ColumnSize]), count};
+        st.flags       = {static_cast<const uint32_t*>(data[ColumnFlags]), count};
+        st.order       = {static_cast<const uint64_t*>(data[ColumnOrder]), count};
+    }
+
+    return true;
+}
+
+const PacketTableStream *PacketTable::findStream(int streamIndex) const noexcept
+{
+    for (auto const &st : m_streams) {
+        if (st.streamIndex == streamIndex)
+            return &st;
+    }
+    return nullptr;
+}
+
+size_t PacketTable::packetsCount() const noexcept
+{
+    size_t count = 0;
+    for (auto const &st : m_streams)
+        count += st.count();
+    return count;
+}
+
+} // namespace av
+
+#endif // AVCPP_CXX_STANDARD >= 20
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "avcompat.h"
+
+#if AVCPP_CXX_STANDARD >= 20
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "avutils.h"
+#include "averror.h"
+#include "rational.h"
+#include "packet.h"
+
+#if AVCPP_HAS_AVFORMAT
+#include "formatcontext.h"
+#endif // if AVCPP_HAS_AVFORMAT
+
+namespace av {
+
+/**
+ * Packet table file layout (host byte order, checked by the reader):
+ *
+ * - header: magic "AVPKTTBL", version, byte order mark, streams count, directory offset;
+ * - columns: one contiguous array per field per stream, every array aligned to PacketTableAlignment;
+ * - directory: one entry per stream with stream index, time base, packets count and columns offsets.
+ *
+ * Columns:
+ * - pts, dts: int64_t, in the stream time base, av::NoPts for unset;
+ * - size: uint32_t, payload size in bytes;
+ * - flags: uint32_t, AV_PKT_FLAG_* of the packet;
+ * - order: uint64_t, sequence number of the packet over all streams, restores the original interleaving.
+ */
+constexpr size_t PacketTableAlignment = 64;
+
+/**
+ * @brief The PacketTableWriter class
+ *
+ * Collects pts/dts/size/flags of the packets into per-stream columns and stores them into memory-mappable file.
+ * Only packet metadata is kept in memory: 32 bytes per packet, without any per-packet allocations.
+ *
+ * @code
+ * PacketTableWriter table{ictx};
+ * while (auto pkt = ictx.readPacket())
+ *     table.push(pkt);
+ * table.save("packets.avpt");
+ * @endcode
+ */
+class PacketTableWriter
+{
+public:
+    PacketTableWriter() = default;
+
+#if AVCPP_HAS_AVFORMAT
+    /**
+     * Register all streams of the format context with their time bases
+     */
+    explicit PacketTableWriter(FormatContext &ctx);
+#endif // if AVCPP_HAS_AVFORMAT
+
+    /**
+     * Register stream. Timestamps of the stream packets are stored in the given time base.
+     */
+    void addStream(int index, const Rational &timeBase);
+
+    /**
+     * Append packet metadata. Packets of unregistered streams register stream with the packet time base. Packets
+     * without payload (null or zero size, like flush packets) are ignored.
+     */
+    void push(const Packet &packet);
+
+    /**
+     * Reserve memory for the given count of packets per stream
+     */
+    void reserve(size_t packetsPerStream);
+
+    size_t packetsCount() const noexcept { return m_order; }
+
+    /**
+     * Write collected table into the file. Collected data is kept: call clear() to drop it.
+     */
+    void save(const std::string &path, OptionalErrorCode ec = throws()) const;
+
+    void clear() noexcept;
+
+private:
+    struct Columns
+    {
+        int                   index = -1;
+        Rational              timeBase;
+        std::vector<int64_t>  pts;
+        std::vector<int64_t>  dts;
+        std::vector<uint32_t> size;
+        std::vector<uint32_t> flags;
+        std::vector<uint64_t> order;
+    };
+
+    Columns& columns(int index, const Rational &timeBase);
+
+private:
+    std::vector<Columns> m_streams;
+    uint64_t             m_order = 0;
+};
+
+/**
+ * Columns of the single stream. Spans point into the mapped file and are valid while PacketTable is alive.
+ */
+struct PacketTableStream
+{
+    int      streamIndex = -1;
+    Rational timeBase;
+
+    std::span<const int64_t>  pts;
+    std::span<const int64_t>  dts;
+    std::span<const uint32_t> size;
+    std::span<const uint32_t> flags;
+    std::span<const uint64_t> order;
+
+    size_t count() const noexcept { return size.size(); }
+};
+
+/**
+ * @brief The PacketTable class
+ *
+ * Read-only view of the file written by PacketTableWriter. File is memory mapped: columns are accessed directly,
+ * without reading and parsing, so scan over the huge table is just sequential memory access.
+ */
+class PacketTable : public noncopyable
+{
+public:
+    PacketTable() = default;
+    explicit PacketTable(const std::string &path, OptionalErrorCode ec = throws());
+    ~PacketTable();
+
+    PacketTable(PacketTable &&other) noexcept;
+    PacketTable& operator=(PacketTable &&rhs) noexcept;
+
+    void swap(PacketTable &other) noexcept;
+
+    void open(const std::string &path, OptionalErrorCode ec = throws());
+    void close() noexcept;
+
+    bool isOpened() const noexcept { return m_data != nullptr; }
+
+    size_t streamsCount() const noexcept { return m_streams.size(); }
+    const std::vector<PacketTableStream>& streams() const noexcept { return m_streams; }
+
+    /**
+     * Stream by position in the table.
+     */
+    const PacketTableStream& stream(size_t idx) const { return m_streams.at(idx); }
+
+    /**
+     * Stream by stream index.
+     * @return nullptr if there is no such stream in the table
+     */
+    const PacketTableStream* findStream(int streamIndex) const noexcept;
+
+    /**
+     * Total packets count over all streams
+     */
+    size_t packetsCount() const noexcept;
+
+private:
+    bool parse() noexcept;
+
+private:
+    const uint8_t                 *m_data = nullptr;
+    size_t                         m_size = 0;
+    std::vector<PacketTableStream> m_streams;
+};
+
+} // namespace av
+
+#endif // AVCPP_CXX_STANDARD >= 20
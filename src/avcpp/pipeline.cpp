@@ -0,0 +1,274 @@
+#include "pipeline.h"
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+// Steps per scheduler task: stage yields to other stages and jobs after it
+constexpr int StepsQuantum = 32;
+
+} // anonymous namespace
+
+/**
+ * Runs single stage on the JobScheduler: stage is posted when its queues are ready and never blocks a worker.
+ */
+struct Pipeline::StageRunner
+{
+    enum State
+    {
+        Idle,
+        Scheduled,
+        Running,
+        RunAgain,  ///< notified while running: queues state changed, reschedule
+        Done,
+    };
+
+    StageRunner(Pipeline &owner, pipeline_detail::StageBase &stage)
+        : owner(owner),
+          stage(stage)
+    {
+    }
+
+    void notify()
+    {
+        auto cur = state.load(std::memory_order_acquire);
+        for (;;) {
+            int next;
+            if (cur == Idle)
+                next = Scheduled;
+            else if (cur == Running)
+                next = RunAgain;
+            else
+                return; // Scheduled, RunAgain or Done
+            if (state.compare_exchange_weak(cur, next, std::memory_order_acq_rel)) {
+                if (next == Scheduled)
+                    post();
+                return;
+            }
+        }
+    }
+
+    void post()
+    {
+        owner.m_scheduler->post(owner.m_job, [this] { run(); });
+    }
+
+    void run() noexcept
+    {
+        state.store(Running, std::memory_order_release);
+
+        auto result = pipeline_detail::StepResult::Progress;
+        try {
+            for (int i = 0; i < StepsQuantum && result == pipeline_detail::StepResult::Progress; ++i)
+                result = stage.step(false);
+        } catch (const PipelineCancelled&) {
+            result = pipeline_detail::StepResult::Finished;
+        } catch (...) {
+            owner.fail(current_exception());
+            result = pipeline_detail::StepResult::Finished;
+        }
+
+        if (result == pipeline_detail::StepResult::Finished) {
+            state.store(Done, std::memory_order_release);
+            owner.stageFinished(); // last access: runner can be destroyed after it
+            return;
+        }
+
+        if (result == pipeline_detail::StepResult::Progress) {
+            // Quantum is exhausted: yield
+            state.store(Scheduled, std::memory_order_release);
+            post();
+            return;
+        }
+
+        // Waiting for queues: go idle, unless they were changed during the run
+        int expected = Running;
+        if (!state.compare_exchange_strong(expected, Idle, std::memory_order_acq_rel)) {
+            state.store(Scheduled, std::memory_order_release);
+            post();
+        }
+    }
+
+    Pipeline                   &owner;
+    pipeline_detail::StageBase &stage;
+    std::atomic<int>            state{Idle};
+};
+
+Pipeline::Pipeline(size_t queueCapacity)
+    : m_queueCapacity(queueCapacity ? queueCapacity : 1)
+{
+}
+
+Pipeline::~Pipeline()
+{
+    if (m_running) {
+        cancel();
+        join();
+    }
+}
+
+void Pipeline::addStage(std::unique_ptr<pipeline_detail::StageBase> stage)
+{
+    if (m_running)
+        throw Exception(make_error_code(Errors::InvalidArgument));
+    m_stages.push_back(std::move(stage));
+}
+
+void Pipeline::runBlocking(pipeline_detail::StageBase &stage) noexcept
+{
+    try {
+        while (stage.step(true) != pipeline_detail::StepResult::Finished)
+            ;
+    } catch (const PipelineCancelled&) {
+        // Normal stop on cancel
+    } catch (...) {
+        fail(current_exception());
+    }
+}
+
+void Pipeline::fail(std::exception_ptr error) noexcept
+{
+    {
+        lock_guard lock{m_errorMutex};
+        if (!m_error)
+            m_error = std::move(error);
+    }
+    cancelQueues();
+}
+
+void Pipeline::stageFinished() noexcept
+{
+    lock_guard lock{m_doneMutex};
+    --m_activeStages;
+    m_doneCond.notify_all();
+}
+
+void Pipeline::cancelQueues()
+{
+    for (auto &queue : m_queues)
+        queue->cancel();
+}
+
+void Pipeline::run(OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (m_running) {
+        throws_if(ec, Errors::InvalidArgument);
+        return;
+    }
+
+    m_running = true;
+    m_threads.reserve(m_stages.size());
+    try {
+        for (auto const &stage : m_stages)
+            m_threads.emplace_back([this, &stage] { runBlocking(*stage); });
+    } catch (const std::system_error &e) {
+        // Thread creation failed: stop already started ones
+        cancel();
+        join();
+        m_running = false;
+        throws_if(ec, e.code().value(), e.code().category());
+    }
+}
+
+void Pipeline::run(JobScheduler &scheduler, JobPriority priority, OptionalErrorCode ec)
+{
+    run(scheduler, scheduler.createJob("pipeline", priority), ec);
+}
+
+void Pipeline::run(JobScheduler &scheduler, std::shared_ptr<Job> job, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (m_running || !job) {
+        throws_if(ec, Errors::InvalidArgument);
+        return;
+    }
+
+    m_scheduler = &scheduler;
+    m_job       = std::move(job);
+
+    m_runners.reserve(m_stages.size());
+    for (auto const &stage : m_stages) {
+        auto runner = make_unique<StageRunner>(*this, *stage);
+        auto ptr = runner.get();
+        if (stage->input)
+            stage->input->setConsumerListener([ptr] { ptr->notify(); });
+        for (auto out : stage->outputs)
+            out->addProducerListener([ptr] { ptr->notify(); });
+        m_runners.push_back(std::move(runner));
+    }
+
+    m_activeStages = m_runners.size();
+    m_running = true;
+
+    // Every stage checks own queues at least once
+    for (auto const &runner : m_runners)
+        runner->notify();
+}
+
+void Pipeline::cancel()
+{
+    m_cancelled = true;
+    cancelQueues();
+}
+
+void Pipeline::join() noexcept
+{
+    for (auto &thread : m_threads) {
+        if (thread.joinable())
+            thread.join();
+    }
+    m_threads.clear();
+
+    if (m_scheduler) {
+        {
+            unique_lock lock{m_doneMutex};
+            m_doneCond.wait(lock, [this] { return m_activeStages == 0; });
+        }
+        // Queues can outlive pipeline via ports
+        for (auto &queue : m_queues)
+            queue->clearListeners();
+        m_runners.clear();
+        m_scheduler = nullptr;
+    }
+}
+
+void Pipeline::wait(OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    join();
+    m_running = false;
+
+    // Stages are single-shot: queues are closed now
+    m_stages.clear();
+    m_queues.clear();
+
+    exception_ptr error;
+    {
+        lock_guard lock{m_errorMutex};
+        error = std::exchange(m_error, nullptr);
+    }
+
+    if (!error)
+        return;
+
+    if (ec) {
+        try {
+            rethrow_exception(error);
+        } catch (const std::system_error &e) {
+            *ec = e.code();
+            return;
+        } catch (...) {
+            throw;
+        }
+    }
+
+    rethrow_exception(error);
+}
+
+} // namespace av
@@ -0,0 +1,1208 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <atomic>
+#include <thread>
+
+#include "avutils.h"
+#include "averror.h"
+#include "packet.h"
+#include "frame.h"
+#include "codeccontext.h"
+#include "videorescaler.h"
+#include "audioresampler.h"
+#include "jobscheduler.h"
+#include "memorybudget.h"
+
+#if AVCPP_HAS_AVFORMAT
+#include "formatcontext.h"
+#endif // if AVCPP_HAS_AVFORMAT
+
+#if AVCPP_HAS_AVFILTER
+#include "filters/buffersrc.h"
+#include "filters/buffersink.h"
+#endif // if AVCPP_HAS_AVFILTER
+
+namespace av {
+
+/**
+ * Thrown by PipelineEmitter when pipeline is cancelled: unwinds stage function. Caught by the pipeline itself, do
+ * not swallow it in the stage code.
+ */
+class PipelineCancelled : public std::exception
+{
+public:
+    const char* what() const noexcept override { return "pipeline cancelled"; }
+};
+
+enum class QueueStatus
+{
+    Ok,
+    Empty,
+    Closed,    ///< closed and drained: EOF
+    Cancelled,
+};
+
+/**
+ * Untyped part of the BoundedQueue: allows pipeline to cancel all queues on error and to track queues state.
+ */
+class BoundedQueueBase : public noncopyable
+{
+public:
+    virtual ~BoundedQueueBase() = default;
+
+    /**
+     * Abort queue: wakes up and fails all blocked and further push() and pop() calls
+     */
+    virtual void cancel() = 0;
+    virtual bool isCancelled() const = 0;
+    virtual bool isFull() const = 0;
+
+    /**
+     * Listeners for the non-blocking consumer and producers (Pipeline run on the JobScheduler). Consumer listener
+     * is called when queue becomes non-empty, closed or cancelled, producer ones - when queue stops being full or
+     * cancelled. Called without queue lock. Must be set while queue is not used.
+     */
+    void setConsumerListener(std::function<void()> listener) { m_consumerListener = std::move(listener); }
+    void addProducerListener(std::function<void()> listener) { m_producerListeners.push_back(std::move(listener)); }
+    virtual void clearListeners()
+    {
+        m_consumerListener = nullptr;
+        m_producerListeners.clear();
+    }
+
+protected:
+    void notifyConsumer() const
+    {
+        if (m_consumerListener)
+            m_consumerListener();
+    }
+
+    void notifyProducers() const
+    {
+        for (auto const &listener : m_producerListeners)
+            listener();
+    }
+
+private:
+    std::function<void()>              m_consumerListener;
+    std::vector<std::function<void()>> m_producerListeners;
+};
+
+/**
+ * @brief The BoundedQueue class
+ *
+ * Fixed capacity queue that connects pipeline stages. Items are moved in and out, ring storage is preallocated, so
+ * there are no allocations in the steady state.
+ *
+ * Producer blocks when queue is full (backpressure) and consumer blocks when it is empty. Each queue is intended to
+ * have one consumer. Producers count is given in the constructor: queue is closed (EOF for the consumer) after all
+ * producers call close().
+ *
+ * Non-blocking tryPop() and forcePush() are used by stages run on the JobScheduler: producer is not resumed while
+ * queue is full, but single step can overfill it (e.g. decoder flush).
+ *
+ * Optional MemoryBudget limits payload of the queued items (see MemoryBudget::payloadBytes()) together with other
+ * queues that share it: producer is blocked or item is dropped while budget is exhausted, according to the budget
+ * policy. Empty queue always accepts the item, so the consumer never starves and the pipeline keeps progressing.
+ */
+template<typename T>
+class BoundedQueue : public BoundedQueueBase
+{
+public:
+    explicit BoundedQueue(size_t capacity = 8, size_t producers = 1)
+        : m_items(capacity ? capacity : 1),
+          m_capacity(capacity ? capacity : 1),
+          m_producers(producers ? producers : 1)
+    {
+    }
+
+    ~BoundedQueue() override
+    {
+        detachBudget();
+    }
+
+    /**
+     * Push item, block while queue is full.
+     * @return false if queue closed or cancelled, item is not consumed in that case
+     */
+    bool push(T &&item)
+    {
+        auto const bytes = m_budget ? MemoryBudget::payloadBytes(item) : 0;
+        std::unique_lock lock{m_mutex};
+        if (m_count >= m_capacity && m_producers && !m_cancelled) {
+            ++m_pushWaits;
+            m_notFull.wait(lock, [this] { return m_count < m_capacity || !m_producers || m_cancelled; });
+        }
+        return pushLocked(std::move(item), lock, bytes, true);
+    }
+
+    /**
+     * Push item ignoring capacity. Budget with Policy::Block is overcommitted.
+     * @return false if queue closed or cancelled, item is not consumed in that case
+     */
+    bool forcePush(T &&item)
+    {
+        auto const bytes = m_budget ? MemoryBudget::payloadBytes(item) : 0;
+        std::unique_lock lock{m_mutex};
+        return pushLocked(std::move(item), lock, bytes, false);
+    }
+
+    /**
+     * Pop item, block while queue is empty.
+     * @return false on cancel or when queue is closed and drained (EOF)
+     */
+    bool pop(T &item)
+    {
+        std::unique_lock lock{m_mutex};
+        if (m_count == 0 && m_producers && !m_cancelled) {
+            ++m_popWaits;
+            m_notEmpty.wait(lock, [this] { return m_count || !m_producers || m_cancelled; });
+        }
+        return popLocked(item, lock) == QueueStatus::Ok;
+    }
+
+    /**
+     * Pop item without blocking
+     */
+    QueueStatus tryPop(T &item)
+    {
+        std::unique_lock lock{m_mutex};
+        return popLocked(item, lock);
+    }
+
+    /**
+     * Producer finished. Consumer receives EOF after queue is drained and all producers finished.
+     */
+    void close()
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            if (m_producers)
+                --m_producers;
+        }
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+        notifyConsumer();
+    }
+
+    void cancel() override
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            m_cancelled = true;
+        }
+        if (m_budget)
+            m_budget->wakeWaiters();
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+        notifyConsumer();
+        notifyProducers();
+    }
+
+    bool isCancelled() const override
+    {
+        std::lock_guard lock{m_mutex};
+        return m_cancelled;
+    }
+
+    bool isFull() const override
+    {
+        std::lock_guard lock{m_mutex};
+        return m_count >= m_capacity || (m_budget && m_count && m_budget->policy() == MemoryBudget::Policy::Block &&
+                                         m_budget->isExhausted());
+    }
+
+    bool isClosed() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_producers == 0;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_count;
+    }
+
+    size_t capacity() const noexcept { return m_capacity; }
+
+    /**
+     * Share memory budget with other queues. Must be set while queue is not used.
+     */
+    void setBudget(std::shared_ptr<MemoryBudget> budget)
+    {
+        detachBudget();
+        m_budget = std::move(budget);
+        if (m_budget)
+            m_budgetListener = m_budget->addListener([this] { notifyProducers(); });
+    }
+
+    const std::shared_ptr<MemoryBudget>& budget() const noexcept { return m_budget; }
+
+    /**
+     * Payload bytes of the queued items, accounted only with the budget
+     */
+    size_t bytes() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_bytes;
+    }
+
+    void clearListeners() override
+    {
+        if (m_budget)
+            m_budget->removeListener(m_budgetListener);
+        BoundedQueueBase::clearListeners();
+    }
+
+    /**
+     * Count of push() calls blocked on full queue: big value means that consumer is a bottleneck
+     */
+    uint64_t pushWaits() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_pushWaits;
+    }
+
+    /**
+     * Count of pop() calls blocked on empty queue: big value means that producer is a bottleneck
+     */
+    uint64_t popWaits() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_popWaits;
+    }
+
+private:
+    enum class Admit
+    {
+        Ok,
+        Dropped,
+        Failed,
+    };
+
+    // Queue lock is released while waiting on the budget
+    Admit admitLocked(size_t bytes, std::unique_lock<std::mutex> &lock, bool blocking)
+    {
+        if (!m_budget || !bytes)
+            return Admit::Ok;
+
+        auto const policy = m_budget->policy();
+        if (m_count == 0 || (!blocking && policy == MemoryBudget::Policy::Block)) {
+            m_budget->forceAcquire(bytes);
+            return Admit::Ok;
+        }
+
+        if (policy == MemoryBudget::Policy::Drop) {
+            if (m_budget->tryAcquire(bytes))
+                return Admit::Ok;
+            m_budget->countDrop(bytes);
+            return Admit::Dropped;
+        }
+
+        lock.unlock();
+        auto const ok = m_budget->acquire(bytes, &m_cancelled);
+        lock.lock();
+        return ok ? Admit::Ok : Admit::Failed;
+    }
+
+    void detachBudget()
+    {
+        if (!m_budget)
+            return;
+        m_budget->removeListener(m_budgetListener);
+        m_budget->release(m_bytes);
+        m_bytes = 0;
+    }
+
+    bool pushLocked(T &&item, std::unique_lock<std::mutex> &lock, size_t bytes, bool blocking)
+    {
+        if (m_cancelled || !m_producers)
+            return false;
+
+        switch (admitLocked(bytes, lock, blocking)) {
+            case Admit::Ok:
+                break;
+            case Admit::Dropped:
+                return true;
+            case Admit::Failed:
+                return false;
+        }
+
+        if (m_cancelled || !m_producers) {
+            // Closed or cancelled while waiting on the budget
+            m_budget->release(bytes);
+            return false;
+        }
+        m_bytes += bytes;
+
+        if (m_count == m_items.size()) {
+            // Overfilled by forcePush(): grow ring storage
+            std::vector<T> items(m_items.size() * 2);
+            for (size_t i = 0; i < m_count; ++i)
+                items[i] = std::move(m_items[(m_head + i) % m_items.size()]);
+            m_items.swap(items);
+            m_head = 0;
+        }
+
+        m_items[(m_head + m_count) % m_items.size()] = std::move(item);
+        auto const wasEmpty = m_count++ == 0;
+        lock.unlock();
+
+        m_notEmpty.notify_one();
+        if (wasEmpty)
+            notifyConsumer();
+        return true;
+    }
+
+    QueueStatus popLocked(T &item, std::unique_lock<std::mutex> &lock)
+    {
+        if (m_cancelled)
+            return QueueStatus::Cancelled;
+        if (m_count == 0)
+            return m_producers ? QueueStatus::Empty : QueueStatus::Closed;
+
+        item = std::move(m_items[m_head]);
+        m_head = (m_head + 1) % m_items.size();
+        auto const wasFull = m_count-- >= m_capacity;
+        auto const isFull  = m_count >= m_capacity;
+        auto const bytes   = m_budget ? std::min(MemoryBudget::payloadBytes(item), m_bytes) : 0;
+        m_bytes -= bytes;
+        lock.unlock();
+
+        if (bytes)
+            m_budget->release(bytes);
+        m_notFull.notify_one();
+        if (wasFull && !isFull)
+            notifyProducers();
+        return QueueStatus::Ok;
+    }
+
+private:
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::vector<T>          m_items;
+    size_t                  m_capacity;
+    size_t                  m_head = 0;
+    size_t                  m_count = 0;
+    size_t                  m_producers;
+    std::atomic_bool        m_cancelled{false}; // read by the budget wait without queue lock
+    uint64_t                m_pushWaits = 0;
+    uint64_t                m_popWaits = 0;
+
+    std::shared_ptr<MemoryBudget> m_budget;
+    size_t                        m_budgetListener = 0;
+    size_t                        m_bytes = 0;
+};
+
+/**
+ * Output of the pipeline stage: pushes items to the next queue. Blocks while next stage is busy (or just queues
+ * item when run on JobScheduler) and throws PipelineCancelled if pipeline is cancelled.
+ */
+template<typename T>
+class PipelineEmitter
+{
+public:
+    explicit PipelineEmitter(BoundedQueue<T> &queue, bool blocking = true) noexcept
+        : m_queue(queue),
+          m_blocking(blocking)
+    {
+    }
+
+    void operator()(T &&item) const
+    {
+        if (!(m_blocking ? m_queue.push(std::move(item)) : m_queue.forcePush(std::move(item))))
+            throw PipelineCancelled{};
+    }
+
+    void operator()(const T &item) const
+    {
+        T copy = item;
+        (*this)(std::move(copy));
+    }
+
+private:
+    BoundedQueue<T> &m_queue;
+    bool             m_blocking;
+};
+
+namespace pipeline_detail {
+
+template<typename F, typename Emitter, typename = void>
+struct HasFlush : std::false_type {};
+
+template<typename F, typename Emitter>
+struct HasFlush<F, Emitter, std::void_t<decltype(std::declval<F&>().flush(std::declval<const Emitter&>()))>>
+    : std::true_type {};
+
+template<typename F, typename = void>
+struct HasFinish : std::false_type {};
+
+template<typename F>
+struct HasFinish<F, std::void_t<decltype(std::declval<F&>().finish())>> : std::true_type {};
+
+struct NoFlush {};
+
+enum class StepResult
+{
+    Progress,
+    NeedInput,
+    NeedOutput,
+    Finished,
+};
+
+/**
+ * Single pipeline stage. step() processes at most one input item: blocking mode is used on the own thread,
+ * non-blocking one on the JobScheduler.
+ */
+class StageBase
+{
+public:
+    virtual ~StageBase() = default;
+
+    /**
+     * Blocking step waits on queues and returns only Progress or Finished
+     */
+    virtual StepResult step(bool blocking) = 0;
+
+    BoundedQueueBase               *input = nullptr;
+    std::vector<BoundedQueueBase*>  outputs;
+
+protected:
+    bool outputsCancelled() const
+    {
+        for (auto out : outputs) {
+            if (out->isCancelled())
+                return true;
+        }
+        return false;
+    }
+
+    bool outputsFull() const
+    {
+        for (auto out : outputs) {
+            if (out->isFull())
+                return true;
+        }
+        return false;
+    }
+
+    template<typename T>
+    static QueueStatus pop(BoundedQueue<T> &queue, T &item, bool blocking)
+    {
+        if (!blocking)
+            return queue.tryPop(item);
+        if (queue.pop(item))
+            return QueueStatus::Ok;
+        return queue.isCancelled() ? QueueStatus::Cancelled : QueueStatus::Closed;
+    }
+};
+
+template<typename T, typename Fn>
+class SourceStage : public StageBase
+{
+public:
+    SourceStage(std::shared_ptr<BoundedQueue<T>> out, Fn fn)
+        : m_out(std::move(out)),
+          m_fn(std::move(fn))
+    {
+        outputs.push_back(m_out.get());
+    }
+
+    StepResult step(bool blocking) override
+    {
+        if (m_out->isCancelled())
+            return StepResult::Finished;
+        if (!blocking && m_out->isFull())
+            return StepResult::NeedOutput;
+
+        PipelineEmitter<T> emit{*m_out, blocking};
+        if (!m_fn(emit)) {
+            m_out->close();
+            return StepResult::Finished;
+        }
+        return StepResult::Progress;
+    }
+
+private:
+    std::shared_ptr<BoundedQueue<T>> m_out;
+    Fn                               m_fn;
+};
+
+template<typename In, typename Out, typename Fn, typename Flush>
+class ProcessStage : public StageBase
+{
+public:
+    ProcessStage(std::shared_ptr<BoundedQueue<In>> in, std::shared_ptr<BoundedQueue<Out>> out, Fn fn, Flush flush)
+        : m_in(std::move(in)),
+          m_out(std::move(out)),
+          m_fn(std::move(fn)),
+          m_flush(std::move(flush))
+    {
+        input = m_in.get();
+        outputs.push_back(m_out.get());
+    }
+
+    StepResult step(bool blocking) override
+    {
+        if (m_out->isCancelled())
+            return StepResult::Finished;
+        if (!blocking && m_out->isFull())
+            return StepResult::NeedOutput;
+
+        PipelineEmitter<Out> emit{*m_out, blocking};
+        switch (pop(*m_in, m_item, blocking)) {
+            case QueueStatus::Ok:
+                m_fn(std::move(m_item), emit);
+                return StepResult::Progress;
+            case QueueStatus::Empty:
+                return StepResult::NeedInput;
+            case QueueStatus::Closed:
+                if constexpr (!std::is_same_v<Flush, NoFlush>)
+                    m_flush(emit);
+                else if constexpr (HasFlush<Fn, PipelineEmitter<Out>>::value)
+                    m_fn.flush(emit);
+                m_out->close();
+                return StepResult::Finished;
+            case QueueStatus::Cancelled:
+                break;
+        }
+        return StepResult::Finished;
+    }
+
+private:
+    std::shared_ptr<BoundedQueue<In>>  m_in;
+    std::shared_ptr<BoundedQueue<Out>> m_out;
+    Fn                                 m_fn;
+    Flush                              m_flush;
+    In                                 m_item;
+};
+
+template<typename In, typename Fn>
+class SinkStage : public StageBase
+{
+public:
+    SinkStage(std::shared_ptr<BoundedQueue<In>> in, Fn fn)
+        : m_in(std::move(in)),
+          m_fn(std::move(fn))
+    {
+        input = m_in.get();
+    }
+
+    StepResult step(bool blocking) override
+    {
+        switch (pop(*m_in, m_item, blocking)) {
+            case QueueStatus::Ok:
+                m_fn(std::move(m_item));
+                return StepResult::Progress;
+            case QueueStatus::Empty:
+                return StepResult::NeedInput;
+            case QueueStatus::Closed:
+                if constexpr (HasFinish<Fn>::value)
+                    m_fn.finish();
+                return StepResult::Finished;
+            case QueueStatus::Cancelled:
+                break;
+        }
+        return StepResult::Finished;
+    }
+
+private:
+    std::shared_ptr<BoundedQueue<In>> m_in;
+    Fn                                m_fn;
+    In                                m_item;
+};
+
+template<typename T, typename Selector>
+class SplitStage : public StageBase
+{
+public:
+    SplitStage(std::shared_ptr<BoundedQueue<T>> in, std::vector<std::shared_ptr<BoundedQueue<T>>> outs, Selector selector)
+        : m_in(std::move(in)),
+          m_outs(std::move(outs)),
+          m_selector(std::move(selector))
+    {
+        input = m_in.get();
+        for (auto const &out : m_outs)
+            outputs.push_back(out.get());
+    }
+
+    StepResult step(bool blocking) override
+    {
+        if (outputsCancelled())
+            return StepResult::Finished;
+        // Conservative: any full output stops the split, like a single consumer of the input queue would
+        if (!blocking && outputsFull())
+            return StepResult::NeedOutput;
+
+        switch (pop(*m_in, m_item, blocking)) {
+            case QueueStatus::Ok:
+            {
+                auto const idx = m_selector(std::as_const(m_item));
+                if (idx < m_outs.size())
+                    PipelineEmitter<T>{*m_outs[idx], blocking}(std::move(m_item));
+                return StepResult::Progress;
+            }
+            case QueueStatus::Empty:
+                return StepResult::NeedInput;
+            case QueueStatus::Closed:
+                for (auto &out : m_outs)
+                    out->close();
+                return StepResult::Finished;
+            case QueueStatus::Cancelled:
+                break;
+        }
+        return StepResult::Finished;
+    }
+
+private:
+    std::shared_ptr<BoundedQueue<T>>              m_in;
+    std::vector<std::shared_ptr<BoundedQueue<T>>> m_outs;
+    Selector                                      m_selector;
+    T                                             m_item;
+};
+
+template<typename T>
+class BroadcastStage : public StageBase
+{
+public:
+    BroadcastStage(std::shared_ptr<BoundedQueue<T>> in, std::vector<std::shared_ptr<BoundedQueue<T>>> outs)
+        : m_in(std::move(in)),
+          m_outs(std::move(outs))
+    {
+        input = m_in.get();
+        for (auto const &out : m_outs)
+            outputs.push_back(out.get());
+    }
+
+    StepResult step(bool blocking) override
+    {
+        if (outputsCancelled())
+            return StepResult::Finished;
+        if (!blocking && outputsFull())
+            return StepResult::NeedOutput;
+
+        switch (pop(*m_in, m_item, blocking)) {
+            case QueueStatus::Ok:
+                for (size_t i = 0; i + 1 < m_outs.size(); ++i)
+                    PipelineEmitter<T>{*m_outs[i], blocking}(std::as_const(m_item));
+                if (!m_outs.empty())
+                    PipelineEmitter<T>{*m_outs.back(), blocking}(std::move(m_item));
+                return StepResult::Progress;
+            case QueueStatus::Empty:
+                return StepResult::NeedInput;
+            case QueueStatus::Closed:
+                for (auto &out : m_outs)
+                    out->close();
+                return StepResult::Finished;
+            case QueueStatus::Cancelled:
+                break;
+        }
+        return StepResult::Finished;
+    }
+
+private:
+    std::shared_ptr<BoundedQueue<T>>              m_in;
+    std::vector<std::shared_ptr<BoundedQueue<T>>> m_outs;
+    T                                             m_item;
+};
+
+struct Forward
+{
+    template<typename T>
+    void operator()(T &&item, const PipelineEmitter<std::decay_t<T>> &emit) const
+    {
+        emit(std::forward<T>(item));
+    }
+};
+
+} // namespace pipeline_detail
+
+/**
+ * @brief The Pipeline class
+ *
+ * Runs processing stages (demuxer, decoders, filters, rescalers, encoders, muxer or any user code) connected by the
+ * BoundedQueue's. Stages overlap in time, so throughput is limited by the slowest stage instead of the sum of all
+ * of them. Stages can be run:
+ * - on own threads, see run(OptionalErrorCode);
+ * - as tasks on the shared JobScheduler, see run(JobScheduler&, ...): stage is scheduled only when it has input
+ *   and room in the output, and yields after few items, so many pipelines share fixed amount of threads.
+ *
+ * - Backpressure: stage is blocked (or not scheduled) while output queue is full.
+ * - Memory: payload of all queues can be limited by the shared MemoryBudget, see setMemoryBudget().
+ * - EOF: source returns false, every stage drains its input, calls flush and closes output in turn.
+ * - Errors: first exception thrown by any stage cancels all queues, stops all stages and is rethrown by wait().
+ *
+ * Objects used by the stages (contexts, rescalers and so on) are accessed by single stage at time, but must outlive
+ * the pipeline run.
+ *
+ * @code
+ * Pipeline pipeline;
+ * auto packets = pipeline.source<Packet>(pipeline::demux(ictx));
+ * auto frames  = pipeline.stage<VideoFrame>(packets, pipeline::decode(vdec, videoStream));
+ * auto encoded = pipeline.stage<Packet>(frames, pipeline::encode(venc));
+ * pipeline.sink(encoded, pipeline::mux(octx, 0));
+ * pipeline.run();
+ * pipeline.wait();
+ * octx.writeTrailer();
+ * @endcode
+ */
+class Pipeline : public noncopyable
+{
+public:
+    template<typename T>
+    using Port = std::shared_ptr<BoundedQueue<T>>;
+
+    /**
+     * @param queueCapacity  default capacity of the queues between stages
+     */
+    explicit Pipeline(size_t queueCapacity = 8);
+
+    /**
+     * Cancels and waits running stages
+     */
+    ~Pipeline();
+
+    /**
+     * Add source stage.
+     *
+     * @param fn        callable bool(const PipelineEmitter<T>&): emits zero or more items, returns false on EOF
+     * @param capacity  output queue capacity, 0 - pipeline default
+     */
+    template<typename T, typename Source>
+    Port<T> source(Source fn, size_t capacity = 0)
+    {
+        auto out = makeQueue<T>(capacity);
+        addStage(std::make_unique<pipeline_detail::SourceStage<T, Source>>(out, std::move(fn)));
+        return out;
+    }
+
+    /**
+     * Add processing stage.
+     *
+     * @param in        input port
+     * @param fn        callable void(In&&, const PipelineEmitter<Out>&). If it has flush(const PipelineEmitter<Out>&)
+     *                  member, it is called on EOF before closing output
+     * @param capacity  output queue capacity, 0 - pipeline default
+     */
+    template<typename Out, typename In, typename Stage>
+    Port<Out> stage(Port<In> in, Stage fn, size_t capacity = 0)
+    {
+        auto out = makeQueue<Out>(capacity);
+        addStage(std::make_unique<pipeline_detail::ProcessStage<In, Out, Stage, pipeline_detail::NoFlush>>(
+            std::move(in), out, std::move(fn), pipeline_detail::NoFlush{}));
+        return out;
+    }
+
+    /**
+     * Add processing stage with separate flush callable void(const PipelineEmitter<Out>&).
+     */
+    template<typename Out, typename In, typename Stage, typename Flush>
+    Port<Out> stage(Port<In> in, Stage fn, Flush flush, size_t capacity = 0)
+    {
+        auto out = makeQueue<Out>(capacity);
+        addStage(std::make_unique<pipeline_detail::ProcessStage<In, Out, Stage, Flush>>(
+            std::move(in), out, std::move(fn), std::move(flush)));
+        return out;
+    }
+
+    /**
+     * Add final stage.
+     *
+     * @param fn  callable void(In&&). If it has finish() member, it is called on EOF.
+     */
+    template<typename In, typename Sink>
+    void sink(Port<In> in, Sink fn)
+    {
+        addStage(std::make_unique<pipeline_detail::SinkStage<In, Sink>>(std::move(in), std::move(fn)));
+    }
+
+    /**
+     * Route items of the single input into several outputs, e.g. demuxed packets into per-stream decoders.
+     *
+     * @param selector  callable size_t(const T&): output index, values out of range drop the item
+     */
+    template<typename T, typename Selector>
+    std::vector<Port<T>> split(Port<T> in, size_t outputs, Selector selector, size_t capacity = 0)
+    {
+        std::vector<Port<T>> outs;
+        for (size_t i = 0; i < outputs; ++i)
+            outs.push_back(makeQueue<T>(capacity));
+        addStage(std::make_unique<pipeline_detail::SplitStage<T, Selector>>(std::move(in), outs, std::move(selector)));
+        return outs;
+    }
+
+    /**
+     * Pass every item of the input to all outputs, e.g. decoded frames to several encoders. Items are copied, so
+     * use reference counted ones (Packet, VideoFrame, AudioSamples): data is shared, not duplicated. Slowest output
+     * limits the whole broadcast.
+     */
+    template<typename T>
+    std::vector<Port<T>> broadcast(Port<T> in, size_t outputs, size_t capacity = 0)
+    {
+        std::vector<Port<T>> outs;
+        for (size_t i = 0; i < outputs; ++i)
+            outs.push_back(makeQueue<T>(capacity));
+        addStage(std::make_unique<pipeline_detail::BroadcastStage<T>>(std::move(in), outs));
+        return outs;
+    }
+
+    /**
+     * Merge several inputs into the single output, e.g. encoded audio and video packets into the muxer. Items of
+     * the different inputs are interleaved in the arrival order.
+     */
+    template<typename T>
+    Port<T> merge(const std::vector<Port<T>> &ins, size_t capacity = 0)
+    {
+        auto out = makeQueue<T>(capacity, ins.size());
+        for (auto const &in : ins) {
+            using Stage = pipeline_detail::ProcessStage<T, T, pipeline_detail::Forward, pipeline_detail::NoFlush>;
+            addStage(std::make_unique<Stage>(in, out, pipeline_detail::Forward{}, pipeline_detail::NoFlush{}));
+        }
+        return out;
+    }
+
+    /**
+     * Start all stages, each one on the own thread. Stages can't be added after start. Pipeline runs once: after
+     * wait() stages are dropped and must be added again for the next run.
+     */
+    void run(OptionalErrorCode ec = throws());
+
+    /**
+     * Start all stages as tasks of the given job on the scheduler. Codec contexts used by stages should be prepared
+     * with JobScheduler::prepareCodecContext().
+     *
+     * wait() must not be called from the scheduler thread.
+     */
+    void run(JobScheduler &scheduler, std::shared_ptr<Job> job, OptionalErrorCode ec = throws());
+
+    /**
+     * Same as above, but creates new job with given priority, see job()
+     */
+    void run(JobScheduler &scheduler, JobPriority priority = JobPriority::Normal, OptionalErrorCode ec = throws());
+
+    /**
+     * Stop all stages: blocked queues operations are interrupted, wait() returns without error.
+     */
+    void cancel();
+
+    /**
+     * Wait for completion of all stages.
+     *
+     * If some stage fails, error code of the av::Exception (or std::system_error) is stored into the ec. Other
+     * exceptions are rethrown as is.
+     */
+    void wait(OptionalErrorCode ec = throws());
+
+    bool isRunning() const noexcept { return m_running; }
+    bool isCancelled() const noexcept { return m_cancelled; }
+
+    size_t stagesCount() const noexcept { return m_stages.size(); }
+
+    /**
+     * Limit payload of all queues added after this call, see BoundedQueue. Budget can be shared with other
+     * pipelines.
+     */
+    void setMemoryBudget(std::shared_ptr<MemoryBudget> budget) { m_budget = std::move(budget); }
+    const std::shared_ptr<MemoryBudget>& memoryBudget() const noexcept { return m_budget; }
+
+    /**
+     * Job of the scheduler run: CPU time and queue latency counters. Null for the threads run.
+     */
+    const std::shared_ptr<Job>& job() const noexcept { return m_job; }
+
+private:
+    struct StageRunner;
+
+    template<typename T>
+    Port<T> makeQueue(size_t capacity, size_t producers = 1)
+    {
+        auto queue = std::make_shared<BoundedQueue<T>>(capacity ? capacity : m_queueCapacity, producers);
+        if (m_budget)
+            queue->setBudget(m_budget);
+        m_queues.push_back(queue);
+        return queue;
+    }
+
+    void addStage(std::unique_ptr<pipeline_detail::StageBase> stage);
+    void runBlocking(pipeline_detail::StageBase &stage) noexcept;
+    void fail(std::exception_ptr error) noexcept;
+    void stageFinished() noexcept;
+    void cancelQueues();
+    void join() noexcept;
+
+private:
+    size_t                                                   m_queueCapacity;
+    std::shared_ptr<MemoryBudget>                            m_budget;
+    std::vector<std::shared_ptr<BoundedQueueBase>>           m_queues;
+    std::vector<std::unique_ptr<pipeline_detail::StageBase>> m_stages;
+
+    // Threads run
+    std::vector<std::thread> m_threads;
+
+    // Scheduler run
+    JobScheduler                             *m_scheduler = nullptr;
+    std::shared_ptr<Job>                      m_job;
+    std::vector<std::unique_ptr<StageRunner>> m_runners;
+    std::mutex                                m_doneMutex;
+    std::condition_variable                   m_doneCond;
+    size_t                                    m_activeStages = 0;
+
+    std::mutex         m_errorMutex;
+    std::exception_ptr m_error;
+    std::atomic_bool   m_running{false};
+    std::atomic_bool   m_cancelled{false};
+};
+
+/**
+ * Ready-to-use stages for the avcpp objects. Objects are referenced, not copied.
+ */
+namespace pipeline {
+
+#if AVCPP_HAS_AVFORMAT
+/**
+ * Source: read packets from the input context till the end
+ */
+inline auto demux(FormatContext &ctx)
+{
+    return [&ctx](const PipelineEmitter<Packet> &emit) {
+        auto pkt = ctx.readPacket();
+        if (!pkt)
+            return false;
+        emit(std::move(pkt));
+        return true;
+    };
+}
+
+/**
+ * Sink: write packets into the output context. Header must be written before run, trailer after wait().
+ *
+ * @param streamIndex  output stream index to set, -1 - keep packet one
+ */
+inline auto mux(FormatContext &ctx, int streamIndex = -1)
+{
+    return [&ctx, streamIndex](Packet &&pkt) {
+        if (streamIndex >= 0)
+            pkt.setStreamIndex(streamIndex);
+        ctx.writePacket(pkt);
+    };
+}
+#endif // if AVCPP_HAS_AVFORMAT
+
+/**
+ * Decoder stage: Packet -> VideoFrame/AudioSamples. Decoder flushed on EOF.
+ */
+template<typename Decoder>
+class DecodeStage
+{
+public:
+    using Frame = decltype(std::declval<Decoder&>().decode(std::declval<const Packet&>()));
+
+    DecodeStage(Decoder &decoder, int streamIndex) : m_decoder(decoder), m_streamIndex(streamIndex) {}
+
+    void operator()(Packet &&pkt, const PipelineEmitter<Frame> &emit)
+    {
+        if (m_streamIndex >= 0 && pkt.streamIndex() != m_streamIndex)
+            return;
+        auto frame = m_decoder.decode(pkt);
+        if (frame)
+            emit(std::move(frame));
+    }
+
+    void flush(const PipelineEmitter<Frame> &emit)
+    {
+        while (true) {
+            auto frame = m_decoder.decode(Packet());
+            if (!frame)
+                break;
+            emit(std::move(frame));
+        }
+    }
+
+private:
+    Decoder &m_decoder;
+    int      m_streamIndex;
+};
+
+/**
+ * @param streamIndex  packets of other streams are ignored, -1 - decode all
+ */
+template<typename Decoder>
+DecodeStage<Decoder> decode(Decoder &decoder, int streamIndex = -1)
+{
+    return {decoder, streamIndex};
+}
+
+/**
+ * Encoder stage: VideoFrame/AudioSamples -> Packet. Encoder flushed on EOF.
+ */
+template<typename Encoder>
+class EncodeStage
+{
+public:
+    explicit EncodeStage(Encoder &encoder) : m_encoder(encoder) {}
+
+    template<typename Frame>
+    void operator()(Frame &&frame, const PipelineEmitter<Packet> &emit)
+    {
+        auto pkt = m_encoder.encode(frame);
+        if (pkt)
+            emit(std::move(pkt));
+    }
+
+    void flush(const PipelineEmitter<Packet> &emit)
+    {
+        while (true) {
+            auto pkt = m_encoder.encode();
+            if (!pkt)
+                break;
+            emit(std::move(pkt));
+        }
+    }
+
+private:
+    Encoder &m_encoder;
+};
+
+template<typename Encoder>
+EncodeStage<Encoder> encode(Encoder &encoder)
+{
+    return EncodeStage<Encoder>{encoder};
+}
+
+/**
+ * Rescaler stage: VideoFrame -> VideoFrame
+ */
+inline auto rescale(VideoRescaler &rescaler)
+{
+    return [&rescaler](VideoFrame &&frame, const PipelineEmitter<VideoFrame> &emit) {
+        auto out = rescaler.rescale(frame);
+        out.setTimeBase(frame.timeBase());
+        out.setStreamIndex(frame.streamIndex());
+        emit(std::move(out));
+    };
+}
+
+/**
+ * Resampler stage: AudioSamples -> AudioSamples with fixed samples count (encoder frame size), rest flushed on EOF.
+ */
+class ResampleStage
+{
+public:
+    ResampleStage(AudioResampler &resampler, size_t frameSize) : m_resampler(resampler), m_frameSize(frameSize) {}
+
+    void operator()(AudioSamples &&samples, const PipelineEmitter<AudioSamples> &emit)
+    {
+        m_resampler.push(samples);
+        pop(emit, m_frameSize);
+    }
+
+    void flush(const PipelineEmitter<AudioSamples> &emit)
+    {
+        pop(emit, m_frameSize);
+        pop(emit, 0);
+    }
+
+private:
+    void pop(const PipelineEmitter<AudioSamples> &emit, size_t samplesCount)
+    {
+        while (true) {
+            auto out = m_resampler.pop(samplesCount);
+            if (!out)
+                break;
+            emit(std::move(out));
+            if (!samplesCount)
+                break;
+        }
+    }
+
+private:
+    AudioResampler &m_resampler;
+    size_t          m_frameSize;
+};
+
+inline ResampleStage resample(AudioResampler &resampler, size_t frameSize)
+{
+    return {resampler, frameSize};
+}
+
+#if AVCPP_HAS_AVFILTER
+/**
+ * Filter graph stage: frames pushed into the buffersrc and pulled from the buffersink, graph flushed on EOF.
+ * Graph must be configured before run.
+ */
+template<typename Frame>
+class FilterStage
+{
+public:
+    FilterStage(BufferSrcFilterContext &src, BufferSinkFilterContext &sink) : m_src(src), m_sink(sink) {}
+
+    void operator()(Frame &&frame, const PipelineEmitter<Frame> &emit)
+    {
+        add(frame);
+        pull(emit);
+    }
+
+    void flush(const PipelineEmitter<Frame> &emit)
+    {
+        auto null = Frame::null();
+        add(null);
+        pull(emit);
+    }
+
+private:
+    void add(Frame &frame)
+    {
+        if constexpr (std::is_same_v<Frame, VideoFrame>)
+            m_src.addVideoFrame(frame);
+        else
+            m_src.addAudioSamples(frame);
+    }
+
+    void pull(const PipelineEmitter<Frame> &emit)
+    {
+        while (true) {
+            std::error_code ec;
+            Frame out;
+            bool got;
+            if constexpr (std::is_same_v<Frame, VideoFrame>)
+                got = m_sink.getVideoFrame(out, ec);
+            else
+                got = m_sink.getAudioFrame(out, ec);
+            if (!got) {
+                // EAGAIN and EOF are not errors here
+                if (ec && (ec.category() != ffmpeg_category() ||
+                           (ec.value() != AVERROR(EAGAIN) && ec.value() != AVERROR_EOF)))
+                    throw Exception(ec);
+                break;
+            }
+            emit(std::move(out));
+        }
+    }
+
+private:
+    BufferSrcFilterContext  &m_src;
+    BufferSinkFilterContext &m_sink;
+};
+
+template<typename Frame>
+FilterStage<Frame> filter(BufferSrcFilterContext &src, BufferSinkFilterContext &sink)
+{
+    return {src, sink};
+}
+#endif // if AVCPP_HAS_AVFILTER
+
+} // namespace pipeline
+
+} // namespace av
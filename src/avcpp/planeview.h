@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace av {
+
+/**
+ * @brief The PlaneView class
+ *
+ * Non-owning strided view of the image plane, like std::mdspan with layout_stride: external code reads (or writes)
+ * pixels in place instead of VideoFrame::copyToBuffer(). Elements are indexed as (row, column), like mdspan.
+ *
+ * - width() is in T elements: pixels for the planar formats, pixels * components for the packed ones (RGB24 as
+ *   uint8_t is 3 * width elements);
+ * - stride() is in bytes, it is the line size of the frame and can be larger than width() * sizeof(T).
+ *
+ * View is valid while the frame buffers are alive.
+ */
+template<typename T>
+class PlaneView
+{
+public:
+    using element_type = T;
+    using value_type   = std::remove_cv_t<T>;
+    using byte_type    = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+
+    PlaneView() noexcept = default;
+
+    PlaneView(T *data, int width, int height, std::ptrdiff_t stride) noexcept
+        : m_data(data),
+          m_width(width),
+          m_height(height),
+          m_stride(stride)
+    {
+    }
+
+    // Mutable view converts to the read-only one
+    template<typename U, typename = std::enable_if_t<std::is_same_v<const U, T> && !std::is_const_v<U>>>
+    PlaneView(const PlaneView<U> &other) noexcept
+        : PlaneView(other.data(), other.width(), other.height(), other.stride())
+    {
+    }
+
+    T*             data() const noexcept { return m_data; }
+    int            width() const noexcept { return m_width; }
+    int            height() const noexcept { return m_height; }
+    std::ptrdiff_t stride() const noexcept { return m_stride; }
+
+    bool empty() const noexcept { return !m_data || m_width <= 0 || m_height <= 0; }
+    explicit operator bool() const noexcept { return !empty(); }
+
+    T* row(int y) const noexcept
+    {
+        return reinterpret_cast<T*>(reinterpret_cast<byte_type*>(m_data) + y * m_stride);
+    }
+
+    T& operator()(int y, int x) const noexcept
+    {
+        return row(y)[x];
+    }
+
+    /**
+     * Same memory as other element type, e.g. uint16_t for 10-bit formats. Empty view if the line width or
+     * the stride is not a multiple of sizeof(U) or data is misaligned for U.
+     */
+    template<typename U>
+    PlaneView<U> as() const noexcept
+    {
+        static_assert(std::is_const_v<U> || !std::is_const_v<T>, "Constness can't be dropped");
+
+        auto const bytes = std::size_t(m_width) * sizeof(T);
+        if (empty() ||
+            bytes % sizeof(U) ||
+            std::size_t(m_stride < 0 ? -m_stride : m_stride) % alignof(U) ||
+            reinterpret_cast<std::uintptr_t>(m_data) % alignof(U))
+        {
+            return {};
+        }
+
+        return {reinterpret_cast<U*>(m_data), int(bytes / sizeof(U)), m_height, m_stride};
+    }
+
+private:
+    T             *m_data   = nullptr;
+    int            m_width  = 0;
+    int            m_height = 0;
+    std::ptrdiff_t m_stride = 0;
+};
+
+} // namespace av
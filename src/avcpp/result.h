@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cassert>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include "ffmpeg.h"
+#include "averror.h"
+
+namespace av {
+
+/**
+ * Outcome of the non-throwing try* calls
+ */
+enum class ResultStatus
+{
+    Ok,     ///< value is set
+    Again,  ///< no output now: feed more input (or receive pending output first)
+    Eof,    ///< stream, decoder or encoder is fully drained
+    Error,  ///< see Result::error()
+};
+
+namespace result_detail {
+
+class Status
+{
+public:
+    constexpr Status() noexcept = default;
+    constexpr Status(ResultStatus status, int code = 0, const std::error_category *category = nullptr) noexcept
+        : m_status(status),
+          m_code(code),
+          m_category(category)
+    {
+    }
+
+    ResultStatus status() const noexcept { return m_status; }
+
+    bool isOk()    const noexcept { return m_status == ResultStatus::Ok; }
+    bool isAgain() const noexcept { return m_status == ResultStatus::Again; }
+    bool isEof()   const noexcept { return m_status == ResultStatus::Eof; }
+    bool isError() const noexcept { return m_status == ResultStatus::Error; }
+
+    explicit operator bool() const noexcept { return isOk(); }
+
+    /**
+     * Raw error value: FFmpeg AVERROR() or av::Errors, 0 for Ok
+     */
+    int errorValue() const noexcept
+    {
+        switch (m_status) {
+            case ResultStatus::Ok:    return 0;
+            case ResultStatus::Again: return AVERROR(EAGAIN);
+            case ResultStatus::Eof:   return AVERROR_EOF;
+            case ResultStatus::Error: return m_code;
+        }
+        return m_code;
+    }
+
+    /**
+     * Error code of the Again, Eof and Error results. Constructed only on request.
+     */
+    std::error_code error() const
+    {
+        if (isOk())
+            return {};
+        if (isError() && m_category)
+            return std::error_code(m_code, *m_category);
+        return make_ffmpeg_error(errorValue());
+    }
+
+    /**
+     * Bridge to the OptionalErrorCode API: Error is thrown or stored, Again and Eof are not errors.
+     */
+    void throwIfError(OptionalErrorCode ec = throws()) const
+    {
+        if (isError())
+            throws_if(ec, m_code, m_category ? *m_category : ffmpeg_category());
+        else
+            clear_if(ec);
+    }
+
+protected:
+    ResultStatus               m_status   = ResultStatus::Ok;
+    int                        m_code     = 0;
+    const std::error_category *m_category = nullptr;
+};
+
+} // namespace result_detail
+
+/**
+ * @brief The Result class
+ *
+ * std::expected-like return value of the non-throwing API for hot loops: tryReadPacket(), tryDecode(),
+ * tryEncode(), tryPush()/tryPop(), tryGetVideoFrame(), tryWritePacket(). EAGAIN and EOF are the regular states
+ * instead of errors, nothing is thrown and std::error_code is built only if error() is called.
+ *
+ * Value is held only by the Ok result: non-Ok ones do not allocate frames/packets. Like std::expected, value
+ * access of the non-Ok result is undefined.
+ *
+ * @code
+ * while (true) {
+ *     auto pkt = ictx.tryReadPacket();
+ *     if (pkt.isEof())
+ *         break;
+ *     if (!pkt)
+ *         return pkt.error();
+ *     ...
+ * }
+ * @endcode
+ */
+template<typename T>
+class Result : public result_detail::Status
+{
+public:
+    using value_type = T;
+
+    Result()
+        : m_value(std::in_place)
+    {
+    }
+
+    Result(T &&value) noexcept(std::is_nothrow_move_constructible_v<T>)
+        : m_value(std::move(value))
+    {
+    }
+
+    Result(const T &value)
+        : m_value(value)
+    {
+    }
+
+    static Result again() noexcept
+    {
+        return Result(ResultStatus::Again);
+    }
+
+    static Result eof() noexcept
+    {
+        return Result(ResultStatus::Eof);
+    }
+
+    static Result error(int code, const std::error_category &category) noexcept
+    {
+        return Result(ResultStatus::Error, code, &category);
+    }
+
+    static Result error(Errors errc) noexcept
+    {
+        return Result(ResultStatus::Error, static_cast<int>(errc), &avcpp_category());
+    }
+
+    using Status::error;
+
+    T&        value() &       noexcept { assert(m_value); return *m_value; }
+    const T&  value() const & noexcept { assert(m_value); return *m_value; }
+    T&&       value() &&      noexcept { assert(m_value); return std::move(*m_value); }
+
+    T&        operator*() &       noexcept { return value(); }
+    const T&  operator*() const & noexcept { return value(); }
+    T&&       operator*() &&      noexcept { return std::move(*this).value(); }
+
+    T*        operator->()       noexcept { return &value(); }
+    const T*  operator->() const noexcept { return &value(); }
+
+    /**
+     * Value of the Ok result, @p other otherwise
+     */
+    T valueOr(T other) &&
+    {
+        return m_value ? std::move(*m_value) : std::move(other);
+    }
+
+private:
+    Result(ResultStatus status, int code = 0, const std::error_category *category = nullptr) noexcept
+        : Status(status, code, category)
+    {
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template<>
+class Result<void> : public result_detail::Status
+{
+public:
+    using value_type = void;
+
+    Result() = default;
+
+    static Result again() noexcept { return Result(ResultStatus::Again); }
+    static Result eof() noexcept { return Result(ResultStatus::Eof); }
+
+    static Result error(int code, const std::error_category &category) noexcept
+    {
+        return Result(ResultStatus::Error, code, &category);
+    }
+
+    static Result error(Errors errc) noexcept
+    {
+        return Result(ResultStatus::Error, static_cast<int>(errc), &avcpp_category());
+    }
+
+    using Status::error;
+
+private:
+    Result(ResultStatus status, int code = 0, const std::error_category *category = nullptr) noexcept
+        : Status(status, code, category)
+    {
+    }
+};
+
+/**
+ * Classify failed status: FFmpeg EAGAIN and EOF are not errors
+ */
+template<typename T>
+Result<T> make_result_status(int code, const std::error_category &category = ffmpeg_category()) noexcept
+{
+    if (&category == &ffmpeg_category()) {
+        if (code == AVERROR(EAGAIN))
+            return Result<T>::again();
+        if (code == AVERROR_EOF)
+            return Result<T>::eof();
+    }
+    return Result<T>::error(code, category);
+}
+
+} // namespace av
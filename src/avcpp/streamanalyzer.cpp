@@ -0,0 +1,528 @@
+#include "streamanalyzer.h"
+
+#if AVCPP_CXX_STANDARD >= 20
+
+#include <bit>
+#include <limits>
+#include <algorithm>
+
+#include "nalunits.h"
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+/**
+ * Minimal RBSP bit reader: removes emulation prevention bytes on the fly. Reads only first bytes of the NAL, so
+ * there is no sense to make a copy.
+ */
+class RbspReader
+{
+public:
+    RbspReader(const uint8_t *begin, const uint8_t *end) noexcept
+        : m_ptr(begin), m_end(end)
+    {
+    }
+
+    bool bit(uint32_t &val) noexcept
+    {
+        if (!m_bitsLeft && !fetch())
+            return false;
+        --m_bitsLeft;
+        val = (m_cur >> m_bitsLeft) & 1;
+        return true;
+    }
+
+    bool bits(int count, uint32_t &val) noexcept
+    {
+        val = 0;
+        for (int i = 0; i < count; ++i) {
+            uint32_t b;
+            if (!bit(b))
+                return false;
+            val = (val << 1) | b;
+        }
+        return true;
+    }
+
+    bool skip(int count) noexcept
+    {
+        uint32_t dummy;
+        for (int i = 0; i < count; ++i) {
+            if (!bit(dummy))
+                return false;
+        }
+        return true;
+    }
+
+    // Exp-Golomb unsigned
+    bool ue(uint32_t &val) noexcept
+    {
+        int zeros = 0;
+        uint32_t b = 0;
+        while (true) {
+            if (!bit(b))
+                return false;
+            if (b)
+                break;
+            if (++zeros > 31)
+                return false;
+        }
+        uint32_t suffix = 0;
+        if (!bits(zeros, suffix))
+            return false;
+        val = (uint32_t(1) << zeros) - 1 + suffix;
+        return true;
+    }
+
+private:
+    bool fetch() noexcept
+    {
+        if (m_ptr >= m_end)
+            return false;
+        uint8_t b = *m_ptr++;
+        if (m_zeros >= 2 && b == 0x03) {
+            // emulation_prevention_three_byte
+            m_zeros = 0;
+            if (m_ptr >= m_end)
+                return false;
+            b = *m_ptr++;
+        }
+        m_zeros = b ? 0 : m_zeros + 1;
+        m_cur = b;
+        m_bitsLeft = 8;
+        return true;
+    }
+
+private:
+    const uint8_t *m_ptr;
+    const uint8_t *m_end;
+    uint32_t       m_cur = 0;
+    int            m_bitsLeft = 0;
+    int            m_zeros = 0;
+};
+
+enum class PictureType
+{
+    Unknown,
+    I,
+    P,
+    B,
+};
+
+// H.264: picture type from the first slice of the access unit
+PictureType h264_picture_type(const NalUnit &nal, bool &found) noexcept
+{
+    auto const type = nal.h264Type();
+    if (type == 5) { // IDR
+        found = true;
+        return PictureType::I;
+    }
+    if (type != 1 || nal.size() < 2)
+        return PictureType::Unknown;
+
+    found = true;
+    RbspReader rd{nal.data.data() + 1, nal.data.data() + nal.size()};
+    uint32_t firstMb, sliceType;
+    if (!rd.ue(firstMb) || !rd.ue(sliceType))
+        return PictureType::Unknown;
+    switch (sliceType % 5) {
+        case 0: // P
+        case 3: // SP
+            return PictureType::P;
+        case 1:
+            return PictureType::B;
+        case 2: // I
+        case 4: // SI
+            return PictureType::I;
+    }
+    return PictureType::Unknown;
+}
+
+// HEVC: store num_extra_slice_header_bits of the PPS, it is needed to reach slice_type
+void hevc_parse_pps(const NalUnit &nal, std::array<uint8_t, 64> &extraBits) noexcept
+{
+    if (nal.size() < 3)
+        return;
+    RbspReader rd{nal.data.data() + 2, nal.data.data() + nal.size()};
+    uint32_t ppsId, spsId, numExtraBits;
+    if (!rd.ue(ppsId) || !rd.ue(spsId) || ppsId >= extraBits.size())
+        return;
+    // dependent_slice_segments_enabled_flag, output_flag_present_flag
+    if (!rd.skip(2) || !rd.bits(3, numExtraBits))
+        return;
+    extraBits[ppsId] = uint8_t(numExtraBits);
+}
+
+PictureType hevc_picture_type(const NalUnit &nal, const std::array<uint8_t, 64> &extraBits, bool &found) noexcept
+{
+    auto const type = nal.hevcType();
+    if (type > 31 || nal.size() < 3) // not a VCL
+        return PictureType::Unknown;
+
+    if (type >= 16 && type <= 23) { // IRAP
+        found = true;
+        return PictureType::I;
+    }
+
+    RbspReader rd{nal.data.data() + 2, nal.data.data() + nal.size()};
+    uint32_t firstSliceInPic, ppsId, sliceType;
+    if (!rd.bit(firstSliceInPic))
+        return PictureType::Unknown;
+    // Non-first slice segments require SPS/PPS to reach slice type: wait for the first one
+    if (!firstSliceInPic)
+        return PictureType::Unknown;
+
+    found = true;
+    if (!rd.ue(ppsId) || ppsId >= extraBits.size())
+        return PictureType::Unknown;
+    if (!rd.skip(extraBits[ppsId]) || !rd.ue(sliceType))
+        return PictureType::Unknown;
+    switch (sliceType) {
+        case 0: return PictureType::B;
+        case 1: return PictureType::P;
+        case 2: return PictureType::I;
+    }
+    return PictureType::Unknown;
+}
+
+template<typename Proc>
+void for_each_nal(std::span<const uint8_t> data, int lengthSize, Proc &&proc)
+{
+    if (isAnnexB(data)) {
+        for (auto const &nal : AnnexBNalUnits{data}) {
+            if (!proc(nal))
+                return;
+        }
+    } else {
+        for (auto const &nal : LengthPrefixedNalUnits{data, lengthSize}) {
+            if (!proc(nal))
+                return;
+        }
+    }
+}
+
+// hvcC: iterate parameter sets arrays
+template<typename Proc>
+void for_each_hvcc_nal(std::span<const uint8_t> extradata, Proc &&proc)
+{
+    if (extradata.size() < 23)
+        return;
+    auto p = extradata.data() + 22;
+    auto const end = extradata.data() + extradata.size();
+    auto const numArrays = *p++;
+    for (unsigned i = 0; i < numArrays; ++i) {
+        if (end - p < 3)
+            return;
+        p += 1; // array_completeness, NAL_unit_type
+        auto const numNalus = (p[0] << 8) | p[1];
+        p += 2;
+        for (int j = 0; j < numNalus; ++j) {
+            if (end - p < 2)
+                return;
+            auto const len = size_t((p[0] << 8) | p[1]);
+            p += 2;
+            if (size_t(end - p) < len)
+                return;
+            proc(NalUnit{{p, len}, 2});
+            p += len;
+        }
+    }
+}
+
+double to_seconds(int64_t ts, const Rational &tb) noexcept
+{
+    return double(ts) * tb.getNumerator() / tb.getDenominator();
+}
+
+} // anonymous namespace
+
+uint64_t StreamSummary::packetSizePercentile(double percentile) const noexcept
+{
+    if (!packets)
+        return 0;
+    percentile = std::clamp(percentile, 0.0, 1.0);
+    auto const target = uint64_t(double(packets) * percentile);
+    uint64_t accum = 0;
+    for (size_t i = 0; i < sizeHistogram.size(); ++i) {
+        accum += sizeHistogram[i];
+        if (accum > target || accum == packets)
+            return i == 0 ? 0 : std::min(maxPacketSize, (uint64_t(1) << i) - 1);
+    }
+    return maxPacketSize;
+}
+
+#if AVCPP_HAS_AVFORMAT
+StreamAnalyzer::StreamAnalyzer(FormatContext &ctx)
+{
+    for (size_t i = 0; i < ctx.streamsCount(); ++i)
+        addStream(ctx.stream(i));
+}
+
+void StreamAnalyzer::addStream(const Stream &st)
+{
+    if (st.isNull())
+        return;
+    auto const par = st.codecParameters();
+    std::span<const uint8_t> extradata;
+    if (par.isValid() && par.raw()->extradata && par.raw()->extradata_size > 0)
+        extradata = {par.raw()->extradata, size_t(par.raw()->extradata_size)};
+    addStream(st.index(), st.mediaType(), par.isValid() ? par.codecId() : AV_CODEC_ID_NONE, st.timeBase(), extradata);
+}
+#endif // if AVCPP_HAS_AVFORMAT
+
+void StreamAnalyzer::addStream(int index, AVMediaType type, AVCodecID codecId, const Rational &timeBase, std::span<const uint8_t> extradata)
+{
+    if (index < 0)
+        return;
+
+    auto &st = state(index);
+    st.summary.mediaType = type;
+    st.summary.codecId   = codecId;
+    st.summary.timeBase  = timeBase;
+
+    if (extradata.empty())
+        return;
+
+    if (codecId == AV_CODEC_ID_H264 || codecId == AV_CODEC_ID_HEVC) {
+        const bool hevc = codecId == AV_CODEC_ID_HEVC;
+        if (auto lengthSize = nalLengthSizeFromExtradata(extradata, hevc))
+            st.nalLengthSize = lengthSize;
+
+        if (hevc) {
+            auto parsePps = [&st](const NalUnit &nal) {
+                if (nal.hevcType() == 34)
+                    hevc_parse_pps(nal, st.hevcExtraSliceHeaderBits);
+                return true;
+            };
+            if (isAnnexB(extradata))
+                for_each_nal(extradata, 4, parsePps);
+            else
+                for_each_hvcc_nal(extradata, parsePps);
+        }
+    }
+}
+
+void StreamAnalyzer::setBitrateSeries(bool enable) noexcept
+{
+    m_bitrateSeries = enable;
+}
+
+void StreamAnalyzer::setPictureTypeDetection(bool enable) noexcept
+{
+    m_pictureTypes = enable;
+}
+
+StreamAnalyzer::State &StreamAnalyzer::state(int index)
+{
+    if (size_t(index) >= m_streams.size())
+        m_streams.resize(size_t(index) + 1);
+    auto &st = m_streams[size_t(index)];
+    if (!st.registered) {
+        st.registered = true;
+        st.summary.streamIndex = index;
+    }
+    return st;
+}
+
+void StreamAnalyzer::closeGop(State &st) noexcept
+{
+    if (!st.currentGop)
+        return;
+    auto &sum = st.summary;
+    sum.minGop = sum.gops ? std::min(sum.minGop, st.currentGop) : st.currentGop;
+    sum.maxGop = std::max(sum.maxGop, st.currentGop);
+    sum.avgGop += double(st.currentGop); // sum for now, averaged in the summary()
+    ++sum.gops;
+    st.currentGop = 0;
+}
+
+void StreamAnalyzer::push(const Packet &packet)
+{
+    auto const index = packet.streamIndex();
+    if (index < 0)
+        return;
+
+    auto &st = state(index);
+    auto &sum = st.summary;
+
+    // Sizes
+    auto const size = uint64_t(packet.size());
+    sum.minPacketSize = sum.packets ? std::min(sum.minPacketSize, size) : size;
+    sum.maxPacketSize = std::max(sum.maxPacketSize, size);
+    sum.bytes += size;
+    ++sum.packets;
+    sum.sizeHistogram[std::min<size_t>(std::bit_width(size), sum.sizeHistogram.size() - 1)]++;
+
+    // Timestamps: prefer DTS, it is monotonic
+    auto const raw = packet.raw();
+    auto const tb  = packet.timeBase() != Rational() ? packet.timeBase() : sum.timeBase;
+    auto const ts  = raw->dts != av::NoPts ? raw->dts : raw->pts;
+
+    const bool hasTime = ts != av::NoPts && tb.getDenominator() != 0 && tb.getNumerator() != 0;
+    double sec = 0.0;
+    if (hasTime) {
+        sec = to_seconds(ts, tb);
+        if (st.firstTs == av::NoPts) {
+            st.firstTs = ts;
+            st.lastTs  = ts;
+        }
+
+        auto const first = to_seconds(st.firstTs, tb);
+        auto const last  = to_seconds(st.lastTs, tb);
+        if (sec >= last) {
+            st.lastTs = ts;
+            st.lastDuration = raw->duration;
+        }
+
+        auto const duration = to_seconds(st.lastTs, tb) - first + to_seconds(st.lastDuration, tb);
+        sum.duration = std::max(sum.duration, duration);
+
+        // Broken timestamp jumps must not grow the series without limit
+        auto const offset = std::max(0.0, sec - first);
+        if (offset < double(MaxBitrateSeconds)) {
+            auto const second = size_t(offset);
+            if (second >= st.bytesPerSecond.size())
+                st.bytesPerSecond.resize(second + 1);
+            st.bytesPerSecond[second] += size;
+        } else {
+            ++sum.outOfRangePackets;
+        }
+    }
+
+    // Key frames and GOP
+    if (packet.isKeyPacket()) {
+        ++sum.keyPackets;
+        if (hasTime) {
+            if (st.lastKeyTs != av::NoPts) {
+                auto const interval = sec - to_seconds(st.lastKeyTs, tb);
+                sum.minKeyInterval = st.keyIntervals ? std::min(sum.minKeyInterval, interval) : interval;
+                sum.maxKeyInterval = std::max(sum.maxKeyInterval, interval);
+                st.keyIntervalSum += interval;
+                ++st.keyIntervals;
+            }
+            st.lastKeyTs = ts;
+        }
+        closeGop(st);
+    }
+    ++st.currentGop;
+
+    if (m_pictureTypes && (sum.codecId == AV_CODEC_ID_H264 || sum.codecId == AV_CODEC_ID_HEVC))
+        detectPictureType(st, packet);
+}
+
+void StreamAnalyzer::detectPictureType(State &st, const Packet &packet) noexcept
+{
+    auto &sum = st.summary;
+    auto type = PictureType::Unknown;
+    bool found = false;
+
+    if (sum.codecId == AV_CODEC_ID_H264) {
+        for_each_nal(packet.span(), st.nalLengthSize, [&](const NalUnit &nal) {
+            type = h264_picture_type(nal, found);
+            return !found;
+        });
+    } else {
+        for_each_nal(packet.span(), st.nalLengthSize, [&](const NalUnit &nal) {
+            if (nal.hevcType() == 34) {
+                hevc_parse_pps(nal, st.hevcExtraSliceHeaderBits);
+                return true;
+            }
+            type = hevc_picture_type(nal, st.hevcExtraSliceHeaderBits, found);
+            return !found;
+        });
+    }
+
+    switch (type) {
+        case PictureType::I: ++sum.iPictures; break;
+        case PictureType::P: ++sum.pPictures; break;
+        case PictureType::B: ++sum.bPictures; break;
+        default:             ++sum.unknownPictures; break;
+    }
+}
+
+StreamSummary StreamAnalyzer::summary(int streamIndex) const
+{
+    if (streamIndex < 0 || size_t(streamIndex) >= m_streams.size() || !m_streams[size_t(streamIndex)].registered)
+        return {};
+
+    // Finalize on the copy: statistics can be continued after
+    auto st = m_streams[size_t(streamIndex)];
+    closeGop(st);
+
+    auto &sum = st.summary;
+    if (sum.gops)
+        sum.avgGop /= double(sum.gops);
+    if (st.keyIntervals)
+        sum.avgKeyInterval = st.keyIntervalSum / double(st.keyIntervals);
+    if (sum.packets)
+        sum.avgPacketSize = double(sum.bytes) / double(sum.packets);
+    if (sum.duration > 0.0)
+        sum.avgBitrate = double(sum.bytes) * 8.0 / sum.duration;
+
+    if (!st.bytesPerSecond.empty()) {
+        // Last second usually incomplete: exclude it from min/max if there are complete ones
+        auto const complete = st.bytesPerSecond.size() > 1 ? st.bytesPerSecond.size() - 1 : 1;
+        auto const [minIt, maxIt] = std::minmax_element(st.bytesPerSecond.begin(), st.bytesPerSecond.begin() + ptrdiff_t(complete));
+        sum.minBitrate = double(*minIt) * 8.0;
+        sum.maxBitrate = double(*maxIt) * 8.0;
+
+        if (m_bitrateSeries) {
+            sum.bitrateSeries.resize(st.bytesPerSecond.size());
+            std::transform(st.bytesPerSecond.begin(), st.bytesPerSecond.end(), sum.bitrateSeries.begin(),
+                           [](uint64_t bytes) { return bytes * 8; });
+        }
+    }
+
+    return std::move(sum);
+}
+
+std::vector<StreamSummary> StreamAnalyzer::summary() const
+{
+    vector<StreamSummary> result;
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        if (m_streams[i].registered)
+            result.push_back(summary(int(i)));
+    }
+    return result;
+}
+
+void StreamAnalyzer::reset() noexcept
+{
+    for (auto &st : m_streams) {
+        if (!st.registered)
+            continue;
+        State fresh;
+        fresh.registered = true;
+        fresh.summary.streamIndex = st.summary.streamIndex;
+        fresh.summary.mediaType   = st.summary.mediaType;
+        fresh.summary.codecId     = st.summary.codecId;
+        fresh.summary.timeBase    = st.summary.timeBase;
+        fresh.nalLengthSize       = st.nalLengthSize;
+        fresh.hevcExtraSliceHeaderBits = st.hevcExtraSliceHeaderBits;
+        st = std::move(fresh);
+    }
+}
+
+#if AVCPP_HAS_AVFORMAT
+std::vector<StreamSummary> StreamAnalyzer::analyze(FormatContext &ctx, OptionalErrorCode ec)
+{
+    clear_if(ec);
+    StreamAnalyzer analyzer{ctx};
+    while (true) {
+        auto pkt = ctx.readPacket(ec);
+        if (is_error(ec))
+            return {};
+        if (!pkt)
+            break;
+        analyzer.push(pkt);
+    }
+    return analyzer.summary();
+}
+#endif // if AVCPP_HAS_AVFORMAT
+
+} // namespace av
+
+#endif // AVCPP_CXX_STANDARD >= 20
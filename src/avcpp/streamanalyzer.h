@@ -0,0 +1,195 @@
+#pragma once
+
+#include "avcompat.h"
+
+#if AVCPP_CXX_STANDARD >= 20
+
+#include <array>
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#include "ffmpeg.h"
+#include "rational.h"
+#include "packet.h"
+#include "averror.h"
+
+#if AVCPP_HAS_AVFORMAT
+#include "stream.h"
+#include "formatcontext.h"
+#endif // if AVCPP_HAS_AVFORMAT
+
+namespace av {
+
+/**
+ * Compact statistics of the single stream collected by StreamAnalyzer.
+ *
+ * Times are in seconds, bitrates in bits per second, sizes in bytes, GOP lengths in packets.
+ */
+struct StreamSummary
+{
+    static constexpr size_t SizeHistogramBuckets = 32;
+
+    int         streamIndex = -1;
+    AVMediaType mediaType   = AVMEDIA_TYPE_UNKNOWN;
+    AVCodecID   codecId     = AV_CODEC_ID_NONE;
+    Rational    timeBase;
+
+    uint64_t packets    = 0;
+    uint64_t keyPackets = 0;
+    uint64_t bytes      = 0;
+    double   duration   = 0.0;
+
+    // GOP: count of packets between key packets, incomplete leading and trailing GOPs included
+    uint64_t gops      = 0;
+    uint64_t minGop    = 0;
+    uint64_t maxGop    = 0;
+    double   avgGop    = 0.0;
+
+    // Time between consecutive key packets
+    double minKeyInterval = 0.0;
+    double maxKeyInterval = 0.0;
+    double avgKeyInterval = 0.0;
+
+    // Per-second bitrate
+    double avgBitrate = 0.0;
+    double minBitrate = 0.0; ///< over all complete seconds
+    double maxBitrate = 0.0;
+    std::vector<uint64_t> bitrateSeries; ///< bits per every second from the stream start, if enabled
+    uint64_t outOfRangePackets = 0;      ///< packets after StreamAnalyzer::MaxBitrateSeconds, not in the bitrate
+
+    // Packets sizes
+    uint64_t minPacketSize = 0;
+    uint64_t maxPacketSize = 0;
+    double   avgPacketSize = 0.0;
+    /// Log2 buckets: bucket N counts packets with size in the range [2^(N-1), 2^N), bucket 0 - empty packets
+    std::array<uint64_t, SizeHistogramBuckets> sizeHistogram{};
+
+    // Picture types detected from H.264/HEVC slice headers
+    uint64_t iPictures       = 0;
+    uint64_t pPictures       = 0;
+    uint64_t bPictures       = 0;
+    uint64_t unknownPictures = 0;
+
+    /**
+     * Approximate packet size percentile from the size histogram: returns upper bound of the bucket.
+     * @param percentile  value in range [0, 1]
+     */
+    uint64_t packetSizePercentile(double percentile) const noexcept;
+};
+
+/**
+ * @brief The StreamAnalyzer class
+ *
+ * Collects GOP, key frame interval, bitrate and packet size statistics incrementally, from packet flags, sizes and
+ * timestamps only, without decoding. For H.264 and HEVC picture types are detected from the slice headers.
+ *
+ * @code
+ * StreamAnalyzer analyzer{ictx};
+ * while (auto pkt = ictx.readPacket())
+ *     analyzer.push(pkt);
+ * for (auto const &summary : analyzer.summary())
+ *     ...
+ * @endcode
+ */
+class StreamAnalyzer
+{
+public:
+    /// Length of the per-second bitrate window from the first timestamp: guards against broken timestamp jumps
+    static constexpr size_t MaxBitrateSeconds = 24 * 3600;
+
+    StreamAnalyzer() = default;
+
+#if AVCPP_HAS_AVFORMAT
+    /**
+     * Register all streams of the opened input format context
+     */
+    explicit StreamAnalyzer(FormatContext &ctx);
+
+    void addStream(const Stream &st);
+#endif // if AVCPP_HAS_AVFORMAT
+
+    /**
+     * Register stream manually.
+     *
+     * @param index      stream index (Packet::streamIndex())
+     * @param type       media type
+     * @param codecId    codec id, used for picture type detection
+     * @param timeBase   time base of the packets without own time base
+     * @param extradata  codec extradata: NAL length size and HEVC PPS are taken from it
+     */
+    void addStream(int index, AVMediaType type, AVCodecID codecId, const Rational &timeBase,
+                   std::span<const uint8_t> extradata = {});
+
+    /**
+     * Enable or disable per-second bitrate series collection. Enabled by default.
+     */
+    void setBitrateSeries(bool enable) noexcept;
+
+    /**
+     * Enable or disable picture type detection for H.264/HEVC. Enabled by default.
+     */
+    void setPictureTypeDetection(bool enable) noexcept;
+
+    /**
+     * Account packet. Packets of unregistered streams are registered with unknown media type on the fly.
+     */
+    void push(const Packet &packet);
+
+    /**
+     * Summary of the given stream. Empty summary returned for unknown streams.
+     */
+    StreamSummary summary(int streamIndex) const;
+
+    /**
+     * Summaries of all registered streams
+     */
+    std::vector<StreamSummary> summary() const;
+
+    void reset() noexcept;
+
+#if AVCPP_HAS_AVFORMAT
+    /**
+     * Read input till the end and return summaries.
+     */
+    static std::vector<StreamSummary> analyze(FormatContext &ctx, OptionalErrorCode ec = throws());
+#endif // if AVCPP_HAS_AVFORMAT
+
+private:
+    struct State
+    {
+        StreamSummary summary;
+        bool          registered = false;
+
+        // NAL parsing
+        int      nalLengthSize = 4;
+        std::array<uint8_t, 64> hevcExtraSliceHeaderBits{};
+
+        // Timestamps
+        int64_t  firstTs = av::NoPts;
+        int64_t  lastTs  = av::NoPts;
+        int64_t  lastKeyTs = av::NoPts;
+        int64_t  lastDuration = 0;
+        uint64_t keyIntervals = 0;
+        double   keyIntervalSum = 0.0;
+
+        // GOP
+        uint64_t currentGop = 0;
+
+        // Bitrate
+        std::vector<uint64_t> bytesPerSecond;
+    };
+
+    State& state(int index);
+    static void closeGop(State &st) noexcept;
+    void   detectPictureType(State &st, const Packet &packet) noexcept;
+
+private:
+    std::vector<State> m_streams;
+    bool m_bitrateSeries = true;
+    bool m_pictureTypes  = true;
+};
+
+} // namespace av
+
+#endif // AVCPP_CXX_STANDARD >= 20
@@ -0,0 +1,584 @@
+#include "syntheticmedia.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "codec.h"
+#include "codeccontext.h"
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+constexpr uint64_t NoiseSalt = 0x6e6f697365ull;
+constexpr double   Pi        = 3.14159265358979323846;
+
+// Gradient period: luma goes 16..235..16 without hard edges
+constexpr int GradientRange  = 219;
+constexpr int GradientPeriod = GradientRange * 2;
+
+uint64_t splitmix64(uint64_t value) noexcept
+{
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+uint64_t mix(uint64_t seed, uint64_t value) noexcept
+{
+    return splitmix64(seed ^ splitmix64(value));
+}
+
+// std:: engines are portable, distributions are not: keep own tiny generator for the reproducible content
+class Random
+{
+public:
+    explicit Random(uint64_t seed) noexcept
+        : m_state(seed)
+    {
+    }
+
+    uint64_t next() noexcept
+    {
+        return splitmix64(m_state++);
+    }
+
+    uint32_t below(uint32_t limit) noexcept
+    {
+        return uint32_t(next() % limit);
+    }
+
+    uint8_t byte() noexcept
+    {
+        if (!m_bytesLeft) {
+            m_bytes     = next();
+            m_bytesLeft = sizeof(m_bytes);
+        }
+        --m_bytesLeft;
+        auto const out = uint8_t(m_bytes);
+        m_bytes >>= 8;
+        return out;
+    }
+
+private:
+    uint64_t m_state;
+    uint64_t m_bytes     = 0;
+    size_t   m_bytesLeft = 0;
+};
+
+uint8_t clamp_byte(int value) noexcept
+{
+    return uint8_t(std::clamp(value, 0, 255));
+}
+
+// [-1, 1)
+double noise_sample(uint64_t seed, uint64_t position) noexcept
+{
+    return double(mix(seed ^ NoiseSalt, position) >> 11) * (2.0 / double(1ull << 53)) - 1.0;
+}
+
+bool store_sample(uint8_t *dst, SampleFormat packedFormat, double value) noexcept
+{
+    switch (packedFormat.get()) {
+        case AV_SAMPLE_FMT_U8: {
+            *dst = uint8_t(lrint(value * 127.0) + 128);
+            return true;
+        }
+        case AV_SAMPLE_FMT_S16: {
+            auto const sample = int16_t(lrint(value * numeric_limits<int16_t>::max()));
+            memcpy(dst, &sample, sizeof(sample));
+            return true;
+        }
+        case AV_SAMPLE_FMT_S32: {
+            auto const sample = int32_t(llrint(value * numeric_limits<int32_t>::max()));
+            memcpy(dst, &sample, sizeof(sample));
+            return true;
+        }
+        case AV_SAMPLE_FMT_FLT: {
+            auto const sample = float(value);
+            memcpy(dst, &sample, sizeof(sample));
+            return true;
+        }
+        case AV_SAMPLE_FMT_DBL: {
+            memcpy(dst, &value, sizeof(value));
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+} // anonymous namespace
+
+//
+// SyntheticVideo
+//
+
+SyntheticVideo::SyntheticVideo()
+    : SyntheticVideo(Options{})
+{
+}
+
+SyntheticVideo::SyntheticVideo(const Options &options)
+    : m_options(options)
+{
+    m_options.noise = std::clamp(m_options.noise, 0.0, 1.0);
+}
+
+VideoFrame SyntheticVideo::frame(size_t index, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (m_options.width <= 0 || m_options.height <= 0 ||
+        m_options.frameRate.getNumerator() <= 0 || m_options.frameRate.getDenominator() <= 0) {
+        throws_if(ec, Errors::InvalidArgument);
+        return VideoFrame();
+    }
+
+    VideoFrame out{AV_PIX_FMT_YUV420P, m_options.width, m_options.height};
+    if (!out.isValid()) {
+        throws_if(ec, Errors::CantAllocateFrame);
+        return VideoFrame();
+    }
+    draw(out, index);
+
+    if (m_options.pixelFormat != AV_PIX_FMT_YUV420P) {
+        VideoFrame converted{m_options.pixelFormat, m_options.width, m_options.height};
+        if (!converted.isValid()) {
+            throws_if(ec, Errors::CantAllocateFrame);
+            return VideoFrame();
+        }
+        m_rescaler.rescale(converted, out, ec);
+        if (is_error(ec))
+            return VideoFrame();
+        out = std::move(converted);
+    }
+
+    Rational const timeBase{m_options.frameRate.getDenominator(), m_options.frameRate.getNumerator()};
+    out.setTimeBase(timeBase);
+    out.setPts(Timestamp{int64_t(index), timeBase});
+    out.setComplete(true);
+    return out;
+}
+
+VideoFrame SyntheticVideo::next(OptionalErrorCode ec)
+{
+    auto out = frame(m_position, ec);
+    if (out)
+        ++m_position;
+    return out;
+}
+
+bool SyntheticVideo::isSceneCut(size_t index) const noexcept
+{
+    return m_options.pattern == Pattern::Gradient && m_options.sceneLength && index && index % m_options.sceneLength == 0;
+}
+
+void SyntheticVideo::draw(VideoFrame &frame, size_t index) const
+{
+    auto const width        = m_options.width;
+    auto const height       = m_options.height;
+    auto const chromaWidth  = (width + 1) / 2;
+    auto const chromaHeight = (height + 1) / 2;
+    auto const raw          = frame.raw();
+
+    Random noise{mix(m_options.seed ^ NoiseSalt, index)};
+
+    if (m_options.pattern == Pattern::Noise) {
+        for (size_t plane = 0; plane < 3; ++plane) {
+            auto const w = plane ? chromaWidth : width;
+            auto const h = plane ? chromaHeight : height;
+            for (int y = 0; y < h; ++y) {
+                auto line = raw->data[plane] + ptrdiff_t(y) * raw->linesize[plane];
+                for (int x = 0; x < w; ++x)
+                    line[x] = noise.byte();
+            }
+        }
+        return;
+    }
+
+    // Scene parameters: constant till the next scene cut
+    auto const scene = m_options.sceneLength ? index / m_options.sceneLength : 0;
+    auto const time  = int64_t(m_options.sceneLength ? index % m_options.sceneLength : index);
+    Random params{mix(m_options.seed, scene)};
+    auto const dx    = int64_t(1 + params.below(4));
+    auto const dy    = int64_t(params.below(4));
+    auto const speed = int64_t(1 + params.below(8));
+    auto const phase = int64_t(params.below(GradientPeriod));
+    auto const baseU = int(64 + params.below(128));
+    auto const baseV = int(64 + params.below(128));
+
+    auto const amount = int(lrint(m_options.noise * 256));
+
+    for (int y = 0; y < height; ++y) {
+        auto line = raw->data[0] + ptrdiff_t(y) * raw->linesize[0];
+        for (int x = 0; x < width; ++x) {
+            auto value = int((x * dx + y * dy + time * speed + phase) % GradientPeriod);
+            if (value > GradientRange)
+                value = GradientPeriod - value;
+            value += 16;
+            if (amount)
+                value += (int(noise.byte()) - 128) * amount / 256;
+            line[x] = clamp_byte(value);
+        }
+    }
+
+    for (int y = 0; y < chromaHeight; ++y) {
+        auto lineU = raw->data[1] + ptrdiff_t(y) * raw->linesize[1];
+        auto lineV = raw->data[2] + ptrdiff_t(y) * raw->linesize[2];
+        for (int x = 0; x < chromaWidth; ++x) {
+            lineU[x] = clamp_byte(baseU + x * 64 / chromaWidth - 32);
+            lineV[x] = clamp_byte(baseV + y * 64 / chromaHeight - 32);
+        }
+    }
+}
+
+//
+// SyntheticAudio
+//
+
+SyntheticAudio::SyntheticAudio()
+    : SyntheticAudio(Options{})
+{
+}
+
+SyntheticAudio::SyntheticAudio(const Options &options)
+    : m_options(options)
+{
+    m_options.amplitude = std::clamp(m_options.amplitude, 0.0, 1.0);
+}
+
+AudioSamples SyntheticAudio::samples(size_t offset, int count, OptionalErrorCode ec) const
+{
+    clear_if(ec);
+
+    if (count <= 0 || m_options.sampleRate <= 0) {
+        throws_if(ec, Errors::InvalidArgument);
+        return AudioSamples();
+    }
+
+    AudioSamples out{m_options.sampleFormat, count, m_options.channelLayout, m_options.sampleRate};
+    if (!out.isValid()) {
+        throws_if(ec, Errors::CantAllocateFrame);
+        return AudioSamples();
+    }
+
+    auto const format   = m_options.sampleFormat;
+    auto const packed   = format.packedSampleFormat();
+    auto const planar   = format.isPlanar();
+    auto const bytes    = packed.bytesPerSample(ec);
+    auto const channels = out.channelsCount();
+    if (is_error(ec))
+        return AudioSamples();
+
+    for (int ch = 0; ch < channels; ++ch) {
+        auto const frequency = m_options.frequency * (ch + 1);
+        auto dst = planar ? out.data(size_t(ch)) : out.data() + size_t(ch) * bytes;
+        auto const step = planar ? bytes : bytes * size_t(channels);
+
+        for (int i = 0; i < count; ++i, dst += step) {
+            auto const position = uint64_t(offset) + uint64_t(i);
+            double value = 0.0;
+            switch (m_options.signal) {
+                case Signal::Tone: {
+                    // Phase from the absolute position: no drift on long runs
+                    auto const cycles = fmod(frequency * double(position) / m_options.sampleRate, 1.0);
+                    value = m_options.amplitude * sin(2.0 * Pi * cycles);
+                    break;
+                }
+                case Signal::Noise:
+                    value = m_options.amplitude * noise_sample(m_options.seed, position * uint64_t(channels) + uint64_t(ch));
+                    break;
+                case Signal::Silence:
+                    break;
+            }
+
+            if (!store_sample(dst, packed, value)) {
+                throws_if(ec, Errors::InvalidArgument);
+                return AudioSamples();
+            }
+        }
+    }
+
+    Rational const timeBase{1, m_options.sampleRate};
+    out.setTimeBase(timeBase);
+    out.setPts(Timestamp{int64_t(offset), timeBase});
+    out.setComplete(true);
+    return out;
+}
+
+AudioSamples SyntheticAudio::next(OptionalErrorCode ec)
+{
+    auto out = samples(m_position, m_options.frameSize, ec);
+    if (out)
+        m_position += size_t(m_options.frameSize);
+    return out;
+}
+
+#if AVCPP_HAS_AVFORMAT
+
+//
+// MemoryIO
+//
+
+MemoryIO::MemoryIO(std::vector<uint8_t> data)
+    : m_data(std::move(data))
+{
+}
+
+std::vector<uint8_t> MemoryIO::release() noexcept
+{
+    m_pos = 0;
+    return std::exchange(m_data, {});
+}
+
+int MemoryIO::write(const uint8_t *data, size_t size)
+{
+    if (m_pos + size > m_data.size())
+        m_data.resize(m_pos + size);
+    memcpy(m_data.data() + m_pos, data, size);
+    m_pos += size;
+    return 0;
+}
+
+int MemoryIO::read(uint8_t *data, size_t size)
+{
+    if (m_pos >= m_data.size())
+        return AVERROR_EOF;
+    auto const count = std::min(size, m_data.size() - m_pos);
+    memcpy(data, m_data.data() + m_pos, count);
+    m_pos += count;
+    return int(count);
+}
+
+int64_t MemoryIO::seek(int64_t offset, int whence)
+{
+    if (whence & AVSEEK_SIZE)
+        return int64_t(m_data.size());
+
+    int64_t base = 0;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = int64_t(m_pos); break;
+        case SEEK_END: base = int64_t(m_data.size()); break;
+        default:
+            return AVERROR(EINVAL);
+    }
+
+    // Writer may seek past the end: gap is filled by the next write
+    auto const next = base + offset;
+    if (next < 0)
+        return AVERROR(EINVAL);
+    m_pos = size_t(next);
+    return next;
+}
+
+int MemoryIO::seekable() const
+{
+    return AVIO_SEEKABLE_NORMAL;
+}
+
+const char *MemoryIO::name() const
+{
+    return "MemoryIO";
+}
+
+//
+// SyntheticMedia
+//
+
+namespace {
+
+// Send frame (null one flushes) and write all ready packets
+template<typename Encoder, typename Frame>
+bool encode_and_write(Encoder &enc, const Frame &frame, FormatContext &octx, int streamIndex, std::error_code &err)
+{
+    auto pkt = enc.tryEncode(frame);
+    while (pkt.isOk()) {
+        pkt->setStreamIndex(streamIndex);
+        auto written = octx.tryWritePacket(*pkt);
+        if (written.isError()) {
+            err = written.error();
+            return false;
+        }
+        pkt = enc.tryEncode();
+    }
+    if (pkt.isError()) {
+        err = pkt.error();
+        return false;
+    }
+    return true;
+}
+
+template<typename T, typename List>
+T supported_or_first(T requested, const List &supported)
+{
+    if (supported.empty() || std::find(supported.begin(), supported.end(), requested) != supported.end())
+        return requested;
+    return supported.front();
+}
+
+} // anonymous namespace
+
+void SyntheticMedia::generate(CustomIO *io, const Options &options, OptionalErrorCode ec)
+{
+    clear_if(ec);
+
+    if (!io || (!options.hasVideo && !options.hasAudio) || options.duration.count() <= 0) {
+        throws_if(ec, Errors::InvalidArgument);
+        return;
+    }
+
+    OutputFormat ofmt{options.format};
+    if (ofmt.isNull()) {
+        throws_if(ec, Errors::FormatNullOutputFormat);
+        return;
+    }
+
+    FormatContext octx;
+    octx.setFormat(ofmt);
+    auto const globalHeader = ofmt.isFlags(AVFMT_GLOBALHEADER) ? AV_CODEC_FLAG_GLOBAL_HEADER : 0;
+    auto const seconds      = chrono::duration<double>(options.duration).count();
+
+    std::error_code err;
+    auto const failed = [&err, &ec] {
+        if (!err)
+            return false;
+        throws_if(ec, err.value(), err.category());
+        return true;
+    };
+
+    // Video
+    SyntheticVideo::Options videoOptions = options.video;
+    VideoEncoderContext     venc;
+    int                     videoStream = -1;
+    size_t                  videoFrames = 0;
+    if (options.hasVideo) {
+        Codec codec = findEncodingCodec(options.videoCodec);
+        if (codec.isNull()) {
+            throws_if(ec, Errors::CodecInvalid);
+            return;
+        }
+
+        videoOptions.pixelFormat = supported_or_first(videoOptions.pixelFormat, codec.supportedPixelFormats());
+        Rational const timeBase{videoOptions.frameRate.getDenominator(), videoOptions.frameRate.getNumerator()};
+
+        venc = VideoEncoderContext{codec};
+        venc.setWidth(videoOptions.width);
+        venc.setHeight(videoOptions.height);
+        venc.setPixelFormat(videoOptions.pixelFormat);
+        venc.setTimeBase(timeBase);
+        venc.setBitRate(options.videoBitRate);
+        venc.setGopSize(options.gopSize);
+        venc.addFlags(globalHeader);
+        venc.open(err);
+        if (failed())
+            return;
+
+        auto st = octx.addStream(venc, err);
+        if (failed())
+            return;
+        st.setFrameRate(videoOptions.frameRate);
+        st.setAverageFrameRate(videoOptions.frameRate);
+        st.setTimeBase(timeBase);
+        videoStream = st.index();
+        videoFrames = size_t(ceil(seconds * videoOptions.frameRate.getDouble()));
+    }
+
+    // Audio
+    SyntheticAudio::Options audioOptions = options.audio;
+    AudioEncoderContext     aenc;
+    int                     audioStream = -1;
+    size_t                  audioFrames = 0;
+    if (options.hasAudio) {
+        Codec codec = findEncodingCodec(options.audioCodec);
+        if (codec.isNull()) {
+            throws_if(ec, Errors::CodecInvalid);
+            return;
+        }
+
+        audioOptions.sampleFormat  = supported_or_first(audioOptions.sampleFormat, codec.supportedSampleFormats());
+        audioOptions.sampleRate    = supported_or_first(audioOptions.sampleRate, codec.supportedSamplerates());
+        audioOptions.channelLayout = supported_or_first(audioOptions.channelLayout, codec.supportedChannelLayouts());
+
+        aenc = AudioEncoderContext{codec};
+        aenc.setSampleRate(audioOptions.sampleRate);
+        aenc.setSampleFormat(audioOptions.sampleFormat);
+        aenc.setChannelLayout(audioOptions.channelLayout);
+        aenc.setTimeBase(Rational{1, audioOptions.sampleRate});
+        aenc.setBitRate(options.audioBitRate);
+        aenc.addFlags(globalHeader);
+        aenc.open(err);
+        if (failed())
+            return;
+
+        // PCM-like encoders accept any frame size
+        if (aenc.frameSize() > 0)
+            audioOptions.frameSize = aenc.frameSize();
+
+        auto st = octx.addStream(aenc, err);
+        if (failed())
+            return;
+        st.setTimeBase(aenc.timeBase());
+        audioStream = st.index();
+        audioFrames = size_t(ceil(seconds * audioOptions.sampleRate / audioOptions.frameSize));
+    }
+
+    octx.openOutput(io, err);
+    if (failed())
+        return;
+    octx.writeHeader(err);
+    if (failed())
+        return;
+
+    // Feed streams in presentation order: muxer interleaving queue stays short
+    SyntheticVideo video{videoOptions};
+    SyntheticAudio audio{audioOptions};
+    size_t videoDone = 0;
+    size_t audioDone = 0;
+    while (videoDone < videoFrames || audioDone < audioFrames) {
+        auto const videoTime = videoDone < videoFrames ? double(videoDone) / videoOptions.frameRate.getDouble()
+                                                       : numeric_limits<double>::max();
+        auto const audioTime = audioDone < audioFrames ? double(audioDone * size_t(audioOptions.frameSize)) / audioOptions.sampleRate
+                                                       : numeric_limits<double>::max();
+        if (videoTime <= audioTime) {
+            auto frame = video.next(err);
+            if (failed() || !encode_and_write(venc, frame, octx, videoStream, err) || failed())
+                return;
+            ++videoDone;
+        } else {
+            auto samples = audio.next(err);
+            if (failed() || !encode_and_write(aenc, samples, octx, audioStream, err) || failed())
+                return;
+            ++audioDone;
+        }
+    }
+
+    // Flush
+    if (options.hasVideo && (!encode_and_write(venc, VideoFrame(nullptr), octx, videoStream, err) || failed()))
+        return;
+    if (options.hasAudio && (!encode_and_write(aenc, AudioSamples(nullptr), octx, audioStream, err) || failed()))
+        return;
+
+    octx.writeTrailer(err);
+    failed();
+}
+
+std::vector<uint8_t> SyntheticMedia::generate(const Options &options, OptionalErrorCode ec)
+{
+    MemoryIO io;
+    generate(&io, options, ec);
+    if (is_error(ec))
+        return {};
+    return io.release();
+}
+
+#endif // if AVCPP_HAS_AVFORMAT
+
+} // namespace av
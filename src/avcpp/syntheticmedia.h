@@ -0,0 +1,237 @@
+#pragma once
+
+#include "avcompat.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "averror.h"
+#include "frame.h"
+#include "videorescaler.h"
+
+#if AVCPP_HAS_AVFORMAT
+#include "formatcontext.h"
+#endif // if AVCPP_HAS_AVFORMAT
+
+namespace av {
+
+/**
+ * @brief The SyntheticVideo class
+ *
+ * Test pattern video generated in memory: inputs for tests and benchmarks without media files.
+ *
+ * Frame content depends only on the seed and frame index, so frames can be requested in any order and are the same
+ * from run to run and between platforms.
+ *
+ * - Pattern::Gradient: moving diagonal gradient with optional noise on top. Scene parameters (direction, speed,
+ *   colors) change every Options::sceneLength frames, that gives a hard scene cut for the encoder.
+ * - Pattern::Noise: uniform noise on all planes, the worst case for the encoder.
+ *
+ * Frames are drawn in YUV420P and converted when other pixel format is requested.
+ *
+ * @code
+ * SyntheticVideo::Options options;
+ * options.sceneLength = 100;
+ * SyntheticVideo video{options};
+ * auto frame = video.next();
+ * @endcode
+ */
+class SyntheticVideo
+{
+public:
+    enum class Pattern
+    {
+        Gradient,
+        Noise,
+    };
+
+    struct Options
+    {
+        int         width       = 640;
+        int         height      = 360;
+        PixelFormat pixelFormat = AV_PIX_FMT_YUV420P;
+        Rational    frameRate   = {25, 1};
+        Pattern     pattern     = Pattern::Gradient;
+        double      noise       = 0.05; ///< 0..1, amount of the noise added to the gradient
+        size_t      sceneLength = 0;    ///< frames between scene cuts, 0 - single scene
+        uint64_t    seed        = 1;
+    };
+
+    SyntheticVideo();
+    explicit SyntheticVideo(const Options &options);
+
+    const Options& options() const noexcept { return m_options; }
+
+    /**
+     * Frame with given index. Time base is the inverse of the frame rate, pts is the index.
+     */
+    VideoFrame frame(size_t index, OptionalErrorCode ec = throws());
+
+    /**
+     * Frame at position(), position is advanced
+     */
+    VideoFrame next(OptionalErrorCode ec = throws());
+
+    size_t position() const noexcept { return m_position; }
+    void   seek(size_t index) noexcept { m_position = index; }
+
+    bool isSceneCut(size_t index) const noexcept;
+
+private:
+    void draw(VideoFrame &frame, size_t index) const;
+
+private:
+    Options       m_options;
+    size_t        m_position = 0;
+    VideoRescaler m_rescaler;
+};
+
+/**
+ * @brief The SyntheticAudio class
+ *
+ * Test signal generated in memory: sine tone, white noise or silence. Like SyntheticVideo content depends only
+ * on the seed and the sample position.
+ *
+ * Tone of the channel N has frequency `Options::frequency * (N + 1)`, so channels can be told apart after remixing.
+ * Noise is independent for every channel.
+ */
+class SyntheticAudio
+{
+public:
+    enum class Signal
+    {
+        Tone,
+        Noise,
+        Silence,
+    };
+
+    struct Options
+    {
+        int          sampleRate    = 48000;
+        uint64_t     channelLayout = AV_CH_LAYOUT_STEREO;
+        SampleFormat sampleFormat  = AV_SAMPLE_FMT_FLTP;
+        int          frameSize     = 1024;  ///< samples per AudioSamples returned by next()
+        Signal       signal        = Signal::Tone;
+        double       frequency     = 440.0; ///< Hz
+        double       amplitude     = 0.5;   ///< 0..1 of the full scale
+        uint64_t     seed          = 1;
+    };
+
+    SyntheticAudio();
+    explicit SyntheticAudio(const Options &options);
+
+    const Options& options() const noexcept { return m_options; }
+
+    /**
+     * Samples starting from the given sample position. Time base is 1/sampleRate, pts is the position.
+     */
+    AudioSamples samples(size_t offset, int count, OptionalErrorCode ec = throws()) const;
+
+    /**
+     * Options::frameSize samples at position(), position is advanced
+     */
+    AudioSamples next(OptionalErrorCode ec = throws());
+
+    size_t position() const noexcept { return m_position; }
+    void   seek(size_t offset) noexcept { m_position = offset; }
+
+private:
+    Options m_options;
+    size_t  m_position = 0;
+};
+
+#if AVCPP_HAS_AVFORMAT
+
+/**
+ * @brief The MemoryIO class
+ *
+ * CustomIO over the memory buffer: write the muxer output into memory and read it back by the demuxer.
+ * Seek is supported, so muxers that update the header on the trailer work too.
+ */
+class MemoryIO : public CustomIO
+{
+public:
+    MemoryIO() = default;
+    explicit MemoryIO(std::vector<uint8_t> data);
+
+    const std::vector<uint8_t>& data() const noexcept { return m_data; }
+
+    /**
+     * Take the buffer, IO becomes empty
+     */
+    std::vector<uint8_t> release() noexcept;
+
+    /**
+     * Move position to the beginning: read the written data back
+     */
+    void rewind() noexcept { m_pos = 0; }
+
+    int         write(const uint8_t *data, size_t size) override;
+    int         read(uint8_t *data, size_t size) override;
+    int64_t     seek(int64_t offset, int whence) override;
+    int         seekable() const override;
+    const char* name() const override;
+
+private:
+    std::vector<uint8_t> m_data;
+    size_t               m_pos = 0;
+};
+
+/**
+ * @brief The SyntheticMedia class
+ *
+ * Encodes SyntheticVideo and SyntheticAudio with VideoEncoderContext/AudioEncoderContext and muxes them with any
+ * muxer into CustomIO. Benchmarks get demux/decode input at realistic bitrates without media files or network.
+ *
+ * Encoder parameters unsupported by the codec are replaced: first supported pixel and sample formats are used and
+ * the audio frame size is taken from the encoder.
+ *
+ * @code
+ * SyntheticMedia::Options options;
+ * options.duration = std::chrono::seconds(30);
+ * options.video.sceneLength = 120;
+ *
+ * MemoryIO io;
+ * SyntheticMedia::generate(&io, options);
+ * io.rewind();
+ *
+ * FormatContext ictx;
+ * ictx.openInput(&io);
+ * @endcode
+ */
+class SyntheticMedia
+{
+public:
+    struct Options
+    {
+        std::string               format   = "matroska";    ///< muxer short name
+        std::chrono::milliseconds duration = std::chrono::seconds(10);
+
+        bool                      hasVideo     = true;
+        SyntheticVideo::Options   video;
+        AVCodecID                 videoCodec   = AV_CODEC_ID_MPEG4;
+        int64_t                   videoBitRate = 2'000'000;
+        int                       gopSize      = 50;
+
+        bool                      hasAudio     = true;
+        SyntheticAudio::Options   audio;
+        AVCodecID                 audioCodec   = AV_CODEC_ID_AAC;
+        int64_t                   audioBitRate = 128'000;
+    };
+
+    /**
+     * Write the whole media into io. IO is not owned and is not rewound.
+     */
+    static void generate(CustomIO *io, const Options &options, OptionalErrorCode ec = throws());
+
+    /**
+     * Whole media in memory
+     */
+    static std::vector<uint8_t> generate(const Options &options, OptionalErrorCode ec = throws());
+};
+
+#endif // if AVCPP_HAS_AVFORMAT
+
+} // namespace av
@@ -0,0 +1,282 @@
+#include "tracing.h"
+#include "diagutils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <locale>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+using namespace std;
+
+namespace av {
+
+namespace {
+
+// Seqlock slot: the owner thread writes, collect() reads and validates by the sequence
+struct Slot
+{
+    atomic<uint64_t>    seq{0}; // odd while written
+    atomic<const char*> name{nullptr};
+    atomic<int64_t>     start{0};
+    atomic<int64_t>     duration{0};
+    atomic<int64_t>     pts{NoPts};
+    atomic<int>         streamIndex{-1};
+};
+
+struct ThreadBuffer
+{
+    ThreadBuffer(size_t capacity, uint64_t generation, uint32_t thread)
+        : slots(capacity),
+          mask(capacity - 1),
+          generation(generation),
+          thread(thread)
+    {
+    }
+
+    vector<Slot>     slots;
+    size_t           mask;
+    atomic<uint64_t> head{0};
+    uint64_t         generation;
+    uint32_t         thread;
+};
+
+struct TracerState
+{
+    atomic_bool                      enabled{false};
+    atomic<uint64_t>                 generation{0};
+    atomic<int64_t>                  epoch{0};
+    size_t                           capacity = 0;
+
+    std::mutex                       access; // buffers list and thread names
+    vector<shared_ptr<ThreadBuffer>> buffers;
+    vector<pair<uint32_t, string>>   names;
+};
+
+TracerState& state()
+{
+    static TracerState st;
+    return st;
+}
+
+int64_t steady_ns() noexcept
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ThreadBuffer* thread_buffer()
+{
+    thread_local shared_ptr<ThreadBuffer> buffer;
+
+    auto &st = state();
+    auto const generation = st.generation.load(memory_order_acquire);
+    if (buffer && buffer->generation == generation)
+        return buffer.get();
+
+    // First span of the thread in this trace: registration is the only locked part
+    lock_guard lock{st.access};
+    if (st.generation.load(memory_order_relaxed) != generation || !st.capacity)
+        return nullptr;
+    buffer = make_shared<ThreadBuffer>(st.capacity, generation, internal::thread_id());
+    st.buffers.push_back(buffer);
+    return buffer.get();
+}
+
+} // anonymous namespace
+
+void Tracer::start(size_t eventsPerThread)
+{
+    auto &st = state();
+    lock_guard lock{st.access};
+    st.enabled.store(false, memory_order_relaxed);
+    st.buffers.clear();
+    st.capacity = internal::round_pow2(std::max<size_t>(eventsPerThread, 2));
+    st.epoch.store(steady_ns(), memory_order_relaxed);
+    st.generation.fetch_add(1, memory_order_release);
+    st.enabled.store(true, memory_order_release);
+}
+
+void Tracer::stop() noexcept
+{
+    state().enabled.store(false, memory_order_release);
+}
+
+bool Tracer::isEnabled() noexcept
+{
+    return state().enabled.load(memory_order_relaxed);
+}
+
+void Tracer::setThreadName(std::string_view name)
+{
+    auto &st = state();
+    auto const thread = internal::thread_id();
+    lock_guard lock{st.access};
+    auto it = std::find_if(st.names.begin(), st.names.end(), [thread](auto const &item) {
+        return item.first == thread;
+    });
+    if (it != st.names.end())
+        it->second = string(name);
+    else
+        st.names.emplace_back(thread, string(name));
+}
+
+std::string Tracer::threadName(uint32_t thread)
+{
+    auto &st = state();
+    lock_guard lock{st.access};
+    for (auto const &[id, name] : st.names) {
+        if (id == thread)
+            return name;
+    }
+    return {};
+}
+
+int64_t Tracer::now() noexcept
+{
+    return steady_ns() - state().epoch.load(memory_order_relaxed);
+}
+
+void Tracer::record(const char *name, int64_t start, int64_t end, int streamIndex, int64_t pts) noexcept
+{
+    // Span started before the trace
+    if (start < 0 || end < start)
+        return;
+
+    ThreadBuffer *buffer = nullptr;
+    try {
+        buffer = thread_buffer();
+    } catch (...) {
+    }
+    if (!buffer)
+        return;
+
+    auto const index = buffer->head.load(memory_order_relaxed);
+    auto &slot = buffer->slots[index & buffer->mask];
+
+    auto const seq = slot.seq.load(memory_order_relaxed);
+    slot.seq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot.name.store(name, memory_order_relaxed);
+    slot.start.store(start, memory_order_relaxed);
+    slot.duration.store(end - start, memory_order_relaxed);
+    slot.pts.store(pts, memory_order_relaxed);
+    slot.streamIndex.store(streamIndex, memory_order_relaxed);
+
+    slot.seq.store(seq + 2, memory_order_release);
+    buffer->head.store(index + 1, memory_order_release);
+}
+
+std::vector<TraceEvent> Tracer::collect()
+{
+    vector<shared_ptr<ThreadBuffer>> buffers;
+    {
+        auto &st = state();
+        lock_guard lock{st.access};
+        buffers = st.buffers;
+    }
+
+    vector<TraceEvent> events;
+    for (auto const &buffer : buffers) {
+        auto const head  = buffer->head.load(memory_order_acquire);
+        auto const count = std::min<uint64_t>(head, buffer->slots.size());
+        for (auto index = head - count; index < head; ++index) {
+            auto const &slot = buffer->slots[index & buffer->mask];
+
+            auto const seq = slot.seq.load(memory_order_acquire);
+            if (seq & 1)
+                continue;
+
+            TraceEvent event;
+            event.name        = slot.name.load(memory_order_relaxed);
+            event.start       = slot.start.load(memory_order_relaxed);
+            event.duration    = slot.duration.load(memory_order_relaxed);
+            event.pts         = slot.pts.load(memory_order_relaxed);
+            event.streamIndex = slot.streamIndex.load(memory_order_relaxed);
+            event.thread      = buffer->thread;
+
+            atomic_thread_fence(memory_order_acquire);
+            // Overwritten by the owner meanwhile
+            if (slot.seq.load(memory_order_relaxed) != seq || !event.name)
+                continue;
+
+            events.push_back(event);
+        }
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const TraceEvent &lhs, const TraceEvent &rhs) {
+        return lhs.start < rhs.start;
+    });
+    return events;
+}
+
+std::string Tracer::toChromeJson(const std::vector<TraceEvent> &events)
+{
+    ostringstream ss;
+    ss.imbue(locale::classic());
+    ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    auto const separator = [&] {
+        if (!first)
+            ss << ",\n";
+        first = false;
+    };
+
+    // Thread names as metadata events
+    vector<uint32_t> threads;
+    for (auto const &event : events) {
+        if (std::find(threads.begin(), threads.end(), event.thread) == threads.end())
+            threads.push_back(event.thread);
+    }
+    for (auto thread : threads) {
+        auto const name = threadName(thread);
+        if (name.empty())
+            continue;
+        separator();
+        ss << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+           << ",\"args\":{\"name\":\"" << internal::escape(name) << "\"}}";
+    }
+
+    for (auto const &event : events) {
+        separator();
+        // Microseconds with the nanosecond precision
+        ss << "{\"name\":\"" << internal::escape(event.name ? event.name : "") << "\",\"cat\":\"avcpp\",\"ph\":\"X\""
+           << ",\"ts\":" << event.start / 1000 << '.' << setw(3) << setfill('0') << event.start % 1000
+           << ",\"dur\":" << event.duration / 1000 << '.' << setw(3) << setfill('0') << event.duration % 1000
+           << ",\"pid\":1,\"tid\":" << event.thread;
+        if (event.streamIndex >= 0 || event.pts != NoPts) {
+            ss << ",\"args\":{";
+            if (event.streamIndex >= 0)
+                ss << "\"stream\":" << event.streamIndex;
+            if (event.pts != NoPts)
+                ss << (event.streamIndex >= 0 ? "," : "") << "\"pts\":" << event.pts;
+            ss << '}';
+        }
+        ss << '}';
+    }
+
+    ss << "]}";
+    return ss.str();
+}
+
+TraceSpan::TraceSpan(const char *name, int streamIndex, int64_t pts) noexcept
+    : m_streamIndex(streamIndex),
+      m_pts(pts)
+{
+    if (Tracer::isEnabled()) {
+        m_name  = name;
+        m_start = Tracer::now();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (m_name)
+        Tracer::record(m_name, m_start, Tracer::now(), m_streamIndex, m_pts);
+}
+
+} // namespace av
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "avconfig.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "avutils.h"
+
+namespace av {
+
+/**
+ * Completed span
+ */
+struct TraceEvent
+{
+    const char *name        = nullptr; ///< static string
+    int64_t     start       = 0;       ///< nanoseconds since Tracer::start()
+    int64_t     duration    = 0;       ///< nanoseconds
+    int         streamIndex = -1;
+    int64_t     pts         = NoPts;   ///< in the stream time base
+    uint32_t    thread      = 0;       ///< sequential thread id, same as LogRecord::thread, see Tracer::threadName()
+};
+
+/**
+ * @brief The Tracer class
+ *
+ * Collects timeline of the main operations: opening, stream info probing, reading, seeking, decoding, encoding,
+ * filter push/pull and writing. Every span carries stream index and PTS when known, so pipeline bubbles (e.g.
+ * encoder waits for the decoder) are visible on the timeline.
+ *
+ * Spans are written to the per-thread ring buffers without locks: only the last `eventsPerThread` spans of every
+ * thread are kept. collect() can be called while tracing, spans that are overwritten during collect are skipped.
+ *
+ * Output is the Chrome trace-event JSON: open it in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Library hooks are compiled in with the AV_ENABLE_INSTRUMENTATION build option, as the Instrumentation ones.
+ * TraceSpan itself is always available for the user code.
+ *
+ * @code
+ * Tracer::start();
+ * transcode();
+ * Tracer::stop();
+ * std::ofstream{"trace.json"} << Tracer::toChromeJson(Tracer::collect());
+ * @endcode
+ */
+class Tracer
+{
+public:
+    /**
+     * Start new trace: previous spans are dropped
+     */
+    static void start(size_t eventsPerThread = 65536);
+    static void stop() noexcept;
+    static bool isEnabled() noexcept;
+
+    /**
+     * Name current thread in the trace
+     */
+    static void setThreadName(std::string_view name);
+    static std::string threadName(uint32_t thread);
+
+    /**
+     * Spans of all threads ordered by start time
+     */
+    static std::vector<TraceEvent> collect();
+
+    /**
+     * Chrome trace-event format: complete ("X") events with stream and pts args, thread name metadata.
+     */
+    static std::string toChromeJson(const std::vector<TraceEvent> &events);
+
+    /**
+     * Nanoseconds since start(), time base for the TraceEvent::start
+     */
+    static int64_t now() noexcept;
+
+    static void record(const char *name, int64_t start, int64_t end, int streamIndex, int64_t pts) noexcept;
+};
+
+/**
+ * @brief The TraceSpan class
+ *
+ * Records span from its construction till destruction if tracing is enabled.
+ */
+class TraceSpan : public noncopyable
+{
+public:
+    explicit TraceSpan(const char *name, int streamIndex = -1, int64_t pts = NoPts) noexcept;
+    ~TraceSpan();
+
+    /**
+     * Stream and PTS can be known only at the end: e.g. after the packet read
+     */
+    void setStream(int streamIndex, int64_t pts) noexcept
+    {
+        m_streamIndex = streamIndex;
+        m_pts         = pts;
+    }
+
+private:
+    const char *m_name = nullptr;
+    int64_t     m_start = 0;
+    int         m_streamIndex;
+    int64_t     m_pts;
+};
+
+} // namespace av
+
+#if AVCPP_ENABLE_INSTRUMENTATION
+#  define AVCPP_TRACE(name) ::av::TraceSpan avcpp_trace_span_{name}
+#  define AVCPP_TRACE_AT(name, streamIndex, pts) ::av::TraceSpan avcpp_trace_span_{name, streamIndex, pts}
+#  define AVCPP_TRACE_STREAM(streamIndex, pts) avcpp_trace_span_.setStream(streamIndex, pts)
+#else
+#  define AVCPP_TRACE(name) do {} while (0)
+#  define AVCPP_TRACE_AT(name, streamIndex, pts) do {} while (0)
+#  define AVCPP_TRACE_STREAM(streamIndex, pts) do {} while (0)
+#endif
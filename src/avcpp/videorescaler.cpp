@@ -1,7 +1,10 @@
 #include "avlog.h"
+#include "instrumentation.h"
 
 #include "videorescaler.h"
 
+#include <algorithm>
+
 using namespace std;
 
 namespace av
@@ -42,6 +45,7 @@ VideoRescaler::VideoRescaler(const VideoRescaler &other)
                     other.m_srcWidth, other.m_srcHeight, other.m_srcPixelFormat,
                     other.m_flags)
 {
+    m_cacheSize = other.m_cacheSize;
 }
 
 VideoRescaler::VideoRescaler(VideoRescaler &&other)
@@ -52,8 +56,9 @@ VideoRescaler::VideoRescaler(VideoRescaler &&other)
 
 VideoRescaler::~VideoRescaler()
 {
-    if (m_raw)
-        sws_freeContext(m_raw);
+    AVCPP_INSTRUMENT_FORGET(this);
+    // m_raw is owned by the cache
+    trimCache(0);
 }
 
 void VideoRescaler::swap(VideoRescaler &other) noexcept
@@ -67,15 +72,18 @@ void VideoRescaler::swap(VideoRescaler &other) noexcept
     swap(m_srcPixelFormat, other.m_srcPixelFormat);
     swap(m_flags,          other.m_flags);
     swap(m_raw,            other.m_raw);
+    swap(m_cache,          other.m_cache);
+    swap(m_cacheSize,      other.m_cacheSize);
+    swap(m_cacheHits,      other.m_cacheHits);
+    swap(m_cacheMisses,    other.m_cacheMisses);
 }
 
 void VideoRescaler::getContext(int32_t flags)
 {
     if (m_srcWidth <= 0 || m_srcHeight <= 0 || m_srcPixelFormat == AV_PIX_FMT_NONE ||
-        m_srcWidth <= 0 || m_dstHeight <= 0 || m_dstPixelFormat == AV_PIX_FMT_NONE)
+        m_dstWidth <= 0 || m_dstHeight <= 0 || m_dstPixelFormat == AV_PIX_FMT_NONE)
     {
-        if (m_raw)
-            sws_freeContext(m_raw);
+        // Cached contexts are kept for the next valid parameters
         m_raw = nullptr;
         return;
     }
@@ -87,11 +95,60 @@ void VideoRescaler::getContext(int32_t flags)
             flags = SWS_AREA;
     }
 
-    m_raw = sws_getCachedContext(m_raw,
-                                 m_srcWidth, m_srcHeight, m_srcPixelFormat,
-                                 m_dstWidth, m_dstHeight, m_dstPixelFormat,
-                                 flags,
-                                 nullptr, nullptr, nullptr);
+    auto const matches = [&](const CachedContext &entry) {
+        return entry.srcWidth == m_srcWidth && entry.srcHeight == m_srcHeight &&
+               entry.srcPixelFormat == m_srcPixelFormat &&
+               entry.dstWidth == m_dstWidth && entry.dstHeight == m_dstHeight &&
+               entry.dstPixelFormat == m_dstPixelFormat &&
+               entry.flags == flags;
+    };
+
+    // Fast path: parameters are not changed
+    if (!m_cache.empty() && matches(m_cache.front())) {
+        m_raw = m_cache.front().context;
+        return;
+    }
+
+    auto it = std::find_if(m_cache.begin(), m_cache.end(), matches);
+    if (it != m_cache.end()) {
+        ++m_cacheHits;
+        std::rotate(m_cache.begin(), it, it + 1);
+        m_raw = m_cache.front().context;
+        return;
+    }
+
+    ++m_cacheMisses;
+    auto context = sws_getContext(m_srcWidth, m_srcHeight, m_srcPixelFormat,
+                                  m_dstWidth, m_dstHeight, m_dstPixelFormat,
+                                  flags,
+                                  nullptr, nullptr, nullptr);
+    if (!context) {
+        m_raw = nullptr;
+        return;
+    }
+
+    m_cache.insert(m_cache.begin(), CachedContext{m_srcWidth, m_srcHeight, m_srcPixelFormat,
+                                                  m_dstWidth, m_dstHeight, m_dstPixelFormat,
+                                                  flags, context});
+    trimCache(std::max<size_t>(m_cacheSize, 1));
+    m_raw = context;
+}
+
+void VideoRescaler::trimCache(size_t size) noexcept
+{
+    while (m_cache.size() > size) {
+        if (m_cache.back().context == m_raw)
+            m_raw = nullptr;
+        sws_freeContext(m_cache.back().context);
+        m_cache.pop_back();
+    }
+}
+
+void VideoRescaler::setContextCacheSize(size_t size)
+{
+    m_cacheSize = size;
+    // Current context is always kept
+    trimCache(std::max<size_t>(size, m_raw ? 1 : 0));
 }
 
 bool VideoRescaler::validate(int width, int height, PixelFormat pixelFormat)
@@ -118,6 +175,9 @@ VideoRescaler& VideoRescaler::operator=(VideoRescaler &&rhs)
 
 void VideoRescaler::rescale(VideoFrame &dst, const VideoFrame &src, OptionalErrorCode ec)
 {
+    AVCPP_INSTRUMENT("rescale", this, nullptr);
+    AVCPP_INSTRUMENT_BYTES(src.size());
+
     m_srcWidth       = src.width();
     m_srcHeight      = src.height();
     m_srcPixelFormat = src.pixelFormat();
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include "ffmpeg.h"
 #include "frame.h"
@@ -37,6 +38,8 @@ enum SwsFlags
 class VideoRescaler : public FFWrapperPtr<SwsContext>, public noncopyable
 {
 public:
+    static constexpr size_t DefaultContextCacheSize = 4;
+
     VideoRescaler();
 
     VideoRescaler(int dstWidth, int dstHeight, PixelFormat dstPixelFormat,
@@ -68,9 +71,36 @@ public:
 
     bool isValid() const;
 
+    /**
+     * Fully initialized SwsContexts are kept for the last used parameters (source and destination size, pixel format
+     * and flags): streams that switch resolution back and forth, like ABR inputs on the rendition switches, don't
+     * rebuild the filter tables on every switch. Least recently used contexts are freed over the size. 1 - only
+     * current context is kept, like with sws_getCachedContext().
+     */
+    void     setContextCacheSize(size_t size);
+    size_t   contextCacheSize() const noexcept { return m_cacheSize; }
+    /// Contexts created: parameters changed to the ones not found in the cache
+    uint64_t contextCacheMisses() const noexcept { return m_cacheMisses; }
+    /// Parameters changed to the ones found in the cache
+    uint64_t contextCacheHits() const noexcept { return m_cacheHits; }
+
 private:
+    struct CachedContext
+    {
+        int         srcWidth;
+        int         srcHeight;
+        PixelFormat srcPixelFormat;
+        int         dstWidth;
+        int         dstHeight;
+        PixelFormat dstPixelFormat;
+        int32_t     flags;
+        SwsContext *context;
+    };
+
     void swap(VideoRescaler &other) noexcept;
 
+    void trimCache(size_t size) noexcept;
+
     void getContext(int32_t flags = 0);
 
     static
@@ -86,6 +116,12 @@ private:
     PixelFormat   m_srcPixelFormat = AV_PIX_FMT_NONE;
 
     int32_t       m_flags          = SwsFlagAuto;
+
+    // Most recently used first, m_raw is the first one or null
+    std::vector<CachedContext> m_cache;
+    size_t        m_cacheSize      = DefaultContextCacheSize;
+    uint64_t      m_cacheHits      = 0;
+    uint64_t      m_cacheMisses    = 0;
 };
 
 } // ::av
@@ -0,0 +1,194 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <deque>
+#include <memory>
+#include <set>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/abrtranscoder.h"
+#include "avcpp/codec.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/dictionary.h"
+#include "avcpp/memorybudget.h"
+#include "avcpp/syntheticmedia.h"
+#include "avcpp/videorescaler.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+#if AVCPP_HAS_AVFORMAT
+
+using namespace std;
+
+namespace {
+
+constexpr size_t Frames = 50;
+
+// Demuxer and decoder of the synthetic media: transcode() reads input till EOF, so every run needs own one
+struct Input
+{
+    av::MemoryIO            io;
+    av::FormatContext       ictx;
+    av::VideoDecoderContext decoder;
+
+    explicit Input(const vector<uint8_t> &media)
+        : io(media)
+    {
+        ictx.openInput(&io);
+        ictx.findStreamInfo();
+        REQUIRE(ictx.streamsCount() == 1);
+        decoder = av::VideoDecoderContext{ictx.stream(0)};
+        decoder.setRefCountedFrames(true);
+        decoder.open(av::Codec());
+    }
+
+    // Payload of the single decoded frame: decoded frames of the stream have the same size
+    size_t frameBytes()
+    {
+        while (auto pkt = ictx.readPacket()) {
+            if (auto frame = decoder.decode(pkt))
+                return av::MemoryBudget::payloadBytes(frame);
+        }
+        return 0;
+    }
+};
+
+// MPEG-4 rendition written into memory. Scene cut detection is off: only forced frames are I frames.
+struct Rendition
+{
+    av::VideoRescaler       rescaler;
+    av::VideoEncoderContext encoder{av::findEncodingCodec(AV_CODEC_ID_MPEG4)};
+    av::MemoryIO            io;
+    av::FormatContext       octx;
+
+    Rendition(int width, int height)
+        : rescaler(width, height, AV_PIX_FMT_YUV420P)
+    {
+        encoder.setWidth(width);
+        encoder.setHeight(height);
+        encoder.setPixelFormat(AV_PIX_FMT_YUV420P);
+        encoder.setTimeBase(av::Rational{1, 25});
+        encoder.setGopSize(1000);
+        encoder.open(av::Dictionary{{"sc_threshold", "1000000000"}});
+
+        octx.setFormat(av::OutputFormat{"matroska"});
+        octx.addStream(encoder);
+        octx.openOutput(&io);
+        octx.writeHeader();
+    }
+
+    // Indices of the key packets in the written file: no B frames, so packet index is the frame index
+    set<size_t> keyPackets()
+    {
+        octx.writeTrailer();
+        io.rewind();
+
+        av::FormatContext ictx;
+        ictx.openInput(&io);
+        ictx.findStreamInfo();
+
+        set<size_t> keys;
+        size_t index = 0;
+        while (auto pkt = ictx.readPacket()) {
+            if (pkt.isKeyPacket())
+                keys.insert(index);
+            ++index;
+        }
+        CHECK(index == Frames);
+        return keys;
+    }
+};
+
+} // anonymous namespace
+
+TEST_CASE("AbrTranscoder", "[AbrTranscoder]")
+{
+    av::SyntheticMedia::Options options;
+    options.duration     = std::chrono::seconds(2);
+    options.video.width  = 160;
+    options.video.height = 120;
+    options.hasAudio     = false;
+    auto const media = av::SyntheticMedia::generate(options);
+
+    SECTION("Forced key frames are aligned across renditions") {
+        Input input{media};
+        deque<Rendition> renditions;
+        renditions.emplace_back(160, 120);
+        renditions.emplace_back(80, 60);
+
+        av::AbrTranscoder::Options abrOptions;
+        abrOptions.gopSize = 10;
+        av::AbrTranscoder abr{input.ictx, input.decoder, 0, abrOptions};
+        for (auto &r : renditions)
+            abr.addRendition(r.rescaler, r.encoder, r.octx);
+        abr.transcode();
+
+        auto const &stats = abr.stats();
+        CHECK(stats.framesDecoded == Frames);
+        CHECK(stats.keyFramesForced == Frames / abrOptions.gopSize);
+        REQUIRE(stats.packetsWritten.size() == 2);
+        CHECK(stats.packetsWritten[0] == Frames);
+        CHECK(stats.packetsWritten[1] == Frames);
+
+        set<size_t> const expected{0, 10, 20, 30, 40};
+        for (auto &r : renditions)
+            CHECK(r.keyPackets() == expected);
+    }
+
+    SECTION("Shared frames are released") {
+        Input input{media};
+        deque<Rendition> renditions;
+        renditions.emplace_back(160, 120);
+        renditions.emplace_back(80, 60);
+        renditions.emplace_back(40, 30);
+
+        av::AbrTranscoder::Options abrOptions;
+        abrOptions.memoryBudget = std::make_shared<av::MemoryBudget>(0);
+        av::AbrTranscoder abr{input.ictx, input.decoder, 0, abrOptions};
+        for (auto &r : renditions)
+            abr.addRendition(r.rescaler, r.encoder, r.octx);
+        abr.transcode();
+
+        CHECK(abr.stats().framesDecoded == Frames);
+        CHECK(abr.stats().peakMemory > 0);
+        // Every frame is accounted once, not per rendition, and returned when the last rendition drops it
+        CHECK(abrOptions.memoryBudget->used() == 0);
+        CHECK(abrOptions.memoryBudget->stats().peak == abr.stats().peakMemory);
+    }
+
+    SECTION("Frames in flight are capped by the memory limit") {
+        auto const frameBytes = Input{media}.frameBytes();
+        REQUIRE(frameBytes > 0);
+
+        Input input{media};
+        deque<Rendition> renditions;
+        renditions.emplace_back(160, 120);
+        renditions.emplace_back(80, 60);
+
+        // Limit below the single frame: next frame waits till the previous one is released
+        av::AbrTranscoder::Options abrOptions;
+        abrOptions.memoryLimit = 1;
+        av::AbrTranscoder abr{input.ictx, input.decoder, 0, abrOptions};
+        for (auto &r : renditions)
+            abr.addRendition(r.rescaler, r.encoder, r.octx);
+        abr.transcode();
+
+        auto const &stats = abr.stats();
+        CHECK(stats.framesDecoded == Frames);
+        CHECK(stats.peakMemory == frameBytes);
+        CHECK(stats.memoryWaits <= Frames);
+        CHECK(stats.packetsWritten[0] == Frames);
+        CHECK(stats.packetsWritten[1] == Frames);
+    }
+
+    SECTION("Renditions are required") {
+        Input input{media};
+        av::AbrTranscoder abr{input.ictx, input.decoder, 0};
+        std::error_code ec;
+        abr.transcode(ec);
+        CHECK(ec == av::Errors::InvalidArgument);
+    }
+}
+
+#endif // if AVCPP_HAS_AVFORMAT
@@ -0,0 +1,248 @@
+#include "AllocationCounter.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__has_feature)
+# if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#  define AVTEST_SANITIZED 1
+# endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+# define AVTEST_SANITIZED 1
+#endif
+
+// Sanitizers own malloc(): replace C heap only on the plain glibc builds
+#if defined(__GLIBC__) && !defined(AVTEST_SANITIZED)
+# define AVTEST_HOOK_HEAP 1
+#else
+# define AVTEST_HOOK_HEAP 0
+#endif
+
+#if AVTEST_HOOK_HEAP
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+#endif
+
+namespace avtest {
+
+namespace {
+
+// Constant initialized: safe to touch from the allocator at any point of the thread life
+thread_local AllocationCounter *t_counter = nullptr;
+
+bool is_valid_alignment(size_t alignment) noexcept
+{
+    return alignment && (alignment & (alignment - 1)) == 0;
+}
+
+void *plain_alloc(size_t size) noexcept
+{
+    if (!size)
+        size = 1;
+#if AVTEST_HOOK_HEAP
+    return __libc_malloc(size);
+#else
+    return std::malloc(size);
+#endif
+}
+
+void *aligned_alloc_impl(size_t size, size_t alignment) noexcept
+{
+    if (!size)
+        size = 1;
+    if (alignment < sizeof(void*))
+        alignment = sizeof(void*);
+#if AVTEST_HOOK_HEAP
+    return __libc_memalign(alignment, size);
+#elif defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+#else
+    void *ptr = nullptr;
+    return posix_memalign(&ptr, alignment, size) ? nullptr : ptr;
+#endif
+}
+
+void aligned_free_impl(void *ptr) noexcept
+{
+#if defined(_MSC_VER) && !AVTEST_HOOK_HEAP
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void *new_impl(size_t size)
+{
+    AllocationCounter::countNew();
+    if (auto ptr = plain_alloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *new_aligned_impl(size_t size, std::align_val_t alignment)
+{
+    AllocationCounter::countNew();
+    if (auto ptr = aligned_alloc_impl(size, size_t(alignment)))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+} // anonymous namespace
+
+AllocationCounter::AllocationCounter() noexcept
+    : m_previous(t_counter)
+{
+    t_counter = this;
+}
+
+AllocationCounter::~AllocationCounter()
+{
+    t_counter = m_previous;
+}
+
+void AllocationCounter::reset() noexcept
+{
+    m_newCalls  = 0;
+    m_heapCalls = 0;
+}
+
+bool AllocationCounter::isHeapHooked() noexcept
+{
+    return AVTEST_HOOK_HEAP;
+}
+
+void AllocationCounter::countNew() noexcept
+{
+    if (t_counter)
+        ++t_counter->m_newCalls;
+}
+
+void AllocationCounter::countHeap() noexcept
+{
+    if (t_counter)
+        ++t_counter->m_heapCalls;
+}
+
+} // namespace avtest
+
+//
+// C heap
+//
+#if AVTEST_HOOK_HEAP
+extern "C" {
+
+void *malloc(size_t size)
+{
+    avtest::AllocationCounter::countHeap();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    avtest::AllocationCounter::countHeap();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    avtest::AllocationCounter::countHeap();
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    avtest::AllocationCounter::countHeap();
+    if (!avtest::is_valid_alignment(alignment) || alignment % sizeof(void*))
+        return EINVAL;
+    auto mem = __libc_memalign(alignment, size);
+    if (!mem)
+        return ENOMEM;
+    *ptr = mem;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    avtest::AllocationCounter::countHeap();
+    if (!avtest::is_valid_alignment(alignment)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return __libc_memalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    avtest::AllocationCounter::countHeap();
+    return __libc_memalign(alignment, size);
+}
+
+} // extern "C"
+#endif
+
+//
+// C++ heap
+//
+void *operator new(size_t size)
+{
+    return avtest::new_impl(size);
+}
+
+void *operator new[](size_t size)
+{
+    return avtest::new_impl(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    avtest::AllocationCounter::countNew();
+    return avtest::plain_alloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    avtest::AllocationCounter::countNew();
+    return avtest::plain_alloc(size);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    return avtest::new_aligned_impl(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return avtest::new_aligned_impl(size, alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    avtest::AllocationCounter::countNew();
+    return avtest::aligned_alloc_impl(size, size_t(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    avtest::AllocationCounter::countNew();
+    return avtest::aligned_alloc_impl(size, size_t(alignment));
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::align_val_t) noexcept { avtest::aligned_free_impl(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { avtest::aligned_free_impl(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { avtest::aligned_free_impl(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { avtest::aligned_free_impl(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t&) noexcept { avtest::aligned_free_impl(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t&) noexcept { avtest::aligned_free_impl(ptr); }
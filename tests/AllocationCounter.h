@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+namespace avtest {
+
+/**
+ * @brief The AllocationCounter class
+ *
+ * Counts heap allocations of the current thread while the counter is alive. Used by the tests to check that steady
+ * state of the hot paths does not touch the allocator.
+ *
+ * Two kinds of allocations are counted:
+ * - C++ operator new (all the replaceable forms), always available;
+ * - C heap: malloc(), calloc(), realloc(), posix_memalign(), aligned_alloc() and memalign(). FFmpeg has no public
+ *   allocator hook, so av_malloc() is caught at this level. Available on glibc only and not under sanitizers that
+ *   intercept the allocator, see isHeapHooked().
+ *
+ * Counters can be nested, inner one hides allocations from the outer one.
+ *
+ * Definitions of the replaced allocation functions live in AllocationCounter.cpp: it must be linked once per test
+ * executable.
+ *
+ * @code
+ * avtest::AllocationCounter counter;
+ * rescaler.rescale(dst, src);
+ * CHECK(counter.total() == 0);
+ * @endcode
+ */
+class AllocationCounter
+{
+public:
+    AllocationCounter() noexcept;
+    ~AllocationCounter();
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    /// operator new calls
+    size_t newCalls() const noexcept { return m_newCalls; }
+
+    /// C heap calls, av_malloc() included. Always zero when !isHeapHooked()
+    size_t heapCalls() const noexcept { return m_heapCalls; }
+
+    size_t total() const noexcept { return m_newCalls + m_heapCalls; }
+
+    void reset() noexcept;
+
+    /**
+     * C heap functions are replaced in this build
+     */
+    static bool isHeapHooked() noexcept;
+
+    // Used by the replaced allocation functions
+    static void countNew() noexcept;
+    static void countHeap() noexcept;
+
+private:
+    AllocationCounter *m_previous = nullptr;
+    size_t             m_newCalls = 0;
+    size_t             m_heapCalls = 0;
+};
+
+} // namespace avtest
@@ -0,0 +1,359 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+#include <cstring>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/bitstreamfilter.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+namespace {
+
+const vector<uint8_t> h264_sps = { 0x67, 0x42, 0x00, 0x0a, 0xf8, 0x41, 0xa2 };
+const vector<uint8_t> h264_pps = { 0x68, 0xce, 0x38, 0x80 };
+const vector<uint8_t> h264_idr = { 0x65, 0x88, 0x84, 0x00, 0x33, 0xff, 0x12, 0x34 };
+
+vector<uint8_t> make_avcc_extradata()
+{
+    vector<uint8_t> avcc = {
+        0x01,                   // configurationVersion
+        h264_sps[1],            // AVCProfileIndication
+        h264_sps[2],            // profile_compatibility
+        h264_sps[3],            // AVCLevelIndication
+        0xff,                   // lengthSizeMinusOne = 3
+        0xe1,                   // numOfSequenceParameterSets = 1
+    };
+    avcc.push_back(0);
+    avcc.push_back(uint8_t(h264_sps.size()));
+    avcc.insert(avcc.end(), h264_sps.begin(), h264_sps.end());
+    avcc.push_back(0x01);       // numOfPictureParameterSets
+    avcc.push_back(0);
+    avcc.push_back(uint8_t(h264_pps.size()));
+    avcc.insert(avcc.end(), h264_pps.begin(), h264_pps.end());
+    return avcc;
+}
+
+void append_length_prefixed(vector<uint8_t> &dst, const vector<uint8_t> &nal)
+{
+    auto size = uint32_t(nal.size());
+    dst.push_back(uint8_t(size >> 24));
+    dst.push_back(uint8_t(size >> 16));
+    dst.push_back(uint8_t(size >> 8));
+    dst.push_back(uint8_t(size));
+    dst.insert(dst.end(), nal.begin(), nal.end());
+}
+
+void append_start_code(vector<uint8_t> &dst, const vector<uint8_t> &nal)
+{
+    dst.insert(dst.end(), {0x00, 0x00, 0x00, 0x01});
+    dst.insert(dst.end(), nal.begin(), nal.end());
+}
+
+void set_extradata(av::CodecParametersView par, const vector<uint8_t> &data)
+{
+    auto raw = par.raw();
+    raw->extradata = static_cast<uint8_t*>(av_mallocz(data.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+    raw->extradata_size = int(data.size());
+    memcpy(raw->extradata, data.data(), data.size());
+}
+
+bool contains(const uint8_t *data, size_t size, const vector<uint8_t> &needle)
+{
+    if (needle.size() > size)
+        return false;
+    for (size_t i = 0; i + needle.size() <= size; ++i) {
+        if (memcmp(data + i, needle.data(), needle.size()) == 0)
+            return true;
+    }
+    return false;
+}
+
+vector<uint8_t> make_adts_frame(size_t payloadSize)
+{
+    const size_t length = payloadSize + 7;
+    vector<uint8_t> frame = {
+        0xff,
+        0xf1,                                           // MPEG-4, layer 0, CRC absent
+        uint8_t((1 << 6) | (4 << 2) | (2 >> 2)),        // AAC LC, 44100 Hz, channel config high bit
+        uint8_t(((2 & 3) << 6) | ((length >> 11) & 3)), // channel config low bits, frame length high bits
+        uint8_t((length >> 3) & 0xff),
+        uint8_t(((length & 7) << 5) | 0x1f),            // frame length low bits, buffer fullness high bits
+        0xfc,                                           // buffer fullness low bits, 1 raw data block
+    };
+    frame.resize(length, 0x00);
+    return frame;
+}
+
+} // anonymous namespace
+
+TEST_CASE("BitStreamFilter lookup", "[BitStreamFilter]")
+{
+    SECTION("Known filters") {
+        for (auto name : {"h264_mp4toannexb", "hevc_mp4toannexb", "aac_adtstoasc", "extract_extradata", "null"}) {
+            av::BitStreamFilter bsf{name};
+            CHECK(bsf);
+            CHECK(bsf.name() == name);
+        }
+    }
+
+    SECTION("Unknown filter") {
+        av::BitStreamFilter bsf{"no_such_bitstream_filter"};
+        CHECK_FALSE(bsf);
+
+        std::error_code ec;
+        av::BitStreamFilterContext ctx{bsf, ec};
+        CHECK(ec);
+        CHECK(ctx.isNull());
+    }
+
+    SECTION("Codec ids") {
+        av::BitStreamFilter bsf{"h264_mp4toannexb"};
+        CHECK(bsf.supportsCodec(AV_CODEC_ID_H264));
+        CHECK_FALSE(bsf.supportsCodec(AV_CODEC_ID_AAC));
+        CHECK(av::BitStreamFilter{"null"}.supportsCodec(AV_CODEC_ID_AAC));
+    }
+
+    SECTION("Enumerate") {
+        auto filters = av::bitStreamFilters();
+        CHECK(!filters.empty());
+    }
+}
+
+TEST_CASE("BitStreamFilterContext state", "[BitStreamFilter]")
+{
+    av::BitStreamFilterContext ctx{"null"};
+    REQUIRE(!ctx.isNull());
+
+    SECTION("Not inited") {
+        av::Packet pkt{h264_idr};
+        std::error_code ec;
+        ctx.sendPacket(pkt, ec);
+        CHECK(ec == av::Errors::BsfNotInited);
+    }
+
+    SECTION("EAGAIN does not throw") {
+        ctx.init();
+        av::Packet out;
+        std::error_code ec;
+        CHECK_FALSE(ctx.receivePacket(out, ec));
+        CHECK(ec.value() == AVERROR(EAGAIN));
+        CHECK_NOTHROW(ctx.receivePacket(out));
+    }
+
+    SECTION("Pass-through without copy") {
+        ctx.setInputTimeBase(av::Rational{1, 1000});
+        ctx.init();
+
+        av::Packet pkt{h264_idr};
+        pkt.setTimeBase(av::Rational{1, 1000});
+        pkt.setPts(av::Timestamp{40, av::Rational{1, 1000}});
+        const auto payload = pkt.data();
+
+        ctx.sendPacket(pkt);
+        CHECK(pkt.isNull());
+
+        av::Packet out;
+        REQUIRE(ctx.receivePacket(out));
+        CHECK(out.data() == payload);
+        CHECK(out.size() == h264_idr.size());
+        CHECK(out.pts().timestamp() == 40);
+        CHECK(out.timeBase() == av::Rational(1, 1000));
+
+        ctx.sendEof();
+        std::error_code ec;
+        CHECK_FALSE(ctx.receivePacket(out, ec));
+        CHECK(ec.value() == AVERROR_EOF);
+    }
+
+    SECTION("Time base of the first packet") {
+        ctx.init();
+        CHECK(ctx.isInited());
+
+        // Nothing to receive before the first packet
+        av::Packet out;
+        std::error_code ec;
+        CHECK_FALSE(ctx.receivePacket(out, ec));
+        CHECK(ec.value() == AVERROR(EAGAIN));
+
+        av::Packet pkt{h264_idr};
+        pkt.setTimeBase(av::Rational{1, 90000});
+        pkt.setPts(av::Timestamp{3600, av::Rational{1, 90000}});
+        ctx.sendPacket(pkt);
+
+        CHECK(ctx.inputTimeBase() == av::Rational(1, 90000));
+        CHECK(ctx.outputTimeBase() == av::Rational(1, 90000));
+
+        REQUIRE(ctx.receivePacket(out));
+        CHECK(out.timeBase() == av::Rational(1, 90000));
+        CHECK(out.pts().timestamp() == 3600);
+    }
+
+    SECTION("Configuration after init") {
+        ctx.init();
+        std::error_code ec;
+        ctx.setInputTimeBase(av::Rational{1, 25}, ec);
+        CHECK(ec == av::Errors::BsfAlreadyInited);
+    }
+}
+
+TEST_CASE("BitStreamFilter h264_mp4toannexb", "[BitStreamFilter]")
+{
+    av::BitStreamFilterContext ctx{"h264_mp4toannexb"};
+    auto par = ctx.inputParameters();
+    par.codecType(AVMEDIA_TYPE_VIDEO);
+    par.codecId(AV_CODEC_ID_H264);
+    set_extradata(par, make_avcc_extradata());
+    ctx.setInputTimeBase(av::Rational{1, 90000});
+    ctx.init();
+
+    vector<uint8_t> avcc;
+    append_length_prefixed(avcc, h264_idr);
+
+    av::Packet pkt{avcc};
+    pkt.setKeyPacket(true);
+
+    size_t count = 0;
+    ctx.filter(pkt, [&](av::Packet &out) {
+        ++count;
+        REQUIRE(out.size() > 4);
+        const uint8_t *data = out.data();
+        // Annex B start code and parameter sets prepended to the IDR slice
+        CHECK(data[0] == 0x00);
+        CHECK(data[1] == 0x00);
+        CHECK((data[2] == 0x01 || (data[2] == 0x00 && data[3] == 0x01)));
+        CHECK(contains(data, out.size(), h264_sps));
+        CHECK(contains(data, out.size(), h264_pps));
+        CHECK(contains(data, out.size(), h264_idr));
+    });
+    CHECK(count == 1);
+}
+
+TEST_CASE("BitStreamFilter hevc_mp4toannexb", "[BitStreamFilter]")
+{
+    // Without hvcC extradata the stream is treated as Annex B already and passed as is
+    av::BitStreamFilterContext ctx{"hevc_mp4toannexb"};
+    auto par = ctx.inputParameters();
+    par.codecType(AVMEDIA_TYPE_VIDEO);
+    par.codecId(AV_CODEC_ID_HEVC);
+    ctx.init();
+
+    vector<uint8_t> annexb;
+    append_start_code(annexb, {0x26, 0x01, 0xaf, 0x02, 0x10}); // IDR_W_RADL
+    av::Packet pkt{annexb};
+
+    size_t count = 0;
+    ctx.filter(pkt, [&](av::Packet &out) {
+        ++count;
+        REQUIRE(out.size() == annexb.size());
+        CHECK(memcmp(out.data(), annexb.data(), annexb.size()) == 0);
+    });
+    CHECK(count == 1);
+}
+
+TEST_CASE("BitStreamFilter aac_adtstoasc", "[BitStreamFilter]")
+{
+    av::BitStreamFilterContext ctx{"aac_adtstoasc"};
+    auto par = ctx.inputParameters();
+    par.codecType(AVMEDIA_TYPE_AUDIO);
+    par.codecId(AV_CODEC_ID_AAC);
+    ctx.init();
+
+    const size_t payloadSize = 32;
+    av::Packet pkt{make_adts_frame(payloadSize)};
+
+    size_t count = 0;
+    ctx.filter(pkt, [&](av::Packet &out) {
+        ++count;
+        // ADTS header stripped
+        CHECK(out.size() == payloadSize);
+    });
+    CHECK(count == 1);
+
+    // AudioSpecificConfig produced: AAC LC, 44100 Hz, stereo
+    auto outPar = ctx.outputParameters();
+    REQUIRE(outPar.raw()->extradata_size >= 2);
+    CHECK(outPar.raw()->extradata[0] == 0x12);
+    CHECK(outPar.raw()->extradata[1] == 0x10);
+}
+
+#if AVCPP_HAS_PKT_SIDE_DATA
+TEST_CASE("BitStreamFilter extract_extradata", "[BitStreamFilter]")
+{
+    av::BitStreamFilterContext ctx{"extract_extradata"};
+    auto par = ctx.inputParameters();
+    par.codecType(AVMEDIA_TYPE_VIDEO);
+    par.codecId(AV_CODEC_ID_H264);
+    ctx.init();
+
+    vector<uint8_t> annexb;
+    append_start_code(annexb, h264_sps);
+    append_start_code(annexb, h264_pps);
+    append_start_code(annexb, h264_idr);
+    av::Packet pkt{annexb};
+
+    size_t count = 0;
+    ctx.filter(pkt, [&](av::Packet &out) {
+        ++count;
+        // Payload is not removed by default
+        CHECK(out.size() == annexb.size());
+
+        auto extradata = out.sideData(AV_PKT_DATA_NEW_EXTRADATA);
+        REQUIRE(!extradata.empty());
+        CHECK(contains(extradata.data(), extradata.size(), h264_sps));
+        CHECK(contains(extradata.data(), extradata.size(), h264_pps));
+        CHECK_FALSE(contains(extradata.data(), extradata.size(), h264_idr));
+    });
+    CHECK(count == 1);
+}
+#endif
+
+TEST_CASE("BitStreamFilter chain", "[BitStreamFilter]")
+{
+    SECTION("From description") {
+        auto ctx = av::BitStreamFilterContext::chain("null,null");
+        REQUIRE(!ctx.isNull());
+        ctx.init();
+
+        av::Packet pkt{h264_idr};
+        size_t count = 0;
+        ctx.filter(pkt, [&](av::Packet &out) {
+            ++count;
+            CHECK(out.size() == h264_idr.size());
+        });
+        CHECK(count == 1);
+    }
+
+    SECTION("From list") {
+        auto ctx = av::BitStreamFilterContext::chain(vector<string>{"h264_mp4toannexb", "dump_extra"});
+        REQUIRE(!ctx.isNull());
+        auto par = ctx.inputParameters();
+        par.codecType(AVMEDIA_TYPE_VIDEO);
+        par.codecId(AV_CODEC_ID_H264);
+        set_extradata(par, make_avcc_extradata());
+        ctx.init();
+
+        vector<uint8_t> avcc;
+        append_length_prefixed(avcc, h264_idr);
+        av::Packet pkt{avcc};
+        pkt.setKeyPacket(true);
+
+        size_t count = 0;
+        ctx.filter(pkt, [&](av::Packet &out) {
+            ++count;
+            CHECK(contains(out.data(), out.size(), h264_idr));
+        });
+        CHECK(count == 1);
+    }
+
+    SECTION("Invalid description") {
+        std::error_code ec;
+        auto ctx = av::BitStreamFilterContext::chain("no_such_bitstream_filter", ec);
+        CHECK(ec);
+        CHECK(ctx.isNull());
+    }
+}
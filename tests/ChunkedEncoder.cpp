@@ -0,0 +1,189 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/chunkedencoder.h"
+
+#include "TestMedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+namespace {
+
+// Source key frames: chunks are split on them
+av::VideoFrame make_frame(size_t index)
+{
+    auto frame = avtest::make_frame(index);
+    frame.setKeyFrame(index % 10 == 0);
+    return frame;
+}
+
+} // anonymous namespace
+
+TEST_CASE("ChunkedEncoder", "[ChunkedEncoder]")
+{
+    av::JobScheduler scheduler{4};
+
+    SECTION("Stitched stream decodes in order") {
+        constexpr size_t FRAMES = 137;
+
+        vector<av::Packet> packets;
+        av::ChunkedEncoder::Options options;
+        options.minChunkFrames = 20;
+        options.parallelChunks = 3;
+
+        av::ChunkedEncoder encoder{scheduler, av::findEncodingCodec(AV_CODEC_ID_MPEG4), avtest::configure_mpeg4,
+                                   [&packets](av::Packet &&pkt) { packets.push_back(std::move(pkt)); },
+                                   options};
+        encoder.open();
+        REQUIRE(encoder.isOpened());
+
+        for (size_t i = 0; i < FRAMES; ++i)
+            encoder.push(make_frame(i));
+        encoder.finish();
+
+        auto const &stats = encoder.stats();
+        CHECK(stats.frames == FRAMES);
+        CHECK(stats.chunks == 7); // split on key frames 20, 40, ..., 120
+        CHECK(stats.packets == packets.size());
+
+        // Monotonic DTS
+        int64_t lastDts = av::NoPts;
+        for (auto &pkt : packets) {
+            auto const dts = pkt.raw()->dts;
+            if (dts == av::NoPts)
+                continue;
+            if (lastDts != av::NoPts)
+                CHECK(dts > lastDts);
+            lastDts = dts;
+        }
+
+        av::VideoDecoderContext dec{av::findDecodingCodec(AV_CODEC_ID_MPEG4)};
+        dec.setTimeBase(av::Rational{1, 25});
+        dec.open();
+
+        vector<int64_t> pts;
+        auto store = [&pts](const av::VideoFrame &frame) {
+            CHECK(frame.width() == avtest::VideoWidth);
+            CHECK(frame.height() == avtest::VideoHeight);
+            pts.push_back(frame.raw()->pts);
+        };
+
+        for (auto &pkt : packets) {
+            auto frame = dec.decode(pkt);
+            if (frame)
+                store(frame);
+        }
+        while (true) {
+            auto frame = dec.decode(av::Packet{});
+            if (!frame)
+                break;
+            store(frame);
+        }
+
+        REQUIRE(pts.size() == FRAMES);
+        for (size_t i = 0; i < FRAMES; ++i)
+            CHECK(pts[i] == int64_t(i));
+    }
+
+    SECTION("Forced split without key frames") {
+        size_t count = 0;
+        av::ChunkedEncoder::Options options;
+        options.minChunkFrames = 1000;
+        options.maxChunkFrames = 8;
+
+        av::ChunkedEncoder encoder{scheduler, av::findEncodingCodec(AV_CODEC_ID_MPEG4), avtest::configure_mpeg4,
+                                   [&count](av::Packet &&) { ++count; },
+                                   options};
+        encoder.open();
+        for (size_t i = 0; i < 30; ++i) {
+            auto frame = make_frame(i);
+            frame.setKeyFrame(false);
+            encoder.push(frame);
+        }
+        encoder.finish();
+
+        CHECK(encoder.stats().chunks == 4);
+        CHECK(count == 30);
+    }
+
+    SECTION("B-frames keep DTS not above PTS") {
+        constexpr size_t FRAMES = 64;
+
+        vector<av::Packet> packets;
+        av::ChunkedEncoder::Options options;
+        options.minChunkFrames = 10;
+
+        auto configure = [](av::VideoEncoderContext &enc) {
+            avtest::configure_mpeg4(enc);
+            enc.setMaxBFrames(2);
+        };
+
+        av::ChunkedEncoder encoder{scheduler, av::findEncodingCodec(AV_CODEC_ID_MPEG4), configure,
+                                   [&packets](av::Packet &&pkt) { packets.push_back(std::move(pkt)); },
+                                   options};
+        encoder.open();
+        for (size_t i = 0; i < FRAMES; ++i)
+            encoder.push(make_frame(i));
+        encoder.finish();
+
+        REQUIRE(packets.size() == FRAMES);
+        int64_t lastDts = av::NoPts;
+        vector<int64_t> pts;
+        for (auto &pkt : packets) {
+            auto const raw = pkt.raw();
+            REQUIRE(raw->dts != av::NoPts);
+            CHECK(raw->dts <= raw->pts);
+            if (lastDts != av::NoPts)
+                CHECK(raw->dts > lastDts);
+            lastDts = raw->dts;
+            pts.push_back(raw->pts);
+        }
+
+        // Reordered, but every frame is present
+        sort(pts.begin(), pts.end());
+        for (size_t i = 0; i < FRAMES; ++i)
+            CHECK(pts[i] == int64_t(i));
+    }
+
+    SECTION("Sink errors are kept") {
+        av::ChunkedEncoder::Options options;
+        options.minChunkFrames = 10;
+
+        av::ChunkedEncoder failing{scheduler, av::findEncodingCodec(AV_CODEC_ID_MPEG4), avtest::configure_mpeg4,
+                                   [](av::Packet &&) { throw std::system_error(make_error_code(std::errc::io_error)); },
+                                   options};
+        failing.open();
+        std::error_code ec;
+        for (size_t i = 0; i < 30 && !ec; ++i)
+            failing.push(make_frame(i), ec);
+        if (!ec)
+            failing.finish(ec);
+        CHECK(ec == std::errc::io_error);
+
+        av::ChunkedEncoder unknown{scheduler, av::findEncodingCodec(AV_CODEC_ID_MPEG4), avtest::configure_mpeg4,
+                                   [](av::Packet &&) { throw std::runtime_error("sink"); },
+                                   options};
+        unknown.open();
+        ec.clear();
+        for (size_t i = 0; i < 30 && !ec; ++i)
+            unknown.push(make_frame(i), ec);
+        if (!ec)
+            unknown.finish(ec);
+        CHECK(ec == av::Errors::ChunkUnhandledException);
+    }
+
+    SECTION("Push before open") {
+        av::ChunkedEncoder encoder{scheduler, av::findEncodingCodec(AV_CODEC_ID_MPEG4), avtest::configure_mpeg4, {}};
+        std::error_code ec;
+        encoder.push(make_frame(0), ec);
+        CHECK(ec == make_error_code(av::Errors::CodecNotOpened));
+    }
+}
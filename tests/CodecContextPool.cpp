@@ -0,0 +1,211 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <thread>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/codec.h"
+#include "avcpp/codeccontextpool.h"
+
+#include "TestMedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+using namespace std::chrono_literals;
+
+namespace {
+
+av::VideoEncoderContext make_encoder()
+{
+    av::VideoEncoderContext enc{av::findEncodingCodec(AV_CODEC_ID_MPEG4)};
+    avtest::configure_mpeg4(enc);
+    return enc;
+}
+
+av::VideoDecoderContext make_decoder()
+{
+    return av::VideoDecoderContext{av::findDecodingCodec(AV_CODEC_ID_MPEG4)};
+}
+
+size_t decode_all(av::VideoDecoderContext &dec, const vector<av::Packet> &packets)
+{
+    size_t frames = 0;
+    for (auto const &pkt : packets) {
+        if (dec.decode(pkt))
+            ++frames;
+    }
+    while (dec.decode(av::Packet{}))
+        ++frames;
+    return frames;
+}
+
+} // anonymous namespace
+
+TEST_CASE("CodecContext flush and detach", "[CodecContextPool][CodecContext]")
+{
+    SECTION("Not opened") {
+        auto dec = make_decoder();
+        CHECK_FALSE(dec.canFlushBuffers());
+
+        std::error_code ec;
+        dec.flushBuffers(ec);
+        CHECK(ec == av::Errors::CodecNotOpened);
+        CHECK(dec.detachStream());
+    }
+
+    SECTION("Decoder") {
+        auto dec = make_decoder();
+        dec.open();
+        CHECK(dec.canFlushBuffers());
+
+        std::error_code ec;
+        dec.flushBuffers(ec);
+        CHECK(!ec);
+    }
+
+    SECTION("Encoder") {
+        auto enc = make_encoder();
+        enc.open();
+        auto const flushable = enc.canFlushBuffers();
+
+        std::error_code ec;
+        enc.flushBuffers(ec);
+        if (flushable) {
+            CHECK(!ec);
+        } else {
+            CHECK(ec == av::Errors::CodecFlushUnsupported);
+        }
+    }
+}
+
+TEST_CASE("CodecContextPool", "[CodecContextPool]")
+{
+    auto const packets = avtest::encode_mpeg4(30);
+    REQUIRE(!packets.empty());
+
+    SECTION("Decoder reuse") {
+        av::CodecContextPool pool;
+
+        size_t firstFrames = 0;
+        {
+            auto dec = pool.acquire(make_decoder());
+            REQUIRE(dec);
+            CHECK_FALSE(dec.isReused());
+            CHECK(dec->isOpened());
+            firstFrames = decode_all(*dec, packets);
+        }
+        CHECK(pool.idleCount() == 1);
+
+        auto dec = pool.acquire(make_decoder());
+        REQUIRE(dec);
+        CHECK(dec.isReused());
+        CHECK(pool.idleCount() == 0);
+
+        // Flushed context decodes the same stream from the start again
+        CHECK(decode_all(*dec, packets) == firstFrames);
+
+        auto const stats = pool.stats();
+        CHECK(stats.hits == 1);
+        CHECK(stats.misses == 1);
+        CHECK(stats.returned == 1);
+    }
+
+    SECTION("Key mismatch") {
+        av::CodecContextPool pool;
+        pool.acquire(make_decoder()).release();
+        REQUIRE(pool.idleCount() == 1);
+
+        // Other options
+        auto lowDelay = make_decoder();
+        lowDelay.addFlags(AV_CODEC_FLAG_LOW_DELAY);
+        CHECK_FALSE(pool.acquire(std::move(lowDelay)).isReused());
+
+        // Other open options
+        CHECK_FALSE(pool.acquire(make_decoder(), {{"threads", "1"}}).isReused());
+
+        // Other context type
+        auto enc = pool.acquire(make_encoder());
+        CHECK_FALSE(enc.isReused());
+
+        CHECK(pool.acquire(make_decoder()).isReused());
+    }
+
+    SECTION("Encoder") {
+        av::CodecContextPool pool;
+        {
+            auto enc = pool.acquire(make_encoder());
+            REQUIRE(enc);
+            CHECK_FALSE(enc.isReused());
+        }
+
+        // Encoders without AV_CODEC_CAP_ENCODER_FLUSH can't be reset
+        auto enc = pool.acquire(make_encoder());
+        if (enc->canFlushBuffers()) {
+            CHECK(enc.isReused());
+        } else {
+            CHECK_FALSE(enc.isReused());
+            CHECK(pool.stats().discarded == 1);
+        }
+    }
+
+    SECTION("LRU eviction") {
+        av::CodecContextPool::Options options;
+        options.maxIdle = 2;
+        av::CodecContextPool pool{options};
+
+        auto first  = pool.acquire(make_decoder());
+        auto second = pool.acquire(make_decoder(), {{"threads", "1"}});
+        auto third  = pool.acquire(make_decoder(), {{"threads", "2"}});
+        first.release();
+        second.release();
+        third.release();
+
+        CHECK(pool.idleCount() == 2);
+        CHECK(pool.stats().evicted == 1);
+
+        // Least recently returned one is evicted
+        CHECK_FALSE(pool.acquire(make_decoder()).isReused());
+        CHECK(pool.acquire(make_decoder(), {{"threads", "2"}}).isReused());
+    }
+
+    SECTION("Idle time eviction") {
+        av::CodecContextPool::Options options;
+        options.maxIdleTime = 10ms;
+        av::CodecContextPool pool{options};
+
+        pool.acquire(make_decoder()).release();
+        REQUIRE(pool.idleCount() == 1);
+
+        this_thread::sleep_for(20ms);
+        pool.evictExpired();
+        CHECK(pool.idleCount() == 0);
+        CHECK(pool.stats().evicted == 1);
+    }
+
+    SECTION("Discard and clear") {
+        av::CodecContextPool pool;
+        auto dec = pool.acquire(make_decoder());
+        dec.discard();
+        CHECK_FALSE(dec);
+        CHECK(pool.idleCount() == 0);
+
+        pool.acquire(make_decoder()).release();
+        pool.clear();
+        CHECK(pool.idleCount() == 0);
+    }
+
+    SECTION("Invalid input") {
+        av::CodecContextPool pool;
+
+        std::error_code ec;
+        auto opened = make_decoder();
+        opened.open();
+        CHECK_FALSE(pool.acquire(std::move(opened), ec));
+        CHECK(ec == av::Errors::CodecAlreadyOpened);
+
+        CHECK_FALSE(pool.acquire(av::VideoDecoderContext{}, ec));
+        CHECK(ec);
+    }
+}
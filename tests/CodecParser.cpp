@@ -0,0 +1,179 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+#include <algorithm>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/codecparser.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/frame.h"
+
+#include "TestMedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr size_t FRAMES = 10;
+
+// Raw MPEG-4 part 2 elementary stream and sizes of the encoded packets
+struct ElementaryStream
+{
+    vector<uint8_t> data;
+    vector<size_t>  sizes;
+};
+
+ElementaryStream encode_mpeg4_stream()
+{
+    ElementaryStream es;
+    for (auto const &pkt : avtest::encode_mpeg4(FRAMES)) {
+        es.data.insert(es.data.end(), pkt.data(), pkt.data() + pkt.size());
+        es.sizes.push_back(pkt.size());
+    }
+    return es;
+}
+
+} // anonymous namespace
+
+TEST_CASE("CodecParser construct", "[CodecParser]")
+{
+    SECTION("Known parser") {
+        av::CodecParser parser{AV_CODEC_ID_H264};
+        CHECK(!parser.isNull());
+        CHECK(parser.codecId() == AV_CODEC_ID_H264);
+    }
+
+    SECTION("Unknown parser") {
+        std::error_code ec;
+        av::CodecParser parser{AV_CODEC_ID_RAWVIDEO, ec};
+        CHECK(ec == av::Errors::ParserNotFound);
+        CHECK(parser.isNull());
+    }
+
+    SECTION("Move") {
+        av::CodecParser parser{AV_CODEC_ID_MPEG4};
+        av::CodecParser other{std::move(parser)};
+        CHECK(parser.isNull());
+        CHECK(!other.isNull());
+        CHECK(other.codecId() == AV_CODEC_ID_MPEG4);
+    }
+}
+
+TEST_CASE("CodecParser split stream", "[CodecParser]")
+{
+    auto const es = encode_mpeg4_stream();
+    REQUIRE(es.sizes.size() == FRAMES);
+
+    SECTION("Ref-counted chunk, zero-copy") {
+        av::CodecParser parser{AV_CODEC_ID_MPEG4};
+        // Padded copy of the stream
+        av::Packet input{es.data};
+
+        vector<uint8_t> output;
+        size_t count = 0;
+        size_t referenced = 0;
+
+        auto check = [&](av::Packet &pkt) {
+            REQUIRE(count < es.sizes.size());
+            CHECK(pkt.size() == es.sizes[count]);
+            if (pkt.data() >= input.data() && pkt.data() < input.data() + input.size())
+                ++referenced;
+            output.insert(output.end(), pkt.data(), pkt.data() + pkt.size());
+            ++count;
+        };
+
+        parser.parseAll(input, check);
+        parser.flushAll(check);
+
+        CHECK(count == FRAMES);
+        CHECK(output == es.data);
+        // Last packet stays in the parser until flush, all other should be references to input
+        CHECK(referenced >= FRAMES - 1);
+    }
+
+    SECTION("Raw chunk is copied") {
+        av::CodecParser parser{AV_CODEC_ID_MPEG4};
+        parser.setInputPadded(true);
+
+        // Reused read buffer
+        vector<uint8_t> input(es.data.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+        std::copy(es.data.begin(), es.data.end(), input.begin());
+
+        vector<av::Packet> packets;
+        parser.parseAll(input.data(), es.data.size(), [&](av::Packet &pkt) {
+            CHECK_FALSE((pkt.data() >= input.data() && pkt.data() < input.data() + input.size()));
+            packets.push_back(std::move(pkt));
+        });
+        std::fill(input.begin(), input.end(), uint8_t(0));
+        parser.flushAll([&](av::Packet &pkt) { packets.push_back(std::move(pkt)); });
+
+        vector<uint8_t> output;
+        for (auto const &pkt : packets)
+            output.insert(output.end(), pkt.data(), pkt.data() + pkt.size());
+        CHECK(packets.size() == FRAMES);
+        CHECK(output == es.data);
+    }
+
+    SECTION("Small chunks") {
+        av::CodecParser parser{AV_CODEC_ID_MPEG4};
+
+        vector<uint8_t> output;
+        size_t count = 0;
+
+        auto check = [&](av::Packet &pkt) {
+            output.insert(output.end(), pkt.data(), pkt.data() + pkt.size());
+            ++count;
+        };
+
+        constexpr size_t chunkSize = 7;
+        for (size_t offset = 0; offset < es.data.size(); offset += chunkSize) {
+            auto const size = std::min(chunkSize, es.data.size() - offset);
+            // Temporary chunk storage: packets must not refer to it after the iteration
+            vector<uint8_t> chunk(es.data.begin() + ptrdiff_t(offset), es.data.begin() + ptrdiff_t(offset + size));
+            parser.parseAll(chunk.data(), chunk.size(), check);
+        }
+        parser.flushAll(check);
+
+        CHECK(count == FRAMES);
+        CHECK(output == es.data);
+    }
+
+#if AVCPP_CXX_STANDARD >= 20
+    SECTION("Span and decode") {
+        av::CodecParser parser{AV_CODEC_ID_MPEG4};
+        parser.setTimeBase(av::Rational{1, 25});
+        parser.setStreamIndex(0);
+
+        av::VideoDecoderContext dec{av::findDecodingCodec(AV_CODEC_ID_MPEG4)};
+        dec.setTimeBase(av::Rational{1, 25});
+        dec.open();
+
+        size_t frames = 0;
+        auto decode = [&](av::Packet &pkt) {
+            CHECK(pkt.streamIndex() == 0);
+            auto frame = dec.decode(pkt);
+            if (frame) {
+                CHECK(frame.width() == avtest::VideoWidth);
+                CHECK(frame.height() == avtest::VideoHeight);
+                ++frames;
+            }
+        };
+
+        parser.parseAll(std::span<const uint8_t>{es.data}, decode);
+        parser.flushAll(decode);
+
+        while (true) {
+            auto frame = dec.decode(av::Packet{});
+            if (!frame)
+                break;
+            ++frames;
+        }
+
+        CHECK(frames == FRAMES);
+    }
+#endif
+}
@@ -0,0 +1,245 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/coroutines.h"
+
+#include "TestMedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+#if AVCPP_CXX_STANDARD >= 20
+
+using namespace std;
+
+namespace {
+
+av::Generator<int> sequence(int count)
+{
+    for (int i = 0; i < count; ++i)
+        co_yield i;
+}
+
+av::Generator<string> strings(av::Generator<int> values)
+{
+    for (auto &value : values)
+        co_yield to_string(value);
+}
+
+av::Generator<int> failing()
+{
+    co_yield 1;
+    throw std::runtime_error("generator failed");
+}
+
+av::Task<int> value(int v)
+{
+    co_return v;
+}
+
+av::Task<int> sum(int count)
+{
+    int result = 0;
+    for (int i = 0; i < count; ++i)
+        result += co_await value(i);
+    co_return result;
+}
+
+av::Task<int> throwing()
+{
+    throw std::runtime_error("task failed");
+    co_return 0;
+}
+
+av::Task<> interleaved(av::Executor &executor, vector<int> &trace, int id)
+{
+    for (int i = 0; i < 3; ++i) {
+        trace.push_back(id);
+        co_await executor.schedule();
+    }
+}
+
+#if AVCPP_HAS_AVFORMAT
+// Elementary stream in memory. Input is not ready while `ready` is false: reads return EAGAIN.
+struct NonBlockingIO : public av::CustomIO
+{
+    vector<uint8_t> data;
+    size_t          pos   = 0;
+    bool            ready = true;
+
+    int read(uint8_t *buf, size_t size) override
+    {
+        if (!ready)
+            return AVERROR(EAGAIN);
+        if (pos == data.size())
+            return AVERROR_EOF;
+        auto const count = std::min(size, data.size() - pos);
+        memcpy(buf, data.data() + pos, count);
+        pos += count;
+        return int(count);
+    }
+};
+#endif // if AVCPP_HAS_AVFORMAT
+
+} // anonymous namespace
+
+TEST_CASE("Coroutines", "[Coroutines]")
+{
+    SECTION("Generator") {
+        vector<string> result;
+        for (auto &str : strings(sequence(5)))
+            result.push_back(std::move(str));
+        CHECK(result == vector<string>{"0", "1", "2", "3", "4"});
+
+        int count = 0;
+        for ([[maybe_unused]] auto &v : sequence(0))
+            ++count;
+        CHECK(count == 0);
+    }
+
+    SECTION("Generator exception") {
+        auto gen = failing();
+        auto it = gen.begin();
+        REQUIRE(it != gen.end());
+        CHECK(*it == 1);
+        CHECK_THROWS_AS(++it, std::runtime_error);
+    }
+
+    SECTION("Task chain and spawn") {
+        av::ManualExecutor executor;
+        int result = -1;
+        bool done = false;
+
+        av::spawn(executor, [](int &result) -> av::Task<> {
+            result = co_await sum(10000); // deep chain: symmetric transfer, no stack growth
+        }(result), [&done](std::exception_ptr error) {
+            done = !error;
+        });
+
+        CHECK(result == -1); // lazy: nothing runs before executor
+        CHECK(executor.pending() == 1);
+        executor.run();
+        CHECK(done);
+        CHECK(result == 49995000);
+    }
+
+    SECTION("Task exception") {
+        av::ManualExecutor executor;
+        std::exception_ptr error;
+        av::spawn(executor, []() -> av::Task<> {
+            co_await throwing();
+        }(), [&error](std::exception_ptr e) { error = e; });
+        executor.run();
+        REQUIRE(error);
+        CHECK_THROWS_AS(std::rethrow_exception(error), std::runtime_error);
+    }
+
+    SECTION("Yield interleaves coroutines") {
+        av::ManualExecutor executor;
+        vector<int> trace;
+        av::spawn(executor, interleaved(executor, trace, 1));
+        av::spawn(executor, interleaved(executor, trace, 2));
+        executor.run();
+        CHECK(trace == vector<int>{1, 2, 1, 2, 1, 2});
+    }
+
+    SECTION("Delayed functions") {
+        av::ManualExecutor executor;
+        vector<int> trace;
+        executor.postAfter(std::chrono::milliseconds(5), [&trace] { trace.push_back(2); });
+        executor.post([&trace] { trace.push_back(1); });
+
+        // Not due delayed function does not keep run()
+        CHECK(executor.run() == 1);
+        CHECK(executor.delayed() == 1);
+        REQUIRE(executor.waitDelayed());
+        CHECK(executor.run() == 1);
+        CHECK(trace == vector<int>{1, 2});
+        CHECK_FALSE(executor.waitDelayed());
+    }
+
+#if AVCPP_HAS_AVFORMAT
+    SECTION("Not ready input does not spin the executor") {
+        NonBlockingIO io;
+        for (auto &pkt : avtest::encode_mpeg4(50))
+            io.data.insert(io.data.end(), pkt.data(), pkt.data() + pkt.size());
+
+        av::FormatContext ictx;
+        ictx.openInput(&io, av::InputFormat("m4v"));
+        ictx.findStreamInfo();
+        io.ready = false;
+
+        av::ManualExecutor executor;
+        av::AsyncDemuxer demuxer{ictx, executor};
+        size_t packets = 0;
+        bool done = false;
+        av::spawn(executor, [](av::AsyncDemuxer &demuxer, size_t &packets) -> av::Task<> {
+            while (co_await demuxer.next())
+                ++packets;
+        }(demuxer, packets), [&done](std::exception_ptr error) {
+            done = !error;
+        });
+
+        // Idle input: read is delayed, not re-posted, so run() returns
+        executor.run();
+        CHECK_FALSE(done);
+        CHECK(executor.pending() == 0);
+        CHECK(executor.delayed() == 1);
+        CHECK(demuxer.retries() == 1);
+
+        // Backoff: 0.5, 1, 2, 4... ms between the reads of the idle input
+        auto const start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100) && executor.waitDelayed())
+            executor.run();
+        CHECK(demuxer.retries() < 20);
+
+        io.ready = true;
+        do {
+            executor.run();
+        } while (executor.waitDelayed());
+        CHECK(done);
+        CHECK(packets > 0);
+    }
+#endif // if AVCPP_HAS_AVFORMAT
+
+    SECTION("Scheduler executor") {
+        av::JobScheduler scheduler{2};
+        av::SchedulerExecutor executor{scheduler, scheduler.createJob("coro")};
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        int finished = 0;
+        std::atomic<int> total{0};
+
+        constexpr int count = 100;
+        for (int i = 0; i < count; ++i) {
+            av::spawn(executor, [](av::Executor &executor, std::atomic<int> &total) -> av::Task<> {
+                for (int n = 0; n < 10; ++n) {
+                    total += co_await value(1);
+                    co_await executor.schedule();
+                }
+            }(executor, total), [&](std::exception_ptr) {
+                std::lock_guard lock{mutex};
+                ++finished;
+                cond.notify_all();
+            });
+        }
+
+        std::unique_lock lock{mutex};
+        cond.wait(lock, [&] { return finished == count; });
+        CHECK(total == count * 10);
+    }
+}
+
+#endif // if AVCPP_CXX_STANDARD >= 20
@@ -0,0 +1,120 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/audioresampler.h"
+#include "avcpp/codec.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/dualstreamtranscoder.h"
+#include "avcpp/syntheticmedia.h"
+#include "avcpp/videorescaler.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+#if AVCPP_HAS_AVFORMAT
+
+using namespace std;
+
+TEST_CASE("DualStreamTranscoder round trip", "[DualStreamTranscoder]")
+{
+    av::SyntheticMedia::Options options;
+    options.duration     = std::chrono::seconds(2);
+    options.video.width  = 160;
+    options.video.height = 120;
+
+    av::MemoryIO      iio{av::SyntheticMedia::generate(options)};
+    av::FormatContext ictx;
+    ictx.openInput(&iio);
+    ictx.findStreamInfo();
+    REQUIRE(ictx.streamsCount() == 2);
+
+    int        videoStream = -1;
+    int        audioStream = -1;
+    av::Stream vst;
+    av::Stream ast;
+    for (size_t i = 0; i < ictx.streamsCount(); ++i) {
+        auto st = ictx.stream(i);
+        if (st.mediaType() == AVMEDIA_TYPE_VIDEO) {
+            videoStream = int(i);
+            vst = st;
+        } else if (st.mediaType() == AVMEDIA_TYPE_AUDIO) {
+            audioStream = int(i);
+            ast = st;
+        }
+    }
+    REQUIRE(videoStream >= 0);
+    REQUIRE(audioStream >= 0);
+
+    av::VideoDecoderContext vdec{vst};
+    vdec.setRefCountedFrames(true);
+    vdec.open(av::Codec());
+
+    av::AudioDecoderContext adec{ast};
+    adec.open(av::Codec());
+
+    // Output: half size video, so rescaler is really used
+    av::MemoryIO      oio;
+    av::FormatContext octx;
+    octx.setFormat(av::OutputFormat{"matroska"});
+
+    av::VideoEncoderContext venc{av::findEncodingCodec(AV_CODEC_ID_MPEG4)};
+    venc.setWidth(80);
+    venc.setHeight(60);
+    venc.setPixelFormat(AV_PIX_FMT_YUV420P);
+    venc.setTimeBase(av::Rational{1, 1000});
+    venc.setBitRate(500'000);
+    venc.open();
+
+    auto acodec = av::findEncodingCodec(AV_CODEC_ID_AAC);
+    av::AudioEncoderContext aenc{acodec};
+    aenc.setSampleRate(44100);
+    aenc.setSampleFormat(acodec.supportedSampleFormats()[0]);
+    aenc.setChannelLayout(AV_CH_LAYOUT_STEREO);
+    aenc.setTimeBase(av::Rational(1, aenc.sampleRate()));
+    aenc.setBitRate(96'000);
+    aenc.open();
+
+    auto vost = octx.addStream(venc);
+    vost.setFrameRate(vst.frameRate());
+    octx.addStream(aenc);
+    octx.openOutput(&oio);
+    octx.writeHeader();
+
+    av::VideoRescaler  rescaler{venc.width(), venc.height(), venc.pixelFormat()};
+    av::AudioResampler resampler(aenc.channelLayout(), aenc.sampleRate(), aenc.sampleFormat(),
+                                 adec.channelLayout(), adec.sampleRate(), adec.sampleFormat());
+
+    av::DualStreamTranscoder transcoder{ictx, octx, {4, 16}};
+    transcoder.setVideo(videoStream, vdec, venc, 0, &rescaler);
+    transcoder.setAudio(audioStream, adec, aenc, 1, &resampler);
+
+    std::error_code ec;
+    transcoder.transcode(ec);
+    REQUIRE(!ec);
+    octx.writeTrailer();
+
+    auto const &stats = transcoder.stats();
+    CHECK(stats.videoFrames == 50);
+    CHECK(stats.videoPackets == 50);
+    CHECK(stats.audioFrames > 0);
+    CHECK(stats.audioPackets > 0);
+    CHECK(stats.muxer.packetsWritten == stats.videoPackets + stats.audioPackets);
+
+    // Read back: both streams are present, converted and have all the packets
+    oio.rewind();
+    av::FormatContext rctx;
+    rctx.openInput(&oio);
+    rctx.findStreamInfo();
+    REQUIRE(rctx.streamsCount() == 2);
+    CHECK(rctx.stream(0).codecParameters().raw()->width == 80);
+    CHECK(rctx.stream(1).codecParameters().raw()->sample_rate == 44100);
+
+    uint64_t packets[2] = {};
+    while (auto pkt = rctx.readPacket())
+        ++packets[pkt.streamIndex()];
+    CHECK(packets[0] == stats.videoPackets);
+    CHECK(packets[1] == stats.audioPackets);
+}
+
+#endif // if AVCPP_HAS_AVFORMAT
@@ -1,5 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstring>
+#include <utility>
 #include <vector>
 
 #include "avcpp/frame.h"
@@ -465,3 +467,189 @@ TEST_CASE("Copy from raw data storage", "[VideoFrame][VideoFrameContruct]")
         CHECK(av_buffer_get_ref_count(&buf_ref_copy) == 1);
     }
 }
+
+TEST_CASE("Crop view and plane views", "[VideoFrame][VideoFrameView]")
+{
+    av::VideoFrame frame{i420_pixfmt, 64, 48};
+    // Pixel value encodes the position
+    auto fill = [&frame](size_t plane, int w, int h) {
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                frame.raw()->data[plane][y * frame.raw()->linesize[plane] + x] = uint8_t(y * 4 + x + plane * 7);
+    };
+    fill(0, 64, 48);
+    fill(1, 32, 24);
+    fill(2, 32, 24);
+
+    SECTION("Plane view") {
+        auto const &cframe = frame;
+        auto const luma = cframe.plane(0);
+        REQUIRE(luma);
+        CHECK(luma.width() == 64);
+        CHECK(luma.height() == 48);
+        CHECK(luma.stride() == frame.raw()->linesize[0]);
+        CHECK(luma(10, 3) == uint8_t(10 * 4 + 3));
+
+        auto const chroma = cframe.plane(2);
+        CHECK(chroma.width() == 32);
+        CHECK(chroma.height() == 24);
+        CHECK(chroma(5, 6) == uint8_t(5 * 4 + 6 + 14));
+
+        CHECK_FALSE(cframe.plane(3));
+
+        // Writes go into the frame
+        auto mutableLuma = frame.plane(0);
+        mutableLuma(0, 0) = 0xAB;
+        CHECK(frame.raw()->data[0][0] == 0xAB);
+
+        CHECK(frame.plane<uint16_t>(0).width() == 32);
+    }
+
+    SECTION("Packed and semi-planar formats") {
+        av::VideoFrame rgb{rgb24_pixfmt, 10, 4};
+        CHECK(rgb.plane(0).width() == 30);
+        // Reinterpretation needs the line multiple of the element size
+        CHECK_FALSE(rgb.plane<uint32_t>(0));
+
+        av::VideoFrame nv12{nv12_pixfmt, 10, 4};
+        CHECK(nv12.plane(1).width() == 10);
+        CHECK(nv12.plane(1).height() == 2);
+    }
+
+    SECTION("Crop view shares buffers") {
+        auto const refs = av_buffer_get_ref_count(frame.raw()->buf[0]);
+        auto view = frame.cropView(av::Rect{8, 4, 16, 12});
+        REQUIRE(view.isValid());
+        CHECK(view.width() == 16);
+        CHECK(view.height() == 12);
+        CHECK(view.pixelFormat() == AV_PIX_FMT_YUV420P);
+        CHECK(av_buffer_get_ref_count(frame.raw()->buf[0]) == refs + 1);
+
+        CHECK(view.plane(0)(0, 0) == frame.plane(0)(4, 8));
+        CHECK(view.plane(1)(0, 0) == frame.plane(1)(2, 4));
+        CHECK(view.plane(2)(1, 1) == frame.plane(2)(3, 5));
+        CHECK(view.raw()->data[0] == frame.raw()->data[0] + 4 * frame.raw()->linesize[0] + 8);
+    }
+
+    SECTION("Crop view origin is aligned to the chroma grid") {
+        auto view = frame.cropView(av::Rect{5, 3, 10, 10});
+        CHECK(view.width() == 11);
+        CHECK(view.height() == 11);
+        CHECK(view.plane(0)(0, 0) == frame.plane(0)(2, 4));
+        CHECK(view.plane(1).width() == 6);
+    }
+
+    SECTION("Invalid crop") {
+        std::error_code ec;
+        frame.cropView(av::Rect{60, 0, 10, 10}, ec);
+        CHECK(ec == av::Errors::InvalidArgument);
+
+        frame.cropView(av::Rect{0, 0, 0, 10}, ec);
+        CHECK(ec == av::Errors::InvalidArgument);
+
+        av::VideoFrame{}.cropView(av::Rect{0, 0, 1, 1}, ec);
+        CHECK(ec == av::Errors::FrameInvalid);
+    }
+}
+
+TEST_CASE("Copy-on-write clone", "[Frame][FrameCopyOnWrite]")
+{
+    SECTION("Video") {
+        av::VideoFrame frame{i420_pixfmt, 64, 48};
+        memset(frame.data(0), 0x10, size_t(frame.raw()->linesize[0] * 48));
+        CHECK(frame.isWritable());
+        CHECK_FALSE(frame.isCopyOnWrite());
+
+        auto clone = frame.clone(av::FrameCommon::copy_on_write{});
+        CHECK(clone.isCopyOnWrite());
+        CHECK(frame.isCopyOnWrite());
+        CHECK(clone.refCount() == 2);
+        CHECK_FALSE(clone.isWritable());
+
+        // Read access does not copy
+        auto const &cclone = clone;
+        CHECK(cclone.data(0) == std::as_const(frame).data(0));
+        CHECK(cclone.plane(0)(0, 0) == 0x10);
+        CHECK(clone.refCount() == 2);
+
+        // First write copies
+        clone.data(0)[0] = 0x20;
+        CHECK(clone.isWritable());
+        CHECK(clone.refCount() == 1);
+        CHECK(frame.refCount() == 1);
+        CHECK(frame.data(0)[0] == 0x10);
+        CHECK(clone.data(0)[1] == 0x10);
+        CHECK(clone.width() == 64);
+        CHECK(clone.height() == 48);
+
+        // Source is not copied again: it is the only owner now
+        auto const source = frame.raw()->data[0];
+        frame.data(0)[0] = 0x30;
+        CHECK(frame.raw()->data[0] == source);
+        CHECK(clone.data(0)[0] == 0x20);
+    }
+
+    SECTION("Source is written first") {
+        av::VideoFrame frame{i420_pixfmt, 64, 48};
+        frame.data(0)[0] = 1;
+        auto clone = frame.clone(av::FrameCommon::copy_on_write{});
+        auto const shared = clone.raw()->data[0];
+
+        frame.plane(0)(0, 0) = 2;
+        CHECK(frame.raw()->data[0] != shared);
+        CHECK(clone.raw()->data[0] == shared);
+        CHECK(clone.plane(0)(0, 0) == 1);
+    }
+
+    SECTION("Read-only source is not changed") {
+        av::VideoFrame frame{i420_pixfmt, 64, 48};
+        frame.data(0)[0] = 1;
+        auto const &source = frame;
+
+        av::VideoFrame copy{source};
+        copy.setCopyOnWrite(true);
+        CHECK_FALSE(source.isCopyOnWrite());
+
+        copy.data(0)[0] = 2;
+        CHECK(source.data(0)[0] == 1);
+        CHECK(source.refCount() == 1);
+    }
+
+    SECTION("Deep clone and plain copies") {
+        av::VideoFrame frame{i420_pixfmt, 64, 48};
+        auto deep = frame.clone();
+        CHECK(deep.refCount() == 1);
+        CHECK_FALSE(deep.isCopyOnWrite());
+
+        // Plain copies share buffers and writes as before
+        auto copy = frame;
+        copy.data(0)[0] = 0x42;
+        CHECK(frame.raw()->data[0][0] == 0x42);
+        CHECK(copy.refCount() == 2);
+    }
+
+    SECTION("Audio") {
+        av::AudioSamples samples{AV_SAMPLE_FMT_S16, 1024, AV_CH_LAYOUT_STEREO, 48000};
+        memset(samples.data(0), 0, samples.size(0));
+
+        auto clone = samples.clone(av::FrameCommon::copy_on_write{});
+        CHECK(clone.refCount() == 2);
+        clone.data(0)[0] = 0x7f;
+        CHECK(clone.refCount() == 1);
+        CHECK(samples.raw()->data[0][0] == 0);
+        CHECK(clone.samplesCount() == 1024);
+    }
+
+    SECTION("Make writable") {
+        av::VideoFrame frame{i420_pixfmt, 64, 48};
+        auto copy = frame;
+        CHECK_FALSE(copy.isWritable());
+        copy.makeWritable();
+        CHECK(copy.isWritable());
+        CHECK(frame.isWritable());
+
+        std::error_code ec;
+        av::VideoFrame::null().makeWritable(ec);
+        CHECK(ec == av::Errors::Unallocated);
+    }
+}
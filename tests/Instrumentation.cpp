@@ -0,0 +1,159 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/codec.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/frame.h"
+#include "avcpp/instrumentation.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+using namespace std::chrono_literals;
+
+TEST_CASE("LatencyHistogram", "[Instrumentation]")
+{
+    av::LatencyHistogram hist;
+    hist.add(0ns);
+    hist.add(1us);
+    hist.add(3us);
+    hist.add(1500us);
+    hist.add(10s);
+
+    CHECK(hist.count == 5);
+    CHECK(hist.counts[0] == 2); // <= 1us
+    CHECK(hist.counts[2] == 1); // <= 4us
+    CHECK(hist.counts[11] == 1); // <= 2048us
+    CHECK(hist.counts[av::LatencyHistogram::Buckets - 1] == 1);
+    CHECK(hist.sum == 10s + 1504us);
+
+    CHECK(hist.quantile(0.0) == 1us);
+    CHECK(hist.quantile(0.5) == 4us);
+    CHECK(hist.quantile(0.8) == 2048us);
+    CHECK(hist.quantile(1.0) == std::chrono::microseconds::max());
+}
+
+TEST_CASE("Instrumentation", "[Instrumentation]")
+{
+    av::Instrumentation::reset();
+    int object = 0;
+
+    SECTION("Disabled scope records nothing") {
+        av::Instrumentation::setEnabled(false);
+        {
+            av::InstrumentationScope scope{"test", &object, "label"};
+            scope.addBytes(100);
+        }
+        CHECK(av::Instrumentation::snapshot().empty());
+    }
+
+    SECTION("Scopes are accounted per object and kind") {
+        av::Instrumentation::setEnabled(true);
+        for (int i = 0; i < 3; ++i) {
+            av::InstrumentationScope scope{"test", &object, "label"};
+            scope.addBytes(10);
+        }
+        {
+            av::InstrumentationScope scope{"other", &object};
+        }
+        av::Instrumentation::setEnabled(false);
+
+        auto metrics = av::Instrumentation::snapshot();
+        REQUIRE(metrics.size() == 2);
+        auto test = std::find_if(metrics.begin(), metrics.end(), [](auto const &m) { return m.kind == "test"; });
+        REQUIRE(test != metrics.end());
+        CHECK(test->label == "label");
+        CHECK(test->object == reinterpret_cast<uintptr_t>(&object));
+        CHECK(test->calls == 3);
+        CHECK(test->bytes == 30);
+        CHECK(test->latency.count == 3);
+
+        av::Instrumentation::forget(&object);
+        CHECK(av::Instrumentation::snapshot().empty());
+    }
+
+    SECTION("Threads share per-object counters") {
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&object] {
+                for (int i = 0; i < 1000; ++i)
+                    av::Instrumentation::record("test", &object, nullptr, 1us, 2);
+            });
+        }
+        for (auto &th : threads)
+            th.join();
+
+        auto metrics = av::Instrumentation::snapshot();
+        REQUIRE(metrics.size() == 1);
+        CHECK(metrics[0].calls == 4000);
+        CHECK(metrics[0].bytes == 8000);
+        CHECK(metrics[0].latency.counts[0] == 4000);
+
+        // Forgotten counters are not reused by the same address
+        av::Instrumentation::record("test", &object, nullptr, 1us, 2);
+        av::Instrumentation::forget(&object);
+        av::Instrumentation::record("test", &object, nullptr, 1us, 2);
+        metrics = av::Instrumentation::snapshot();
+        REQUIRE(metrics.size() == 1);
+        CHECK(metrics[0].calls == 1);
+    }
+
+    SECTION("Exporters") {
+        av::Instrumentation::record("decode", &object, "h\"264", 3us, 1000);
+        auto metrics = av::Instrumentation::snapshot();
+
+        auto prom = av::Instrumentation::toPrometheus(metrics, "test");
+        CHECK(prom.find("# TYPE test_calls_total counter\n") != string::npos);
+        CHECK(prom.find("test_calls_total{kind=\"decode\",label=\"h\\\"264\",object=\"0x") != string::npos);
+        CHECK(prom.find("} 1000\n") != string::npos);
+        CHECK(prom.find(",le=\"2e-06\"} 0\n") != string::npos);
+        CHECK(prom.find(",le=\"4e-06\"} 1\n") != string::npos);
+        CHECK(prom.find(",le=\"+Inf\"} 1\n") != string::npos);
+        CHECK(prom.find("test_latency_seconds_count{") != string::npos);
+
+        auto json = av::Instrumentation::toJson(metrics);
+        CHECK(json.rfind("{\"objects\":[{\"kind\":\"decode\",\"label\":\"h\\\"264\"", 0) == 0);
+        CHECK(json.find("\"calls\":1,\"bytes\":1000") != string::npos);
+        CHECK(json.find("\"sum_ns\":3000") != string::npos);
+        CHECK(json.find("{\"le_us\":null,\"count\":0}]}}]}") != string::npos);
+
+        CHECK(av::Instrumentation::toJson({}) == "{\"objects\":[]}");
+    }
+
+    if (av::Instrumentation::isCompiled()) {
+        SECTION("Encoder hooks") {
+            av::VideoEncoderContext enc{av::findEncodingCodec(AV_CODEC_ID_MPEG4)};
+            enc.setWidth(64);
+            enc.setHeight(48);
+            enc.setPixelFormat(AV_PIX_FMT_YUV420P);
+            enc.setTimeBase(av::Rational{1, 25});
+            enc.open();
+
+            av::Instrumentation::setEnabled(true);
+            av::VideoFrame frame{AV_PIX_FMT_YUV420P, 64, 48};
+            memset(frame.data(0), 0x80, size_t(frame.raw()->linesize[0] * 48));
+            frame.setTimeBase(av::Rational{1, 25});
+            frame.setPts(av::Timestamp{0, av::Rational{1, 25}});
+            auto pkt = enc.encode(frame);
+            while (!pkt)
+                pkt = enc.encode();
+            av::Instrumentation::setEnabled(false);
+
+            auto metrics = av::Instrumentation::snapshot();
+            auto encode = std::find_if(metrics.begin(), metrics.end(), [](auto const &m) { return m.kind == "encode"; });
+            REQUIRE(encode != metrics.end());
+            CHECK(encode->label == "mpeg4");
+            CHECK(encode->calls >= 1);
+            CHECK(encode->bytes >= pkt.size());
+        }
+    }
+
+    av::Instrumentation::reset();
+}
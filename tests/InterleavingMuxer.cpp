@@ -0,0 +1,165 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/interleavingmuxer.h"
+#include "avcpp/syntheticmedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+#if AVCPP_HAS_AVFORMAT
+
+using namespace std;
+
+namespace {
+
+// Demuxed packets of the synthetic input, per stream
+struct Source
+{
+    av::MemoryIO          io;
+    av::FormatContext     ictx;
+    vector<av::Packet>    packets[2];
+
+    Source()
+    {
+        av::SyntheticMedia::Options options;
+        options.duration     = std::chrono::seconds(2);
+        options.video.width  = 160;
+        options.video.height = 120;
+        av::SyntheticMedia::generate(&io, options);
+        io.rewind();
+
+        ictx.openInput(&io);
+        ictx.findStreamInfo();
+        REQUIRE(ictx.streamsCount() == 2);
+
+        while (auto pkt = ictx.readPacket())
+            packets[pkt.streamIndex()].push_back(std::move(pkt));
+    }
+
+    size_t count() const noexcept
+    {
+        return packets[0].size() + packets[1].size();
+    }
+};
+
+// Output with the streams of the source: packets are copied as is
+void setup_output(av::FormatContext &octx, av::MemoryIO &io, const av::FormatContext &ictx)
+{
+    octx.setFormat(av::OutputFormat{"matroska"});
+    for (size_t i = 0; i < ictx.streamsCount(); ++i) {
+        auto const ist = ictx.stream(i);
+        auto ost = octx.addStream();
+        ost.setCodecParameters(ist.codecParameters());
+        ost.codecParameters().codecTag(0);
+        ost.setTimeBase(ist.timeBase());
+    }
+    octx.openOutput(&io);
+    octx.writeHeader();
+}
+
+double order_seconds(const av::Packet &pkt)
+{
+    auto const ts = pkt.dts().isNoPts() ? pkt.pts() : pkt.dts();
+    return ts.seconds();
+}
+
+// Written packets in the file order
+vector<av::Packet> read_back(av::MemoryIO &io)
+{
+    io.rewind();
+    av::FormatContext ictx;
+    ictx.openInput(&io);
+    ictx.findStreamInfo();
+
+    vector<av::Packet> packets;
+    while (auto pkt = ictx.readPacket())
+        packets.push_back(std::move(pkt));
+    return packets;
+}
+
+} // anonymous namespace
+
+TEST_CASE("InterleavingMuxer", "[InterleavingMuxer]")
+{
+    Source source;
+
+    SECTION("Skewed producers are written in DTS order") {
+        av::MemoryIO      io;
+        av::FormatContext octx;
+        setup_output(octx, io, source.ictx);
+
+        av::InterleavingMuxer muxer{octx, source.count()};
+
+        // Audio is produced at once, video lags behind: as a cheap audio encoder and an expensive video one
+        auto produce = [&muxer, &source](size_t stream, std::chrono::microseconds delay) {
+            for (auto const &pkt : source.packets[stream]) {
+                std::this_thread::sleep_for(delay);
+                muxer.write(av::Packet{pkt});
+            }
+            muxer.finishStream(stream);
+        };
+
+        std::thread video{produce, size_t(0), std::chrono::microseconds(500)};
+        std::thread audio{produce, size_t(1), std::chrono::microseconds(0)};
+        video.join();
+        audio.join();
+        muxer.flush();
+        octx.writeTrailer();
+
+        auto const stats = muxer.stats();
+        CHECK(stats.packetsWritten == source.count());
+        CHECK(stats.forcedWrites == 0);
+
+        auto const written = read_back(io);
+        REQUIRE(written.size() == source.count());
+        for (size_t i = 1; i < written.size(); ++i)
+            CHECK(order_seconds(written[i - 1]) <= order_seconds(written[i]));
+    }
+
+    SECTION("Lookahead bounds the queue of the stalled stream") {
+        av::MemoryIO      io;
+        av::FormatContext octx;
+        setup_output(octx, io, source.ictx);
+
+        constexpr size_t lookahead = 8;
+        av::InterleavingMuxer muxer{octx, lookahead};
+
+        // Video stalls until the whole audio is produced
+        for (auto const &pkt : source.packets[1])
+            muxer.write(av::Packet{pkt});
+        for (auto const &pkt : source.packets[0])
+            muxer.write(av::Packet{pkt});
+        muxer.finishStream(0);
+        muxer.finishStream(1);
+        muxer.flush();
+        octx.writeTrailer();
+
+        auto const stats = muxer.stats();
+        CHECK(stats.packetsWritten == source.count());
+        CHECK(stats.forcedWrites > 0);
+        CHECK(stats.maxQueued <= 2 * (lookahead + 1));
+    }
+
+    SECTION("Invalid stream") {
+        av::MemoryIO      io;
+        av::FormatContext octx;
+        setup_output(octx, io, source.ictx);
+
+        av::InterleavingMuxer muxer{octx};
+        av::Packet pkt{source.packets[0].front()};
+        pkt.setStreamIndex(5);
+        std::error_code ec;
+        muxer.write(std::move(pkt), ec);
+        CHECK(ec == av::Errors::InvalidArgument);
+        muxer.finishStream(5, ec);
+        CHECK(ec == av::Errors::InvalidArgument);
+    }
+}
+
+#endif // if AVCPP_HAS_AVFORMAT
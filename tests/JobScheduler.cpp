@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
+
+#include "avcpp/jobscheduler.h"
+
+using namespace std;
+
+TEST_CASE("Job scheduler", "[JobScheduler]")
+{
+    SECTION("Runs all tasks") {
+        av::JobScheduler scheduler{4};
+        CHECK(scheduler.threadsCount() == 4);
+        CHECK(scheduler.currentWorker() == -1);
+
+        auto job = scheduler.createJob("sum");
+        std::atomic<int> sum{0};
+        for (int i = 1; i <= 1000; ++i)
+            scheduler.post(job, [&sum, i] { sum += i; });
+        job->wait();
+
+        CHECK(sum == 500500);
+        CHECK(job->pendingTasks() == 0);
+        auto const stats = job->stats();
+        CHECK(stats.tasks == 1000);
+        CHECK(stats.maxQueueLatency >= stats.averageQueueLatency());
+    }
+
+    SECTION("Tasks posted from the worker") {
+        av::JobScheduler scheduler{2};
+        auto job = scheduler.createJob();
+
+        std::atomic<int> count{0};
+        std::atomic<bool> onWorker{true};
+        std::function<void(int)> spawn = [&](int depth) {
+            if (scheduler.currentWorker() < 0)
+                onWorker = false;
+            ++count;
+            if (depth < 10) {
+                scheduler.post(job, [&spawn, depth] { spawn(depth + 1); });
+                scheduler.post(job, [&spawn, depth] { spawn(depth + 1); });
+            }
+        };
+        scheduler.post(job, [&spawn] { spawn(0); });
+        job->wait();
+
+        CHECK(count == 2047);
+        CHECK(onWorker);
+    }
+
+    SECTION("Priorities") {
+        // Single worker: order is defined
+        av::JobScheduler scheduler{1};
+        auto low  = scheduler.createJob("low", av::JobPriority::Low);
+        auto high = scheduler.createJob("high", av::JobPriority::High);
+
+        std::mutex gate;
+        std::unique_lock lock{gate};
+        std::atomic<bool> started{false};
+        scheduler.post(low, [&] { // hold the worker
+            started = true;
+            std::lock_guard l{gate};
+        });
+        while (!started)
+            std::this_thread::yield();
+
+        vector<char> order;
+        std::mutex orderMutex;
+        for (int i = 0; i < 3; ++i) {
+            scheduler.post(low, [&] { std::lock_guard l{orderMutex}; order.push_back('l'); });
+            scheduler.post(high, [&] { std::lock_guard l{orderMutex}; order.push_back('h'); });
+        }
+        lock.unlock();
+
+        low->wait();
+        high->wait();
+
+        REQUIRE(order.size() == 6);
+        CHECK(order[0] == 'h');
+        CHECK(order[1] == 'h');
+        CHECK(order[2] == 'h');
+    }
+
+    SECTION("Exception does not kill worker") {
+        av::JobScheduler scheduler{1};
+        auto job = scheduler.createJob();
+        bool done = false;
+        scheduler.post(job, [] { throw std::runtime_error("task failed"); });
+        scheduler.post(job, [&done] { done = true; });
+        job->wait();
+        CHECK(done);
+    }
+
+    SECTION("Priority change") {
+        av::JobScheduler scheduler{1};
+        auto job = scheduler.createJob("job", av::JobPriority::Low);
+        CHECK(job->name() == "job");
+        CHECK(job->priority() == av::JobPriority::Low);
+        job->setPriority(av::JobPriority::High);
+        CHECK(job->priority() == av::JobPriority::High);
+    }
+}
@@ -0,0 +1,255 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "avcpp/logsink.h"
+#include "avcpp/tracing.h"
+
+extern "C" {
+#include <libavutil/log.h>
+}
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+namespace {
+
+struct Captured
+{
+    int         level;
+    const void *context;
+    string      tag;
+    string      message;
+    uint32_t    thread;
+    uint64_t    suppressed;
+};
+
+struct Capture
+{
+    std::mutex       access;
+    vector<Captured> records;
+
+    av::LogSink::Handler handler()
+    {
+        return [this](const av::LogRecord &rec) {
+            lock_guard lock{access};
+            records.push_back({rec.level, rec.context, string(rec.tag), string(rec.message), rec.thread, rec.suppressed});
+        };
+    }
+};
+
+const AVClass s_testClass = {
+    .class_name = "logsink-test",
+    .item_name  = av_default_item_name,
+    .option     = nullptr,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+struct TestContext
+{
+    const AVClass *cls = &s_testClass;
+};
+
+} // anonymous namespace
+
+TEST_CASE("LogSink", "[LogSink]")
+{
+    auto const savedLevel = av_log_get_level();
+    av_log_set_level(AV_LOG_INFO);
+
+    Capture capture;
+    av::LogSink::Options opts;
+    opts.handler   = capture.handler();
+    opts.rateLimit = 0;
+
+    SECTION("Install and uninstall") {
+        av::LogSink::install(opts);
+        CHECK(av::LogSink::isInstalled());
+        av::LogSink::uninstall();
+        CHECK_FALSE(av::LogSink::isInstalled());
+        // Idempotent
+        av::LogSink::uninstall();
+    }
+
+    SECTION("Messages are tagged and filtered by level") {
+        TestContext ctx;
+        av::LogSink::install(opts);
+        av_log(&ctx, AV_LOG_WARNING, "value %d\n", 42);
+        av_log(&ctx, AV_LOG_DEBUG, "filtered %d\n", 1);
+        av_log(nullptr, AV_LOG_ERROR, "no context\n");
+        av::LogSink::flush();
+
+        {
+            lock_guard lock{capture.access};
+            REQUIRE(capture.records.size() == 2);
+            CHECK(capture.records[0].level == AV_LOG_WARNING);
+            CHECK(capture.records[0].context == &ctx);
+            CHECK(capture.records[0].tag == "logsink-test");
+            CHECK(capture.records[0].message == "value 42\n");
+            CHECK(capture.records[1].context == nullptr);
+            CHECK(capture.records[1].tag.empty());
+            CHECK(capture.records[1].message == "no context\n");
+        }
+
+        av::LogSink::uninstall();
+    }
+
+    SECTION("Thread ids match the trace ones") {
+        av::LogSink::install(opts);
+        av::Tracer::start();
+        thread worker{[] {
+            av::TraceSpan span{"worker"};
+            av_log(nullptr, AV_LOG_ERROR, "worker\n");
+        }};
+        worker.join();
+        av::Tracer::stop();
+        av::LogSink::uninstall();
+
+        auto const events = av::Tracer::collect();
+        REQUIRE(events.size() == 1);
+        REQUIRE(capture.records.size() == 1);
+        CHECK(capture.records[0].thread == events[0].thread);
+    }
+
+    SECTION("Long messages are truncated") {
+        av::LogSink::install(opts);
+        string text(av::LogSink::MessageSize * 2, 'x');
+        av_log(nullptr, AV_LOG_ERROR, "%s", text.c_str());
+        av::LogSink::uninstall();
+
+        REQUIRE(capture.records.size() == 1);
+        CHECK(capture.records[0].message.size() == av::LogSink::MessageSize - 1);
+    }
+
+    SECTION("Rate limit per context") {
+        TestContext noisy;
+        TestContext quiet;
+        opts.rateLimit = 5;
+        av::LogSink::install(opts);
+        auto const before = av::LogSink::stats();
+
+        for (int i = 0; i < 20; ++i)
+            av_log(&noisy, AV_LOG_ERROR, "broken frame %d\n", i);
+        av_log(&quiet, AV_LOG_ERROR, "other context\n");
+        av::LogSink::uninstall();
+
+        auto const after = av::LogSink::stats();
+        auto const noisyCount = std::count_if(capture.records.begin(), capture.records.end(), [&](auto const &rec) {
+            return rec.context == &noisy;
+        });
+        // Window can change during the loop
+        CHECK(noisyCount >= 5);
+        CHECK(noisyCount <= 10);
+        CHECK(after.suppressed - before.suppressed == uint64_t(20 - noisyCount));
+        CHECK(capture.records.back().message == "other context\n");
+    }
+
+    SECTION("Contexts do not share the rate limit") {
+        vector<TestContext> contexts(500);
+        opts.rateLimit = 2;
+        opts.ringSize  = 2048;
+        av::LogSink::install(opts);
+
+        // Start of the window: all messages are logged within the same second
+        auto const now = chrono::steady_clock::now();
+        this_thread::sleep_until(chrono::steady_clock::time_point{
+            chrono::duration_cast<chrono::seconds>(now.time_since_epoch()) + chrono::seconds(1)});
+        auto const before = av::LogSink::stats();
+
+        for (auto &ctx : contexts) {
+            for (int i = 0; i < 3; ++i)
+                av_log(&ctx, AV_LOG_ERROR, "broken frame %d\n", i);
+        }
+        av::LogSink::uninstall();
+
+        auto const after = av::LogSink::stats();
+        CHECK(after.suppressed - before.suppressed == contexts.size());
+        CHECK(capture.records.size() == contexts.size() * 2);
+    }
+
+    SECTION("Threads do not lose messages") {
+        opts.ringSize      = 4096;
+        opts.drainInterval = chrono::milliseconds(1);
+        av::LogSink::install(opts);
+        auto const before = av::LogSink::stats();
+
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([] {
+                for (int i = 0; i < 1000; ++i)
+                    av_log(nullptr, AV_LOG_ERROR, "%d\n", i);
+            });
+        }
+        for (auto &th : threads)
+            th.join();
+        av::LogSink::uninstall();
+
+        auto const after = av::LogSink::stats();
+        CHECK(after.dropped == before.dropped);
+        CHECK(after.written - before.written == 4000);
+        CHECK(capture.records.size() == 4000);
+
+        // Per-thread order is kept
+        vector<vector<int>> perThread;
+        vector<uint32_t> ids;
+        for (auto const &rec : capture.records) {
+            auto it = std::find(ids.begin(), ids.end(), rec.thread);
+            if (it == ids.end()) {
+                ids.push_back(rec.thread);
+                perThread.emplace_back();
+                it = ids.end() - 1;
+            }
+            perThread[size_t(it - ids.begin())].push_back(std::stoi(rec.message));
+        }
+        REQUIRE(perThread.size() == 4);
+        for (auto const &values : perThread) {
+            CHECK(values.size() == 1000);
+            CHECK(std::is_sorted(values.begin(), values.end()));
+        }
+    }
+
+    SECTION("Rings of the exited threads are freed") {
+        av::LogSink::install(opts);
+        for (int round = 0; round < 3; ++round) {
+            vector<thread> threads;
+            for (int t = 0; t < 4; ++t)
+                threads.emplace_back([] { av_log(nullptr, AV_LOG_ERROR, "worker\n"); });
+            for (auto &th : threads)
+                th.join();
+            av::LogSink::flush();
+            CHECK(av::LogSink::stats().rings == 0);
+        }
+
+        // Ring of the running thread is kept
+        av_log(nullptr, AV_LOG_ERROR, "main\n");
+        av::LogSink::flush();
+        CHECK(av::LogSink::stats().rings == 1);
+        av::LogSink::uninstall();
+        CHECK(capture.records.size() == 13);
+    }
+
+    SECTION("Ring overflow drops messages") {
+        opts.ringSize      = 4;
+        opts.drainInterval = chrono::milliseconds(10000);
+        av::LogSink::install(opts);
+        auto const before = av::LogSink::stats();
+
+        for (int i = 0; i < 10; ++i)
+            av_log(nullptr, AV_LOG_ERROR, "%d\n", i);
+        av::LogSink::uninstall();
+
+        // Spurious drain wake up frees the ring earlier
+        auto const after = av::LogSink::stats();
+        CHECK(capture.records.size() >= 4);
+        CHECK(after.dropped - before.dropped + capture.records.size() == 10);
+    }
+
+    av_log_set_level(savedLevel);
+}
@@ -0,0 +1,140 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/codec.h"
+#include "avcpp/lowlatency.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+TEST_CASE("LowLatencyProfile", "[LowLatency]")
+{
+    av::LowLatencyProfile profile;
+    profile.gopSize = 10;
+    profile.threads = 2;
+
+    SECTION("Decoder") {
+        av::VideoDecoderContext dec{av::findDecodingCodec(AV_CODEC_ID_MPEG4)};
+        profile.applyDecoder(dec);
+        CHECK(dec.isFlags(AV_CODEC_FLAG_LOW_DELAY));
+        CHECK(dec.threadType() == FF_THREAD_SLICE);
+        CHECK(dec.threadCount() == 2);
+    }
+
+    SECTION("Encoder") {
+        av::VideoEncoderContext enc{av::findEncodingCodec(AV_CODEC_ID_MPEG4)};
+        enc.setMaxBFrames(2);
+        profile.applyEncoder(enc);
+        CHECK(enc.raw()->max_b_frames == 0);
+        CHECK(enc.gopSize() == 10);
+        CHECK(enc.threadType() == FF_THREAD_SLICE);
+
+        // Unknown zero-latency options are skipped
+        enc.setWidth(64);
+        enc.setHeight(48);
+        enc.setPixelFormat(AV_PIX_FMT_YUV420P);
+        enc.setTimeBase(av::Rational{1, 25});
+        std::error_code ec;
+        enc.open(ec);
+        CHECK(!ec);
+    }
+
+#if AVCPP_HAS_AVFORMAT
+    SECTION("Input") {
+        av::FormatContext ctx;
+        profile.applyInput(ctx);
+        CHECK((ctx.raw()->flags & AVFMT_FLAG_NOBUFFER));
+        CHECK(ctx.raw()->probesize == 32);
+        CHECK(ctx.raw()->max_analyze_duration == 0);
+    }
+
+    SECTION("Output") {
+        av::FormatContext ctx;
+        profile.applyOutput(ctx);
+        CHECK(ctx.raw()->flush_packets == 1);
+    }
+#endif // if AVCPP_HAS_AVFORMAT
+}
+
+TEST_CASE("LatencyTracker", "[LowLatency]")
+{
+    av::LatencyTracker tracker{{"demux", "decode", "encode"}};
+
+    SECTION("Stages are accounted in order") {
+        for (int64_t i = 0; i < 10; ++i)
+            tracker.mark(0, 0, av::Timestamp{i * 3003, av::Rational{1, 90000}});
+        // Decoder and encoder change time base: matched by time within tolerance
+        for (int64_t i = 0; i < 10; ++i)
+            tracker.mark(1, 0, av::Timestamp{i * 3003, av::Rational{1, 90000}});
+        for (int64_t i = 0; i < 10; ++i)
+            tracker.mark(2, 0, av::Timestamp{i * 1001 / 30, av::Rational{1, 1000}});
+
+        auto const stats = tracker.stats();
+        REQUIRE(stats.size() == 3);
+        CHECK(stats[0].name == "demux");
+        CHECK(stats[0].count == 10);
+        CHECK(stats[1].count == 10);
+        CHECK(stats[2].count == 10);
+        CHECK(stats[2].min <= stats[2].max);
+
+        auto const total = tracker.total();
+        CHECK(total.count == 10);
+        CHECK(total.max >= stats[2].max);
+        CHECK(tracker.unmatched() == 0);
+        CHECK(tracker.dropped() == 0);
+    }
+
+    SECTION("Streams are tracked separately") {
+        tracker.mark(0, 0, av::Timestamp{0, av::Rational{1, 25}});
+        tracker.mark(1, 1, av::Timestamp{0, av::Rational{1, 25}});
+        tracker.mark(2, 0, av::Timestamp{0, av::Rational{1, 25}});
+
+        CHECK(tracker.unmatched() == 1);
+        CHECK(tracker.stats()[1].count == 0);
+        // Skipped stage is accounted to the next one
+        CHECK(tracker.stats()[2].count == 1);
+        CHECK(tracker.total().count == 1);
+    }
+
+    SECTION("Items without PTS are skipped") {
+        tracker.mark(0, 0, av::Timestamp{});
+        CHECK(tracker.stats()[0].count == 0);
+    }
+
+    SECTION("Lost items are dropped") {
+        av::LatencyTracker bounded{{"in", "out"}, std::chrono::milliseconds(1), 4};
+        for (int64_t i = 0; i < 10; ++i)
+            bounded.mark(0, 0, av::Timestamp{i, av::Rational{1, 25}});
+        CHECK(bounded.dropped() == 6);
+        bounded.mark(1, 0, av::Timestamp{9, av::Rational{1, 25}});
+        bounded.mark(1, 0, av::Timestamp{0, av::Rational{1, 25}});
+        CHECK(bounded.total().count == 1);
+        CHECK(bounded.unmatched() == 1);
+
+        bounded.reset();
+        CHECK(bounded.stats()[0].name == "in");
+        CHECK(bounded.stats()[0].count == 0);
+        CHECK(bounded.dropped() == 0);
+    }
+
+    SECTION("Pending items are bounded per stream") {
+        av::LatencyTracker bounded{{"in", "out"}, std::chrono::milliseconds(1), 4};
+        // Stream 1 is lost after the first stage, stream 0 is processed
+        for (int64_t i = 0; i < 10; ++i) {
+            bounded.mark(0, 0, av::Timestamp{i, av::Rational{1, 25}});
+            bounded.mark(0, 1, av::Timestamp{i, av::Rational{1, 25}});
+        }
+        CHECK(bounded.dropped() == 12);
+
+        // The last 4 items of every stream are kept
+        for (int64_t i = 6; i < 10; ++i) {
+            bounded.mark(1, 0, av::Timestamp{i, av::Rational{1, 25}});
+            bounded.mark(1, 1, av::Timestamp{i, av::Rational{1, 25}});
+        }
+        CHECK(bounded.total().count == 8);
+        CHECK(bounded.unmatched() == 0);
+    }
+}
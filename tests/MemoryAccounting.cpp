@@ -0,0 +1,174 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <thread>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/buffer.h"
+#include "avcpp/frame.h"
+#include "avcpp/memoryaccounting.h"
+#include "avcpp/packet.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+TEST_CASE("MemoryAccounting", "[MemoryAccounting]")
+{
+    av::MemoryAccounting::setEnabled(true);
+
+    SECTION("Objects are accounted per owner and kind") {
+        av::MemoryTag a, b, c;
+        {
+            av::MemoryOwnerScope owner{"test-job-1"};
+            av::MemoryAccounting::track(a, av::MemoryKind::VideoFrame, 1000);
+            av::MemoryAccounting::track(b, av::MemoryKind::Packet, 100);
+            {
+                av::MemoryOwnerScope nested{"test-job-2"};
+                av::MemoryAccounting::track(c, av::MemoryKind::VideoFrame, 500);
+            }
+        }
+
+        auto job1 = av::MemoryAccounting::usage("test-job-1");
+        CHECK(job1.owner == "test-job-1");
+        CHECK(job1[av::MemoryKind::VideoFrame].objects == 1);
+        CHECK(job1[av::MemoryKind::VideoFrame].bytes == 1000);
+        CHECK(job1[av::MemoryKind::Packet].bytes == 100);
+        CHECK(job1.total.objects == 2);
+        CHECK(job1.total.bytes == 1100);
+
+        auto job2 = av::MemoryAccounting::usage("test-job-2");
+        CHECK(job2.total.bytes == 500);
+
+        // Resize keeps owner
+        av::MemoryAccounting::track(a, av::MemoryKind::VideoFrame, 400);
+        CHECK(av::MemoryAccounting::usage("test-job-1").total.bytes == 500);
+        CHECK(av::MemoryAccounting::usage("test-job-1").total.peakBytes >= 1100);
+
+        av::MemoryAccounting::untrack(a);
+        av::MemoryAccounting::untrack(b);
+        av::MemoryAccounting::untrack(c);
+        av::MemoryAccounting::untrack(c); // idempotent
+
+        job1 = av::MemoryAccounting::usage("test-job-1");
+        CHECK(job1.total.objects == 0);
+        CHECK(job1.total.bytes == 0);
+        CHECK(job1.total.allocations >= 2);
+        CHECK(av::MemoryAccounting::usage("test-job-2").total.bytes == 0);
+
+        bool found = false;
+        for (auto const &usage : av::MemoryAccounting::snapshot())
+            found |= usage.owner == "test-job-1";
+        CHECK(found);
+        CHECK(av::MemoryAccounting::usage("test-unknown-job").total.allocations == 0);
+    }
+
+    SECTION("High watermark reset") {
+        av::MemoryOwnerScope owner{"test-peak"};
+        av::MemoryAccounting::resetPeaks("test-peak");
+
+        av::MemoryTag tag;
+        av::MemoryAccounting::track(tag, av::MemoryKind::AudioSamples, 4096);
+        av::MemoryAccounting::track(tag, av::MemoryKind::AudioSamples, 1024);
+        CHECK(av::MemoryAccounting::usage("test-peak").total.peakBytes == 4096);
+
+        av::MemoryAccounting::resetPeaks("test-peak");
+        CHECK(av::MemoryAccounting::usage("test-peak").total.peakBytes == 1024);
+
+        av::MemoryAccounting::untrack(tag);
+        av::MemoryAccounting::resetPeaks();
+        CHECK(av::MemoryAccounting::usage("test-peak").total.peakBytes == 0);
+    }
+
+    SECTION("Owner is per thread") {
+        av::MemoryOwnerScope owner{"test-main-thread"};
+        av::MemoryTag tag;
+        thread th{[&tag] {
+            av::MemoryAccounting::track(tag, av::MemoryKind::Packet, 10);
+        }};
+        th.join();
+        CHECK(tag.owner == 0);
+        CHECK(av::MemoryAccounting::usage("test-main-thread").total.allocations == 0);
+        av::MemoryAccounting::untrack(tag);
+    }
+
+    SECTION("Disabled accounting does not track new objects") {
+        av::MemoryAccounting::setEnabled(false);
+        av::MemoryTag tag;
+        av::MemoryAccounting::track(tag, av::MemoryKind::Packet, 10);
+        CHECK_FALSE(tag.tracked);
+    }
+
+    SECTION("Buffers are accounted till the last reference") {
+        av::MemoryOwnerScope owner{"test-buffers"};
+        {
+            av::BufferRef buf{1024};
+            REQUIRE_FALSE(buf.isNull());
+            auto ref = buf;
+            buf.reset();
+            if (av::MemoryAccounting::isCompiled())
+                CHECK(av::MemoryAccounting::usage("test-buffers")[av::MemoryKind::Buffer].bytes == 1024);
+        }
+        CHECK(av::MemoryAccounting::usage("test-buffers")[av::MemoryKind::Buffer].bytes == 0);
+
+        {
+            av::BufferPool pool{256};
+            CHECK(pool.bufferSize() == 256);
+            auto first = pool.get();
+            REQUIRE_FALSE(first.isNull());
+            CHECK(first.size() == 256);
+            {
+                auto second = pool.get();
+            }
+            if (av::MemoryAccounting::isCompiled()) {
+                // Returned buffer stays in the pool
+                auto usage = av::MemoryAccounting::usage("test-buffers")[av::MemoryKind::BufferPool];
+                CHECK(usage.objects == 2);
+                CHECK(usage.bytes == 512);
+            }
+        }
+        CHECK(av::MemoryAccounting::usage("test-buffers")[av::MemoryKind::BufferPool].bytes == 0);
+
+        av::BufferPool null;
+        std::error_code ec;
+        CHECK(null.get(ec).isNull());
+        CHECK(ec == av::Errors::Unallocated);
+    }
+
+    if (av::MemoryAccounting::isCompiled()) {
+        SECTION("Wrapper hooks") {
+            av::MemoryOwnerScope owner{"test-wrappers"};
+            {
+                av::VideoFrame frame{AV_PIX_FMT_YUV420P, 64, 48};
+                av::AudioSamples samples{AV_SAMPLE_FMT_S16, 1024, AV_CH_LAYOUT_STEREO, 48000};
+                av::Packet packet{vector<uint8_t>(100, 1)};
+
+                auto usage = av::MemoryAccounting::usage("test-wrappers");
+                CHECK(usage[av::MemoryKind::VideoFrame].objects == 1);
+                CHECK(usage[av::MemoryKind::VideoFrame].bytes >= 64 * 48 * 3 / 2);
+                CHECK(usage[av::MemoryKind::AudioSamples].objects == 1);
+                CHECK(usage[av::MemoryKind::AudioSamples].bytes >= 1024 * 2 * 2);
+                CHECK(usage[av::MemoryKind::Packet].objects == 1);
+                CHECK(usage[av::MemoryKind::Packet].bytes >= 100);
+
+                // Copy references the same buffers, move keeps the single object
+                auto copy  = frame;
+                auto moved = std::move(packet);
+                usage = av::MemoryAccounting::usage("test-wrappers");
+                CHECK(usage[av::MemoryKind::VideoFrame].objects == 2);
+                CHECK(usage[av::MemoryKind::Packet].objects == 1);
+
+                av::VideoFrame empty{nullptr};
+                copy = empty;
+                CHECK(av::MemoryAccounting::usage("test-wrappers")[av::MemoryKind::VideoFrame].objects == 1);
+            }
+            auto usage = av::MemoryAccounting::usage("test-wrappers");
+            CHECK(usage.total.objects == 0);
+            CHECK(usage.total.bytes == 0);
+            CHECK(usage.total.peakBytes > 0);
+        }
+    }
+
+    av::MemoryAccounting::setEnabled(false);
+}
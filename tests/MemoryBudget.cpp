@@ -0,0 +1,258 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/buffer.h"
+#include "avcpp/memorybudget.h"
+#include "avcpp/pipeline.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+using namespace std::chrono_literals;
+
+namespace {
+
+av::Packet make_packet(size_t size)
+{
+    return av::Packet{vector<uint8_t>(size, 0x42)};
+}
+
+} // anonymous namespace
+
+TEST_CASE("MemoryBudget", "[MemoryBudget]")
+{
+    SECTION("Limit and peak") {
+        av::MemoryBudget budget{100};
+        CHECK(budget.tryAcquire(60));
+        CHECK_FALSE(budget.tryAcquire(60));
+        CHECK(budget.tryAcquire(40));
+        CHECK(budget.isExhausted());
+        budget.release(100);
+        CHECK(budget.used() == 0);
+
+        // Single item bigger than limit passes when nothing is accounted
+        CHECK(budget.tryAcquire(1000));
+        budget.release(1000);
+
+        auto stats = budget.stats();
+        CHECK(stats.limit == 100);
+        CHECK(stats.peak == 1000);
+        budget.resetPeak();
+        CHECK(budget.stats().peak == 0);
+    }
+
+    SECTION("Blocked acquire, stall time and cancel") {
+        av::MemoryBudget budget{100};
+        REQUIRE(budget.tryAcquire(100));
+
+        // Release only when acquire() is blocked
+        std::thread releaser{[&budget] {
+            while (budget.stats().waits != 1)
+                this_thread::yield();
+            budget.release(100);
+        }};
+        CHECK(budget.acquire(50));
+        releaser.join();
+
+        auto stats = budget.stats();
+        CHECK(stats.waits == 1);
+        CHECK(stats.stallTime > 0ns);
+        CHECK(stats.used == 50);
+
+        std::atomic_bool cancelled{false};
+        budget.forceAcquire(100);
+        bool acquired = true;
+        std::thread waiter{[&] { acquired = budget.acquire(10, &cancelled); }};
+        while (budget.stats().waits != 2)
+            this_thread::yield();
+        cancelled = true;
+        budget.wakeWaiters();
+        waiter.join();
+        CHECK_FALSE(acquired);
+        CHECK(budget.used() == 150);
+
+        budget.cancel();
+        CHECK_FALSE(budget.acquire(10));
+    }
+
+    SECTION("Payload bytes") {
+        auto const pkt = make_packet(1000);
+        CHECK(av::MemoryBudget::payloadBytes(pkt) >= 1000);
+        CHECK(av::MemoryBudget::payloadBytes(av::Packet{}) == 0);
+
+        av::VideoFrame frame{AV_PIX_FMT_YUV420P, 64, 48};
+        CHECK(av::MemoryBudget::payloadBytes(frame) >= 64 * 48 * 3 / 2);
+        CHECK(av::MemoryBudget::payloadBytes(42) == 0);
+    }
+
+    SECTION("Buffer pool") {
+        auto budget = std::make_shared<av::MemoryBudget>(1500);
+        {
+            av::BufferPool pool{1000, budget};
+            auto first = pool.get();
+            CHECK(budget->used() == 1000);
+
+            // Pool does not wait for the budget, other producers do
+            auto second = pool.get();
+            CHECK(budget->used() == 2000);
+            CHECK_FALSE(budget->tryAcquire(1));
+
+            // Returned buffers stay charged till the pool is gone
+            first.reset();
+            second.reset();
+            CHECK(budget->used() == 2000);
+            auto reused = pool.get();
+            CHECK(budget->used() == 2000);
+        }
+        CHECK(budget->used() == 0);
+    }
+}
+
+TEST_CASE("Bounded queue with memory budget", "[Pipeline][MemoryBudget]")
+{
+    auto const unit = av::MemoryBudget::payloadBytes(make_packet(1000));
+
+    SECTION("Queues share the budget") {
+        auto budget = make_shared<av::MemoryBudget>(unit * 3);
+        av::BoundedQueue<av::Packet> first{8}, second{8};
+        first.setBudget(budget);
+        second.setBudget(budget);
+
+        REQUIRE(first.push(make_packet(1000)));
+        REQUIRE(first.push(make_packet(1000)));
+        REQUIRE(second.push(make_packet(1000)));
+        CHECK(budget->used() == unit * 3);
+        CHECK(first.bytes() == unit * 2);
+        CHECK(first.isFull());
+
+        // Empty queue always accepts
+        av::BoundedQueue<av::Packet> third{8};
+        third.setBudget(budget);
+        REQUIRE(third.push(make_packet(1000)));
+        CHECK(budget->used() == unit * 4);
+
+        std::atomic_bool pushed{false};
+        std::thread producer{[&] {
+            pushed = second.push(make_packet(1000));
+        }};
+        while (budget->stats().waits != 1)
+            this_thread::yield();
+        CHECK_FALSE(pushed);
+
+        av::Packet pkt;
+        REQUIRE(first.pop(pkt));
+        REQUIRE(first.pop(pkt));
+        producer.join();
+        CHECK(pushed);
+        CHECK(second.size() == 2);
+        CHECK(budget->stats().waits == 1);
+        CHECK(budget->stats().stallTime > 0ns);
+    }
+
+    SECTION("Queue releases the budget on destruction") {
+        auto budget = make_shared<av::MemoryBudget>(unit * 10);
+        {
+            av::BoundedQueue<av::Packet> queue{8};
+            queue.setBudget(budget);
+            queue.push(make_packet(1000));
+            queue.push(make_packet(1000));
+            CHECK(budget->used() == unit * 2);
+        }
+        CHECK(budget->used() == 0);
+    }
+
+    SECTION("Cancel wakes up producer blocked on the budget") {
+        auto budget = make_shared<av::MemoryBudget>(unit);
+        av::BoundedQueue<av::Packet> queue{8};
+        queue.setBudget(budget);
+        REQUIRE(queue.push(make_packet(1000)));
+
+        bool pushed = true;
+        std::thread producer{[&] { pushed = queue.push(make_packet(1000)); }};
+        while (budget->stats().waits != 1)
+            this_thread::yield();
+        queue.cancel();
+        producer.join();
+        CHECK_FALSE(pushed);
+        CHECK(budget->used() == unit);
+    }
+
+    SECTION("Drop policy") {
+        auto budget = make_shared<av::MemoryBudget>(unit * 2, av::MemoryBudget::Policy::Drop);
+        av::BoundedQueue<av::Packet> queue{8};
+        queue.setBudget(budget);
+        for (int i = 0; i < 5; ++i)
+            REQUIRE(queue.push(make_packet(1000)));
+
+        CHECK(queue.size() == 2);
+        auto stats = budget->stats();
+        CHECK(stats.drops == 3);
+        CHECK(stats.droppedBytes == unit * 3);
+        CHECK(stats.waits == 0);
+    }
+}
+
+TEST_CASE("Pipeline with memory budget", "[Pipeline][MemoryBudget]")
+{
+    auto const unit  = av::MemoryBudget::payloadBytes(make_packet(1000));
+    auto const count = 200;
+
+    auto build = [&](av::Pipeline &pipeline, const shared_ptr<av::MemoryBudget> &budget, size_t &maxUsed, int &received) {
+        pipeline.setMemoryBudget(budget);
+
+        auto packets = pipeline.source<av::Packet>([counter = 0](const av::PipelineEmitter<av::Packet> &emit) mutable {
+            if (counter == count)
+                return false;
+            ++counter;
+            emit(make_packet(1000));
+            return true;
+        });
+        auto passed = pipeline.stage<av::Packet>(packets, [](av::Packet &&pkt, const av::PipelineEmitter<av::Packet> &emit) {
+            emit(std::move(pkt));
+        });
+
+        pipeline.sink(passed, [&maxUsed, &received, budget](av::Packet &&) {
+            maxUsed = std::max(maxUsed, budget->used());
+            this_thread::sleep_for(100us); // slow consumer
+            ++received;
+        });
+    };
+
+    SECTION("Threads") {
+        auto budget = make_shared<av::MemoryBudget>(unit * 4);
+        av::Pipeline pipeline{16};
+        size_t maxUsed = 0;
+        int received = 0;
+        build(pipeline, budget, maxUsed, received);
+        pipeline.run();
+        pipeline.wait();
+
+        CHECK(received == count);
+        // Empty queue accepts item over the limit
+        CHECK(maxUsed <= unit * 6);
+        CHECK(budget->used() == 0);
+        CHECK(budget->stats().waits > 0);
+    }
+
+    SECTION("JobScheduler") {
+        av::JobScheduler scheduler{2};
+        auto budget = make_shared<av::MemoryBudget>(unit * 4);
+        av::Pipeline pipeline{16};
+        size_t maxUsed = 0;
+        int received = 0;
+        build(pipeline, budget, maxUsed, received);
+        pipeline.run(scheduler);
+        pipeline.wait();
+
+        CHECK(received == count);
+        // Non-blocking producers can overcommit by a step
+        CHECK(maxUsed <= unit * 6);
+        CHECK(budget->used() == 0);
+    }
+}
@@ -0,0 +1,163 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/memorybudget.h"
+#include "avcpp/multirescaler.h"
+#include "avcpp/syntheticmedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+namespace {
+
+av::VideoFrame make_source(av::PixelFormat pixelFormat = AV_PIX_FMT_RGB24)
+{
+    av::SyntheticVideo::Options options;
+    options.width       = 1280;
+    options.height      = 720;
+    options.pixelFormat = pixelFormat;
+    options.noise       = 0.0;
+    av::SyntheticVideo video{options};
+    return video.frame(3);
+}
+
+// Mean absolute difference of the luma planes
+double luma_difference(const av::VideoFrame &lhs, const av::VideoFrame &rhs)
+{
+    double sum = 0;
+    for (int y = 0; y < lhs.height(); ++y) {
+        auto a = lhs.raw()->data[0] + y * lhs.raw()->linesize[0];
+        auto b = rhs.raw()->data[0] + y * rhs.raw()->linesize[0];
+        for (int x = 0; x < lhs.width(); ++x)
+            sum += std::abs(int(a[x]) - int(b[x]));
+    }
+    return sum / (lhs.width() * lhs.height());
+}
+
+const vector<av::MultiRescaler::Output> ladder = {
+    {640, 360}, {1280, 720}, {320, 180}, {160, 90},
+};
+
+} // anonymous namespace
+
+TEST_CASE("MultiRescaler", "[MultiRescaler][VideoRescaler]")
+{
+    auto const src = make_source();
+
+    SECTION("Outputs and cascade plan") {
+        av::MultiRescaler::Options options;
+        options.workPixelFormat = AV_PIX_FMT_YUV420P;
+        av::MultiRescaler rescaler{ladder, options};
+
+        auto const frames = rescaler.rescale(src);
+        REQUIRE(frames.size() == ladder.size());
+        for (size_t i = 0; i < ladder.size(); ++i) {
+            CHECK(frames[i].width() == ladder[i].width);
+            CHECK(frames[i].height() == ladder[i].height);
+            CHECK(frames[i].pixelFormat() == AV_PIX_FMT_YUV420P);
+            CHECK(frames[i].pts() == src.pts());
+        }
+
+        // 720p is scaled from the converted source, 360p from 720p, 180p from 360p and 90p from 180p
+        auto const &plan = rescaler.plan();
+        CHECK(plan[1] == -1);
+        CHECK(plan[0] == 1);
+        CHECK(plan[2] == 0);
+        CHECK(plan[3] == 2);
+
+        // Cascaded results are close to the direct ones
+        av::VideoRescaler direct{320, 180, AV_PIX_FMT_YUV420P};
+        auto const reference = direct.rescale(src);
+        CHECK(luma_difference(frames[2], reference) < 3.0);
+    }
+
+    SECTION("Cascading disabled") {
+        av::MultiRescaler::Options options;
+        options.workPixelFormat = AV_PIX_FMT_YUV420P;
+        options.cascadeRatio    = 0;
+        av::MultiRescaler rescaler{ladder, options};
+        rescaler.rescale(src);
+        for (auto const from : rescaler.plan())
+            CHECK(from == -1);
+    }
+
+    SECTION("Per-output pixel format") {
+        av::MultiRescaler rescaler{vector<av::MultiRescaler::Output>{
+            {640, 360, AV_PIX_FMT_YUV420P}, {320, 180, AV_PIX_FMT_GRAY8}, {160, 90},
+        }};
+        auto const frames = rescaler.rescale(src);
+        CHECK(frames[0].pixelFormat() == AV_PIX_FMT_YUV420P);
+        CHECK(frames[1].pixelFormat() == AV_PIX_FMT_GRAY8);
+        CHECK(frames[2].pixelFormat() == AV_PIX_FMT_YUV420P);
+
+        // Outputs of other formats are scaled from the source and not cascaded from
+        CHECK(rescaler.plan()[1] == -1);
+        CHECK(rescaler.plan()[2] == 0);
+    }
+
+    SECTION("Parallel") {
+        av::JobScheduler scheduler{4};
+        av::MultiRescaler::Options options;
+        options.workPixelFormat = AV_PIX_FMT_YUV420P;
+        options.scheduler       = &scheduler;
+        av::MultiRescaler parallel{ladder, options};
+        options.scheduler       = nullptr;
+        av::MultiRescaler sequential{ladder, options};
+
+        vector<av::VideoFrame> frames;
+        for (int i = 0; i < 3; ++i) {
+            // Frames of the previous iteration are returned to the pools
+            parallel.rescale(frames, src);
+            auto const expected = sequential.rescale(src);
+            for (size_t j = 0; j < ladder.size(); ++j)
+                CHECK(luma_difference(frames[j], expected[j]) == 0.0);
+        }
+    }
+
+    SECTION("Memory budget") {
+        auto budget = std::make_shared<av::MemoryBudget>(0);
+        {
+            av::MultiRescaler::Options options;
+            options.workPixelFormat = AV_PIX_FMT_YUV420P;
+            options.memoryBudget    = budget;
+            av::MultiRescaler rescaler{ladder, options};
+
+            auto const frames = rescaler.rescale(src);
+            size_t payload = 0;
+            for (auto const &frame : frames)
+                payload += av::MemoryBudget::payloadBytes(frame);
+            // Outputs and the converted source are pooled
+            CHECK(budget->used() > payload);
+        }
+        CHECK(budget->used() == 0);
+        CHECK(budget->stats().peak > 0);
+    }
+
+    SECTION("Source format change") {
+        av::MultiRescaler rescaler{ladder};
+        auto const rgb = rescaler.rescale(src);
+        CHECK(rgb[1].pixelFormat() == AV_PIX_FMT_RGB24);
+
+        auto const yuv = rescaler.rescale(make_source(AV_PIX_FMT_YUV420P));
+        CHECK(yuv[1].pixelFormat() == AV_PIX_FMT_YUV420P);
+        CHECK(yuv[1].width() == 1280);
+        CHECK(yuv[1].height() == 720);
+    }
+
+    SECTION("Invalid parameters") {
+        av::MultiRescaler rescaler{vector<av::MultiRescaler::Output>{{0, 180}}};
+        std::error_code ec;
+        rescaler.rescale(src, ec);
+        CHECK(ec == av::Errors::RescalerInvalidParameters);
+
+        av::MultiRescaler valid{ladder};
+        valid.rescale(av::VideoFrame{}, ec);
+        CHECK(ec == av::Errors::RescalerInvalidParameters);
+    }
+}
@@ -0,0 +1,205 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/nalunits.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+#if AVCPP_CXX_STANDARD >= 20
+
+using namespace std;
+
+namespace {
+
+const uint8_t* find_start_code_ref(const uint8_t *begin, const uint8_t *end)
+{
+    for (auto p = begin; end - p >= 3; ++p) {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+            return p;
+    }
+    return end;
+}
+
+// Build length prefixed stream from NAL units without zero bytes (no emulation prevention needed)
+vector<uint8_t> make_avcc(const vector<vector<uint8_t>> &nals, int lengthSize)
+{
+    vector<uint8_t> out;
+    for (auto const &nal : nals) {
+        auto const len = uint32_t(nal.size());
+        for (int i = lengthSize - 1; i >= 0; --i)
+            out.push_back(uint8_t(len >> (8 * i)));
+        out.insert(out.end(), nal.begin(), nal.end());
+    }
+    return out;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Start code scanner", "[NalUnits]")
+{
+    INFO("Scanner: " << av::startCodeScannerName());
+
+    SECTION("Simple") {
+        const vector<uint8_t> data = {1, 2, 0, 0, 1, 3, 0, 0, 0, 1};
+        auto begin = data.data();
+        auto end = begin + data.size();
+        CHECK(av::findStartCode(begin, end) == begin + 2);
+        CHECK(av::findStartCode(begin + 3, end) == begin + 7);
+        CHECK(av::findStartCode(begin + 8, end) == end);
+        CHECK(av::findStartCode(begin, begin) == begin);
+    }
+
+    SECTION("Match reference on random data") {
+        // Dense zeros and ones to produce many candidates and vector block boundary crossings
+        std::mt19937 rng{42};
+        for (int iter = 0; iter < 20000; ++iter) {
+            vector<uint8_t> data(rng() % 160);
+            for (auto &byte : data) {
+                auto const r = rng() % 10;
+                byte = r < 5 ? 0 : (r < 7 ? 1 : uint8_t(rng()));
+            }
+            auto const offset = data.empty() ? 0 : rng() % (data.size() + 1);
+            auto const begin = data.data() + offset;
+            auto const end = data.data() + data.size();
+            REQUIRE(av::findStartCode(begin, end) == find_start_code_ref(begin, end));
+        }
+    }
+}
+
+TEST_CASE("NAL units iteration", "[NalUnits]")
+{
+    SECTION("Annex B, mixed start codes and trailing zeros") {
+        const vector<uint8_t> data = {
+            0, 0, 0, 1, 0x67, 1, 2,
+            0, 0, 1, 0x68, 3,
+            0, 0, 0, 0, 1, 0x65, 9, 8,
+        };
+
+        vector<av::NalUnit> nals;
+        for (auto const &nal : av::AnnexBNalUnits{std::span<const uint8_t>{data}})
+            nals.push_back(nal);
+
+        REQUIRE(nals.size() == 3);
+        CHECK(nals[0].h264Type() == 7);
+        CHECK(nals[0].prefixSize == 4);
+        CHECK(nals[0].size() == 3);
+        CHECK(nals[1].h264Type() == 8);
+        CHECK(nals[1].prefixSize == 3);
+        CHECK(nals[1].size() == 2); // trailing zero dropped
+        CHECK(nals[2].h264Type() == 5);
+        CHECK(nals[2].prefixSize == 4);
+        CHECK(nals[2].size() == 3);
+    }
+
+    SECTION("Packet") {
+        const vector<uint8_t> data = {0, 0, 1, 0x40, 0x01, 0x0c, 0, 0, 1, 0x26, 0x01, 0xaf};
+        av::Packet pkt{data};
+
+        size_t count = 0;
+        for (auto const &nal : av::AnnexBNalUnits{pkt}) {
+            CHECK(nal.data.data() >= pkt.data());
+            CHECK(nal.data.data() + nal.size() <= pkt.data() + pkt.size());
+            CHECK(nal.hevcType() == (count == 0 ? 32 : 19)); // VPS, IDR_W_RADL
+            ++count;
+        }
+        CHECK(count == 2);
+    }
+
+    SECTION("Empty and garbage") {
+        const vector<uint8_t> garbage = {1, 2, 3, 4, 5};
+        av::AnnexBNalUnits units{std::span<const uint8_t>{garbage}};
+        CHECK(units.begin() == units.end());
+
+        av::AnnexBNalUnits empty{std::span<const uint8_t>{}};
+        CHECK(empty.begin() == empty.end());
+    }
+
+    SECTION("Length prefixed") {
+        const vector<vector<uint8_t>> nals = {{0x67, 1, 2, 3}, {0x68, 4}, {0x65, 5, 6, 7, 8, 9}};
+        for (int lengthSize : {1, 2, 3, 4}) {
+            auto const data = make_avcc(nals, lengthSize);
+            size_t index = 0;
+            for (auto const &nal : av::LengthPrefixedNalUnits{std::span<const uint8_t>{data}, lengthSize}) {
+                REQUIRE(index < nals.size());
+                CHECK(std::equal(nal.data.begin(), nal.data.end(), nals[index].begin(), nals[index].end()));
+                ++index;
+            }
+            CHECK(index == nals.size());
+        }
+    }
+
+    SECTION("Length prefixed, malformed") {
+        const vector<uint8_t> data = {0, 0, 0, 2, 0x67, 1, 0, 0, 0, 100, 0x68};
+        size_t count = 0;
+        for ([[maybe_unused]] auto const &nal : av::LengthPrefixedNalUnits{std::span<const uint8_t>{data}})
+            ++count;
+        CHECK(count == 1);
+    }
+}
+
+TEST_CASE("AVCC and Annex B in-place conversion", "[NalUnits]")
+{
+    const vector<vector<uint8_t>> nals = {{0x67, 1, 2, 3}, {0x68, 4}, {0x65, 5, 6, 7, 8, 9}};
+
+    SECTION("Round trip") {
+        for (int lengthSize : {3, 4}) {
+            auto data = make_avcc(nals, lengthSize);
+            auto const orig = data;
+
+            REQUIRE(av::avccToAnnexBInPlace(std::span<uint8_t>{data}, lengthSize));
+            CHECK(av::isAnnexB(data));
+
+            size_t index = 0;
+            for (auto const &nal : av::AnnexBNalUnits{std::span<const uint8_t>{data}}) {
+                REQUIRE(index < nals.size());
+                CHECK(nal.prefixSize == lengthSize);
+                CHECK(std::equal(nal.data.begin(), nal.data.end(), nals[index].begin(), nals[index].end()));
+                ++index;
+            }
+            CHECK(index == nals.size());
+
+            REQUIRE(av::annexBToAvccInPlace(std::span<uint8_t>{data}, lengthSize));
+            CHECK(data == orig);
+        }
+    }
+
+    SECTION("Sizes do not allow") {
+        // Mixed start codes can't be rewritten into 4-bytes length in-place
+        vector<uint8_t> data = {0, 0, 0, 1, 0x67, 1, 0, 0, 1, 0x68, 2};
+        auto const orig = data;
+        CHECK_FALSE(av::annexBToAvccInPlace(std::span<uint8_t>{data}, 4));
+        CHECK(data == orig);
+
+        // 2-bytes length can't be replaced by start code
+        auto avcc = make_avcc(nals, 2);
+        auto const origAvcc = avcc;
+        CHECK_FALSE(av::avccToAnnexBInPlace(std::span<uint8_t>{avcc}, 2));
+        CHECK(avcc == origAvcc);
+    }
+
+    SECTION("Packet") {
+        auto data = make_avcc(nals, 4);
+        av::Packet pkt{data};
+        av::Packet shared = pkt; // payload shared: must be copied before modification
+
+        REQUIRE(av::avccToAnnexBInPlace(pkt, 4));
+        CHECK(av::isAnnexB(pkt.span()));
+        CHECK(!av::isAnnexB(shared.span()));
+        CHECK(std::equal(shared.span().begin(), shared.span().end(), data.begin(), data.end()));
+    }
+
+    SECTION("Extradata length size") {
+        const vector<uint8_t> avcC = {0x01, 0x42, 0x00, 0x0a, 0xfd, 0xe1, 0x00, 0x00};
+        CHECK(av::nalLengthSizeFromExtradata(avcC, false) == 2);
+        const vector<uint8_t> annexb = {0x00, 0x00, 0x00, 0x01, 0x67};
+        CHECK(av::nalLengthSizeFromExtradata(annexb, false) == 0);
+    }
+}
+
+#endif // AVCPP_CXX_STANDARD >= 20
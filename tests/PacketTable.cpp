@@ -0,0 +1,125 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+#include <filesystem>
+#include <fstream>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/packettable.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+#if AVCPP_CXX_STANDARD >= 20
+
+using namespace std;
+
+namespace {
+
+av::Packet make_packet(int streamIndex, size_t size, int64_t ts, const av::Rational &tb, bool key)
+{
+    vector<uint8_t> data(size, 0x5a);
+    av::Packet pkt{data};
+    pkt.setStreamIndex(streamIndex);
+    pkt.setTimeBase(tb);
+    pkt.setPts({ts, tb});
+    pkt.setDts({ts, tb});
+    pkt.setKeyPacket(key);
+    return pkt;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Packet table", "[PacketTable]")
+{
+    auto const path = (std::filesystem::temp_directory_path() / "avcpp-packet-table-test.avpt").string();
+
+    SECTION("Write and read back") {
+        {
+            av::PacketTableWriter writer;
+            writer.addStream(0, {1, 90000});
+            writer.addStream(1, {1, 48000});
+
+            for (int i = 0; i < 300; ++i) {
+                // Video in milliseconds: stored in the registered 1/90000
+                writer.push(make_packet(0, 100 + i, i * 40, {1, 1000}, i % 25 == 0));
+                writer.push(make_packet(1, 10, i * 1024, {1, 48000}, true));
+                writer.push(make_packet(1, 11, i * 1024 + 512, {1, 48000}, true));
+            }
+            CHECK(writer.packetsCount() == 900);
+            writer.save(path);
+        }
+
+        av::PacketTable table{path};
+        REQUIRE(table.isOpened());
+        REQUIRE(table.streamsCount() == 2);
+        CHECK(table.packetsCount() == 900);
+
+        auto video = table.findStream(0);
+        auto audio = table.findStream(1);
+        REQUIRE(video);
+        REQUIRE(audio);
+        CHECK(table.findStream(2) == nullptr);
+
+        CHECK(video->timeBase == av::Rational(1, 90000));
+        REQUIRE(video->count() == 300);
+        CHECK(reinterpret_cast<uintptr_t>(video->pts.data()) % av::PacketTableAlignment == 0);
+        CHECK(video->pts[1] == 3600);
+        CHECK(video->dts[299] == 299 * 3600);
+        CHECK(video->size[299] == 399);
+        CHECK((video->flags[25] & AV_PKT_FLAG_KEY) != 0);
+        CHECK((video->flags[26] & AV_PKT_FLAG_KEY) == 0);
+        CHECK(video->order[1] == 3);
+
+        REQUIRE(audio->count() == 600);
+        uint64_t bytes = 0;
+        for (auto size : audio->size)
+            bytes += size;
+        CHECK(bytes == 300 * 21);
+        CHECK(audio->order[0] == 1);
+        CHECK(audio->order[1] == 2);
+
+        av::PacketTable moved = std::move(table);
+        CHECK(!table.isOpened());
+        CHECK(moved.packetsCount() == 900);
+    }
+
+    SECTION("Packets without payload are ignored") {
+        av::PacketTableWriter writer;
+        writer.push(av::Packet{});
+        writer.push(make_packet(0, 0, 0, {1, 1000}, true));
+        writer.push(make_packet(0, 10, 40, {1, 1000}, true));
+        CHECK(writer.packetsCount() == 1);
+    }
+
+#ifdef __linux__
+    SECTION("Write errors are reported") {
+        av::PacketTableWriter writer;
+        writer.push(make_packet(0, 10, 0, {1, 1000}, true));
+        std::error_code ec;
+        writer.save("/dev/full", ec);
+        CHECK(ec == std::errc::no_space_on_device);
+    }
+#endif
+
+    SECTION("Invalid files") {
+        std::error_code ec;
+        av::PacketTable table;
+        table.open(path + ".missing", ec);
+        CHECK(ec);
+        CHECK(!table.isOpened());
+
+        {
+            std::ofstream out{path, std::ios::binary};
+            out << "definitely not a packet table, but long enough to contain the header bytes..........";
+        }
+        table.open(path, ec);
+        CHECK(ec == make_error_code(av::Errors::PacketTableInvalid));
+        CHECK(!table.isOpened());
+    }
+
+    std::filesystem::remove(path);
+}
+
+#endif // AVCPP_CXX_STANDARD >= 20
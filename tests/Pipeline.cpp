@@ -0,0 +1,359 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+#include <numeric>
+#include <thread>
+#include <string>
+#include <stdexcept>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/pipeline.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+TEST_CASE("Bounded queue", "[Pipeline][BoundedQueue]")
+{
+    SECTION("FIFO, close and drain") {
+        av::BoundedQueue<int> queue{4};
+        CHECK(queue.capacity() == 4);
+        for (int i = 0; i < 4; ++i)
+            REQUIRE(queue.push(int(i)));
+        CHECK(queue.size() == 4);
+        queue.close();
+        CHECK(queue.isClosed());
+        CHECK_FALSE(queue.push(5));
+
+        int value = -1;
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(queue.pop(value));
+            CHECK(value == i);
+        }
+        CHECK_FALSE(queue.pop(value));
+    }
+
+    SECTION("Backpressure") {
+        av::BoundedQueue<int> queue{2};
+        std::thread producer{[&queue] {
+            for (int i = 0; i < 1000; ++i)
+                queue.push(int(i));
+            queue.close();
+        }};
+
+        int value = 0, expected = 0;
+        while (queue.pop(value)) {
+            CHECK(value == expected);
+            CHECK(queue.size() <= 2);
+            ++expected;
+        }
+        producer.join();
+        CHECK(expected == 1000);
+    }
+
+    SECTION("Cancel wakes up blocked producer") {
+        av::BoundedQueue<int> queue{1};
+        REQUIRE(queue.push(1));
+        bool pushed = true;
+        std::thread producer{[&] { pushed = queue.push(2); }};
+        queue.cancel();
+        producer.join();
+        CHECK_FALSE(pushed);
+        int value;
+        CHECK_FALSE(queue.pop(value));
+    }
+
+    SECTION("Several producers") {
+        av::BoundedQueue<int> queue{3, 2};
+        queue.push(1);
+        queue.close();
+        CHECK_FALSE(queue.isClosed());
+        queue.push(2);
+        queue.close();
+        CHECK(queue.isClosed());
+
+        int value;
+        CHECK(queue.pop(value));
+        CHECK(queue.pop(value));
+        CHECK_FALSE(queue.pop(value));
+    }
+}
+
+namespace {
+
+struct FlushingStage
+{
+    int last = 0;
+
+    void operator()(int &&value, const av::PipelineEmitter<int> &emit)
+    {
+        last = value;
+        emit(value * 2);
+    }
+
+    void flush(const av::PipelineEmitter<int> &emit)
+    {
+        emit(-1); // EOF marker
+    }
+};
+
+} // anonymous namespace
+
+TEST_CASE("Pipeline", "[Pipeline]")
+{
+    SECTION("Source, stages and sink") {
+        av::Pipeline pipeline{2};
+
+        int counter = 0;
+        auto numbers = pipeline.source<int>([&counter](const av::PipelineEmitter<int> &emit) {
+            if (counter == 100)
+                return false;
+            emit(counter++);
+            return true;
+        });
+        auto doubled = pipeline.stage<int>(numbers, FlushingStage{});
+        auto strings = pipeline.stage<std::string>(doubled, [](int &&value, const av::PipelineEmitter<std::string> &emit) {
+            emit(std::to_string(value));
+        });
+
+        vector<string> result;
+        pipeline.sink(strings, [&result](std::string &&value) { result.push_back(std::move(value)); });
+
+        CHECK(pipeline.stagesCount() == 4);
+        pipeline.run();
+        pipeline.wait();
+
+        REQUIRE(result.size() == 101);
+        CHECK(result[0] == "0");
+        CHECK(result[99] == "198");
+        CHECK(result[100] == "-1");
+    }
+
+    SECTION("Split and merge") {
+        av::Pipeline pipeline;
+
+        int counter = 0;
+        auto numbers = pipeline.source<int>([&counter](const av::PipelineEmitter<int> &emit) {
+            if (counter == 1000)
+                return false;
+            emit(counter++);
+            return true;
+        });
+        auto parts = pipeline.split(numbers, 2, [](int value) { return size_t(value % 2); });
+        REQUIRE(parts.size() == 2);
+        auto odd = pipeline.stage<int>(parts[1], [](int &&value, const av::PipelineEmitter<int> &emit) {
+            emit(-value);
+        });
+        auto merged = pipeline.merge<int>({parts[0], odd});
+
+        long long sum = 0;
+        size_t count = 0;
+        pipeline.sink(merged, [&](int &&value) {
+            sum += value;
+            ++count;
+        });
+
+        pipeline.run();
+        pipeline.wait();
+
+        CHECK(count == 1000);
+        CHECK(sum == -500); // (0 - 1) + (2 - 3) + ...
+    }
+
+    SECTION("Broadcast") {
+        av::Pipeline pipeline{2};
+
+        int counter = 0;
+        auto numbers = pipeline.source<int>([&counter](const av::PipelineEmitter<int> &emit) {
+            if (counter == 500)
+                return false;
+            emit(counter++);
+            return true;
+        });
+        auto outs = pipeline.broadcast(numbers, 3);
+        REQUIRE(outs.size() == 3);
+
+        vector<long long> sums(3, 0);
+        for (size_t i = 0; i < outs.size(); ++i)
+            pipeline.sink(outs[i], [&sum = sums[i]](int &&value) { sum += value; });
+
+        pipeline.run();
+        pipeline.wait();
+
+        for (auto sum : sums)
+            CHECK(sum == 500 * 499 / 2);
+    }
+
+    SECTION("Error cancels pipeline") {
+        av::Pipeline pipeline{1};
+
+        // Infinite source: only cancellation can stop it
+        auto numbers = pipeline.source<int>([](const av::PipelineEmitter<int> &emit) {
+            emit(1);
+            return true;
+        });
+        int processed = 0;
+        pipeline.sink(numbers, [&processed](int &&) {
+            if (++processed == 50)
+                throw av::Exception(make_error_code(av::Errors::Unallocated));
+        });
+
+        pipeline.run();
+        std::error_code ec;
+        pipeline.wait(ec);
+        CHECK(ec == make_error_code(av::Errors::Unallocated));
+        CHECK(processed == 50);
+    }
+
+    SECTION("Non system errors are rethrown") {
+        av::Pipeline pipeline;
+        auto numbers = pipeline.source<int>([](const av::PipelineEmitter<int> &) -> bool {
+            throw std::runtime_error("source failed");
+        });
+        pipeline.sink(numbers, [](int &&) {});
+
+        pipeline.run();
+        std::error_code ec;
+        CHECK_THROWS_AS(pipeline.wait(ec), std::runtime_error);
+    }
+
+    SECTION("External cancel") {
+        av::Pipeline pipeline{1};
+        auto numbers = pipeline.source<int>([](const av::PipelineEmitter<int> &emit) {
+            emit(1);
+            return true;
+        });
+        pipeline.sink(numbers, [](int &&) {});
+
+        pipeline.run();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pipeline.cancel();
+        pipeline.wait();
+        CHECK(pipeline.isCancelled());
+    }
+}
+
+TEST_CASE("Pipeline on JobScheduler", "[Pipeline][JobScheduler]")
+{
+    av::JobScheduler scheduler{2};
+
+    SECTION("Source, stages and sink") {
+        av::Pipeline pipeline{2};
+
+        int counter = 0;
+        auto numbers = pipeline.source<int>([&counter](const av::PipelineEmitter<int> &emit) {
+            if (counter == 1000)
+                return false;
+            emit(counter++);
+            return true;
+        });
+        auto doubled = pipeline.stage<int>(numbers, FlushingStage{});
+
+        vector<int> result;
+        pipeline.sink(doubled, [&result](int &&value) { result.push_back(value); });
+
+        pipeline.run(scheduler);
+        pipeline.wait();
+
+        REQUIRE(result.size() == 1001);
+        for (int i = 0; i < 1000; ++i)
+            REQUIRE(result[i] == i * 2);
+        CHECK(result[1000] == -1);
+
+        REQUIRE(pipeline.job());
+        CHECK(pipeline.job()->stats().tasks > 0);
+    }
+
+    SECTION("Flush overfills queue") {
+        av::Pipeline pipeline{1};
+
+        int counter = 0;
+        auto numbers = pipeline.source<int>([&counter](const av::PipelineEmitter<int> &emit) {
+            if (counter == 10)
+                return false;
+            emit(counter++);
+            return true;
+        });
+        // Emits everything on flush, like decoder draining
+        vector<int> buffered;
+        auto delayed = pipeline.stage<int>(numbers,
+            [&buffered](int &&value, const av::PipelineEmitter<int> &) { buffered.push_back(value); },
+            [&buffered](const av::PipelineEmitter<int> &emit) {
+                for (auto value : buffered)
+                    emit(value);
+            });
+
+        int sum = 0;
+        pipeline.sink(delayed, [&sum](int &&value) { sum += value; });
+
+        pipeline.run(scheduler);
+        pipeline.wait();
+        CHECK(sum == 45);
+    }
+
+    SECTION("Many pipelines share workers") {
+        constexpr int count = 8;
+        vector<unique_ptr<av::Pipeline>> pipelines;
+        vector<int> counters(count, 0);
+        vector<long long> sums(count, 0);
+
+        for (int n = 0; n < count; ++n) {
+            auto pipeline = make_unique<av::Pipeline>(4);
+            auto numbers = pipeline->source<int>([&counter = counters[n]](const av::PipelineEmitter<int> &emit) {
+                if (counter == 500)
+                    return false;
+                emit(counter++);
+                return true;
+            });
+            auto parts = pipeline->split(numbers, 2, [](int value) { return size_t(value % 2); });
+            auto merged = pipeline->merge<int>(parts);
+            pipeline->sink(merged, [&sum = sums[n]](int &&value) { sum += value; });
+            pipelines.push_back(std::move(pipeline));
+        }
+
+        for (auto &pipeline : pipelines)
+            pipeline->run(scheduler);
+        for (auto &pipeline : pipelines)
+            pipeline->wait();
+
+        for (int n = 0; n < count; ++n)
+            CHECK(sums[n] == 500 * 499 / 2);
+    }
+
+    SECTION("Error cancels pipeline") {
+        av::Pipeline pipeline{1};
+
+        auto numbers = pipeline.source<int>([](const av::PipelineEmitter<int> &emit) {
+            emit(1);
+            return true;
+        });
+        int processed = 0;
+        pipeline.sink(numbers, [&processed](int &&) {
+            if (++processed == 50)
+                throw av::Exception(make_error_code(av::Errors::Unallocated));
+        });
+
+        pipeline.run(scheduler, av::JobPriority::High);
+        std::error_code ec;
+        pipeline.wait(ec);
+        CHECK(ec == make_error_code(av::Errors::Unallocated));
+        CHECK(processed == 50);
+    }
+
+    SECTION("External cancel") {
+        av::Pipeline pipeline{1};
+        auto numbers = pipeline.source<int>([](const av::PipelineEmitter<int> &emit) {
+            emit(1);
+            return true;
+        });
+        pipeline.sink(numbers, [](int &&) {});
+
+        pipeline.run(scheduler);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pipeline.cancel();
+        pipeline.wait();
+        CHECK(pipeline.isCancelled());
+    }
+}
@@ -0,0 +1,126 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/result.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/audioresampler.h"
+#include "avcpp/frame.h"
+#include "avcpp/packet.h"
+
+#if AVCPP_HAS_AVFORMAT
+#include "avcpp/formatcontext.h"
+#endif // if AVCPP_HAS_AVFORMAT
+
+#include "TestMedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr size_t FRAMES = 10;
+
+} // anonymous namespace
+
+TEST_CASE("Result", "[Result]")
+{
+    SECTION("States") {
+        av::Result<int> ok{42};
+        CHECK(ok);
+        CHECK(ok.isOk());
+        CHECK(*ok == 42);
+        CHECK(ok.errorValue() == 0);
+        CHECK_FALSE(ok.error());
+
+        auto again = av::Result<int>::again();
+        CHECK_FALSE(again);
+        CHECK(again.isAgain());
+        CHECK(again.errorValue() == AVERROR(EAGAIN));
+        CHECK(again.error() == av::make_ffmpeg_error(AVERROR(EAGAIN)));
+        CHECK(std::move(again).valueOr(7) == 7);
+
+        auto eof = av::make_result_status<int>(AVERROR_EOF);
+        CHECK(eof.isEof());
+        CHECK(eof.errorValue() == AVERROR_EOF);
+
+        auto error = av::Result<int>::error(av::Errors::CodecOutputPending);
+        CHECK(error.isError());
+        CHECK(error.error() == av::Errors::CodecOutputPending);
+        CHECK_THROWS_AS(error.throwIfError(), av::Exception);
+
+        std::error_code ec;
+        error.throwIfError(ec);
+        CHECK(ec == av::Errors::CodecOutputPending);
+        again.throwIfError(ec);
+        CHECK_FALSE(ec);
+
+        // Not an FFmpeg category: EAGAIN value is not special
+        auto other = av::make_result_status<void>(AVERROR(EAGAIN), av::avcpp_category());
+        CHECK(other.isError());
+    }
+
+    SECTION("Encode and decode loops") {
+        av::VideoEncoderContext enc{av::findEncodingCodec(AV_CODEC_ID_MPEG4)};
+        avtest::configure_mpeg4(enc);
+        enc.setGopSize(4);
+        enc.open();
+
+        vector<av::Packet> packets;
+        for (size_t i = 0; i < FRAMES; ++i) {
+            auto res = enc.tryEncode(avtest::make_frame(i));
+            for (; res; res = enc.tryEncode())
+                packets.push_back(std::move(res).value());
+            CHECK(res.isAgain());
+        }
+        // Drain
+        auto res = enc.tryEncode(av::VideoFrame(nullptr));
+        for (; res; res = enc.tryEncode())
+            packets.push_back(std::move(res).value());
+        CHECK(res.isEof());
+        CHECK(packets.size() == FRAMES);
+
+        av::VideoDecoderContext dec{av::findDecodingCodec(AV_CODEC_ID_MPEG4)};
+        dec.setTimeBase(av::Rational{1, 25});
+        dec.open();
+
+        size_t frames = 0;
+        for (auto const &pkt : packets) {
+            auto frame = dec.tryDecode(pkt);
+            for (; frame; frame = dec.tryDecode()) {
+                CHECK(frame->width() == avtest::VideoWidth);
+                CHECK(frame->height() == avtest::VideoHeight);
+                ++frames;
+            }
+            CHECK(frame.isAgain());
+        }
+        auto frame = dec.tryDecode(av::Packet{});
+        for (; frame; frame = dec.tryDecode())
+            ++frames;
+        CHECK(frame.isEof());
+        CHECK(frames == FRAMES);
+    }
+
+    SECTION("Errors are returned") {
+        av::VideoDecoderContext dec;
+        auto frame = dec.tryDecode(av::Packet{});
+        CHECK(frame.isError());
+        CHECK(frame.error() == av::Errors::CodecInvalid);
+
+        av::AudioResampler resampler;
+        CHECK(resampler.tryPop(1024).error() == av::Errors::ResamplerNotInited);
+        CHECK(resampler.tryPush(av::AudioSamples(nullptr)).error() == av::Errors::ResamplerNotInited);
+
+#if AVCPP_HAS_AVFORMAT
+        av::FormatContext ctx;
+        auto pkt = ctx.tryReadPacket();
+        CHECK(pkt.isError());
+        CHECK(pkt.error() == av::Errors::FormatNoStreams);
+        CHECK(ctx.tryWritePacket(av::Packet{}).error() == av::Errors::FormatNotOpened);
+#endif // if AVCPP_HAS_AVFORMAT
+    }
+}
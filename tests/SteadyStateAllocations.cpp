@@ -0,0 +1,232 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_message.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/audioresampler.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/frame.h"
+#include "avcpp/packet.h"
+#include "avcpp/videorescaler.h"
+
+#if AVCPP_HAS_AVFORMAT
+#include "avcpp/formatcontext.h"
+#endif // if AVCPP_HAS_AVFORMAT
+
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+#include "AllocationCounter.h"
+#include "TestMedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr size_t WARMUP = 8;
+constexpr size_t ITERATIONS = 32;
+
+// FFmpeg allocates AVPacket/AVFrame and AVBufferRef for every demuxed packet and decoded frame even with the buffer
+// pools: only the count is bounded for that paths
+constexpr size_t MAX_FFMPEG_CALLS = 32;
+
+struct Calls
+{
+    bool   ok = false;
+    size_t newCalls = 0;
+    size_t heapCalls = 0;
+};
+
+using Report = array<Calls, ITERATIONS>;
+
+// Catch2 macros allocate: check results outside of the counted scope
+template<typename Setup, typename Step>
+Report measure(Setup &&setup, Step &&step)
+{
+    Report report;
+    for (size_t i = 0; i < WARMUP + ITERATIONS; ++i) {
+        setup(i);
+        avtest::AllocationCounter counter;
+        auto const ok = step(i);
+        if (i >= WARMUP)
+            report[i - WARMUP] = {ok, counter.newCalls(), counter.heapCalls()};
+    }
+    return report;
+}
+
+void check_report(const Report &report, size_t maxHeapCalls)
+{
+    for (size_t i = 0; i < report.size(); ++i) {
+        INFO("iteration: " << i);
+        CHECK(report[i].ok);
+        CHECK(report[i].newCalls == 0);
+        if (avtest::AllocationCounter::isHeapHooked())
+            CHECK(report[i].heapCalls <= maxHeapCalls);
+    }
+}
+
+} // anonymous namespace
+
+TEST_CASE("AllocationCounter", "[AllocationCounter]")
+{
+    avtest::AllocationCounter outer;
+    {
+        avtest::AllocationCounter inner;
+        vector<int> values(100);
+        CHECK(inner.newCalls() == 1);
+    }
+    auto values = make_unique<int>(42);
+    CHECK(outer.newCalls() >= 1);
+
+    outer.reset();
+    CHECK(outer.total() == 0);
+
+    if (avtest::AllocationCounter::isHeapHooked()) {
+        avtest::AllocationCounter counter;
+        av_free(av_malloc(1024));
+        CHECK(counter.heapCalls() >= 1);
+        CHECK(counter.newCalls() == 0);
+    }
+}
+
+TEST_CASE("Steady state allocations", "[AllocationCounter][SteadyState]")
+{
+    SECTION("Rescale into preallocated frame") {
+        av::VideoRescaler rescaler;
+        av::VideoFrame dst{AV_PIX_FMT_RGB24, avtest::VideoWidth * 2, avtest::VideoHeight * 2};
+        auto const src = avtest::make_frame(0);
+        REQUIRE(dst.isValid());
+
+        auto report = measure([](size_t) {}, [&](size_t) {
+            std::error_code ec;
+            rescaler.rescale(dst, src, ec);
+            return !ec;
+        });
+        check_report(report, 0);
+    }
+
+    SECTION("Resampler pop into preallocated samples") {
+        av::AudioResampler resampler{AV_CH_LAYOUT_STEREO, 44100, AV_SAMPLE_FMT_FLTP,
+                                     AV_CH_LAYOUT_STEREO, 48000, AV_SAMPLE_FMT_S16};
+        av::AudioSamples src{AV_SAMPLE_FMT_S16, 1024, AV_CH_LAYOUT_STEREO, 48000};
+        av::AudioSamples dst{AV_SAMPLE_FMT_FLTP, 256, AV_CH_LAYOUT_STEREO, 44100};
+        REQUIRE(src.isValid());
+        REQUIRE(dst.isValid());
+        memset(src.data(), 0, src.size());
+
+        size_t popped = 0;
+        auto report = measure([&](size_t) {
+            resampler.push(src);
+        }, [&](size_t) {
+            std::error_code ec;
+            while (resampler.pop(dst, false, ec))
+                ++popped;
+            return !ec;
+        });
+        check_report(report, 0);
+        CHECK(popped > ITERATIONS);
+    }
+
+    SECTION("Decode") {
+        auto packets = avtest::encode_mpeg4(WARMUP + ITERATIONS);
+        REQUIRE(packets.size() == WARMUP + ITERATIONS);
+
+        av::VideoDecoderContext dec{av::findDecodingCodec(AV_CODEC_ID_MPEG4)};
+        dec.setWidth(avtest::VideoWidth);
+        dec.setHeight(avtest::VideoHeight);
+        dec.setTimeBase(av::Rational{1, 25});
+        // Frame threads keep own frames and queues
+        dec.setThreadCount(1);
+        dec.open();
+
+        auto report = measure([](size_t) {}, [&](size_t i) {
+            std::error_code ec;
+            auto frame = dec.decode(packets[i], ec);
+            return !ec && frame.isComplete();
+        });
+        check_report(report, MAX_FFMPEG_CALLS);
+    }
+
+    SECTION("Try decode and encode without output") {
+        av::VideoDecoderContext dec{av::findDecodingCodec(AV_CODEC_ID_MPEG4)};
+        dec.setWidth(avtest::VideoWidth);
+        dec.setHeight(avtest::VideoHeight);
+        dec.setTimeBase(av::Rational{1, 25});
+        dec.setThreadCount(1);
+        dec.open();
+
+        av::VideoEncoderContext enc{av::findEncodingCodec(AV_CODEC_ID_MPEG4)};
+        avtest::configure_mpeg4(enc);
+        enc.open();
+
+        // Nothing is pending: Again results must not touch the heap at all
+        auto report = measure([](size_t) {}, [&](size_t) {
+            return dec.tryDecode().isAgain() && enc.tryEncode().isAgain();
+        });
+        check_report(report, 0);
+    }
+
+    SECTION("Try decode loop") {
+        auto packets = avtest::encode_mpeg4(WARMUP + ITERATIONS);
+        REQUIRE(packets.size() == WARMUP + ITERATIONS);
+
+        av::VideoDecoderContext dec{av::findDecodingCodec(AV_CODEC_ID_MPEG4)};
+        dec.setWidth(avtest::VideoWidth);
+        dec.setHeight(avtest::VideoHeight);
+        dec.setTimeBase(av::Rational{1, 25});
+        dec.setThreadCount(1);
+        dec.open();
+
+        auto report = measure([](size_t) {}, [&](size_t i) {
+            auto frame = dec.tryDecode(packets[i]);
+            return frame.isOk() && dec.tryDecode().isAgain();
+        });
+        check_report(report, MAX_FFMPEG_CALLS);
+    }
+
+#if AVCPP_HAS_AVFORMAT
+    SECTION("Read packet") {
+        vector<uint8_t> stream;
+        for (auto &pkt : avtest::encode_mpeg4(WARMUP + ITERATIONS * 2))
+            stream.insert(stream.end(), pkt.data(), pkt.data() + pkt.size());
+        av::MemoryIO io{std::move(stream)};
+
+        av::FormatContext ictx;
+        ictx.openInput(&io, av::InputFormat("m4v"));
+        ictx.findStreamInfo();
+
+        auto report = measure([](size_t) {}, [&](size_t) {
+            std::error_code ec;
+            auto pkt = ictx.readPacket(ec);
+            return !ec && !pkt.isNull();
+        });
+        check_report(report, MAX_FFMPEG_CALLS);
+    }
+
+    SECTION("Try read packet") {
+        vector<uint8_t> stream;
+        for (auto &pkt : avtest::encode_mpeg4(WARMUP + ITERATIONS * 2))
+            stream.insert(stream.end(), pkt.data(), pkt.data() + pkt.size());
+        av::MemoryIO io{std::move(stream)};
+
+        av::FormatContext ictx;
+        ictx.openInput(&io, av::InputFormat("m4v"));
+        ictx.findStreamInfo();
+
+        auto report = measure([](size_t) {}, [&](size_t) {
+            return ictx.tryReadPacket().isOk();
+        });
+        check_report(report, MAX_FFMPEG_CALLS);
+    }
+#endif // if AVCPP_HAS_AVFORMAT
+}
@@ -0,0 +1,175 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/streamanalyzer.h"
+#include "avcpp/syntheticmedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+#if AVCPP_CXX_STANDARD >= 20
+
+using namespace std;
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+// Annex B H.264 access units with single slice: first_mb_in_slice = 0, slice_type = ue()
+const vector<uint8_t> h264Idr = {0, 0, 0, 1, 0x65, 0x88, 0x80};
+const vector<uint8_t> h264P   = {0, 0, 0, 1, 0x41, 0xc0, 0x80}; // slice_type 0
+const vector<uint8_t> h264B   = {0, 0, 0, 1, 0x01, 0xa0, 0x80}; // slice_type 1
+
+av::Packet make_packet(const vector<uint8_t> &payload, size_t padding, int64_t dts, bool key,
+                       const av::Rational &tb = {1, 25})
+{
+    auto data = payload;
+    data.resize(data.size() + padding, 0x55);
+    av::Packet pkt{data};
+    pkt.setStreamIndex(0);
+    pkt.setTimeBase(tb);
+    pkt.setDts({dts, tb});
+    pkt.setPts({dts, tb});
+    pkt.setDuration(1, tb);
+    pkt.setKeyPacket(key);
+    return pkt;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Stream analyzer", "[StreamAnalyzer]")
+{
+    SECTION("GOP, key interval and bitrate") {
+        av::StreamAnalyzer analyzer;
+        analyzer.addStream(0, AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_H264, {1, 25});
+
+        // 4 seconds, GOP 25 packets, IPB pattern
+        for (int i = 0; i < 100; ++i) {
+            auto const key = i % 25 == 0;
+            auto const &payload = key ? h264Idr : (i % 3 == 1 ? h264P : h264B);
+            analyzer.push(make_packet(payload, 93, i, key));
+        }
+
+        auto const sum = analyzer.summary(0);
+        CHECK(sum.streamIndex == 0);
+        CHECK(sum.packets == 100);
+        CHECK(sum.keyPackets == 4);
+        CHECK(sum.bytes == 100 * 100);
+        CHECK(sum.gops == 4);
+        CHECK(sum.minGop == 25);
+        CHECK(sum.maxGop == 25);
+        CHECK_THAT(sum.avgGop, WithinAbs(25.0, 1e-9));
+        CHECK_THAT(sum.avgKeyInterval, WithinAbs(1.0, 1e-9));
+        CHECK_THAT(sum.duration, WithinAbs(4.0, 1e-9));
+        CHECK_THAT(sum.avgBitrate, WithinAbs(20000.0, 1e-6));
+        CHECK_THAT(sum.minBitrate, WithinAbs(20000.0, 1e-6));
+        CHECK_THAT(sum.maxBitrate, WithinAbs(20000.0, 1e-6));
+        CHECK(sum.bitrateSeries.size() == 4);
+
+        CHECK(sum.minPacketSize == 100);
+        CHECK(sum.maxPacketSize == 100);
+        CHECK(sum.sizeHistogram[7] == 100); // [64, 128)
+        CHECK(sum.packetSizePercentile(0.5) == 100);
+
+        CHECK(sum.iPictures == 4);
+        CHECK(sum.pPictures == 32);
+        CHECK(sum.bPictures == 64);
+        CHECK(sum.unknownPictures == 0);
+    }
+
+    SECTION("Trailing GOP and unknown streams") {
+        av::StreamAnalyzer analyzer;
+        analyzer.setBitrateSeries(false);
+        for (int i = 0; i < 30; ++i)
+            analyzer.push(make_packet(h264P, 0, i, i == 0 || i == 20));
+
+        auto const sums = analyzer.summary();
+        REQUIRE(sums.size() == 1);
+        auto const &sum = sums.front();
+        CHECK(sum.mediaType == AVMEDIA_TYPE_UNKNOWN);
+        CHECK(sum.gops == 2);
+        CHECK(sum.minGop == 10);
+        CHECK(sum.maxGop == 20);
+        CHECK(sum.bitrateSeries.empty());
+        // Codec unknown: no picture type detection
+        CHECK(sum.pPictures == 0);
+        CHECK(sum.unknownPictures == 0);
+
+        CHECK(analyzer.summary(5).streamIndex == -1);
+    }
+
+    SECTION("Timestamp jumps do not grow the bitrate series") {
+        av::StreamAnalyzer analyzer;
+        analyzer.push(make_packet(h264P, 0, 0, true));
+        analyzer.push(make_packet(h264P, 0, 25, false));
+        // Corrupted DTS: years after the start
+        analyzer.push(make_packet(h264P, 0, int64_t(1) << 40, false));
+
+        auto const sum = analyzer.summary(0);
+        CHECK(sum.packets == 3);
+        CHECK(sum.outOfRangePackets == 1);
+        CHECK(sum.bitrateSeries.size() == 2);
+    }
+
+    SECTION("Reset") {
+        av::StreamAnalyzer analyzer;
+        analyzer.addStream(0, AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_H264, {1, 25});
+        analyzer.push(make_packet(h264Idr, 10, 0, true));
+        analyzer.reset();
+
+        auto const sum = analyzer.summary(0);
+        CHECK(sum.packets == 0);
+        CHECK(sum.codecId == AV_CODEC_ID_H264);
+    }
+}
+
+#if AVCPP_HAS_AVFORMAT
+TEST_CASE("Stream analyzer input", "[StreamAnalyzer]")
+{
+    av::SyntheticMedia::Options options;
+    options.duration         = std::chrono::seconds(4);
+    options.video.width      = 160;
+    options.video.height     = 120;
+    options.video.frameRate  = {25, 1};
+    options.gopSize          = 25;
+    options.videoBitRate     = 200'000;
+
+    av::MemoryIO io;
+    av::SyntheticMedia::generate(&io, options);
+    io.rewind();
+
+    av::FormatContext ictx;
+    ictx.openInput(&io);
+    ictx.findStreamInfo();
+
+    auto const sums = av::StreamAnalyzer::analyze(ictx);
+    REQUIRE(sums.size() == 2);
+
+    auto const video = std::find_if(sums.begin(), sums.end(), [](auto const &sum) {
+        return sum.mediaType == AVMEDIA_TYPE_VIDEO;
+    });
+    REQUIRE(video != sums.end());
+    CHECK(video->codecId == AV_CODEC_ID_MPEG4);
+    CHECK(video->packets == 100);
+    CHECK(video->keyPackets == 4);
+    CHECK(video->maxGop == 25);
+    CHECK_THAT(video->avgKeyInterval, WithinAbs(1.0, 1e-3));
+    CHECK_THAT(video->duration, WithinAbs(4.0, 0.05));
+    CHECK(video->avgBitrate > 0.0);
+
+    auto const audio = std::find_if(sums.begin(), sums.end(), [](auto const &sum) {
+        return sum.mediaType == AVMEDIA_TYPE_AUDIO;
+    });
+    REQUIRE(audio != sums.end());
+    CHECK(audio->codecId == AV_CODEC_ID_AAC);
+    CHECK(audio->packets > 0);
+    CHECK(audio->keyPackets == audio->packets);
+}
+#endif // AVCPP_HAS_AVFORMAT
+
+#endif // AVCPP_CXX_STANDARD >= 20
@@ -0,0 +1,223 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/syntheticmedia.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+namespace {
+
+vector<uint8_t> plane_bytes(const av::VideoFrame &frame, size_t plane, int width, int height)
+{
+    vector<uint8_t> out;
+    for (int y = 0; y < height; ++y) {
+        auto line = frame.raw()->data[plane] + y * frame.raw()->linesize[plane];
+        out.insert(out.end(), line, line + width);
+    }
+    return out;
+}
+
+size_t differences(const vector<uint8_t> &lhs, const vector<uint8_t> &rhs)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < std::min(lhs.size(), rhs.size()); ++i)
+        count += lhs[i] != rhs[i];
+    return count;
+}
+
+} // anonymous namespace
+
+TEST_CASE("SyntheticVideo", "[SyntheticMedia]")
+{
+    av::SyntheticVideo::Options options;
+    options.width       = 64;
+    options.height      = 48;
+    options.sceneLength = 10;
+    options.seed        = 42;
+
+    SECTION("Frames are reproducible") {
+        av::SyntheticVideo first{options}, second{options};
+        second.seek(5);
+        auto const a = first.frame(5);
+        auto const b = second.next();
+        REQUIRE(a.isValid());
+        CHECK(a.width() == 64);
+        CHECK(a.height() == 48);
+        CHECK(a.pixelFormat() == AV_PIX_FMT_YUV420P);
+        CHECK(a.pts() == av::Timestamp(5, av::Rational(1, 25)));
+        CHECK(second.position() == 6);
+        CHECK(plane_bytes(a, 0, 64, 48) == plane_bytes(b, 0, 64, 48));
+
+        options.seed = 43;
+        av::SyntheticVideo other{options};
+        CHECK(plane_bytes(a, 0, 64, 48) != plane_bytes(other.frame(5), 0, 64, 48));
+    }
+
+    SECTION("Motion and scene cuts") {
+        options.noise = 0;
+        av::SyntheticVideo video{options};
+        CHECK_FALSE(video.isSceneCut(0));
+        CHECK_FALSE(video.isSceneCut(9));
+        CHECK(video.isSceneCut(10));
+
+        auto const f8  = plane_bytes(video.frame(8), 1, 32, 24);
+        auto const f9  = plane_bytes(video.frame(9), 1, 32, 24);
+        auto const f10 = plane_bytes(video.frame(10), 1, 32, 24);
+        // Colors are kept inside of the scene and changed on the cut
+        CHECK(f8 == f9);
+        CHECK(f9 != f10);
+        // Gradient moves
+        CHECK(differences(plane_bytes(video.frame(8), 0, 64, 48), plane_bytes(video.frame(9), 0, 64, 48)) > 0);
+    }
+
+    SECTION("Pixel format conversion") {
+        options.pixelFormat = AV_PIX_FMT_RGB24;
+        av::SyntheticVideo video{options};
+        auto const frame = video.next();
+        REQUIRE(frame.isValid());
+        CHECK(frame.pixelFormat() == AV_PIX_FMT_RGB24);
+    }
+
+    SECTION("Invalid options") {
+        options.width = 0;
+        av::SyntheticVideo video{options};
+        std::error_code ec;
+        CHECK_FALSE(video.next(ec));
+        CHECK(ec == av::Errors::InvalidArgument);
+        CHECK(video.position() == 0);
+    }
+}
+
+TEST_CASE("SyntheticAudio", "[SyntheticMedia]")
+{
+    av::SyntheticAudio::Options options;
+    options.sampleRate   = 8000;
+    options.frequency    = 1000;
+    options.amplitude    = 1.0;
+    options.sampleFormat = AV_SAMPLE_FMT_FLTP;
+
+    SECTION("Tone") {
+        av::SyntheticAudio audio{options};
+        auto const samples = audio.next();
+        REQUIRE(samples.isValid());
+        CHECK(samples.samplesCount() == 1024);
+        CHECK(samples.channelsCount() == 2);
+        CHECK(audio.position() == 1024);
+
+        // 8 samples per period, second channel - twice frequency
+        auto left  = reinterpret_cast<const float*>(samples.data(0));
+        auto right = reinterpret_cast<const float*>(samples.data(1));
+        CHECK(left[0] == 0.0f);
+        CHECK(left[2] > 0.99f);
+        CHECK(left[6] < -0.99f);
+        CHECK(right[1] > 0.99f);
+
+        // Random access gives the same signal
+        auto const tail = audio.samples(2, 4);
+        CHECK(memcmp(tail.data(0), left + 2, 4 * sizeof(float)) == 0);
+    }
+
+    SECTION("Noise and silence in packed format") {
+        options.signal       = av::SyntheticAudio::Signal::Noise;
+        options.sampleFormat = AV_SAMPLE_FMT_S16;
+        av::SyntheticAudio noise{options}, same{options};
+        auto const a = noise.next();
+        auto const b = same.next();
+        REQUIRE(a.isValid());
+        CHECK(memcmp(a.data(), b.data(), 1024 * 2 * sizeof(int16_t)) == 0);
+
+        auto samples = reinterpret_cast<const int16_t*>(a.data());
+        size_t zeros = 0;
+        for (size_t i = 0; i < 1024 * 2; ++i)
+            zeros += samples[i] == 0;
+        CHECK(zeros < 16);
+
+        options.signal = av::SyntheticAudio::Signal::Silence;
+        av::SyntheticAudio silence{options};
+        auto const quiet = silence.next();
+        samples = reinterpret_cast<const int16_t*>(quiet.data());
+        CHECK(std::all_of(samples, samples + 1024 * 2, [](int16_t v) { return v == 0; }));
+    }
+}
+
+#if AVCPP_HAS_AVFORMAT
+TEST_CASE("SyntheticMedia", "[SyntheticMedia]")
+{
+    av::SyntheticMedia::Options options;
+    options.duration          = std::chrono::seconds(2);
+    options.video.width       = 160;
+    options.video.height      = 120;
+    options.video.sceneLength = 20;
+    options.videoBitRate      = 400'000;
+
+    SECTION("Matroska in memory") {
+        av::MemoryIO io;
+        av::SyntheticMedia::generate(&io, options);
+        REQUIRE(io.data().size() > 1000);
+        io.rewind();
+
+        av::FormatContext ictx;
+        ictx.openInput(&io);
+        ictx.findStreamInfo();
+        REQUIRE(ictx.streamsCount() == 2);
+
+        size_t videoIndex = 0;
+        for (size_t i = 0; i < ictx.streamsCount(); ++i) {
+            if (ictx.stream(i).isVideo())
+                videoIndex = i;
+        }
+        av::VideoDecoderContext vdec{ictx.stream(videoIndex)};
+        vdec.open();
+
+        size_t videoFrames = 0, audioPackets = 0;
+        while (auto pkt = ictx.readPacket()) {
+            if (size_t(pkt.streamIndex()) != videoIndex) {
+                ++audioPackets;
+                continue;
+            }
+            auto frame = vdec.decode(pkt);
+            if (frame) {
+                CHECK(frame.width() == 160);
+                CHECK(frame.height() == 120);
+                ++videoFrames;
+            }
+        }
+        while (vdec.decode(av::Packet{}))
+            ++videoFrames;
+
+        CHECK(videoFrames == 50);
+        CHECK(audioPackets >= 2 * 48000 / 1024);
+    }
+
+    SECTION("Output is reproducible") {
+        options.hasAudio = false;
+        options.format   = "nut";
+        auto const first  = av::SyntheticMedia::generate(options);
+        auto const second = av::SyntheticMedia::generate(options);
+        REQUIRE_FALSE(first.empty());
+        CHECK(first == second);
+    }
+
+    SECTION("Errors") {
+        std::error_code ec;
+        options.format = "no-such-muxer";
+        CHECK(av::SyntheticMedia::generate(options, ec).empty());
+        CHECK(ec == av::Errors::FormatNullOutputFormat);
+
+        options.format   = "matroska";
+        options.hasVideo = false;
+        options.hasAudio = false;
+        av::SyntheticMedia::generate(options, ec);
+        CHECK(ec == av::Errors::InvalidArgument);
+    }
+}
+#endif // if AVCPP_HAS_AVFORMAT
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "avcpp/codec.h"
+#include "avcpp/codeccontext.h"
+#include "avcpp/frame.h"
+#include "avcpp/packet.h"
+#include "avcpp/syntheticmedia.h"
+
+namespace avtest {
+
+/**
+ * Small video shared by the codec tests: frames of the SyntheticVideo encoded by MPEG-4 without B frames, so packet
+ * order is the frame order.
+ */
+constexpr int VideoWidth  = 64;
+constexpr int VideoHeight = 48;
+
+inline av::SyntheticVideo::Options video_options()
+{
+    av::SyntheticVideo::Options options;
+    options.width       = VideoWidth;
+    options.height      = VideoHeight;
+    options.pixelFormat = AV_PIX_FMT_YUV420P;
+    options.frameRate   = av::Rational{25, 1};
+    return options;
+}
+
+/**
+ * YUV420P frame with given index, time base 1/25, pts is the index
+ */
+inline av::VideoFrame make_frame(size_t index)
+{
+    thread_local av::SyntheticVideo video{video_options()};
+    return video.frame(index);
+}
+
+inline void configure_mpeg4(av::VideoEncoderContext &enc)
+{
+    enc.setWidth(VideoWidth);
+    enc.setHeight(VideoHeight);
+    enc.setPixelFormat(AV_PIX_FMT_YUV420P);
+    enc.setTimeBase(av::Rational{1, 25});
+    enc.setGopSize(12);
+    enc.setMaxBFrames(0);
+}
+
+/**
+ * Encode first count frames, encoder is drained
+ */
+inline std::vector<av::Packet> encode_mpeg4(size_t count)
+{
+    av::VideoEncoderContext enc{av::findEncodingCodec(AV_CODEC_ID_MPEG4)};
+    configure_mpeg4(enc);
+    enc.open();
+
+    std::vector<av::Packet> packets;
+    for (size_t i = 0; i < count; ++i) {
+        auto pkt = enc.encode(make_frame(i));
+        if (pkt)
+            packets.push_back(std::move(pkt));
+    }
+    while (auto pkt = enc.encode())
+        packets.push_back(std::move(pkt));
+    return packets;
+}
+
+} // namespace avtest
@@ -0,0 +1,120 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/tracing.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+TEST_CASE("Tracer", "[Tracing]")
+{
+    SECTION("Disabled tracer records nothing") {
+        av::Tracer::start();
+        av::Tracer::stop();
+        {
+            av::TraceSpan span{"test"};
+        }
+        CHECK(av::Tracer::collect().empty());
+    }
+
+    SECTION("Spans carry stream and pts") {
+        av::Tracer::start();
+        {
+            av::TraceSpan outer{"outer"};
+            av::TraceSpan inner{"inner", 1, 42};
+        }
+        {
+            av::TraceSpan late{"late"};
+            late.setStream(0, 7);
+        }
+        av::Tracer::stop();
+
+        auto events = av::Tracer::collect();
+        REQUIRE(events.size() == 3);
+        CHECK(string(events[0].name) == "outer");
+        CHECK(events[0].streamIndex == -1);
+        CHECK(events[0].pts == av::NoPts);
+        CHECK(string(events[1].name) == "inner");
+        CHECK(events[1].streamIndex == 1);
+        CHECK(events[1].pts == 42);
+        CHECK(events[1].start >= events[0].start);
+        CHECK(events[1].start + events[1].duration <= events[0].start + events[0].duration);
+        CHECK(string(events[2].name) == "late");
+        CHECK(events[2].streamIndex == 0);
+        CHECK(events[2].pts == 7);
+    }
+
+    SECTION("Ring keeps last spans") {
+        av::Tracer::start(4);
+        for (int i = 0; i < 10; ++i) {
+            av::TraceSpan span{"span", 0, i};
+        }
+        av::Tracer::stop();
+
+        auto events = av::Tracer::collect();
+        REQUIRE(events.size() == 4);
+        CHECK(events.front().pts == 6);
+        CHECK(events.back().pts == 9);
+    }
+
+    SECTION("Threads and restart") {
+        av::Tracer::start(16);
+        {
+            av::TraceSpan span{"old"};
+        }
+
+        // Previous spans are dropped
+        av::Tracer::start(1024);
+        av::Tracer::setThreadName("main");
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([t] {
+                for (int i = 0; i < 100; ++i) {
+                    av::TraceSpan span{"worker", t, i};
+                }
+            });
+        }
+        // Collect while writing
+        while (av::Tracer::collect().size() < 100)
+            this_thread::yield();
+        for (auto &th : threads)
+            th.join();
+        {
+            av::TraceSpan span{"main"};
+        }
+        av::Tracer::stop();
+
+        auto events = av::Tracer::collect();
+        CHECK(events.size() == 401);
+        CHECK(std::none_of(events.begin(), events.end(), [](auto const &ev) { return string(ev.name) == "old"; }));
+        CHECK(std::is_sorted(events.begin(), events.end(), [](auto const &lhs, auto const &rhs) {
+            return lhs.start < rhs.start;
+        }));
+
+        auto json = av::Tracer::toChromeJson(events);
+        CHECK(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+        CHECK(json.find("{\"name\":\"thread_name\",\"ph\":\"M\"") != string::npos);
+        CHECK(json.find("\"args\":{\"name\":\"main\"}") != string::npos);
+        CHECK(json.find("\"name\":\"worker\",\"cat\":\"avcpp\",\"ph\":\"X\"") != string::npos);
+        CHECK(json.find("\"args\":{\"stream\":3,\"pts\":99}") != string::npos);
+        CHECK(json.substr(json.size() - 2) == "]}");
+    }
+
+    SECTION("Chrome JSON format") {
+        vector<av::TraceEvent> events(1);
+        events[0].name     = "read";
+        events[0].start    = 1234567;
+        events[0].duration = 1005;
+        events[0].thread   = 99;
+        CHECK(av::Tracer::toChromeJson(events) ==
+              "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["
+              "{\"name\":\"read\",\"cat\":\"avcpp\",\"ph\":\"X\",\"ts\":1234.567,\"dur\":1.005,\"pid\":1,\"tid\":99}]}");
+    }
+}
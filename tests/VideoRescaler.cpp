@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "avcpp/avconfig.h"
+#include "avcpp/videorescaler.h"
+
+#ifdef _MSC_VER
+# pragma warning (disable : 4702) // Disable warning: unreachable code
+#endif
+
+using namespace std;
+
+TEST_CASE("VideoRescaler context cache", "[VideoRescaler]")
+{
+    av::VideoFrame const hd{AV_PIX_FMT_YUV420P, 1280, 720};
+    av::VideoFrame const sd{AV_PIX_FMT_YUV420P, 640, 360};
+    av::VideoFrame const ld{AV_PIX_FMT_YUV420P, 320, 180};
+
+    SECTION("Switching back uses cached context") {
+        av::VideoRescaler rescaler{160, 90, AV_PIX_FMT_YUV420P};
+        CHECK(rescaler.contextCacheSize() == av::VideoRescaler::DefaultContextCacheSize);
+
+        rescaler.rescale(hd);
+        auto const hdContext = rescaler.raw();
+        rescaler.rescale(hd);
+        CHECK(rescaler.contextCacheMisses() == 1);
+        CHECK(rescaler.contextCacheHits() == 0);
+
+        rescaler.rescale(sd);
+        CHECK(rescaler.contextCacheMisses() == 2);
+        CHECK(rescaler.raw() != hdContext);
+
+        // Rendition switch back
+        rescaler.rescale(hd);
+        CHECK(rescaler.contextCacheMisses() == 2);
+        CHECK(rescaler.contextCacheHits() == 1);
+        CHECK(rescaler.raw() == hdContext);
+    }
+
+    SECTION("LRU eviction") {
+        av::VideoRescaler rescaler{160, 90, AV_PIX_FMT_YUV420P};
+        rescaler.setContextCacheSize(2);
+
+        rescaler.rescale(hd);
+        rescaler.rescale(sd);
+        rescaler.rescale(ld); // hd is evicted
+        CHECK(rescaler.contextCacheMisses() == 3);
+
+        rescaler.rescale(sd);
+        CHECK(rescaler.contextCacheHits() == 1);
+        rescaler.rescale(hd);
+        CHECK(rescaler.contextCacheMisses() == 4);
+    }
+
+    SECTION("Single context") {
+        av::VideoRescaler rescaler{160, 90, AV_PIX_FMT_YUV420P};
+        rescaler.rescale(hd);
+        rescaler.rescale(sd);
+        rescaler.setContextCacheSize(1);
+        REQUIRE(rescaler.isValid());
+
+        rescaler.rescale(hd);
+        rescaler.rescale(sd);
+        CHECK(rescaler.contextCacheMisses() == 4);
+        CHECK(rescaler.contextCacheHits() == 0);
+    }
+
+    SECTION("Copy and move") {
+        av::VideoRescaler rescaler{160, 90, AV_PIX_FMT_YUV420P};
+        rescaler.setContextCacheSize(3);
+        rescaler.rescale(hd);
+
+        av::VideoRescaler copy{rescaler};
+        CHECK(copy.contextCacheSize() == 3);
+        CHECK(copy.isValid());
+        CHECK(copy.raw() != rescaler.raw());
+
+        auto const context = rescaler.raw();
+        av::VideoRescaler moved{std::move(rescaler)};
+        CHECK(moved.raw() == context);
+        CHECK(moved.contextCacheMisses() == 1);
+        moved.rescale(hd);
+        CHECK(moved.contextCacheMisses() == 1);
+    }
+}